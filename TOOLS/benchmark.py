@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+
+"""
+Run mpv's benchmark mode over a small set of generated test media, and merge
+the per-run reports into a single JSON document.
+
+The test media is generated with the ffmpeg command line tool on the first
+run, and reused afterwards. Each case plays one file with a fixed set of
+options, so that the numbers can be compared between builds.
+
+Usage:
+
+    TOOLS/benchmark.py [--mpv=build/mpv] [--media=build/benchmark]
+                       [--output=build/benchmark/report.json]
+"""
+
+import json
+import os
+import subprocess
+import sys
+from optparse import OptionParser
+
+# name -> ffmpeg arguments to create it
+MEDIA = [
+    ("h264-720p.mkv",
+     ["-f", "lavfi", "-i", "testsrc=size=1280x720:rate=30:duration=20",
+      "-f", "lavfi", "-i", "sine=frequency=440:sample_rate=48000:duration=20",
+      "-c:v", "libx264", "-preset", "veryfast", "-pix_fmt", "yuv420p",
+      "-c:a", "aac", "-strict", "experimental", "-ac", "2"]),
+    ("mpeg4-480p.avi",
+     ["-f", "lavfi", "-i", "testsrc=size=854x480:rate=25:duration=20",
+      "-c:v", "mpeg4", "-q:v", "4", "-an"]),
+    ("interlaced-576i.mkv",
+     ["-f", "lavfi", "-i", "testsrc=size=720x576:rate=50:duration=20",
+      "-vf", "interlace", "-c:v", "mpeg2video", "-q:v", "4", "-an"]),
+    ("flac-stereo.flac",
+     ["-f", "lavfi", "-i", "sine=frequency=1000:sample_rate=96000:duration=60",
+      "-ac", "2", "-c:a", "flac"]),
+    ("pcm-surround.wav",
+     ["-f", "lavfi", "-i", "sine=frequency=220:sample_rate=48000:duration=60",
+      "-ac", "6", "-c:a", "pcm_s16le"]),
+]
+
+# name -> (media file, extra mpv options)
+# "{media}" in the options is replaced with the media directory.
+CASES = [
+    ("demux-decode-h264", "h264-720p.mkv", []),
+    ("demux-decode-mpeg4", "mpeg4-480p.avi", []),
+    ("vf-chain", "mpeg4-480p.avi", ["--vf=scale=1280:720,format=rgb24"]),
+    ("vf-yadif", "interlaced-576i.mkv", ["--vf=yadif"]),
+    ("vf-eq", "mpeg4-480p.avi", ["--vf=eq=contrast=1.2:brightness=0.1"]),
+    ("vf-eq-gamma", "mpeg4-480p.avi", ["--vf=eq=gamma=1.5"]),
+    ("vf-unsharp", "mpeg4-480p.avi", ["--vf=unsharp=lavfi=no"]),
+    ("vf-noise", "mpeg4-480p.avi", ["--vf=noise=strength=20:lavfi=no"]),
+    ("vf-noise-avg", "mpeg4-480p.avi",
+     ["--vf=noise=strength=20:averaged:lavfi=no"]),
+    ("vf-interpolate", "mpeg4-480p.avi", ["--vf=interpolate=fps=60"]),
+    ("vf-interpolate-mci", "mpeg4-480p.avi",
+     ["--vf=interpolate=fps=60:mode=mci"]),
+    # Per-frame overhead of the libavfilter bridge
+    ("vf-lavfi-null", "mpeg4-480p.avi", ["--vf=lavfi=graph=null"]),
+    ("af-lavfi-null", "flac-stereo.flac", ["--af=lavfi=graph=anull"]),
+    ("af-resample", "flac-stereo.flac", ["--af=lavrresample", "--srate=44100"]),
+    ("af-downmix", "pcm-surround.wav", ["--channels=2"]),
+    ("cache", "h264-720p.mkv", ["--cache=8192"]),
+    ("thumbnails", "h264-720p.mkv",
+     ["--thumbnail-atlas={media}/thumbnails.png", "--thumbnail-count=25"]),
+]
+
+def generate_media(ffmpeg, media_dir):
+    if not os.path.isdir(media_dir):
+        os.makedirs(media_dir)
+    for name, args in MEDIA:
+        path = os.path.join(media_dir, name)
+        if os.path.exists(path):
+            continue
+        print("generating %s" % name)
+        subprocess.check_call([ffmpeg, "-v", "error", "-y"] + args + [path])
+
+def run_case(mpv, media_dir, name, media, opts):
+    report = os.path.join(media_dir, name + ".json")
+    if os.path.exists(report):
+        os.remove(report)
+    opts = [o.replace("{media}", media_dir) for o in opts]
+    cmd = [mpv, "--no-config", "--really-quiet", "--benchmark=" + report] \
+        + opts + [os.path.join(media_dir, media)]
+    rc = subprocess.call(cmd)
+    if rc != 0 or not os.path.exists(report):
+        print("%s: mpv failed (exit code %d)" % (name, rc))
+        return None
+    with open(report) as f:
+        return json.load(f)
+
+def main():
+    parser = OptionParser()
+    parser.add_option("--mpv", default=os.path.join("build", "mpv"))
+    parser.add_option("--ffmpeg", default="ffmpeg")
+    parser.add_option("--media", default=os.path.join("build", "benchmark"))
+    parser.add_option("--output", default=None)
+    (options, args) = parser.parse_args()
+    output = options.output or os.path.join(options.media, "report.json")
+
+    generate_media(options.ffmpeg, options.media)
+
+    results = {}
+    failed = False
+    for name, media, opts in CASES:
+        if args and name not in args:
+            continue
+        report = run_case(options.mpv, options.media, name, media, opts)
+        if report is None:
+            failed = True
+            continue
+        results[name] = report
+        print("%-20s %8.3fs wall %8.3fs cpu" % (name, report["wall_time"],
+              report["cpu_time"]["user"] + report["cpu_time"]["system"]))
+        for f in report["files"]:
+            if f.get("thumbnails_per_sec") is not None:
+                print("    %d thumbnails %8.1f thumbnails/s" %
+                      (f["thumbnails"], f["thumbnails_per_sec"]))
+            for vf in f.get("video_filters", []):
+                if vf["mpix_per_sec"] is not None:
+                    print("    vf %-15s %8.1f Mpix/s %8.1f us/frame" %
+                          (vf["name"], vf["mpix_per_sec"], vf["us_per_frame"]))
+            for af in f.get("audio_filters", []):
+                if af["us_per_call"] is not None:
+                    print("    af %-15s %8.1f us/call" % (af["name"],
+                                                         af["us_per_call"]))
+
+    with open(output, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+    print("report written to %s" % output)
+    return 1 if failed else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
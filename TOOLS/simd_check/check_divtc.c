@@ -0,0 +1,56 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "video/filter/vf_divtc.c"
+
+#include "simd_check.h"
+
+typedef int (*diff_fn)(unsigned char *old, unsigned char *new, int os, int ns);
+
+static void check_impl(enum impl impl, diff_fn fn)
+{
+    static uint8_t old[8 * 64], new[8 * 64];
+
+    if (!fn || !impl_supported(impl))
+        return;
+
+    for (int run = 0; run < NUM_RUNS; run++) {
+        int os = rnd_range(8, 64), ns = rnd_range(8, 64);
+        int ox = rnd_range(0, os - 8), nx = rnd_range(0, ns - 8);
+        char params[40];
+
+        fill_random(old, sizeof(old), run);
+        fill_random(new, sizeof(new), run);
+
+        snprintf(params, sizeof(params), "os=%d ns=%d", os, ns);
+        if (!check_int("divtc diff", impl, diff_C(old + ox, new + nx, os, ns),
+                       fn(old + ox, new + nx, os, ns), params))
+            break;
+    }
+    report_kernel("divtc diff", impl);
+}
+
+void check_divtc(void)
+{
+#if HAVE_X86_INTRINSICS
+    check_impl(IMPL_SSE2, diff_SSE2);
+    check_impl(IMPL_AVX2, diff_AVX2);
+#endif
+#if HAVE_NEON_INTRINSICS
+    check_impl(IMPL_NEON, diff_NEON);
+#endif
+}
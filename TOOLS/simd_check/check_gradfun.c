@@ -0,0 +1,259 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "video/filter/vf_gradfun.c"
+
+#include "simd_check.h"
+
+#define MAX_W 300
+#define MAX_H 100
+#define PAD 64
+
+struct impl_funcs {
+    void (*filter_line)(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                        int width, int thresh, const uint16_t *dithers);
+    void (*blur_line)(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
+                      uint8_t *src, int sstride, int width);
+    void (*filter_line16)(uint16_t *dst, uint16_t *src, uint32_t *dc,
+                          int width, int thresh, const uint16_t *dithers,
+                          int depth);
+    void (*blur_line16)(uint32_t *dc, uint32_t *buf, uint32_t *buf1,
+                        uint16_t *src, int sstride, int width);
+};
+
+static const struct impl_funcs funcs_c = {
+    filter_line_c, blur_line_c, filter_line16_c, blur_line16_c,
+};
+
+// Random samples of the given bit depth; smooth (where the filter actually
+// changes something) for odd runs.
+static void fill_samples(uint16_t *buf, size_t n, int depth, int run)
+{
+    int maxval = (1 << depth) - 1;
+    int base = rnd_range(0, maxval);
+    int spread = 1 << (depth - 5);
+    for (size_t i = 0; i < n; i++) {
+        int v = run % 2 ? base + rnd_range(-spread, spread)
+                        : rnd_range(0, maxval);
+        buf[i] = MPCLAMP(v, 0, maxval);
+    }
+}
+
+static int random_thresh(void)
+{
+    // vf_open(): (1<<15)/av_clipf(thresh,0.51,255)
+    return rnd_range((1 << 15) / 255, (1 << 15) * 100 / 51);
+}
+
+static int random_depth(int run)
+{
+    return run % 3 == 0 ? 16 : rnd_range(9, 16);
+}
+
+static void check_lines(enum impl impl, const struct impl_funcs *f)
+{
+    static uint16_t src[2 * (2 * MAX_W + PAD)], dc16[MAX_W + PAD];
+    static uint16_t buf_c[MAX_W + PAD], buf_simd[MAX_W + PAD];
+    static uint16_t dc_c[MAX_W + PAD], dc_simd[MAX_W + PAD];
+    static uint16_t out_c[MAX_W + PAD], out_simd[MAX_W + PAD];
+    static uint32_t dc32[MAX_W + PAD], buf1_32[MAX_W + PAD];
+    static uint32_t buf32_c[MAX_W + PAD], buf32_simd[MAX_W + PAD];
+    static uint32_t dc32_c[MAX_W + PAD], dc32_simd[MAX_W + PAD];
+    static uint8_t src8[2 * (2 * MAX_W + PAD)];
+    static uint8_t out8_c[MAX_W + PAD], out8_simd[MAX_W + PAD];
+    char params[80];
+    int run;
+
+    if (f->filter_line) {
+        for (run = 0; run < NUM_RUNS; run++) {
+            int w = run < MAX_W ? run + 1 : rnd_range(1, MAX_W);
+            int thresh = random_thresh();
+            const uint16_t *dith = dither[run & 7];
+            fill_random(src8, sizeof(src8), run);
+            // dc is the block average in 9.7 fixed point, as in FILTER_SLICE().
+            for (int x = 0; x < MAX_W + PAD; x++) {
+                int v = (src8[x] << 7) + rnd_range(-256, 256);
+                dc16[x] = MPCLAMP(v, 0, 255 << 7);
+            }
+            fill_random(out8_c, sizeof(out8_c), 0);
+            memcpy(out8_simd, out8_c, sizeof(out8_c));
+            filter_line_c(out8_c, src8, dc16, w, thresh, dith);
+            f->filter_line(out8_simd, src8, dc16, w, thresh, dith);
+            snprintf(params, sizeof(params), "w=%d thresh=%d", w, thresh);
+            if (!check_bytes("gradfun filter_line", impl, out8_c, out8_simd,
+                             sizeof(out8_c), params))
+                break;
+        }
+        report_kernel("gradfun filter_line", impl);
+    }
+
+    if (f->blur_line) {
+        for (run = 0; run < NUM_RUNS; run++) {
+            int w = run < MAX_W ? run + 1 : rnd_range(1, MAX_W);
+            int sstride = 2 * w + rnd_range(0, PAD);
+            fill_random(src8, sizeof(src8), run);
+            for (int x = 0; x < MAX_W + PAD; x++) {
+                dc16[x] = rnd();
+                buf_c[x] = buf_simd[x] = rnd();
+                dc_c[x] = dc_simd[x] = rnd();
+            }
+            blur_line_c(dc_c, buf_c, dc16, src8, sstride, w);
+            f->blur_line(dc_simd, buf_simd, dc16, src8, sstride, w);
+            snprintf(params, sizeof(params), "w=%d sstride=%d", w, sstride);
+            if (!check_bytes("gradfun blur_line", impl, (uint8_t *)buf_c,
+                             (uint8_t *)buf_simd, sizeof(buf_c), params) ||
+                !check_bytes("gradfun blur_line", impl, (uint8_t *)dc_c,
+                             (uint8_t *)dc_simd, sizeof(dc_c), params))
+                break;
+        }
+        report_kernel("gradfun blur_line", impl);
+    }
+
+    if (f->filter_line16) {
+        for (run = 0; run < NUM_RUNS; run++) {
+            int w = run < MAX_W ? run + 1 : rnd_range(1, MAX_W);
+            int depth = random_depth(run);
+            int thresh = random_thresh();
+            const uint16_t *dith = dither[run & 7];
+            fill_samples(src, MAX_W + PAD, depth, run);
+            for (int x = 0; x < MAX_W + PAD; x++) {
+                int v = (src[x] << 7) + rnd_range(-(1 << depth), 1 << depth);
+                dc32[x] = MPCLAMP(v, 0, ((1 << depth) - 1) << 7);
+            }
+            fill_random((uint8_t *)out_c, sizeof(out_c), 0);
+            memcpy(out_simd, out_c, sizeof(out_c));
+            filter_line16_c(out_c, src, dc32, w, thresh, dith, depth);
+            f->filter_line16(out_simd, src, dc32, w, thresh, dith, depth);
+            snprintf(params, sizeof(params), "w=%d depth=%d thresh=%d",
+                     w, depth, thresh);
+            if (!check_bytes("gradfun filter_line16", impl, (uint8_t *)out_c,
+                             (uint8_t *)out_simd, sizeof(out_c), params))
+                break;
+        }
+        report_kernel("gradfun filter_line16", impl);
+    }
+
+    if (f->blur_line16) {
+        for (run = 0; run < NUM_RUNS; run++) {
+            int w = run < MAX_W ? run + 1 : rnd_range(1, MAX_W);
+            int depth = random_depth(run);
+            int sstride = 2 * w + rnd_range(0, PAD);
+            fill_samples(src, sizeof(src) / sizeof(src[0]), depth, run);
+            for (int x = 0; x < MAX_W + PAD; x++) {
+                buf1_32[x] = rnd();
+                buf32_c[x] = buf32_simd[x] = rnd();
+                dc32_c[x] = dc32_simd[x] = rnd();
+            }
+            blur_line16_c(dc32_c, buf32_c, buf1_32, src, sstride, w);
+            f->blur_line16(dc32_simd, buf32_simd, buf1_32, src, sstride, w);
+            snprintf(params, sizeof(params), "w=%d depth=%d sstride=%d",
+                     w, depth, sstride);
+            if (!check_bytes("gradfun blur_line16", impl, (uint8_t *)buf32_c,
+                             (uint8_t *)buf32_simd, sizeof(buf32_c), params) ||
+                !check_bytes("gradfun blur_line16", impl, (uint8_t *)dc32_c,
+                             (uint8_t *)dc32_simd, sizeof(dc32_c), params))
+                break;
+        }
+        report_kernel("gradfun blur_line16", impl);
+    }
+}
+
+// Filter whole planes with all C functions and with the SIMD ones. This
+// covers odd widths and heights, and the dc values the filter really uses.
+static void check_planes(enum impl impl, const struct impl_funcs *f)
+{
+    static uint16_t src[MAX_H * (MAX_W + PAD)];
+    static uint16_t dst_c[MAX_H * (MAX_W + PAD)], dst_simd[MAX_H * (MAX_W + PAD)];
+    static uint32_t sbuf_c[(MAX_W + 16) / 2 * 34 + 32];
+    static uint32_t sbuf_simd[(MAX_W + 16) / 2 * 34 + 32];
+    static uint8_t src8[MAX_H * (MAX_W + PAD)];
+    static uint8_t dst8_c[MAX_H * (MAX_W + PAD)], dst8_simd[MAX_H * (MAX_W + PAD)];
+    struct vf_priv_s ctx_c = {
+        .filter_line = funcs_c.filter_line,
+        .blur_line = funcs_c.blur_line,
+        .filter_line16 = funcs_c.filter_line16,
+        .blur_line16 = funcs_c.blur_line16,
+    };
+    // Functions without SIMD version stay C.
+    struct vf_priv_s ctx_simd = {
+        .filter_line = f->filter_line ? f->filter_line : funcs_c.filter_line,
+        .blur_line = f->blur_line ? f->blur_line : funcs_c.blur_line,
+        .filter_line16 = f->filter_line16 ? f->filter_line16
+                                          : funcs_c.filter_line16,
+        .blur_line16 = f->blur_line16 ? f->blur_line16 : funcs_c.blur_line16,
+    };
+
+    for (int run = 0; run < NUM_RUNS / 10; run++) {
+        int depth = run % 2 ? 8 : random_depth(run / 2);
+        int r = rnd_range(2, 16) * 2;
+        int w = rnd_range(2 * r + 1, MAX_W);
+        int h = rnd_range(2 * r + 1, MAX_H);
+        int stride = w + rnd_range(0, PAD);
+        char params[80];
+
+        ctx_c.thresh = ctx_simd.thresh = random_thresh();
+        snprintf(params, sizeof(params), "w=%d h=%d r=%d depth=%d thresh=%d",
+                 w, h, r, depth, ctx_c.thresh);
+        memset(sbuf_c, 0, sizeof(sbuf_c));
+        memset(sbuf_simd, 0, sizeof(sbuf_simd));
+
+        if (depth == 8) {
+            fill_random(src8, sizeof(src8), run / 2);
+            memset(dst8_c, 0, sizeof(dst8_c));
+            memset(dst8_simd, 0, sizeof(dst8_simd));
+            filter_slice(&ctx_c, (uint16_t *)sbuf_c, dst8_c, src8, w, h,
+                         stride, stride, r, 0, h, depth);
+            filter_slice(&ctx_simd, (uint16_t *)sbuf_simd, dst8_simd, src8, w,
+                         h, stride, stride, r, 0, h, depth);
+            if (!check_bytes("gradfun plane", impl, dst8_c, dst8_simd,
+                             sizeof(dst8_c), params))
+                break;
+        } else {
+            fill_samples(src, sizeof(src) / sizeof(src[0]), depth, run / 2);
+            memset(dst_c, 0, sizeof(dst_c));
+            memset(dst_simd, 0, sizeof(dst_simd));
+            filter_slice16(&ctx_c, sbuf_c, dst_c, src, w, h, stride, stride, r,
+                           0, h, depth);
+            filter_slice16(&ctx_simd, sbuf_simd, dst_simd, src, w, h, stride,
+                           stride, r, 0, h, depth);
+            if (!check_bytes("gradfun plane", impl, (uint8_t *)dst_c,
+                             (uint8_t *)dst_simd, sizeof(dst_c), params))
+                break;
+        }
+    }
+    report_kernel("gradfun plane", impl);
+}
+
+static void check_impl(enum impl impl, const struct impl_funcs *f)
+{
+    if (!impl_supported(impl))
+        return;
+    check_lines(impl, f);
+    check_planes(impl, f);
+}
+
+void check_gradfun(void)
+{
+#if HAVE_X86_INTRINSICS
+    check_impl(IMPL_SSE2, &(struct impl_funcs){
+        filter_line_sse2, blur_line_sse2, NULL, blur_line16_sse2,
+    });
+    check_impl(IMPL_AVX2, &(struct impl_funcs){
+        filter_line_avx2, blur_line_avx2, filter_line16_avx2, blur_line16_avx2,
+    });
+#endif
+}
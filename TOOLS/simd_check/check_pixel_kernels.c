@@ -0,0 +1,193 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "video/filter/pixel_kernels.c"
+
+#include "simd_check.h"
+
+#define MAX_W 1024
+#define PAD 64
+#define MAX_BLUR 12             // vf_unsharp's largest matrix is 13x13
+
+static uint8_t src[2][MAX_W + PAD], dst_c[MAX_W + PAD], dst_simd[MAX_W + PAD];
+static int8_t noise[3][MAX_W + PAD];
+static uint32_t buf_c[MAX_W + PAD], buf_simd[MAX_W + PAD];
+static uint32_t st_c[MAX_BLUR][MAX_W + PAD], st_simd[MAX_BLUR][MAX_W + PAD];
+
+// Prepare a run: random inputs, identical (garbage) outputs.
+static int setup(int run, char *params, size_t params_size)
+{
+    int w = run < 256 ? run + 1 : rnd_range(1, MAX_W);
+    for (int n = 0; n < 2; n++)
+        fill_random(src[n], sizeof(src[n]), run);
+    for (int n = 0; n < 3; n++)
+        fill_random((uint8_t *)noise[n], sizeof(noise[n]), run);
+    fill_random(dst_c, sizeof(dst_c), 0);
+    memcpy(dst_simd, dst_c, sizeof(dst_c));
+    snprintf(params, params_size, "w=%d", w);
+    return w;
+}
+
+static bool check_u32(const char *kernel, enum impl impl, const uint32_t *c,
+                      const uint32_t *simd, int n, const char *params)
+{
+    return check_bytes(kernel, impl, (const uint8_t *)c,
+                       (const uint8_t *)simd, n * sizeof(uint32_t), params);
+}
+
+static void check_impl(enum impl impl, const struct mp_pixel_kernels *k)
+{
+    const struct mp_pixel_kernels *c = &kernels_c;
+    char params[80];
+    int run;
+
+    if (!impl_supported(impl))
+        return;
+
+    if (k->lut) {
+        uint8_t lut[256];
+        for (run = 0; run < NUM_RUNS; run++) {
+            int w = setup(run, params, sizeof(params));
+            fill_random(lut, sizeof(lut), 0);
+            for (int x = 0; x < w; x++)
+                dst_c[x] = lut[src[0][x]];
+            k->lut(dst_simd, src[0], w, lut);
+            if (!check_bytes("lut", impl, dst_c, dst_simd, sizeof(dst_c), params))
+                break;
+        }
+        report_kernel("lut", impl);
+    }
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        int w = setup(run, params, sizeof(params));
+        int contrast = rnd_range(-32768, 32767);
+        int brightness = rnd_range(-32768, 32767);
+        if (run % 4 == 0)
+            brightness = rnd_range(-256, 256);
+        c->affine(dst_c, src[0], w, contrast, brightness);
+        k->affine(dst_simd, src[0], w, contrast, brightness);
+        snprintf(params, sizeof(params), "w=%d contrast=%d brightness=%d",
+                 w, contrast, brightness);
+        if (!check_bytes("affine", impl, dst_c, dst_simd, sizeof(dst_c), params))
+            break;
+    }
+    report_kernel("affine", impl);
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        int w = setup(run, params, sizeof(params));
+        c->add_noise(dst_c, src[0], noise[0], w);
+        k->add_noise(dst_simd, src[0], noise[0], w);
+        if (!check_bytes("add_noise", impl, dst_c, dst_simd, sizeof(dst_c), params))
+            break;
+    }
+    report_kernel("add_noise", impl);
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        int w = setup(run, params, sizeof(params));
+        int8_t *const shift[3] = {noise[0], noise[1], noise[2]};
+        c->add_noise_avg(dst_c, src[0], shift, w);
+        k->add_noise_avg(dst_simd, src[0], shift, w);
+        if (!check_bytes("add_noise_avg", impl, dst_c, dst_simd, sizeof(dst_c),
+                         params))
+            break;
+    }
+    report_kernel("add_noise_avg", impl);
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        int w = setup(run, params, sizeof(params));
+        for (int x = 0; x < MAX_W + PAD; x++)
+            buf_c[x] = buf_simd[x] = rnd();
+        c->pair_sum(buf_c, w);
+        k->pair_sum(buf_simd, w);
+        if (!check_u32("pair_sum", impl, buf_c, buf_simd, MAX_W + PAD, params))
+            break;
+    }
+    report_kernel("pair_sum", impl);
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        int w = setup(run, params, sizeof(params));
+        int n = rnd_range(1, MAX_BLUR);
+        uint32_t *pst_c[MAX_BLUR], *pst_simd[MAX_BLUR];
+        for (int x = 0; x < MAX_W + PAD; x++)
+            buf_c[x] = buf_simd[x] = rnd();
+        for (int i = 0; i < MAX_BLUR; i++) {
+            for (int x = 0; x < MAX_W + PAD; x++)
+                st_c[i][x] = st_simd[i][x] = rnd();
+            pst_c[i] = st_c[i];
+            pst_simd[i] = st_simd[i];
+        }
+        c->blur_v(buf_c, pst_c, n, w);
+        k->blur_v(buf_simd, pst_simd, n, w);
+        snprintf(params, sizeof(params), "w=%d n=%d", w, n);
+        if (!check_u32("blur_v", impl, buf_c, buf_simd, MAX_W + PAD, params) ||
+            !check_u32("blur_v", impl, st_c[0], st_simd[0],
+                       MAX_BLUR * (MAX_W + PAD), params))
+            break;
+    }
+    report_kernel("blur_v", impl);
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        int w = setup(run, params, sizeof(params));
+        int scalebits = rnd_range(1, 24);
+        int amount = rnd_range(-(1 << 23) + 1, (1 << 23) - 1);
+        for (int x = 0; x < MAX_W + PAD; x++)
+            buf_c[x] = rnd() % (256u << scalebits);
+        c->sharpen(dst_c, src[0], buf_c, w, amount, scalebits);
+        k->sharpen(dst_simd, src[0], buf_c, w, amount, scalebits);
+        snprintf(params, sizeof(params), "w=%d amount=%d scalebits=%d",
+                 w, amount, scalebits);
+        if (!check_bytes("sharpen", impl, dst_c, dst_simd, sizeof(dst_c), params))
+            break;
+    }
+    report_kernel("sharpen", impl);
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        int w = setup(run, params, sizeof(params));
+        int weight = rnd_range(0, 256);
+        c->blend(dst_c, src[0], src[1], w, weight);
+        k->blend(dst_simd, src[0], src[1], w, weight);
+        snprintf(params, sizeof(params), "w=%d weight=%d", w, weight);
+        if (!check_bytes("blend", impl, dst_c, dst_simd, sizeof(dst_c), params))
+            break;
+    }
+    report_kernel("blend", impl);
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        static uint8_t a[16 * (MAX_W + PAD)], b[16 * (MAX_W + PAD)];
+        int w = setup(run, params, sizeof(params));
+        int h = rnd_range(1, 16);
+        int a_stride = w + rnd_range(0, PAD), b_stride = w + rnd_range(0, PAD);
+        fill_random(a, sizeof(a), run);
+        fill_random(b, sizeof(b), run);
+        snprintf(params, sizeof(params), "w=%d h=%d", w, h);
+        if (!check_int("sad", impl, c->sad(a, a_stride, b, b_stride, w, h),
+                       k->sad(a, a_stride, b, b_stride, w, h), params))
+            break;
+    }
+    report_kernel("sad", impl);
+}
+
+void check_pixel_kernels(void)
+{
+#if HAVE_X86_INTRINSICS
+    check_impl(IMPL_SSE2, &kernels_sse2);
+    check_impl(IMPL_AVX2, &kernels_avx2);
+#endif
+#if HAVE_NEON_INTRINSICS
+    check_impl(IMPL_NEON, &kernels_neon);
+#endif
+}
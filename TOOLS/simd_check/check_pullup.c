@@ -0,0 +1,63 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "video/filter/pullup.c"
+
+#include "simd_check.h"
+
+typedef int (*metric_fn)(unsigned char *a, unsigned char *b, int s);
+
+static void check_impl(const char *kernel, enum impl impl, metric_fn ref,
+                       metric_fn fn)
+{
+    // 8x4 blocks, plus the line above and below that licomb_y reads.
+    static uint8_t a[6 * 64], b[6 * 64];
+
+    if (!fn || !impl_supported(impl))
+        return;
+
+    for (int run = 0; run < NUM_RUNS; run++) {
+        int s = rnd_range(8, 64);
+        int x = rnd_range(0, s - 8);
+        char params[40];
+
+        fill_random(a, sizeof(a), run);
+        fill_random(b, sizeof(b), run);
+
+        snprintf(params, sizeof(params), "stride=%d", s);
+        if (!check_int(kernel, impl, ref(a + s + x, b + s + x, s),
+                       fn(a + s + x, b + s + x, s), params))
+            break;
+    }
+    report_kernel(kernel, impl);
+}
+
+void check_pullup(void)
+{
+#if HAVE_X86_INTRINSICS
+    check_impl("pullup diff_y", IMPL_SSE2, diff_y, diff_y_sse2);
+    check_impl("pullup licomb_y", IMPL_SSE2, licomb_y, licomb_y_sse2);
+    check_impl("pullup var_y", IMPL_SSE2, var_y, var_y_sse2);
+    check_impl("pullup diff_y", IMPL_AVX2, diff_y, diff_y_avx2);
+    check_impl("pullup licomb_y", IMPL_AVX2, licomb_y, licomb_y_avx2);
+#endif
+#if HAVE_NEON_INTRINSICS
+    check_impl("pullup diff_y", IMPL_NEON, diff_y, diff_y_neon);
+    check_impl("pullup licomb_y", IMPL_NEON, licomb_y, licomb_y_neon);
+    check_impl("pullup var_y", IMPL_NEON, var_y, var_y_neon);
+#endif
+}
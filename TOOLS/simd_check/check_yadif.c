@@ -0,0 +1,72 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "video/filter/vf_yadif.c"
+
+#include "simd_check.h"
+
+#define MAX_W 300
+#define PAD 64                  // at least 2 + the widest vector, per side
+#define ROWS 5                  // filter_line reads up to 2 lines above/below
+
+typedef void (*filter_line_fn)(struct vf_priv_s *p, uint8_t *dst,
+                               uint8_t *prev, uint8_t *cur, uint8_t *next,
+                               int w, int refs, int parity);
+
+static void check_impl(enum impl impl, filter_line_fn fn)
+{
+    static uint8_t frames[3][ROWS * (MAX_W + 2 * PAD)];
+    static uint8_t dst_c[MAX_W + PAD], dst_simd[MAX_W + PAD];
+
+    if (!fn || !impl_supported(impl))
+        return;
+
+    for (int run = 0; run < NUM_RUNS; run++) {
+        int w = run < MAX_W ? run + 1 : rnd_range(1, MAX_W);
+        int refs = w + 2 * PAD;
+        int offset = (ROWS / 2) * refs + PAD;
+        struct vf_priv_s p = { .mode = run % 4 };
+        int parity = (run / 4) % 2;
+        char params[80];
+
+        for (int n = 0; n < 3; n++)
+            fill_random(frames[n], ROWS * refs, run);
+        memset(dst_c, 0xAA, sizeof(dst_c));
+        memset(dst_simd, 0xAA, sizeof(dst_simd));
+
+        filter_line_c(&p, dst_c, frames[0] + offset, frames[1] + offset,
+                      frames[2] + offset, w, refs, parity);
+        fn(&p, dst_simd, frames[0] + offset, frames[1] + offset,
+           frames[2] + offset, w, refs, parity);
+
+        snprintf(params, sizeof(params), "w=%d mode=%d parity=%d",
+                 w, p.mode, parity);
+        // Also catches writes past the end of the line.
+        if (!check_bytes("yadif filter_line", impl, dst_c, dst_simd,
+                         sizeof(dst_c), params))
+            break;
+    }
+    report_kernel("yadif filter_line", impl);
+}
+
+void check_yadif(void)
+{
+#if HAVE_X86_INTRINSICS
+    check_impl(IMPL_SSE2, filter_line_sse2);
+    check_impl(IMPL_AVX2, filter_line_avx2);
+#endif
+}
@@ -0,0 +1,164 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Check that the SSE2/AVX2/NEON versions of the video filter kernels produce
+ * exactly the same results as the C versions, on random input:
+ * - vf_yadif filter_line
+ * - vf_pullup diff/comb/var metrics
+ * - vf_divtc 8x8 SAD
+ * - vf_gradfun line and blur functions (8 and 9-16 bit), and whole planes
+ * - mp_pixel_kernels (eq, unsharp, noise, interpolate)
+ *
+ * The filter sources are compiled into this program (see the Makefile), so
+ * that their static functions can be called. Implementations the CPU doesn't
+ * support are skipped.
+ *
+ * Usage: make -C TOOLS/simd_check && TOOLS/simd_check/simd_check [seed]
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "common/cpudetect.h"
+
+#include "simd_check.h"
+
+// The filters select their kernels with this; it's not used here.
+CpuCaps gCpuCaps;
+
+static uint32_t rnd_state;
+static int num_failed, num_kernels;
+static bool kernel_failed;
+
+bool impl_supported(enum impl impl)
+{
+    switch (impl) {
+    case IMPL_C:
+        return true;
+#if HAVE_X86_INTRINSICS
+    case IMPL_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case IMPL_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#if HAVE_NEON_INTRINSICS
+    case IMPL_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const char *impl_name(enum impl impl)
+{
+    static const char *const names[] = {"C", "SSE2", "AVX2", "NEON"};
+    return names[impl];
+}
+
+uint32_t rnd(void)
+{
+    // xorshift32
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+int rnd_range(int min, int max)
+{
+    return min + (int)(rnd() % (unsigned)(max - min + 1));
+}
+
+void fill_random(uint8_t *buf, size_t size, int run)
+{
+    if (run % 2) {
+        int base = rnd_range(0, 255), spread = rnd_range(1, 8);
+        for (size_t n = 0; n < size; n++) {
+            int v = base + rnd_range(-spread, spread);
+            buf[n] = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+    } else {
+        for (size_t n = 0; n < size; n++)
+            buf[n] = rnd();
+    }
+}
+
+static bool fail(const char *kernel, enum impl impl, const char *fmt, ...)
+{
+    if (!kernel_failed) {
+        va_list ap;
+        va_start(ap, fmt);
+        printf("FAIL %s %s: ", kernel, impl_name(impl));
+        vprintf(fmt, ap);
+        printf("\n");
+        va_end(ap);
+    }
+    kernel_failed = true;
+    return false;
+}
+
+bool check_bytes(const char *kernel, enum impl impl, const uint8_t *c,
+                 const uint8_t *simd, size_t size, const char *params)
+{
+    for (size_t n = 0; n < size; n++) {
+        if (c[n] != simd[n]) {
+            return fail(kernel, impl, "byte %zu is %d, C has %d (%s)",
+                        n, simd[n], c[n], params);
+        }
+    }
+    return true;
+}
+
+bool check_int(const char *kernel, enum impl impl, long long c, long long simd,
+               const char *params)
+{
+    if (c != simd)
+        return fail(kernel, impl, "%lld, C has %lld (%s)", simd, c, params);
+    return true;
+}
+
+void report_kernel(const char *kernel, enum impl impl)
+{
+    if (!kernel_failed)
+        printf("ok   %s %s\n", kernel, impl_name(impl));
+    num_failed += kernel_failed;
+    num_kernels++;
+    kernel_failed = false;
+}
+
+int main(int argc, char **argv)
+{
+    rnd_state = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+    if (!rnd_state)
+        rnd_state = 1;
+    printf("seed %u\n", (unsigned)rnd_state);
+
+    check_yadif();
+    check_pullup();
+    check_divtc();
+    check_gradfun();
+    check_pixel_kernels();
+
+    printf("%d of %d kernels differ from the C version\n", num_failed,
+           num_kernels);
+    return num_failed ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIMD_CHECK_H
+#define SIMD_CHECK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of random inputs per kernel and implementation.
+#define NUM_RUNS 2000
+
+enum impl {
+    IMPL_C,
+    IMPL_SSE2,
+    IMPL_AVX2,
+    IMPL_NEON,
+};
+
+// Whether the CPU can run the given implementation.
+bool impl_supported(enum impl impl);
+const char *impl_name(enum impl impl);
+
+uint32_t rnd(void);
+int rnd_range(int min, int max);
+
+// Fill with random bytes. Depending on the run number, the bytes are either
+// uniformly distributed or close to each other, so that the kernels' branches
+// and saturating paths are all exercised.
+void fill_random(uint8_t *buf, size_t size, int run);
+
+// Compare the output of an implementation with the C version. Returns false
+// and prints a message on mismatch (only the first one per kernel).
+bool check_bytes(const char *kernel, enum impl impl, const uint8_t *c,
+                 const uint8_t *simd, size_t size, const char *params);
+bool check_int(const char *kernel, enum impl impl, long long c, long long simd,
+               const char *params);
+
+// Called by the check_*() functions when all runs of a kernel were done.
+void report_kernel(const char *kernel, enum impl impl);
+
+void check_yadif(void);
+void check_pullup(void);
+void check_divtc(void);
+void check_gradfun(void);
+void check_pixel_kernels(void);
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Example reader for the "tap" audio filter: prints the peak level of each
+ * channel about 10 times per second, and the number of lost frames.
+ *
+ * Build: cc -O2 -I../audio/filter tap_levels.c -o tap_levels -lm -lrt
+ * Usage: mpv --af=tap=name=levels file & ./tap_levels levels
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "af_tap.h"
+
+#define LOAD(x) __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+
+static struct mp_tap_header *open_tap(const char *name, size_t *size)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    void *ptr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct mp_tap_header))
+        ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return NULL;
+    struct mp_tap_header *h = ptr;
+    if (h->magic != MP_TAP_MAGIC || h->version != MP_TAP_VERSION ||
+        h->header_size + (size_t)h->packet_size * h->num_packets > (size_t)st.st_size)
+    {
+        munmap(ptr, st.st_size);
+        return NULL;
+    }
+    *size = st.st_size;
+    return h;
+}
+
+int main(int argc, char **argv)
+{
+    char name[256];
+    snprintf(name, sizeof(name), "/%s", argc > 1 ? argv[1] : "mpv-tap");
+
+    for (;;) {
+        size_t size;
+        struct mp_tap_header *h = open_tap(name, &size);
+        if (!h) {
+            usleep(500000);
+            continue;
+        }
+        printf("%s: %u channels, %u Hz\n", name, h->nch, h->rate);
+
+        float *buf = malloc(h->packet_size);
+        float peak[16] = {0};
+        uint64_t frames = 0, lost = 0;
+        uint64_t seq = LOAD(h->write_seq) + 1;
+        while (!LOAD(h->closed)) {
+            uint64_t write_seq = LOAD(h->write_seq);
+            if (seq > write_seq) {
+                usleep(5000);
+                continue;
+            }
+            if (seq + h->num_packets <= write_seq) {
+                // Fell behind; skip to the oldest packet still in the ring.
+                uint64_t next = write_seq - h->num_packets + 1;
+                lost += (next - seq) * h->max_frames;
+                seq = next;
+            }
+            const struct mp_tap_packet *pkt = (void *)((char *)h +
+                h->header_size + (seq - 1) % h->num_packets * h->packet_size);
+            if (LOAD(pkt->seq) != seq)
+                continue; // overwritten meanwhile, retry with a new write_seq
+            struct mp_tap_packet info = *pkt;
+            if (info.frames > h->max_frames)
+                continue;
+            memcpy(buf, pkt + 1, info.frames * h->nch * sizeof(float));
+            // Order the copy before checking seq again.
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (LOAD(pkt->seq) != seq)
+                continue;
+            seq++;
+
+            for (uint32_t i = 0; i < info.frames; i++) {
+                for (uint32_t c = 0; c < h->nch && c < 16; c++)
+                    peak[c] = fmaxf(peak[c], fabsf(buf[i * h->nch + c]));
+            }
+            frames += info.frames;
+            if (frames >= h->rate / 10) {
+                printf("%8.3f", info.pts);
+                for (uint32_t c = 0; c < h->nch && c < 16; c++)
+                    printf(" %6.1f", 20 * log10f(peak[c] + 1e-10f));
+                printf("  lost: %llu\n", (unsigned long long)lost);
+                memset(peak, 0, sizeof(peak));
+                frames = 0;
+            }
+        }
+        free(buf);
+        munmap(h, size);
+    }
+}
@@ -203,6 +203,8 @@ int audio_init_filters(struct dec_audio *d_audio, int in_samplerate,
         d_audio->afilter = af_new(d_audio->global);
     struct af_stream *afs = d_audio->afilter;
 
+    afs->replaygain_data = d_audio->header->audio->replaygain_data;
+
     // input format: same as codec's output format:
     mp_audio_buffer_get_format(d_audio->decode_buffer, &afs->input);
     // Sample rate can be different when adjusting playback speed
@@ -273,6 +275,14 @@ static int filter_n_bytes(struct dec_audio *da, struct mp_audio_buffer *outbuf,
     filter_data.samples = len;
     bool eof = filter_data.samples == 0 && error < 0;
 
+    // pts of the first sample in the decoder buffer
+    da->afilter->pts = MP_NOPTS_VALUE;
+    if (da->pts != MP_NOPTS_VALUE) {
+        int buffered = mp_audio_buffer_samples(da->decode_buffer);
+        da->afilter->pts = da->pts + (da->pts_offset - buffered) /
+                                     (double)config.rate;
+    }
+
     if (af_filter(da->afilter, &filter_data, eof ? AF_FILTER_FLAG_EOF : 0) < 0)
         return -1;
 
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <assert.h>
 
 #include "common/common.h"
@@ -27,6 +28,7 @@
 
 #include "options/m_option.h"
 #include "options/m_config.h"
+#include "osdep/timer.h"
 
 #include "af.h"
 
@@ -41,13 +43,15 @@ extern struct af_info af_info_equalizer;
 extern struct af_info af_info_pan;
 extern struct af_info af_info_surround;
 extern struct af_info af_info_sub;
-extern struct af_info af_info_export;
+extern struct af_info af_info_tap;
 extern struct af_info af_info_drc;
+extern struct af_info af_info_ebur128;
 extern struct af_info af_info_extrastereo;
 extern struct af_info af_info_lavcac3enc;
 extern struct af_info af_info_lavrresample;
 extern struct af_info af_info_sweep;
 extern struct af_info af_info_hrtf;
+extern struct af_info af_info_convolution;
 extern struct af_info af_info_ladspa;
 extern struct af_info af_info_center;
 extern struct af_info af_info_sinesuppress;
@@ -68,15 +72,17 @@ static struct af_info* filter_list[] = {
     &af_info_pan,
     &af_info_surround,
     &af_info_sub,
-#if HAVE_SYS_MMAN_H
-    &af_info_export,
+#if HAVE_SHM_OPEN
+    &af_info_tap,
 #endif
     &af_info_drc,
+    &af_info_ebur128,
     &af_info_extrastereo,
     &af_info_lavcac3enc,
     &af_info_lavrresample,
     &af_info_sweep,
     &af_info_hrtf,
+    &af_info_convolution,
 #if HAVE_LADSPA
     &af_info_ladspa,
 #endif
@@ -204,6 +210,8 @@ static struct af_instance *af_create(struct af_stream *s, char *name,
         .mul = 1,
         .data = talloc_zero(af, struct mp_audio),
         .log = mp_log_new(af, s->log, name),
+        .replaygain_data = s->replaygain_data,
+        .pts = MP_NOPTS_VALUE,
     };
     struct m_config *config = m_config_from_obj_desc(af, s->log, &desc);
     if (m_config_apply_defaults(config, name, s->opts->af_defs) < 0)
@@ -302,11 +310,48 @@ repeat:
     }
 }
 
+// Number of bits of precision a sample format can hold.
+static int af_fmt_precision(int format)
+{
+    if ((format & AF_FORMAT_POINT_MASK) == AF_FORMAT_F)
+        return af_fmt2bits(format) > 32 ? 53 : 24;
+    return af_fmt2bits(format);
+}
+
+// Cost of converting from one sample format to another in a single step.
+// Every step is a pass over the data; (de)interleaving alone is cheaper than
+// converting the sample type. Losing precision is penalized heavily, so that
+// lossy intermediate formats are only used if there's no other way.
+static int af_fmt_conversion_cost(int src, int dst)
+{
+    if (src == dst)
+        return 0;
+    int cost = 2;
+    if ((src & ~AF_FORMAT_INTERLEAVING_MASK) ==
+        (dst & ~AF_FORMAT_INTERLEAVING_MASK))
+        cost = 1;
+    if (af_fmt_precision(dst) < af_fmt_precision(src))
+        cost += 16;
+    return cost;
+}
+
+// Cost of an auto-inserted conversion filter going from src to dst.
+static int af_conversion_cost(struct mp_audio *src, struct mp_audio *dst)
+{
+    int cost = af_fmt_conversion_cost(src->format, dst->format);
+    if (!mp_chmap_equals(&src->channels, &dst->channels))
+        cost += 2;
+    if (src->rate != dst->rate)
+        cost += 4;
+    return cost;
+}
+
 static void af_print_filter_chain(struct af_stream *s, struct af_instance *at,
                                   int msg_level)
 {
     MP_MSG(s, msg_level, "Audio filter chain:\n");
 
+    int conversions = 0, total_cost = 0;
     struct af_instance *af = s->first;
     while (af) {
         MP_MSG(s, msg_level, "  [%s] ", af->info->name);
@@ -315,6 +360,12 @@ static void af_print_filter_chain(struct af_stream *s, struct af_instance *at,
             MP_MSG(s, msg_level, "%s", info);
             talloc_free(info);
         }
+        if (af->auto_inserted && af->prev) {
+            int cost = af_conversion_cost(af->prev->data, af->data);
+            MP_MSG(s, msg_level, " (auto, cost %d)", cost);
+            conversions++;
+            total_cost += cost;
+        }
         if (af == at)
             MP_MSG(s, msg_level, " <-");
         MP_MSG(s, msg_level, "\n");
@@ -326,6 +377,11 @@ static void af_print_filter_chain(struct af_stream *s, struct af_instance *at,
     char *info = mp_audio_config_to_str(&s->output);
     MP_MSG(s, msg_level, "%s\n", info);
     talloc_free(info);
+
+    if (conversions) {
+        MP_MSG(s, msg_level, "  %d conversion filter(s), total cost %d\n",
+               conversions, total_cost);
+    }
 }
 
 static int af_count_filters(struct af_stream *s)
@@ -338,7 +394,8 @@ static int af_count_filters(struct af_stream *s)
 
 // Finds the first conversion filter on the way from srcfmt to dstfmt.
 // Conversions form a DAG: each node is a format/filter pair, and possible
-// conversions are edges. We search the DAG for the shortest path.
+// conversions are edges weighted with af_fmt_conversion_cost(). We search the
+// DAG for the cheapest path.
 // Some cases visit the same filter multiple times, but with different formats
 // (like u24le->s8), so one node per format or filter separate is not enough.
 // Returns the filter and dest. format for the first conversion step.
@@ -354,10 +411,10 @@ static char *af_find_conversion_filter(int srcfmt, int *dstfmt)
         assert(n < NUM_FMT);
 
     bool visited[NUM_NODES] = {0};
-    unsigned char distance[NUM_NODES];
+    int distance[NUM_NODES];
     short previous[NUM_NODES] = {0};
     for (int n = 0; n < NUM_NODES; n++) {
-        distance[n] = 255;
+        distance[n] = INT_MAX;
         if (af_fmtstr_table[n % NUM_FMT].format == srcfmt)
             distance[n] = 0;
     }
@@ -368,7 +425,7 @@ static char *af_find_conversion_filter(int srcfmt, int *dstfmt)
             if (!visited[n] && (next < 0 || (distance[n] < distance[next])))
                 next = n;
         }
-        if (next < 0 || distance[next] == 255)
+        if (next < 0 || distance[next] == INT_MAX)
             return NULL;
         visited[next] = true;
 
@@ -376,7 +433,8 @@ static char *af_find_conversion_filter(int srcfmt, int *dstfmt)
         if (af_fmtstr_table[fmt].format == *dstfmt) {
             // Best match found
             for (int cur = next; cur >= 0; cur = previous[cur] - 1) {
-                if (distance[cur] == 1) {
+                int prev = previous[cur] - 1;
+                if (prev >= 0 && distance[prev] == 0) {
                     *dstfmt = af_fmtstr_table[cur % NUM_FMT].format;
                     return (char *)filter_list[cur / NUM_FMT]->name;
                 }
@@ -389,11 +447,12 @@ static char *af_find_conversion_filter(int srcfmt, int *dstfmt)
             if (!af->test_conversion)
                 continue;
             for (int i = 0; af_fmtstr_table[i].format; i++) {
-                if (i != fmt && af->test_conversion(af_fmtstr_table[fmt].format,
-                                                    af_fmtstr_table[i].format))
-                {
+                int src = af_fmtstr_table[fmt].format;
+                int dst = af_fmtstr_table[i].format;
+                if (i != fmt && af->test_conversion(src, dst)) {
                     int other = n * NUM_FMT + i;
-                    int ndist = distance[next] + 1;
+                    int ndist = distance[next] +
+                                af_fmt_conversion_cost(src, dst);
                     if (ndist < distance[other]) {
                         distance[other] = ndist;
                         previous[other] = next + 1;
@@ -429,6 +488,18 @@ static int af_fix_format_conversion(struct af_stream *s,
     struct mp_audio actual = *prev->data;
     if (actual.format == in.format)
         return AF_FALSE;
+    // If the previous filter is an auto-inserted conversion filter, try to
+    // make it output the wanted format directly instead of adding another
+    // conversion step after it.
+    if (prev->auto_inserted && prev->info->test_conversion &&
+        prev->info->test_conversion(prev->prev->data->format, in.format))
+    {
+        int fmt = in.format;
+        if (prev->control(prev, AF_CONTROL_SET_FORMAT, &fmt) == AF_OK) {
+            *p_af = prev;
+            return AF_OK;
+        }
+    }
     int dstfmt = in.format;
     char *filter = af_find_conversion_filter(actual.format, &dstfmt);
     if (!filter)
@@ -587,6 +658,7 @@ void af_uninit(struct af_stream *s)
 struct af_stream *af_new(struct mpv_global *global)
 {
     struct af_stream *s = talloc_zero(NULL, struct af_stream);
+    s->pts = MP_NOPTS_VALUE;
     static struct af_info in = { .name = "in" };
     s->first = talloc(s, struct af_instance);
     *s->first = (struct af_instance) {
@@ -694,13 +766,28 @@ struct af_instance *af_add(struct af_stream *s, char *name, char **args)
 int af_filter(struct af_stream *s, struct mp_audio *data, int flags)
 {
     struct af_instance *af = s->first;
+    double pts = s->pts;
     assert(mp_audio_config_equals(af->data, data));
     // Iterate through all filters
     while (af) {
+        af->pts = pts;
+        void *in_plane = data->planes[0];
+        void *out_plane = af->data->planes[0];
+        int in_samples = data->samples;
+        int64_t start = mp_time_us();
+        af->stats_calls += 1;
+        af->stats_samples += data->samples;
         int r = af->filter(af, data, flags);
+        af->stats_time += (mp_time_us() - start) / 1e6;
+        if (af->data->planes[0] != out_plane)
+            af->stats_allocs += 1;
         if (r < 0)
             return r;
         assert(mp_audio_config_equals(af->data, data));
+        assert(!(af->info->flags & AF_FLAGS_INPLACE) || !in_samples ||
+               data->planes[0] == in_plane);
+        if (pts != MP_NOPTS_VALUE)
+            pts -= af->delay;
         af = af->next;
     }
     return 0;
@@ -753,3 +840,16 @@ void af_control_all(struct af_stream *s, int cmd, void *arg)
     for (struct af_instance *af = s->first; af; af = af->next)
         af->control(af, cmd, arg);
 }
+
+/* Pass new sub-options to all filters with the given name. Returns the number
+ * of filters that accepted them. */
+int af_send_command_line(struct af_stream *s, const char *name, char *args)
+{
+    int count = 0;
+    for (struct af_instance *af = s->first; af; af = af->next) {
+        if (strcmp(af->info->name, name) == 0 &&
+            af->control(af, AF_CONTROL_SET_COMMAND_LINE, args) == AF_OK)
+            count++;
+    }
+    return count;
+}
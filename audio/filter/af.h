@@ -29,6 +29,8 @@
 #include "audio/audio.h"
 #include "common/msg.h"
 
+struct replaygain_data;
+
 struct af_instance;
 struct mpv_global;
 
@@ -38,6 +40,9 @@ struct mpv_global;
 // Flags used for defining the behavior of an audio filter
 #define AF_FLAGS_REENTRANT      0x00000000
 #define AF_FLAGS_NOT_REENTRANT  0x00000001
+// filter() always returns its output in the buffer that was passed to it
+// (unless that was empty)
+#define AF_FLAGS_INPLACE        0x00000002
 
 // Flags for af->filter()
 #define AF_FILTER_FLAG_EOF 1
@@ -75,6 +80,17 @@ struct af_instance {
                  * the number of samples passed though. (Ratio of input
                  * and output, e.g. mul=4 => 1 sample becomes 4 samples) .*/
     bool auto_inserted; // inserted by af.c, such as conversion filters
+    struct replaygain_data *replaygain_data; // copied from af_stream
+    double pts; // pts of the first sample passed to filter() (set by
+                // af_filter(), MP_NOPTS_VALUE if unknown)
+
+    // Statistics for --benchmark: time spent in filter() (in seconds), and
+    // the number of calls and samples passed to it.
+    double stats_time;
+    int64_t stats_calls, stats_samples;
+    // Number of buffer (re)allocations. Reallocations of af->data are counted
+    // by af_filter(); filters count their internal buffers themselves.
+    int64_t stats_allocs;
 };
 
 // Current audio stream
@@ -88,6 +104,14 @@ struct af_stream {
     struct mp_audio output;
     struct mp_audio filter_output;
 
+    // ReplayGain data of the current file (NULL if unknown); passed to the
+    // filters when they are created.
+    struct replaygain_data *replaygain_data;
+
+    // pts of the first sample of the data passed to af_filter(), or
+    // MP_NOPTS_VALUE. Set by the user.
+    double pts;
+
     struct mp_log *log;
     struct MPOpts *opts;
 };
@@ -115,6 +139,11 @@ enum af_control {
     AF_CONTROL_SET_PAN_BALANCE,
     AF_CONTROL_GET_PAN_BALANCE,
     AF_CONTROL_SET_PLAYBACK_SPEED,
+    // double*: speed factor applied by resampling, for small continuous
+    // adjustments (A/V sync) that must not reinit the filter
+    AF_CONTROL_SET_PLAYBACK_SPEED_RESAMPLE,
+    AF_CONTROL_SET_COMMAND_LINE,
+    AF_CONTROL_GET_LOUDNESS,
 };
 
 // Argument for AF_CONTROL_SET_PAN_LEVEL
@@ -123,6 +152,14 @@ typedef struct af_control_ext_s {
     int ch;     // Chanel number
 } af_control_ext_t;
 
+// Argument for AF_CONTROL_GET_LOUDNESS
+struct af_loudness {
+    double integrated;  // gated integrated loudness (LUFS), -HUGE_VAL if
+                        // there was no audio above the absolute gate
+    double true_peak;   // maximum true peak (dBTP)
+    double duration;    // measured audio (seconds)
+};
+
 struct af_stream *af_new(struct mpv_global *global);
 void af_destroy(struct af_stream *s);
 int af_init(struct af_stream *s);
@@ -131,6 +168,7 @@ struct af_instance *af_add(struct af_stream *s, char *name, char **args);
 int af_filter(struct af_stream *s, struct mp_audio *data, int flags);
 struct af_instance *af_control_any_rev(struct af_stream *s, int cmd, void *arg);
 void af_control_all(struct af_stream *s, int cmd, void *arg);
+int af_send_command_line(struct af_stream *s, const char *name, char *args);
 
 double af_calc_filter_multiplier(struct af_stream *s);
 double af_calc_delay(struct af_stream *s);
@@ -192,6 +192,7 @@ static int af_open(struct af_instance *af)
 struct af_info af_info_bs2b = {
     .info = "Bauer stereophonic-to-binaural audio filter",
     .name = "bs2b",
+    .flags = AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(struct af_bs2b),
     .options = (const struct m_option[]) {
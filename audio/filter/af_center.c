@@ -31,11 +31,13 @@
 
 #include "common/common.h"
 #include "af.h"
+#include "chmix.h"
 
 // Data for specific instances of this filter
 typedef struct af_center_s
 {
   int ch;		// Channel number which to insert the filtered data
+  struct mp_chmix *mix;
 }af_center_t;
 
 // Initialization and runtime control
@@ -48,11 +50,25 @@ static int control(struct af_instance* af, int cmd, void* arg)
     // Sanity check
     if(!arg) return AF_ERROR;
 
-    af->data->rate   = ((struct mp_audio*)arg)->rate;
-    mp_audio_set_channels_old(af->data, MPMAX(s->ch+1,((struct mp_audio*)arg)->nch));
-    mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+    struct mp_audio *in = arg;
+    af->data->rate   = in->rate;
+    mp_audio_set_channels_old(af->data, MPMAX(s->ch+1,in->nch));
+    if(af_fmt_is_planar(in->format))
+      mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
+    else
+      mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
 
-    return af_test_output(af,(struct mp_audio*)arg);
+    // Pass all channels through, except the center channel, which gets the
+    // average of left and right.
+    int nch = af->data->nch;
+    talloc_free(s->mix);
+    s->mix = mp_chmix_create(af, nch, nch);
+    mp_chmix_set_identity(s->mix);
+    for(int i=0;i<nch;i++)
+      mp_chmix_set(s->mix, s->ch, i, i < 2 ? 0.5 : 0);
+    mp_chmix_commit(s->mix);
+
+    return af_test_output(af,in);
   }
   }
   return AF_UNKNOWN;
@@ -61,19 +77,13 @@ static int control(struct af_instance* af, int cmd, void* arg)
 // Filter data through filter
 static int filter(struct af_instance* af, struct mp_audio* data, int flags)
 {
-  struct mp_audio*    c   = data;	 // Current working data
   af_center_t*  s   = af->priv; // Setup for this instance
-  float*   	a   = c->planes[0];	 // Audio data
-  int		nch = c->nch;	 // Number of channels
-  int		len = c->samples*c->nch;	 // Number of samples in current audio block
-  int		ch  = s->ch;	 // Channel in which to insert the center audio
-  register int  i;
 
-  // Run filter
-  for(i=0;i<len;i+=nch){
-    // Average left and right
-    a[i+ch] = (a[i]/2) + (a[i+1]/2);
-  }
+  if(af_fmt_is_planar(data->format))
+    mp_chmix_process_planar(s->mix, (float **)data->planes,
+                            (float **)data->planes, data->samples);
+  else
+    mp_chmix_process(s->mix, data->planes[0], data->planes[0], data->samples);
 
   return 0;
 }
@@ -89,7 +99,7 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_center = {
     .info = "Audio filter for adding a center channel",
     .name = "center",
-    .flags = AF_FLAGS_NOT_REENTRANT,
+    .flags = AF_FLAGS_NOT_REENTRANT | AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(af_center_t),
     .options = (const struct m_option[]) {
@@ -29,6 +29,7 @@
 
 #include "common/common.h"
 #include "af.h"
+#include "chmix.h"
 
 #define FR 0
 #define TO 1
@@ -38,86 +39,9 @@ typedef struct af_channels_s{
   int nch, nr;
   int router;
   char *routes;
+  struct mp_chmix *mix;
 }af_channels_t;
 
-// Local function for copying data
-static void copy(struct af_instance *af, void* in, void* out,
-                 int ins, int inos,int outs, int outos, int len, int bps)
-{
-  switch(bps){
-  case 1:{
-    int8_t* tin  = (int8_t*)in;
-    int8_t* tout = (int8_t*)out;
-    tin  += inos;
-    tout += outos;
-    len = len/ins;
-    while(len--){
-      *tout=*tin;
-      tin +=ins;
-      tout+=outs;
-    }
-    break;
-  }
-  case 2:{
-    int16_t* tin  = (int16_t*)in;
-    int16_t* tout = (int16_t*)out;
-    tin  += inos;
-    tout += outos;
-    len = len/(2*ins);
-    while(len--){
-      *tout=*tin;
-      tin +=ins;
-      tout+=outs;
-    }
-    break;
-  }
-  case 3:{
-    int8_t* tin  = (int8_t*)in;
-    int8_t* tout = (int8_t*)out;
-    tin  += 3 * inos;
-    tout += 3 * outos;
-    len = len / ( 3 * ins);
-    while (len--) {
-      tout[0] = tin[0];
-      tout[1] = tin[1];
-      tout[2] = tin[2];
-      tin += 3 * ins;
-      tout += 3 * outs;
-    }
-    break;
-  }
-  case 4:{
-    int32_t* tin  = (int32_t*)in;
-    int32_t* tout = (int32_t*)out;
-    tin  += inos;
-    tout += outos;
-    len = len/(4*ins);
-    while(len--){
-      *tout=*tin;
-      tin +=ins;
-      tout+=outs;
-    }
-    break;
-  }
-  case 8:{
-    int64_t* tin  = (int64_t*)in;
-    int64_t* tout = (int64_t*)out;
-    tin  += inos;
-    tout += outos;
-    len = len/(8*ins);
-    while(len--){
-      *tout=*tin;
-      tin +=ins;
-      tout+=outs;
-    }
-    break;
-  }
-  default:
-    MP_ERR(af, "Unsupported number of bytes/sample: %i"
-	   " please report this error on the MPlayer mailing list. \n",bps);
-  }
-}
-
 // Make sure the routes are sane
 static int check_routes(struct af_instance *af, int nin, int nout)
 {
@@ -144,6 +68,7 @@ static int control(struct af_instance* af, int cmd, void* arg)
   af_channels_t* s = af->priv;
   switch(cmd){
   case AF_CONTROL_REINIT: ;
+    struct mp_audio *in = arg;
 
     struct mp_chmap chmap;
     mp_chmap_set_unknown(&chmap, s->nch);
@@ -153,11 +78,11 @@ static int control(struct af_instance* af, int cmd, void* arg)
     if(!s->router){
       int i;
       // Make sure this filter isn't redundant
-      if(af->data->nch == ((struct mp_audio*)arg)->nch)
+      if(af->data->nch == in->nch)
 	return AF_DETACH;
 
       // If mono: fake stereo
-      if(((struct mp_audio*)arg)->nch == 1){
+      if(in->nch == 1){
 	s->nr = MPMIN(af->data->nch,2);
 	for(i=0;i<s->nr;i++){
 	  s->route[i][FR] = 0;
@@ -165,7 +90,7 @@ static int control(struct af_instance* af, int cmd, void* arg)
 	}
       }
       else{
-	s->nr = MPMIN(af->data->nch, ((struct mp_audio*)arg)->nch);
+	s->nr = MPMIN(af->data->nch, in->nch);
 	for(i=0;i<s->nr;i++){
 	  s->route[i][FR] = i;
 	  s->route[i][TO] = i;
@@ -173,10 +98,28 @@ static int control(struct af_instance* af, int cmd, void* arg)
       }
     }
 
-    af->data->rate   = ((struct mp_audio*)arg)->rate;
-    mp_audio_force_interleaved_format((struct mp_audio*)arg);
-    mp_audio_set_format(af->data, ((struct mp_audio*)arg)->format);
-    return check_routes(af,((struct mp_audio*)arg)->nch,af->data->nch);
+    af->data->rate   = in->rate;
+    if(af_fmt_is_planar(in->format))
+      mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
+    else
+      mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+    if(in->format != af->data->format){
+      mp_audio_set_format(in, af->data->format);
+      return AF_FALSE;
+    }
+    if(AF_OK != check_routes(af,in->nch,af->data->nch))
+      return AF_ERROR;
+
+    // A channel routed to several times gets the last route.
+    talloc_free(s->mix);
+    s->mix = mp_chmix_create(af, in->nch, af->data->nch);
+    for(int i=0;i<s->nr;i++){
+      for(int k=0;k<in->nch;k++)
+        mp_chmix_set(s->mix, s->route[i][TO], k, 0);
+      mp_chmix_set(s->mix, s->route[i][TO], s->route[i][FR], 1);
+    }
+    mp_chmix_commit(s->mix);
+    return AF_OK;
   }
   return AF_UNKNOWN;
 }
@@ -184,24 +127,32 @@ static int control(struct af_instance* af, int cmd, void* arg)
 // Filter data through filter
 static int filter(struct af_instance* af, struct mp_audio* data, int flags)
 {
-  struct mp_audio*   	 c = data;			// Current working data
   struct mp_audio*   	 l = af->data;	 		// Local data
   af_channels_t* s = af->priv;
-  int 		 i;
+  bool planar = af_fmt_is_planar(data->format);
+
+  // Removing or routing channels: write the output over the input.
+  if(l->nch <= data->nch){
+    if(planar)
+      mp_chmix_process_planar(s->mix, (float **)data->planes,
+                              (float **)data->planes, data->samples);
+    else
+      mp_chmix_process(s->mix, data->planes[0], data->planes[0], data->samples);
+    mp_audio_set_channels(data, &l->channels);
+    return 0;
+  }
 
   mp_audio_realloc_min(af->data, data->samples);
-
-  // Reset unused channels
-  memset(l->planes[0],0,mp_audio_psize(c) / c->nch * l->nch);
-
-  if(AF_OK == check_routes(af,c->nch,l->nch))
-    for(i=0;i<s->nr;i++)
-      copy(af, c->planes[0],l->planes[0],c->nch,s->route[i][FR],
-	   l->nch,s->route[i][TO],mp_audio_psize(c),c->bps);
+  if(planar)
+    mp_chmix_process_planar(s->mix, (float **)l->planes,
+                            (float **)data->planes, data->samples);
+  else
+    mp_chmix_process(s->mix, l->planes[0], data->planes[0], data->samples);
 
   // Set output data
-  c->planes[0] = l->planes[0];
-  mp_audio_set_channels(c, &l->channels);
+  for(int n=0;n<l->num_planes;n++)
+    data->planes[n] = l->planes[n];
+  mp_audio_set_channels(data, &l->channels);
 
   return 0;
 }
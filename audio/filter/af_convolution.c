@@ -0,0 +1,286 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Convolve the audio with impulse responses loaded from a WAV file (for
+ * room correction, speaker/headphone equalization, reverb, ...).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libavutil/intfloat.h>
+#include <libavutil/intreadwrite.h>
+
+#include "talloc.h"
+
+#include "common/common.h"
+#include "af.h"
+#include "fft_conv.h"
+
+#define WAV_ID_RIFF 0x46464952 /* "RIFF" */
+#define WAV_ID_WAVE 0x45564157 /* "WAVE" */
+#define WAV_ID_FMT  0x20746d66 /* "fmt " */
+#define WAV_ID_DATA 0x61746164 /* "data" */
+#define WAV_ID_PCM  0x0001
+#define WAV_ID_FLOAT_PCM  0x0003
+#define WAV_ID_FORMAT_EXTENSIBLE 0xfffe
+
+// Upper bound for the IR length (about 22 seconds at 48 kHz).
+#define MAX_IR_LEN (1 << 20)
+// Upper bound for the IR file size.
+#define MAX_FILE_SIZE (512 * 1024 * 1024)
+
+struct priv {
+    char *filename;
+    int block;
+    float cfg_gain;
+
+    float gain;
+    float *ir;          // ir_nch planes of ir_len samples
+    int ir_nch, ir_len, ir_rate;
+    struct fft_conv *conv;
+    bool flushed;       // EOF was signaled and the delayed audio was output
+};
+
+static uint8_t *read_file(void *talloc_ctx, const char *filename, int *size)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+        return NULL;
+    uint8_t *buf = NULL;
+    int len = 0;
+    while (len < MAX_FILE_SIZE) {
+        buf = talloc_realloc_size(talloc_ctx, buf, len + 65536);
+        size_t r = fread(buf + len, 1, 65536, f);
+        len += r;
+        if (r < 65536)
+            break;
+    }
+    fclose(f);
+    *size = len;
+    return buf;
+}
+
+static int load_ir(struct af_instance *af)
+{
+    struct priv *p = af->priv;
+    void *tmp = talloc_new(NULL);
+    int res = -1;
+
+    int size = 0;
+    uint8_t *buf = read_file(tmp, p->filename, &size);
+    if (!buf) {
+        MP_ERR(af, "Can't open '%s'.\n", p->filename);
+        goto done;
+    }
+    if (size < 12 || AV_RL32(buf) != WAV_ID_RIFF ||
+        AV_RL32(buf + 8) != WAV_ID_WAVE)
+    {
+        MP_ERR(af, "'%s' is not a WAV file.\n", p->filename);
+        goto done;
+    }
+
+    int tag = -1, nch = 0, rate = 0, bits = 0;
+    uint8_t *data = NULL;
+    int data_len = 0;
+    int pos = 12;
+    while (size - pos >= 8) {
+        uint32_t id = AV_RL32(buf + pos);
+        int len = MPMIN(AV_RL32(buf + pos + 4), size - pos - 8);
+        uint8_t *chunk = buf + pos + 8;
+        if (id == WAV_ID_FMT && len >= 16) {
+            tag = AV_RL16(chunk);
+            nch = AV_RL16(chunk + 2);
+            rate = AV_RL32(chunk + 4);
+            bits = AV_RL16(chunk + 14);
+            if (tag == WAV_ID_FORMAT_EXTENSIBLE && len >= 26)
+                tag = AV_RL16(chunk + 24);
+        } else if (id == WAV_ID_DATA) {
+            data = chunk;
+            data_len = len;
+        }
+        pos += 8 + len + (len & 1);
+    }
+
+    bool ok = (tag == WAV_ID_PCM && (bits == 16 || bits == 24 || bits == 32)) ||
+              (tag == WAV_ID_FLOAT_PCM && bits == 32);
+    if (!ok || !data || nch < 1 || nch > AF_NCH * AF_NCH || rate < 1) {
+        MP_ERR(af, "'%s': unsupported WAV format (must be 16, 24 or 32 bit "
+               "integer or 32 bit float PCM).\n", p->filename);
+        goto done;
+    }
+    int bytes = bits / 8;
+    int len = data_len / (bytes * nch);
+    if (len < 1 || len > MAX_IR_LEN) {
+        MP_ERR(af, "'%s': impulse response is empty or too long.\n",
+               p->filename);
+        goto done;
+    }
+
+    p->ir = talloc_array(af, float, nch * len);
+    for (int i = 0; i < len; i++) {
+        for (int c = 0; c < nch; c++) {
+            uint8_t *s = data + (i * nch + c) * bytes;
+            float v;
+            if (tag == WAV_ID_FLOAT_PCM) {
+                v = av_int2float(AV_RL32(s));
+            } else if (bits == 16) {
+                v = (int16_t)AV_RL16(s) / 32768.0f;
+            } else if (bits == 24) {
+                v = ((int32_t)(AV_RL24(s) << 8) >> 8) / 8388608.0f;
+            } else {
+                v = (int32_t)AV_RL32(s) / 2147483648.0f;
+            }
+            p->ir[c * len + i] = v;
+        }
+    }
+    p->ir_nch = nch;
+    p->ir_len = len;
+    p->ir_rate = rate;
+    MP_VERBOSE(af, "Loaded %d channel impulse response with %d samples at "
+               "%d Hz.\n", nch, len, rate);
+    res = 0;
+done:
+    talloc_free(tmp);
+    return res;
+}
+
+// Set up the convolution of nch channels with the loaded IRs.
+static int setup_conv(struct af_instance *af, int nch)
+{
+    struct priv *p = af->priv;
+
+    talloc_free(p->conv);
+    p->conv = fft_conv_create(af, p->block, nch, nch, p->ir_len);
+    if (!p->conv)
+        return -1;
+
+    for (int out = 0; out < nch; out++) {
+        for (int in = 0; in < nch; in++) {
+            int ir_ch = -1;
+            if (p->ir_nch == nch * nch) {
+                // Full matrix: one IR for each input/output pair.
+                ir_ch = out * nch + in;
+            } else if (in == out) {
+                // One IR per channel, or the same IR for all channels.
+                ir_ch = p->ir_nch == 1 ? 0 : in;
+            }
+            if (ir_ch >= 0) {
+                fft_conv_set_ir(p->conv, out, in, p->ir + ir_ch * p->ir_len,
+                                p->ir_len, p->gain);
+            }
+        }
+    }
+    return 0;
+}
+
+static int control(struct af_instance *af, int cmd, void *arg)
+{
+    struct priv *p = af->priv;
+
+    switch (cmd) {
+    case AF_CONTROL_REINIT: {
+        struct mp_audio *in = arg;
+        int nch = in->nch;
+
+        mp_audio_copy_config(af->data, in);
+        mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+        af->data->rate = p->ir_rate;
+
+        if (p->ir_nch != 1 && p->ir_nch != nch && p->ir_nch != nch * nch) {
+            MP_ERR(af, "Impulse response has %d channels, but the audio has "
+                   "%d channels (must be 1, %d or %d).\n", p->ir_nch, nch,
+                   nch, nch * nch);
+            return AF_ERROR;
+        }
+        if (setup_conv(af, nch) < 0)
+            return AF_ERROR;
+        p->flushed = false;
+        af->delay = p->block / (double)af->data->rate;
+        return af_test_output(af, in);
+    }
+    case AF_CONTROL_RESET:
+        if (p->conv)
+            fft_conv_reset(p->conv);
+        p->flushed = false;
+        return AF_OK;
+    }
+    return AF_UNKNOWN;
+}
+
+static int filter(struct af_instance *af, struct mp_audio *data, int flags)
+{
+    struct priv *p = af->priv;
+
+    if (data->samples == 0 && (flags & AF_FILTER_FLAG_EOF)) {
+        if (p->flushed)
+            return 0;
+        // Output the audio still delayed by the convolution.
+        mp_audio_realloc_min(af->data, p->block);
+        mp_audio_copy_config(data, af->data);
+        data->planes[0] = af->data->planes[0];
+        data->samples = p->block;
+        mp_audio_fill_silence(data, 0, data->samples);
+        p->flushed = true;
+    } else {
+        p->flushed = false;
+    }
+
+    fft_conv_filter(p->conv, data->planes[0], data->planes[0], data->samples);
+    return 0;
+}
+
+static int af_open(struct af_instance *af)
+{
+    struct priv *p = af->priv;
+
+    af->control = control;
+    af->filter = filter;
+
+    if (!p->filename) {
+        MP_ERR(af, "No impulse response file set.\n");
+        return AF_ERROR;
+    }
+    if (p->block & (p->block - 1)) {
+        MP_ERR(af, "block must be a power of 2.\n");
+        return AF_ERROR;
+    }
+    if (load_ir(af) < 0)
+        return AF_ERROR;
+    af_from_dB(1, &p->cfg_gain, &p->gain, 20.0, -200.0, 60.0);
+    MP_VERBOSE(af, "Using %s complex multiply-accumulate.\n",
+               fft_conv_simd_name());
+    return AF_OK;
+}
+
+#define OPT_BASE_STRUCT struct priv
+
+struct af_info af_info_convolution = {
+    .info = "Convolution with impulse responses from a WAV file",
+    .name = "convolution",
+    .flags = AF_FLAGS_INPLACE,
+    .open = af_open,
+    .priv_size = sizeof(struct priv),
+    .options = (const struct m_option[]) {
+        OPT_STRING("file", filename, 0),
+        OPT_INTRANGE("block", block, 0, 8, 32768, OPTDEF_INT(512)),
+        OPT_FLOATRANGE("gain", cfg_gain, 0, -200, 60),
+        {0}
+    },
+};
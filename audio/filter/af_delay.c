@@ -62,7 +62,6 @@ static int control(struct af_instance* af, int cmd, void* arg)
     for(i=0;i<af->data->nch;i++)
       free(s->q[i]);
 
-    mp_audio_force_interleaved_format(in);
     mp_audio_copy_config(af->data, in);
 
     // Allocate new delay queues
@@ -102,17 +101,21 @@ static int filter(struct af_instance* af, struct mp_audio* data, int flags)
   struct mp_audio*   	c   = data;	 // Current working data
   af_delay_t*  	s   = af->priv; // Setup for this instance
   int 		nch = c->nch;	 // Number of channels
-  int		len = mp_audio_psize(c)/c->bps; // Number of sample in data chunk
+  int		planar = af_fmt_is_planar(c->format);
+  int		step = planar ? 1 : nch; // Distance between samples of a channel
+  int		len = c->samples*step; // Number of samples in a plane
   int		ri  = 0;
   int 		ch,i;
   for(ch=0;ch<nch;ch++){
+    void*	plane = c->planes[planar ? ch : 0];
+    int		first = planar ? 0 : ch; // Index of first sample of channel
     switch(c->bps){
     case 1:{
-      int8_t* a = c->planes[0];
+      int8_t* a = plane;
       int8_t* q = s->q[ch];
       int wi = s->wi[ch];
       ri = s->ri;
-      for(i=ch;i<len;i+=nch){
+      for(i=first;i<len;i+=step){
 	q[wi] = a[i];
 	a[i]  = q[ri];
 	UPDATEQI(wi);
@@ -122,11 +125,11 @@ static int filter(struct af_instance* af, struct mp_audio* data, int flags)
       break;
     }
     case 2:{
-      int16_t* a = c->planes[0];
+      int16_t* a = plane;
       int16_t* q = s->q[ch];
       int wi = s->wi[ch];
       ri = s->ri;
-      for(i=ch;i<len;i+=nch){
+      for(i=first;i<len;i+=step){
 	q[wi] = a[i];
 	a[i]  = q[ri];
 	UPDATEQI(wi);
@@ -136,11 +139,11 @@ static int filter(struct af_instance* af, struct mp_audio* data, int flags)
       break;
     }
     case 4:{
-      int32_t* a = c->planes[0];
+      int32_t* a = plane;
       int32_t* q = s->q[ch];
       int wi = s->wi[ch];
       ri = s->ri;
-      for(i=ch;i<len;i+=nch){
+      for(i=first;i<len;i+=step){
 	q[wi] = a[i];
 	a[i]  = q[ri];
 	UPDATEQI(wi);
@@ -181,6 +184,7 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_delay = {
     .info = "Delay audio filter",
     .name = "delay",
+    .flags = AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(af_delay_t),
     .options = (const struct m_option[]) {
@@ -1,327 +1,357 @@
 /*
- * Copyright (C) 2004 Alex Beregszaszi & Pierre Lombard
+ * This file is part of mpv.
  *
- * This file is part of MPlayer.
- *
- * MPlayer is free software; you can redistribute it and/or modify
+ * mpv is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 2 of the License, or
  * (at your option) any later version.
  *
- * MPlayer is distributed in the hope that it will be useful,
+ * mpv is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
  *
  * You should have received a copy of the GNU General Public License along
- * with MPlayer; if not, write to the Free Software Foundation, Inc.,
- * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Look-ahead compressor/limiter with linked channels.
+ *
+ * The audio is cut into blocks of BLOCK samples. For each block, the peak
+ * over all channels gives two target gains: the compressor gain (threshold,
+ * ratio, knee and makeup gain), and the limit gain, which is the highest gain
+ * that keeps the peak below the output ceiling. The audio is delayed by
+ * num_blocks blocks; the envelope follows the minimum of both targets over
+ * the look-ahead window with the attack and release time constants, so that
+ * the gain is already reduced when a peak arrives. The gain at the boundary
+ * of two blocks additionally never exceeds the limit gain of either block,
+ * and it is interpolated linearly within a block, so no sample exceeds the
+ * ceiling.
  */
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-#include <inttypes.h>
 #include <math.h>
-#include <limits.h>
+
+#include "config.h"
+#include "talloc.h"
 
 #include "common/common.h"
+#include "common/cpudetect.h"
 #include "af.h"
 
-// Methods:
-// 1: uses a 1 value memory and coefficients new=a*old+b*cur (with a+b=1)
-// 2: uses several samples to smooth the variations (standard weighted mean
-//    on past samples)
-
-// Size of the memory array
-// FIXME: should depend on the frequency of the data (should be a few seconds)
-#define NSAMPLES 128
-
-// If summing all the mem[].len is lower than MIN_SAMPLE_SIZE bytes, then we
-// choose to ignore the computed value as it's not significant enough
-// FIXME: should depend on the frequency of the data (0.5s maybe)
-#define MIN_SAMPLE_SIZE 32000
-
-// mul is the value by which the samples are scaled
-// and has to be in [MUL_MIN, MUL_MAX]
-#define MUL_INIT 1.0
-#define MUL_MIN 0.1
-#define MUL_MAX 5.0
-
-// Silence level
-// FIXME: should be relative to the level of the samples
-#define SIL_S16 (SHRT_MAX * 0.01)
-#define SIL_FLOAT 0.01
-
-// smooth must be in ]0.0, 1.0[
-#define SMOOTH_MUL 0.06
-#define SMOOTH_LASTAVG 0.06
-
-#define DEFAULT_TARGET 0.25
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+
+#define BLOCK 32
+
+// Move n floats of input from io to delay, and replace them with
+// delayed[i] * (g0 + dg * pos[i]). Returns the maximum of peak and all |input|.
+typedef float (*process_fn)(float *io, float *delay, const float *delayed,
+                            const float *pos, float g0, float dg, int n,
+                            float peak);
+
+struct priv {
+    // Options
+    float threshold, ratio, knee, attack, release, lookahead, makeup, limit;
+
+    process_fn process;
+    float ceiling;      // limit as linear gain
+
+    int planes;         // number of planes
+    int stride;         // floats per sample in a plane
+    int num_blocks;     // delay in blocks
+    int ring_blocks;    // num_blocks + 1 blocks of audio per plane
+    float *ring;        // planes * ring_blocks * BLOCK * stride floats
+    float *targets;     // target gain of the last ring_blocks blocks
+    float *limits;      // limit gain of the last ring_blocks blocks
+    float *ramp;        // position of each sample within a block (1/BLOCK
+                        // to 1, expanded to stride floats per sample)
+    int slot;           // ring slot of the block being filled (the next
+                        // slot holds the block being output)
+    int pos;            // samples in the block being filled
+    float block_peak;   // peak of the block being filled
+    float env;          // envelope (smoothed gain)
+    float gain;         // gain at the start of the output block
+    float gain_step;    // gain change over the output block
+    float att_coef, rel_coef;
+    bool flushed;       // EOF was signaled and the delayed audio was output
+};
 
-// Data for specific instances of this filter
-typedef struct af_volume_s
+static float process_c(float *io, float *delay, const float *delayed,
+                       const float *pos, float g0, float dg, int n, float peak)
 {
-    int method; // method used
-    float mul;
-    // method 1
-    float lastavg; // history value of the filter
-    // method 2
-    int idx;
-    struct {
-	float avg; // average level of the sample
-	int len; // sample size (weight)
-    } mem[NSAMPLES];
-    // "Ideal" level
-    float mid_s16;
-    float mid_float;
-}af_drc_t;
-
-// Initialization and runtime control
-static int control(struct af_instance* af, int cmd, void* arg)
+    for (int i = 0; i < n; i++) {
+        float x = io[i];
+        peak = MPMAX(peak, fabsf(x));
+        delay[i] = x;
+        io[i] = delayed[i] * (g0 + dg * pos[i]);
+    }
+    return peak;
+}
+
+#if HAVE_X86_INTRINSICS
+__attribute__((target("sse")))
+static float process_sse(float *io, float *delay, const float *delayed,
+                         const float *pos, float g0, float dg, int n,
+                         float peak)
 {
-  switch(cmd){
-  case AF_CONTROL_REINIT:
-    // Sanity check
-    if(!arg) return AF_ERROR;
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 vg0 = _mm_set1_ps(g0), vdg = _mm_set1_ps(dg);
+    __m128 acc = _mm_set1_ps(peak);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(io + i);
+        acc = _mm_max_ps(acc, _mm_and_ps(x, abs_mask));
+        _mm_storeu_ps(delay + i, x);
+        __m128 g = _mm_add_ps(vg0, _mm_mul_ps(vdg, _mm_loadu_ps(pos + i)));
+        _mm_storeu_ps(io + i, _mm_mul_ps(_mm_loadu_ps(delayed + i), g));
+    }
+    acc = _mm_max_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_max_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    return process_c(io + i, delay + i, delayed + i, pos + i, g0, dg, n - i,
+                     _mm_cvtss_f32(acc));
+}
 
-    mp_audio_force_interleaved_format((struct mp_audio*)arg);
-    mp_audio_copy_config(af->data, (struct mp_audio*)arg);
+__attribute__((target("avx2")))
+static float process_avx2(float *io, float *delay, const float *delayed,
+                          const float *pos, float g0, float dg, int n,
+                          float peak)
+{
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 vg0 = _mm256_set1_ps(g0), vdg = _mm256_set1_ps(dg);
+    __m256 acc = _mm256_set1_ps(peak);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(io + i);
+        acc = _mm256_max_ps(acc, _mm256_and_ps(x, abs_mask));
+        _mm256_storeu_ps(delay + i, x);
+        __m256 g = _mm256_add_ps(vg0, _mm256_mul_ps(vdg,
+                                                    _mm256_loadu_ps(pos + i)));
+        _mm256_storeu_ps(io + i, _mm256_mul_ps(_mm256_loadu_ps(delayed + i), g));
+    }
+    __m128 h = _mm_max_ps(_mm256_castps256_ps128(acc),
+                          _mm256_extractf128_ps(acc, 1));
+    h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+    h = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+    return process_c(io + i, delay + i, delayed + i, pos + i, g0, dg, n - i,
+                     _mm_cvtss_f32(h));
+}
+#endif
 
-    if(((struct mp_audio*)arg)->format != (AF_FORMAT_S16)){
-      mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+static process_fn get_process(const char **name)
+{
+#if HAVE_X86_INTRINSICS
+    if (gCpuCaps.hasAVX2) {
+        *name = "AVX2";
+        return process_avx2;
     }
-    return af_test_output(af,(struct mp_audio*)arg);
-  }
-  return AF_UNKNOWN;
+    if (gCpuCaps.hasSSE) {
+        *name = "SSE";
+        return process_sse;
+    }
+#endif
+    *name = "C";
+    return process_c;
 }
 
-static void method1_int16(af_drc_t *s, struct mp_audio *c)
+// Static gain curve: compute the target gain and the limit gain (both
+// linear) of a block with the given peak.
+static void block_gains(struct priv *p, float peak, float *target, float *limit)
 {
-  register int i = 0;
-  int16_t *data = (int16_t*)c->planes[0];	// Audio data
-  int len = c->samples*c->nch;		// Number of samples
-  float curavg = 0.0, newavg, neededmul;
-  int tmp;
-
-  for (i = 0; i < len; i++)
-  {
-    tmp = data[i];
-    curavg += tmp * tmp;
-  }
-  curavg = sqrt(curavg / (float) len);
-
-  // Evaluate an adequate 'mul' coefficient based on previous state, current
-  // samples level, etc
-
-  if (curavg > SIL_S16)
-  {
-    neededmul = s->mid_s16 / (curavg * s->mul);
-    s->mul = (1.0 - SMOOTH_MUL) * s->mul + SMOOTH_MUL * neededmul;
-
-    // clamp the mul coefficient
-    s->mul = MPCLAMP(s->mul, MUL_MIN, MUL_MAX);
-  }
-
-  // Scale & clamp the samples
-  for (i = 0; i < len; i++)
-  {
-    tmp = s->mul * data[i];
-    tmp = MPCLAMP(tmp, SHRT_MIN, SHRT_MAX);
-    data[i] = tmp;
-  }
-
-  // Evaulation of newavg (not 100% accurate because of values clamping)
-  newavg = s->mul * curavg;
-
-  // Stores computed values for future smoothing
-  s->lastavg = (1.0 - SMOOTH_LASTAVG) * s->lastavg + SMOOTH_LASTAVG * newavg;
+    float level = 20.0f * log10f(MPMAX(peak, 1e-9f));
+    float over = level - p->threshold;
+    float slope = 1.0f / p->ratio - 1.0f;
+    float gain_db;
+    if (2 * over <= -p->knee) {
+        gain_db = 0;
+    } else if (2 * over < p->knee) {
+        float x = over + p->knee / 2;
+        gain_db = slope * x * x / (2 * p->knee);
+    } else {
+        gain_db = slope * over;
+    }
+    *limit = peak > p->ceiling / 1e9f ? p->ceiling / peak : 1e9f;
+    *target = MPMIN(powf(10.0f, (gain_db + p->makeup) / 20.0f), *limit);
 }
 
-static void method1_float(af_drc_t *s, struct mp_audio *c)
+static float *ring_block(struct priv *p, int plane, int slot)
 {
-  register int i = 0;
-  float *data = (float*)c->planes[0];	// Audio data
-  int len = c->samples*c->nch;		// Number of samples
-  float curavg = 0.0, newavg, neededmul, tmp;
-
-  for (i = 0; i < len; i++)
-  {
-    tmp = data[i];
-    curavg += tmp * tmp;
-  }
-  curavg = sqrt(curavg / (float) len);
-
-  // Evaluate an adequate 'mul' coefficient based on previous state, current
-  // samples level, etc
-
-  if (curavg > SIL_FLOAT) // FIXME
-  {
-    neededmul = s->mid_float / (curavg * s->mul);
-    s->mul = (1.0 - SMOOTH_MUL) * s->mul + SMOOTH_MUL * neededmul;
-
-    // clamp the mul coefficient
-    s->mul = MPCLAMP(s->mul, MUL_MIN, MUL_MAX);
-  }
-
-  // Scale & clamp the samples
-  for (i = 0; i < len; i++)
-    data[i] *= s->mul;
-
-  // Evaulation of newavg (not 100% accurate because of values clamping)
-  newavg = s->mul * curavg;
-
-  // Stores computed values for future smoothing
-  s->lastavg = (1.0 - SMOOTH_LASTAVG) * s->lastavg + SMOOTH_LASTAVG * newavg;
+    return p->ring + (plane * p->ring_blocks + slot) * BLOCK * p->stride;
 }
 
-static void method2_int16(af_drc_t *s, struct mp_audio *c)
+static void reset(struct priv *p)
 {
-  register int i = 0;
-  int16_t *data = (int16_t*)c->planes[0];	// Audio data
-  int len = c->samples*c->nch;		// Number of samples
-  float curavg = 0.0, newavg, avg = 0.0;
-  int tmp, totallen = 0;
-
-  for (i = 0; i < len; i++)
-  {
-    tmp = data[i];
-    curavg += tmp * tmp;
-  }
-  curavg = sqrt(curavg / (float) len);
-
-  // Evaluate an adequate 'mul' coefficient based on previous state, current
-  // samples level, etc
-  for (i = 0; i < NSAMPLES; i++)
-  {
-    avg += s->mem[i].avg * (float)s->mem[i].len;
-    totallen += s->mem[i].len;
-  }
-
-  if (totallen > MIN_SAMPLE_SIZE)
-  {
-    avg /= (float)totallen;
-    if (avg >= SIL_S16)
-    {
-	s->mul = s->mid_s16 / avg;
-	s->mul = MPCLAMP(s->mul, MUL_MIN, MUL_MAX);
+    float gain, limit;
+    block_gains(p, 0, &gain, &limit);
+    memset(p->ring, 0,
+           p->planes * p->ring_blocks * BLOCK * p->stride * sizeof(float));
+    for (int n = 0; n < p->ring_blocks; n++) {
+        p->targets[n] = gain;
+        p->limits[n] = limit;
     }
-  }
-
-  // Scale & clamp the samples
-  for (i = 0; i < len; i++)
-  {
-    tmp = s->mul * data[i];
-    tmp = MPCLAMP(tmp, SHRT_MIN, SHRT_MAX);
-    data[i] = tmp;
-  }
-
-  // Evaulation of newavg (not 100% accurate because of values clamping)
-  newavg = s->mul * curavg;
-
-  // Stores computed values for future smoothing
-  s->mem[s->idx].len = len;
-  s->mem[s->idx].avg = newavg;
-  s->idx = (s->idx + 1) % NSAMPLES;
+    p->slot = 0;
+    p->pos = 0;
+    p->block_peak = 0;
+    p->env = gain;
+    p->gain = gain;
+    p->gain_step = 0;
+    p->flushed = false;
 }
 
-static void method2_float(af_drc_t *s, struct mp_audio *c)
+// Called when the block in p->slot is complete. The block in the slot after
+// it was output completely and the slot is reused for the next input; compute
+// the gain ramp of the next output block, which is in the slot after that.
+static void finish_block(struct priv *p)
 {
-  register int i = 0;
-  float *data = (float*)c->planes[0];	// Audio data
-  int len = c->samples*c->nch;		// Number of samples
-  float curavg = 0.0, newavg, avg = 0.0, tmp;
-  int totallen = 0;
-
-  for (i = 0; i < len; i++)
-  {
-    tmp = data[i];
-    curavg += tmp * tmp;
-  }
-  curavg = sqrt(curavg / (float) len);
-
-  // Evaluate an adequate 'mul' coefficient based on previous state, current
-  // samples level, etc
-  for (i = 0; i < NSAMPLES; i++)
-  {
-    avg += s->mem[i].avg * (float)s->mem[i].len;
-    totallen += s->mem[i].len;
-  }
-
-  if (totallen > MIN_SAMPLE_SIZE)
-  {
-    avg /= (float)totallen;
-    if (avg >= SIL_FLOAT)
-    {
-	s->mul = s->mid_float / avg;
-	s->mul = MPCLAMP(s->mul, MUL_MIN, MUL_MAX);
+    int cur = p->slot;
+    int done = (cur + 1) % p->ring_blocks;
+    int out = (cur + 2) % p->ring_blocks;
+    int next = (cur + 3) % p->ring_blocks;
+    block_gains(p, p->block_peak, &p->targets[cur], &p->limits[cur]);
+
+    // Gain at the end of the next output block: the envelope over the
+    // blocks after it (all slots but these two), limited by the block itself
+    // and the following one.
+    float target = p->targets[next];
+    for (int n = 0; n < p->ring_blocks; n++) {
+        if (n != done && n != out)
+            target = MPMIN(target, p->targets[n]);
     }
-  }
 
-  // Scale & clamp the samples
-  for (i = 0; i < len; i++)
-    data[i] *= s->mul;
+    float coef = target < p->env ? p->att_coef : p->rel_coef;
+    p->env = target + (p->env - target) * coef;
 
-  // Evaulation of newavg (not 100% accurate because of values clamping)
-  newavg = s->mul * curavg;
+    float gain = MPMIN(p->env, p->limits[out]);
+    gain = MPMIN(gain, p->limits[next]);
 
-  // Stores computed values for future smoothing
-  s->mem[s->idx].len = len;
-  s->mem[s->idx].avg = newavg;
-  s->idx = (s->idx + 1) % NSAMPLES;
+    p->gain += p->gain_step;
+    p->gain_step = gain - p->gain;
+
+    p->slot = done;
+    p->pos = 0;
+    p->block_peak = 0;
+}
+
+static int control(struct af_instance *af, int cmd, void *arg)
+{
+    struct priv *p = af->priv;
+
+    switch (cmd) {
+    case AF_CONTROL_REINIT: {
+        struct mp_audio *in = arg;
+
+        mp_audio_copy_config(af->data, in);
+        if (af_fmt_is_planar(in->format)) {
+            mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
+        } else {
+            mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+        }
+
+        bool planar = af_fmt_is_planar(af->data->format);
+        p->planes = planar ? af->data->nch : 1;
+        p->stride = planar ? 1 : af->data->nch;
+        int delay = lrint(p->lookahead / 1000.0 * af->data->rate);
+        p->num_blocks = MPMAX(2, (delay + BLOCK - 1) / BLOCK);
+        p->ring_blocks = p->num_blocks + 1;
+        p->ring = talloc_realloc(af, p->ring, float,
+                                 p->planes * p->ring_blocks * BLOCK * p->stride);
+        p->targets = talloc_realloc(af, p->targets, float, p->ring_blocks);
+        p->limits = talloc_realloc(af, p->limits, float, p->ring_blocks);
+        p->ramp = talloc_realloc(af, p->ramp, float, BLOCK * p->stride);
+        for (int i = 0; i < BLOCK; i++) {
+            for (int c = 0; c < p->stride; c++)
+                p->ramp[i * p->stride + c] = (i + 1) / (float)BLOCK;
+        }
+
+        double block_time = BLOCK / (double)af->data->rate;
+        p->att_coef = exp(-block_time / MPMAX(p->attack / 1000.0, 1e-6));
+        p->rel_coef = exp(-block_time / MPMAX(p->release / 1000.0, 1e-6));
+
+        reset(p);
+        af->delay = p->num_blocks * block_time;
+        return af_test_output(af, in);
+    }
+    case AF_CONTROL_RESET:
+        if (p->ring)
+            reset(p);
+        return AF_OK;
+    }
+    return AF_UNKNOWN;
 }
 
-static int filter(struct af_instance* af, struct mp_audio* data, int flags)
+static int filter(struct af_instance *af, struct mp_audio *data, int flags)
 {
-  af_drc_t *s = af->priv;
-
-  if(af->data->format == (AF_FORMAT_S16))
-  {
-    if (s->method == 2)
-	method2_int16(s, data);
-    else
-	method1_int16(s, data);
-  }
-  else if(af->data->format == (AF_FORMAT_FLOAT))
-  {
-    if (s->method == 2)
-	method2_float(s, data);
-    else
-	method1_float(s, data);
-  }
-  return 0;
+    struct priv *p = af->priv;
+
+    if (data->samples == 0 && (flags & AF_FILTER_FLAG_EOF)) {
+        if (p->flushed)
+            return 0;
+        // Output the audio still delayed by the look-ahead.
+        mp_audio_realloc_min(af->data, p->num_blocks * BLOCK);
+        mp_audio_copy_config(data, af->data);
+        for (int n = 0; n < data->num_planes; n++)
+            data->planes[n] = af->data->planes[n];
+        data->samples = p->num_blocks * BLOCK;
+        mp_audio_fill_silence(data, 0, data->samples);
+        p->flushed = true;
+    } else {
+        p->flushed = false;
+    }
+
+    int done = 0;
+    while (done < data->samples) {
+        int n = MPMIN(data->samples - done, BLOCK - p->pos);
+        int off = p->pos * p->stride;
+        for (int plane = 0; plane < p->planes; plane++) {
+            float *io = (float *)data->planes[plane] + done * p->stride;
+            float *in = ring_block(p, plane, p->slot) + off;
+            float *out = ring_block(p, plane, (p->slot + 1) % p->ring_blocks);
+            p->block_peak = p->process(io, in, out + off, p->ramp + off,
+                                       p->gain, p->gain_step, n * p->stride,
+                                       p->block_peak);
+        }
+        done += n;
+        p->pos += n;
+        if (p->pos == BLOCK)
+            finish_block(p);
+    }
+    return 0;
 }
 
-// Allocate memory and set function pointers
-static int af_open(struct af_instance* af){
-  int i = 0;
-  af->control=control;
-  af->filter=filter;
-  af_drc_t *priv = af->priv;
-
-  priv->mul = MUL_INIT;
-  priv->lastavg = ((float)SHRT_MAX) * DEFAULT_TARGET;
-  priv->idx = 0;
-  for (i = 0; i < NSAMPLES; i++)
-  {
-     priv->mem[i].len = 0;
-     priv->mem[i].avg = 0;
-  }
-  priv->mid_s16 = ((float)SHRT_MAX) * priv->mid_float;
-  return AF_OK;
+static int af_open(struct af_instance *af)
+{
+    struct priv *p = af->priv;
+
+    af->control = control;
+    af->filter = filter;
+
+    const char *simd;
+    p->process = get_process(&simd);
+    p->ceiling = powf(10.0f, p->limit / 20.0f);
+    MP_VERBOSE(af, "Using %s gain application.\n", simd);
+    return AF_OK;
 }
 
-#define OPT_BASE_STRUCT af_drc_t
+#define OPT_BASE_STRUCT struct priv
+
 struct af_info af_info_drc = {
-    .info = "Dynamic range compression filter",
+    .info = "Dynamic range compressor/limiter with look-ahead",
     .name = "drc",
-    .flags = AF_FLAGS_NOT_REENTRANT,
+    .flags = AF_FLAGS_INPLACE,
     .open = af_open,
-    .priv_size = sizeof(af_drc_t),
+    .priv_size = sizeof(struct priv),
     .options = (const struct m_option[]) {
-        OPT_INTRANGE("method", method, 0, 1, 2, OPTDEF_INT(1)),
-        OPT_FLOAT("target", mid_float, 0, OPTDEF_FLOAT(DEFAULT_TARGET)),
+        OPT_FLOATRANGE("threshold", threshold, 0, -60, 0,
+                       OPTDEF_FLOAT(-20)),
+        OPT_FLOATRANGE("ratio", ratio, 0, 1, 100, OPTDEF_FLOAT(4)),
+        OPT_FLOATRANGE("knee", knee, 0, 0, 24, OPTDEF_FLOAT(6)),
+        OPT_FLOATRANGE("attack", attack, 0, 0, 1000, OPTDEF_FLOAT(5)),
+        OPT_FLOATRANGE("release", release, 0, 1, 5000, OPTDEF_FLOAT(200)),
+        OPT_FLOATRANGE("lookahead", lookahead, 0, 0, 100, OPTDEF_FLOAT(5)),
+        OPT_FLOATRANGE("makeup", makeup, 0, 0, 40, OPTDEF_FLOAT(0)),
+        OPT_FLOATRANGE("limit", limit, 0, -20, 0, OPTDEF_FLOAT(0)),
         {0}
     },
 };
@@ -57,5 +57,6 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_dummy = {
     .info = "dummy",
     .name = "dummy",
+    .flags = AF_FLAGS_INPLACE,
     .open = af_open,
 };
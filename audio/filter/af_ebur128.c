@@ -0,0 +1,452 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Loudness measurement according to EBU R128 / ITU-R BS.1770. The audio
+ * passes through unchanged.
+ *
+ * The audio is K-weighted (a high shelf and a high pass biquad), with the
+ * channel weights folded into the gain of the second section, so that the
+ * weighted energy is just the sum of squares over all channels. Energies of
+ * 400 ms blocks overlapping by 75% are collected in a histogram with 0.1 LU
+ * bins, from which the gated integrated loudness is computed. The true peak
+ * is the peak of the signal upsampled by 4 with a polyphase FIR.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/cpudetect.h"
+#include "af.h"
+#include "biquad.h"
+
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+
+#define ABS_GATE -70.0          // LUFS
+#define REL_GATE -10.0          // LU
+#define HIST_STEP 0.1           // LU per histogram bin
+#define HIST_BINS 1000          // up to +30 LUFS
+
+#define TP_PHASES 4             // true peak oversampling factor
+#define TP_TAPS 12              // FIR taps per phase
+
+// Returns the sum of src[i]^2.
+typedef float (*sumsq_fn)(const float *src, int n);
+// Upsample n samples (read with the given stride) and return the maximum of
+// peak and the absolute values of the upsampled signal. hist is the filter
+// history (2 * TP_TAPS floats) and *pos the current position in it.
+typedef float (*true_peak_fn)(const float *coefs, float *hist, int *pos,
+                              const float *src, int stride, int n, float peak);
+
+struct priv {
+    sumsq_fn sumsq;
+    true_peak_fn true_peak;
+
+    int nch;
+    bool planar;
+    struct mp_biquad *kw;
+    float *scratch;             // K-weighted copy of the input
+    int scratch_size;
+
+    int sub_len;                // samples per 100 ms sub-block
+    int sub_pos;
+    double sub_sum;
+    double subs[4];             // energy of the last 4 sub-blocks
+    int num_subs;
+
+    double hist_energy[HIST_BINS];
+    int64_t hist_count[HIST_BINS];
+
+    // coefficient t * TP_PHASES + p weights the input t samples back for
+    // output phase p
+    float tp_coefs[TP_TAPS * TP_PHASES];
+    float tp_hist[MP_NUM_CHANNELS][2 * TP_TAPS];
+    int tp_pos;
+    float tp_max;
+
+    double duration;
+};
+
+static float sumsq_c(const float *src, int n)
+{
+    float sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += src[i] * src[i];
+    return sum;
+}
+
+static float true_peak_c(const float *coefs, float *hist, int *pos,
+                         const float *src, int stride, int n, float peak)
+{
+    int p = *pos;
+    for (int i = 0; i < n; i++) {
+        p = p ? p - 1 : TP_TAPS - 1;
+        hist[p] = hist[p + TP_TAPS] = src[i * stride];
+        const float *w = hist + p;
+        for (int ph = 0; ph < TP_PHASES; ph++) {
+            float y = 0;
+            for (int t = 0; t < TP_TAPS; t++)
+                y += coefs[t * TP_PHASES + ph] * w[t];
+            peak = MPMAX(peak, fabsf(y));
+        }
+    }
+    *pos = p;
+    return peak;
+}
+
+#if HAVE_X86_INTRINSICS
+__attribute__((target("sse")))
+static float sumsq_sse(const float *src, int n)
+{
+    __m128 acc = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(src + i);
+        acc = _mm_add_ps(acc, _mm_mul_ps(x, x));
+    }
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    return _mm_cvtss_f32(acc) + sumsq_c(src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static float sumsq_avx2(const float *src, int n)
+{
+    __m256 acc = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(src + i);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(x, x));
+    }
+    __m128 h = _mm_add_ps(_mm256_castps256_ps128(acc),
+                          _mm256_extractf128_ps(acc, 1));
+    h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+    h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+    return _mm_cvtss_f32(h) + sumsq_c(src + i, n - i);
+}
+
+// All 4 phases of an output sample are computed in one vector.
+__attribute__((target("sse")))
+static float true_peak_sse(const float *coefs, float *hist, int *pos,
+                           const float *src, int stride, int n, float peak)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 acc = _mm_set1_ps(peak);
+    int p = *pos;
+    for (int i = 0; i < n; i++) {
+        p = p ? p - 1 : TP_TAPS - 1;
+        hist[p] = hist[p + TP_TAPS] = src[i * stride];
+        const float *w = hist + p;
+        __m128 y = _mm_setzero_ps();
+        for (int t = 0; t < TP_TAPS; t++) {
+            y = _mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(coefs + t * TP_PHASES),
+                                         _mm_set1_ps(w[t])));
+        }
+        acc = _mm_max_ps(acc, _mm_andnot_ps(sign, y));
+    }
+    *pos = p;
+    acc = _mm_max_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_max_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    return _mm_cvtss_f32(acc);
+}
+#endif
+
+static const char *select_simd(struct priv *p)
+{
+    p->sumsq = sumsq_c;
+    p->true_peak = true_peak_c;
+#if HAVE_X86_INTRINSICS
+    if (gCpuCaps.hasSSE) {
+        p->sumsq = sumsq_sse;
+        p->true_peak = true_peak_sse;
+    }
+    if (gCpuCaps.hasAVX2) {
+        p->sumsq = sumsq_avx2;
+        return "AVX2";
+    }
+    if (gCpuCaps.hasSSE)
+        return "SSE";
+#endif
+    return "C";
+}
+
+// Hann windowed sinc interpolator. Phase 0 reproduces the input (delayed by
+// TP_TAPS / 2 - 1 samples).
+static void init_true_peak(struct priv *p)
+{
+    double center = TP_TAPS / 2 - 1;
+    for (int ph = 0; ph < TP_PHASES; ph++) {
+        double sum = 0;
+        for (int t = 0; t < TP_TAPS; t++) {
+            double x = t - center - ph / (double)TP_PHASES;
+            double sinc = x == 0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double win = 0.5 + 0.5 * cos(M_PI * x / (TP_TAPS / 2));
+            p->tp_coefs[t * TP_PHASES + ph] = sinc * win;
+            sum += sinc * win;
+        }
+        for (int t = 0; t < TP_TAPS; t++)
+            p->tp_coefs[t * TP_PHASES + ph] /= sum;
+    }
+}
+
+// ITU-R BS.1770 channel weights.
+static double channel_weight(int speaker)
+{
+    switch (speaker) {
+    case MP_SPEAKER_ID_LFE:
+    case MP_SPEAKER_ID_LFE2:
+        return 0.0;
+    case MP_SPEAKER_ID_SL:
+    case MP_SPEAKER_ID_SR:
+    case MP_SPEAKER_ID_BL:
+    case MP_SPEAKER_ID_BR:
+        return 1.41;
+    default:
+        return 1.0;
+    }
+}
+
+// K-weighting filter (BS.1770 pre-filter and RLB high pass), with the
+// coefficients recomputed for the given sample rate.
+static void init_k_weighting(struct af_instance *af, struct mp_audio *fmt)
+{
+    struct priv *p = af->priv;
+    double rate = fmt->rate;
+
+    talloc_free(p->kw);
+    p->kw = mp_biquad_create(af, fmt->nch, 2);
+
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / rate);
+    double vh = pow(10.0, gain / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    struct mp_biquad_coeffs shelf = {
+        .b0 = (vh + vb * k / q + k * k) / a0,
+        .b1 = 2.0 * (k * k - vh) / a0,
+        .b2 = (vh - vb * k / q + k * k) / a0,
+        .a1 = 2.0 * (k * k - 1.0) / a0,
+        .a2 = (1.0 - k / q + k * k) / a0,
+    };
+    mp_biquad_set(p->kw, 0, -1, &shelf);
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / rate);
+    a0 = 1.0 + k / q + k * k;
+    for (int c = 0; c < fmt->nch; c++) {
+        double g = sqrt(channel_weight(fmt->channels.speaker[c]));
+        struct mp_biquad_coeffs hp = {
+            .b0 = g,
+            .b1 = -2.0 * g,
+            .b2 = g,
+            .a1 = 2.0 * (k * k - 1.0) / a0,
+            .a2 = (1.0 - k / q + k * k) / a0,
+        };
+        mp_biquad_set(p->kw, 1, c, &hp);
+    }
+    mp_biquad_commit(p->kw, 2, 0);
+}
+
+static double energy_to_loudness(double energy)
+{
+    return energy > 0 ? -0.691 + 10 * log10(energy) : -HUGE_VAL;
+}
+
+static void add_block(struct priv *p, double energy)
+{
+    double l = energy_to_loudness(energy);
+    if (l <= ABS_GATE)
+        return;
+    int bin = MPMIN((int)((l - ABS_GATE) / HIST_STEP), HIST_BINS - 1);
+    p->hist_energy[bin] += energy;
+    p->hist_count[bin] += 1;
+}
+
+static void end_sub_block(struct priv *p)
+{
+    p->subs[p->num_subs % 4] = p->sub_sum / p->sub_len;
+    p->num_subs++;
+    p->sub_sum = 0;
+    p->sub_pos = 0;
+    if (p->num_subs >= 4)
+        add_block(p, (p->subs[0] + p->subs[1] + p->subs[2] + p->subs[3]) / 4);
+}
+
+// Mean loudness of the blocks above the given gate.
+static double gated_loudness(struct priv *p, double gate)
+{
+    double sum = 0;
+    int64_t count = 0;
+    for (int n = 0; n < HIST_BINS; n++) {
+        // Compare with the bin center.
+        if (ABS_GATE + (n + 0.5) * HIST_STEP > gate) {
+            sum += p->hist_energy[n];
+            count += p->hist_count[n];
+        }
+    }
+    return count ? energy_to_loudness(sum / count) : -HUGE_VAL;
+}
+
+static void get_loudness(struct priv *p, struct af_loudness *res)
+{
+    double rel_gate = gated_loudness(p, ABS_GATE) + REL_GATE;
+    *res = (struct af_loudness) {
+        .integrated = gated_loudness(p, MPMAX(rel_gate, ABS_GATE)),
+        .true_peak = p->tp_max > 0 ? 20 * log10(p->tp_max) : -HUGE_VAL,
+        .duration = p->duration,
+    };
+}
+
+// Clear the filter states and the current block (but not the measurements).
+static void reset(struct priv *p)
+{
+    if (p->kw)
+        mp_biquad_reset(p->kw);
+    memset(p->tp_hist, 0, sizeof(p->tp_hist));
+    p->sub_pos = 0;
+    p->sub_sum = 0;
+    p->num_subs = 0;
+}
+
+static int control(struct af_instance *af, int cmd, void *arg)
+{
+    struct priv *p = af->priv;
+
+    switch (cmd) {
+    case AF_CONTROL_REINIT: {
+        struct mp_audio *in = arg;
+
+        mp_audio_copy_config(af->data, in);
+        if (af_fmt_is_planar(in->format)) {
+            mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
+        } else {
+            mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+        }
+        if (af->data->nch > MP_NUM_CHANNELS || af->data->rate < 1000)
+            return AF_ERROR;
+
+        p->nch = af->data->nch;
+        p->planar = af_fmt_is_planar(af->data->format);
+        p->sub_len = lrint(af->data->rate / 10.0);
+        init_k_weighting(af, af->data);
+        reset(p);
+        return af_test_output(af, in);
+    }
+    case AF_CONTROL_RESET:
+        reset(p);
+        return AF_OK;
+    case AF_CONTROL_GET_LOUDNESS:
+        get_loudness(p, arg);
+        return AF_OK;
+    }
+    return AF_UNKNOWN;
+}
+
+static int filter(struct af_instance *af, struct mp_audio *data, int flags)
+{
+    struct priv *p = af->priv;
+    int samples = data->samples;
+
+    if (!samples)
+        return 0;
+
+    int pos = p->tp_pos;
+    for (int c = 0; c < p->nch; c++) {
+        const float *src = p->planar ? data->planes[c]
+                                     : (float *)data->planes[0] + c;
+        pos = p->tp_pos;
+        p->tp_max = p->true_peak(p->tp_coefs, p->tp_hist[c], &pos, src,
+                                 p->planar ? 1 : p->nch, samples, p->tp_max);
+    }
+    p->tp_pos = pos;
+
+    if (p->scratch_size < samples * p->nch) {
+        p->scratch_size = samples * p->nch;
+        p->scratch = talloc_realloc(af, p->scratch, float, p->scratch_size);
+        af->stats_allocs++;
+    }
+    float *planes[MP_NUM_CHANNELS];
+    if (p->planar) {
+        for (int c = 0; c < p->nch; c++) {
+            planes[c] = p->scratch + c * samples;
+            memcpy(planes[c], data->planes[c], samples * sizeof(float));
+        }
+        mp_biquad_process_planar(p->kw, planes, samples);
+    } else {
+        memcpy(p->scratch, data->planes[0], samples * p->nch * sizeof(float));
+        mp_biquad_process(p->kw, p->scratch, samples);
+    }
+
+    int done = 0;
+    while (done < samples) {
+        int n = MPMIN(samples - done, p->sub_len - p->sub_pos);
+        if (p->planar) {
+            for (int c = 0; c < p->nch; c++)
+                p->sub_sum += p->sumsq(planes[c] + done, n);
+        } else {
+            p->sub_sum += p->sumsq(p->scratch + done * p->nch, n * p->nch);
+        }
+        done += n;
+        p->sub_pos += n;
+        if (p->sub_pos == p->sub_len)
+            end_sub_block(p);
+    }
+
+    p->duration += samples / (double)data->rate;
+    return 0;
+}
+
+static void uninit(struct af_instance *af)
+{
+    struct priv *p = af->priv;
+    struct af_loudness l;
+    get_loudness(p, &l);
+    if (p->duration > 0) {
+        MP_INFO(af, "Integrated loudness: %.1f LUFS, true peak: %.1f dBTP\n",
+                l.integrated, l.true_peak);
+    }
+}
+
+static int af_open(struct af_instance *af)
+{
+    struct priv *p = af->priv;
+
+    af->control = control;
+    af->filter = filter;
+    af->uninit = uninit;
+
+    init_true_peak(p);
+    MP_VERBOSE(af, "Using %s sum of squares.\n", select_simd(p));
+    return AF_OK;
+}
+
+struct af_info af_info_ebur128 = {
+    .info = "EBU R128 loudness meter",
+    .name = "ebur128",
+    .flags = AF_FLAGS_INPLACE,
+    .open = af_open,
+    .priv_size = sizeof(struct priv),
+};
@@ -1,8 +1,7 @@
 /*
  * Equalizer filter, implementation of a 10 band time domain graphic
- * equalizer using IIR filters. The IIR filters are implemented using a
- * Direct Form II approach, but has been modified (b1 == 0 always) to
- * save computation.
+ * equalizer using IIR filters, plus optional parametric bands. All bands
+ * are run as a cascade of biquad sections (see biquad.c).
  *
  * Copyright (C) 2001 Anders Johansson ajh@atri.curtin.edu.au
  *
@@ -25,15 +24,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <inttypes.h>
 #include <math.h>
 
+#include "talloc.h"
+
 #include "common/common.h"
+#include "options/m_config.h"
 #include "af.h"
+#include "biquad.h"
 
 #define L   	2      // Storage for filter taps
 #define KM  	10     // Max number of bands
+#define KP      32     // Max number of parametric bands
 
 #define Q   1.2247449 /* Q value for band-pass filters 1.2247=(3/2)^(1/2)
 			 gives 4dB suppression @ Fc*2 and Fc/2 */
@@ -58,17 +63,22 @@
 #define G_MAX	+12.0
 #define G_MIN	-12.0
 
+// Duration of the transition when changing parameters at runtime (seconds)
+#define RAMP_TIME 0.02
+
+// Parametric band
+struct band {
+  int     type;            // enum mp_biquad_type
+  double  freq, gain, q;
+};
+
 // Data for specific instances of this filter
 typedef struct af_equalizer_s
 {
-  float   a[KM][L];        	// A weights
-  float   b[KM][L];	     	// B weights
-  float   wq[AF_NCH][KM][L];  	// Circular buffer for W data
-  float   g[AF_NCH][KM];      	// Gain factor for each channel and band
-  int     K; 		   	// Number of used eq bands
-  int     channels;        	// Number of channels
-  float   gain_factor;     // applied at output to avoid clipping
-  double  p[KM];
+  struct mp_biquad *bq;    // All bands as biquad cascade
+  int     channels;        // Number of channels bq was created for
+  double  p[KM];           // Gain of each octave band (dB)
+  char   *bands;           // Parametric bands
 } af_equalizer_t;
 
 // 2nd order Band-pass Filter design
@@ -83,6 +93,140 @@ static void bp2(float* a, float* b, float fc, float q){
   b[1] = -1.0050;
 }
 
+// Parse "type/freq/gain[/q],..." into bands (if not NULL). Returns the
+// number of bands, or -1 on error.
+static int parse_bands(struct af_instance* af, const char *str,
+		       struct band *bands)
+{
+  int num = 0;
+  bstr rest = bstr0(str);
+
+  while(rest.len){
+    bstr item, f[4];
+    int nf = 0;
+    bstr_split_tok(rest, ",", &item, &rest);
+    while(item.len && nf < 4)
+      bstr_split_tok(item, "/", &f[nf++], &item);
+
+    char *type = bstrto0(NULL, f[0]);
+    struct band b = { .type = mp_biquad_type_from_name(type) };
+    talloc_free(type);
+    bool ok = nf >= 3 && b.type >= 0;
+    if(ok){
+      b.freq = bstrtod(f[1], &f[1]);
+      b.gain = MPCLAMP(bstrtod(f[2], &f[2]), -30, 30);
+      b.q    = b.type == MP_BIQUAD_PEAK || b.type == MP_BIQUAD_NOTCH ?
+               1.0 : M_SQRT1_2;
+      if(nf >= 4)
+        b.q = bstrtod(f[3], &f[3]);
+      ok = !f[1].len && !f[2].len && (nf < 4 || !f[3].len) &&
+           b.freq > 0 && b.q > 0;
+    }
+    if(!ok || item.len){
+      MP_ERR(af, "[equalizer] Invalid band: '%s'\n", str);
+      return -1;
+    }
+    if(num == KP){
+      MP_ERR(af, "[equalizer] At most %d bands are supported.\n", KP);
+      return -1;
+    }
+    if(bands)
+      bands[num] = b;
+    num++;
+  }
+  return num;
+}
+
+// Set up the biquad cascade for the current parameters
+static int setup_filters(struct af_instance* af, int ramp)
+{
+  af_equalizer_t* s = af->priv;
+  struct mp_biquad_coeffs c[KM + KP];
+  struct band bands[KP];
+  float F[KM] = CF;
+  double rate = af->data->rate;
+  double max_gain = 0;
+  int n = 0, k;
+
+  int num_bands = parse_bands(af, s->bands, bands);
+  if(num_bands < 0)
+    return AF_ERROR;
+
+  // Octave bands: the output of a band-pass filter (scaled by g) is added
+  // to the input, which is the same as a single biquad with the band-pass
+  // denominator.
+  for(k=0;k<KM;k++){
+    double g = pow(10.0,MPCLAMP(s->p[k],G_MIN,G_MAX)/20.0)-1.0;
+    float a[L], b[L];
+
+    if(max_gain < g) max_gain = g;
+    if(g == 0 || F[k] > rate/2.2)
+      continue;
+    bp2(a,b,F[k]/rate,Q);
+    c[n++] = (struct mp_biquad_coeffs){
+      .b0 = 1 + g*b[0], .b1 = -a[0], .b2 = -a[1] + g*b[0]*b[1],
+      .a1 = -a[0], .a2 = -a[1],
+    };
+  }
+  for(k=KM;k>0 && F[k-1] > rate/2.2;k--);
+  if(k != KM)
+    MP_INFO(af, "[equalizer] Limiting the number of filters to"
+	   " %i due to low sample rate.\n",k);
+
+  // Parametric bands
+  for(k=0;k<num_bands;k++){
+    if(bands[k].freq >= rate/2){
+      MP_WARN(af, "[equalizer] Band at %g Hz is above the Nyquist "
+	      "frequency, ignoring it.\n", bands[k].freq);
+      continue;
+    }
+    if(bands[k].type <= MP_BIQUAD_HIGHSHELF)
+      max_gain = MPMAX(max_gain, pow(10.0, bands[k].gain/20.0)-1.0);
+    mp_biquad_design(&c[n++], bands[k].type, bands[k].freq, bands[k].gain,
+		     bands[k].q, rate);
+  }
+
+  // Calculate gain factor to prevent clipping at output, and apply it to
+  // the last section (the low frequency sections are the most sensitive to
+  // rounding errors)
+  double gain_factor = log10(max_gain + 1.0) * 20.0;
+  gain_factor = gain_factor > 0.0 ? 0.1 + gain_factor/12.0 : 1;
+  if(n > 0){
+    c[n-1].b0 *= gain_factor;
+    c[n-1].b1 *= gain_factor;
+    c[n-1].b2 *= gain_factor;
+  }
+
+  for(k=0;k<n;k++)
+    mp_biquad_set(s->bq, k, -1, &c[k]);
+  mp_biquad_commit(s->bq, n, ramp);
+  return AF_OK;
+}
+
+// Apply new sub-options while playing
+static int reparse_cmdline(struct af_instance* af, char *args)
+{
+  af_equalizer_t* s = af->priv;
+  struct m_config *cfg = m_config_new(NULL, af->log, sizeof(*s), s,
+                                      af->info->options);
+  af_equalizer_t* opts = cfg->optstruct;
+  int r = m_config_parse_suboptions(cfg, "equalizer", args);
+
+  if(r >= 0 && parse_bands(af, opts->bands, NULL) < 0)
+    r = -1;
+  if(r >= 0){
+    const struct m_option *bands_opt =
+      m_option_list_find(af->info->options, "bands");
+    memcpy(s->p, opts->p, sizeof(s->p));
+    m_option_copy(bands_opt, &s->bands, &opts->bands);
+    if(s->bq)
+      r = setup_filters(af, RAMP_TIME * af->data->rate) == AF_OK ? 0 : -1;
+  }
+
+  talloc_free(cfg);
+  return r >= 0 ? AF_OK : AF_ERROR;
+}
+
 // Initialization and runtime control
 static int control(struct af_instance* af, int cmd, void* arg)
 {
@@ -90,53 +234,33 @@ static int control(struct af_instance* af, int cmd, void* arg)
 
   switch(cmd){
   case AF_CONTROL_REINIT:{
-    int k =0, i =0;
-    float F[KM] = CF;
-
-    s->gain_factor=0.0;
-
     // Sanity check
     if(!arg) return AF_ERROR;
 
     mp_audio_copy_config(af->data, (struct mp_audio*)arg);
     mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+    if(af_fmt_is_planar(((struct mp_audio*)arg)->format))
+      mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
 
-    // Calculate number of active filters
-    s->K=KM;
-    while(F[s->K-1] > (float)af->data->rate/2.2)
-      s->K--;
-
-    if(s->K != KM)
-      MP_INFO(af, "[equalizer] Limiting the number of filters to"
-	     " %i due to low sample rate.\n",s->K);
-
-    // Generate filter taps
-    for(k=0;k<s->K;k++)
-      bp2(s->a[k],s->b[k],F[k]/((float)af->data->rate),Q);
+    if(!s->bq || s->channels != af->data->nch){
+      talloc_free(s->bq);
+      s->bq = mp_biquad_create(af, af->data->nch, KM + KP);
+      s->channels = af->data->nch;
+    }
+    if(setup_filters(af, 0) != AF_OK)
+      return AF_ERROR;
 
     // Calculate how much this plugin adds to the overall time delay
     af->delay = 2.0 / (double)af->data->rate;
 
-    // Calculate gain factor to prevent clipping at output
-    for(k=0;k<AF_NCH;k++)
-    {
-        for(i=0;i<KM;i++)
-        {
-            if(s->gain_factor < s->g[k][i]) s->gain_factor=s->g[k][i];
-        }
-    }
-
-    s->gain_factor=log10(s->gain_factor + 1.0) * 20.0;
-
-    if(s->gain_factor > 0.0)
-    {
-        s->gain_factor=0.1+(s->gain_factor/12.0);
-    }else{
-        s->gain_factor=1;
-    }
-
     return af_test_output(af,arg);
   }
+  case AF_CONTROL_RESET:
+    if(s->bq)
+      mp_biquad_reset(s->bq);
+    return AF_OK;
+  case AF_CONTROL_SET_COMMAND_LINE:
+    return reparse_cmdline(af, arg);
   }
   return AF_UNKNOWN;
 }
@@ -144,52 +268,24 @@ static int control(struct af_instance* af, int cmd, void* arg)
 // Filter data through filter
 static int filter(struct af_instance* af, struct mp_audio* data, int flags)
 {
-  struct mp_audio*       c 	= data;			    	// Current working data
-  af_equalizer_t*  s 	= (af_equalizer_t*)af->priv; 	// Setup
-  uint32_t  	   ci  	= af->data->nch; 	    	// Index for channels
-  uint32_t	   nch 	= af->data->nch;   	    	// Number of channels
-
-  while(ci--){
-    float*	g   = s->g[ci];      // Gain factor
-    float*	in  = ((float*)c->planes[0])+ci;
-    float*	out = ((float*)c->planes[0])+ci;
-    float* 	end = in + c->samples*c->nch; // Block loop end
-
-    while(in < end){
-      register int	k  = 0;		// Frequency band index
-      register float 	yt = *in; 	// Current input sample
-      in+=nch;
-
-      // Run the filters
-      for(;k<s->K;k++){
- 	// Pointer to circular buffer wq
- 	register float* wq = s->wq[ci][k];
- 	// Calculate output from AR part of current filter
- 	register float w=yt*s->b[k][0] + wq[0]*s->a[k][0] + wq[1]*s->a[k][1];
- 	// Calculate output form MA part of current filter
- 	yt+=(w + wq[1]*s->b[k][1])*g[k];
- 	// Update circular buffer
- 	wq[1] = wq[0];
-	wq[0] = w;
-      }
-      // Calculate output
-      *out=yt*s->gain_factor;
-      out+=nch;
-    }
-  }
+  af_equalizer_t* s = af->priv;
+
+  if(af_fmt_is_planar(data->format))
+    mp_biquad_process_planar(s->bq, (float**)data->planes, data->samples);
+  else
+    mp_biquad_process(s->bq, data->planes[0], data->samples);
   return 0;
 }
 
 // Allocate memory and set function pointers
 static int af_open(struct af_instance* af){
+  af_equalizer_t *priv = af->priv;
   af->control=control;
   af->filter=filter;
-  af_equalizer_t *priv = af->priv;
-  for(int i=0;i<AF_NCH;i++){
-      for(int j=0;j<KM;j++){
-        priv->g[i][j] = pow(10.0,MPCLAMP(priv->p[j],G_MIN,G_MAX)/20.0)-1.0;
-      }
-    }
+  if(parse_bands(af, priv->bands, NULL) < 0)
+    return AF_ERROR;
+  MP_VERBOSE(af, "[equalizer] Using %s biquad implementation.\n",
+	     mp_biquad_simd_name());
   return AF_OK;
 }
 
@@ -197,13 +293,14 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_equalizer = {
   .info = "Equalizer audio filter",
   .name = "equalizer",
-  .flags = AF_FLAGS_NOT_REENTRANT,
+  .flags = AF_FLAGS_NOT_REENTRANT | AF_FLAGS_INPLACE,
   .open = af_open,
   .priv_size = sizeof(af_equalizer_t),
   .options = (const struct m_option[]) {
 #define BAND(n) OPT_DOUBLE("e" #n, p[n], 0)
         BAND(0), BAND(1), BAND(2), BAND(3), BAND(4),
         BAND(5), BAND(6), BAND(7), BAND(8), BAND(9),
+        OPT_STRING("bands", bands, 0),
         {0}
   },
 };
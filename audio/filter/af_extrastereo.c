@@ -52,7 +52,7 @@ static int control(struct af_instance* af, int cmd, void* arg)
     if (af->data->format == AF_FORMAT_FLOAT)
     {
 	af->filter = play_float;
-    }// else
+    } else
     {
         mp_audio_set_format(af->data, AF_FORMAT_S16);
 	af->filter = play_s16;
@@ -121,7 +121,7 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_extrastereo = {
     .info = "Increase difference between audio channels",
     .name = "extrastereo",
-    .flags = AF_FLAGS_NOT_REENTRANT,
+    .flags = AF_FLAGS_NOT_REENTRANT | AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(af_extrastereo_t),
     .options = (const struct m_option[]) {
@@ -28,24 +28,38 @@
 #include <inttypes.h>
 
 #include <math.h>
-#include <libavutil/common.h>
 
+#include "talloc.h"
+
+#include "common/common.h"
 #include "af.h"
 #include "dsp.h"
+#include "fft_conv.h"
 
 /* HRTF filter coefficients and adjustable parameters */
 #include "af_hrtf.h"
 
+/* Inputs of the convolution: the decoded channels, the bass compensation
+   inputs and the LFE channel */
+enum {
+    IN_LF, IN_RF, IN_LR, IN_RR, IN_CF, IN_CR, IN_BA_L, IN_BA_R, IN_LFE,
+    NUM_IN
+};
+
 typedef struct af_hrtf_s {
     /* Lengths */
     int dlbuflen, hrflen, basslen;
     /* L, C, R, Ls, Rs channels */
     float *lf, *rf, *lr, *rr, *cf, *cr;
-    const float *cf_ir, *af_ir, *of_ir, *ar_ir, *or_ir, *cr_ir;
-    int cf_o, af_o, of_o, ar_o, or_o, cr_o;
     /* Bass */
-    float *ba_l, *ba_r;
     float *ba_ir;
+    /* All FIR filters are applied at once by a NUM_IN -> 2 channel
+       convolution; ir_mode is the decode_mode its filters were set up
+       for (-1 if none yet) */
+    struct fft_conv *conv;
+    float *conv_buf;
+    int conv_buf_samples;
+    int ir_mode;
     /* Whether to matrix decode the rear center channel */
     int matrix_mode;
     /* How to decode the input:
@@ -72,28 +86,11 @@ typedef struct af_hrtf_s {
     int cyc_pos;
     int print_flag;
     int mode;
+    int block;
+    /* Whether the audio delayed by the convolution was output at EOF */
+    bool flushed;
 } af_hrtf_t;
 
-/* Convolution on a ring buffer
- *    nx:	length of the ring buffer
- *    nk:	length of the convolution kernel
- *    sx:	ring buffer
- *    sk:	convolution kernel
- *    offset:	offset on the ring buffer, can be
- */
-static float conv(const int nx, const int nk, const float *sx, const float *sk,
-		  const int offset)
-{
-    /* k = reminder of offset / nx */
-    int k = offset >= 0 ? offset % nx : nx + (offset % nx);
-
-    if(nk + k <= nx)
-	return af_filter_fir(nk, sx + k, sk);
-    else
-	return af_filter_fir(nk + k - nx, sx, sk + nx - k) +
-	    af_filter_fir(nx - k, sx + k, sk);
-}
-
 /* Detect when the impulse response starts (significantly) */
 static int pulse_detect(const float *sx)
 {
@@ -121,7 +118,7 @@ static inline float passive_lock(float x)
 
 /* Unified active matrix decoder for 2 channel matrix encoded surround
    sources */
-static inline void matrix_decode(short *in, const int k, const int il,
+static inline void matrix_decode(float *in, const int k, const int il,
 			  const int ir, const int decode_rear,
 			  const int dlbuflen,
 			  float l_fwr, float r_fwr,
@@ -228,26 +225,26 @@ static inline void matrix_decode(short *in, const int k, const int il,
 #endif
 }
 
-static inline void update_ch(af_hrtf_t *s, short *in, const int k)
+static inline void update_ch(af_hrtf_t *s, float *in, const int k)
 {
     const int fwr_pos = (k + FWRDURATION) % s->dlbuflen;
     /* Update the full wave rectified total amplitude */
     /* Input matrix decoder */
     if(s->decode_mode == HRTF_MIX_MATRIX2CH) {
-       s->l_fwr += abs(in[0]) - fabs(s->fwrbuf_l[fwr_pos]);
-       s->r_fwr += abs(in[1]) - fabs(s->fwrbuf_r[fwr_pos]);
-       s->lpr_fwr += abs(in[0] + in[1]) -
+       s->l_fwr += fabs(in[0]) - fabs(s->fwrbuf_l[fwr_pos]);
+       s->r_fwr += fabs(in[1]) - fabs(s->fwrbuf_r[fwr_pos]);
+       s->lpr_fwr += fabs(in[0] + in[1]) -
 	  fabs(s->fwrbuf_l[fwr_pos] + s->fwrbuf_r[fwr_pos]);
-       s->lmr_fwr += abs(in[0] - in[1]) -
+       s->lmr_fwr += fabs(in[0] - in[1]) -
 	  fabs(s->fwrbuf_l[fwr_pos] - s->fwrbuf_r[fwr_pos]);
     }
     /* Rear matrix decoder */
     if(s->matrix_mode) {
-       s->lr_fwr += abs(in[2]) - fabs(s->fwrbuf_lr[fwr_pos]);
-       s->rr_fwr += abs(in[3]) - fabs(s->fwrbuf_rr[fwr_pos]);
-       s->lrprr_fwr += abs(in[2] + in[3]) -
+       s->lr_fwr += fabs(in[2]) - fabs(s->fwrbuf_lr[fwr_pos]);
+       s->rr_fwr += fabs(in[3]) - fabs(s->fwrbuf_rr[fwr_pos]);
+       s->lrprr_fwr += fabs(in[2] + in[3]) -
 	  fabs(s->fwrbuf_lr[fwr_pos] + s->fwrbuf_rr[fwr_pos]);
-       s->lrmrr_fwr += abs(in[2] - in[3]) -
+       s->lrmrr_fwr += fabs(in[2] - in[3]) -
 	  fabs(s->fwrbuf_lr[fwr_pos] - s->fwrbuf_rr[fwr_pos]);
     }
 
@@ -278,10 +275,79 @@ static inline void update_ch(af_hrtf_t *s, short *in, const int k)
        s->cf[k] = s->lr[k] = s->rr[k] = 0;
        break;
     }
+}
+
+/* Set the HRTF filt (with its leading near-silence skipped) as impulse
+   response from input channel in to output channel out */
+static void set_hrtf_ir(af_hrtf_t *s, int out, int in, const float *filt,
+			float gain)
+{
+    float ir[128] = {0};
+    const int o = pulse_detect(filt);
+
+    memcpy(ir + o, filt + o, s->hrflen * sizeof(float));
+    fft_conv_set_ir(s->conv, out, in, ir, o + s->hrflen, gain);
+}
+
+/* Set up the convolution for the current decode mode. Output channel 0
+   is the left ear, 1 the right ear. In the filter notation below, the
+   right ear uses the mirrored filters. */
+static int setup_filters(struct af_instance *af)
+{
+    af_hrtf_t *s = af->priv;
+    /* In matrix decoding mode, the rear channel gain must be
+       renormalized, as there is an additional channel. */
+    const float rear_gain = s->matrix_mode ? M1_76DB : 1;
+    const int surround = s->decode_mode != HRTF_MIX_STEREO;
+    float lfe = M3_01DB;
+    float fc;
+    int i, ch;
+
+    fc = 2.0 * BASSFILTFREQ / (float)af->data->rate;
+    if(af_filter_design_fir(s->basslen, s->ba_ir, &fc, LP | KAISER, 4 * M_PI) ==
+       -1) {
+	MP_ERR(af, "[hrtf] Unable to design low-pass "
+	       "filter.\n");
+	return AF_ERROR;
+    }
+    for(i = 0; i < s->basslen; i++)
+	s->ba_ir[i] *= BASSGAIN;
 
-    /* We need to update the bass compensation delay line, too. */
-    s->ba_l[k] = in[0] + in[4] + in[2];
-    s->ba_r[k] = in[4] + in[1] + in[3];
+    for(ch = 0; ch < 2; ch++) {
+	const int same_f = ch ? IN_RF : IN_LF, opp_f = ch ? IN_LF : IN_RF;
+	const int same_r = ch ? IN_RR : IN_LR, opp_r = ch ? IN_LR : IN_RR;
+	const int same_b = ch ? IN_BA_R : IN_BA_L;
+	const int opp_b = ch ? IN_BA_L : IN_BA_R;
+
+	for(i = 0; i < NUM_IN; i++)
+	    fft_conv_set_ir(s->conv, ch, i, NULL, 0, 0);
+
+	set_hrtf_ir(s, ch, same_f, af_filt, 1);
+	set_hrtf_ir(s, ch, opp_f, of_filt, 1);
+	if(surround) {
+	    set_hrtf_ir(s, ch, same_r, ar_filt, rear_gain);
+	    set_hrtf_ir(s, ch, opp_r, or_filt, rear_gain);
+	    set_hrtf_ir(s, ch, IN_CF, cf_filt, 1);
+	    if(s->matrix_mode)
+		set_hrtf_ir(s, ch, IN_CR, cr_filt, rear_gain);
+	}
+
+	/* Bass compensation for the lower frequency cut of the HRTF.  A
+	   cross talk of the left and right channel is introduced to
+	   match the directional characteristics of higher frequencies.
+	   The bass will not have any real 3D perception, but that is
+	   OK (note at 180 Hz, the wavelength is about 2 m, and any
+	   spatial perception is impossible). */
+	fft_conv_set_ir(s->conv, ch, same_b, s->ba_ir, s->basslen,
+			1 - BASSCROSS);
+	fft_conv_set_ir(s->conv, ch, opp_b, s->ba_ir, s->basslen, BASSCROSS);
+	/* Also mix the LFE channel (if available) */
+	fft_conv_set_ir(s->conv, ch, IN_LFE, &lfe, 1, 1);
+    }
+
+    fft_conv_reset(s->conv);
+    s->ir_mode = s->decode_mode;
+    return AF_OK;
 }
 
 /* Initialization and runtime control */
@@ -310,12 +376,20 @@ static int control(struct af_instance *af, int cmd, void* arg)
 	    }
 	    else if (af->data->nch < 5)
 	      mp_audio_set_channels_old(af->data, 5);
-        mp_audio_set_format(af->data, AF_FORMAT_S16);
+        mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
 	test_output_res = af_test_output(af, (struct mp_audio*)arg);
 	// after testing input set the real output format
         mp_audio_set_num_channels(af->data, 2);
 	s->print_flag = 1;
+	if(s->ir_mode != s->decode_mode && setup_filters(af) != AF_OK)
+	    return AF_ERROR;
+	s->flushed = false;
+	af->delay = s->block / (double)af->data->rate;
 	return test_output_res;
+    case AF_CONTROL_RESET:
+	fft_conv_reset(s->conv);
+	s->flushed = false;
+	return AF_OK;
     }
 
     return AF_UNKNOWN;
@@ -332,8 +406,6 @@ static void uninit(struct af_instance *af)
 	free(s->rr);
 	free(s->cf);
 	free(s->cr);
-	free(s->ba_l);
-	free(s->ba_r);
 	free(s->ba_ir);
 	free(s->fwrbuf_l);
 	free(s->fwrbuf_r);
@@ -355,13 +427,38 @@ damped (without any real 3D acoustical image, however).
 static int filter(struct af_instance *af, struct mp_audio *data, int flags)
 {
     af_hrtf_t *s = af->priv;
-    short *in = data->planes[0]; // Input audio data
-    short *out = NULL; // Output audio data
-    short *end = in + data->samples * data->nch; // Loop end
-    float common, left, right, diff, left_b, right_b;
-    const int dblen = s->dlbuflen, hlen = s->hrflen, blen = s->basslen;
+    float *in; // Input audio data
+    float *out = NULL; // Output audio data
+    float *buf;
+    float left, right, diff;
+    const int dblen = s->dlbuflen;
+    int nch;
+    int i;
 
-    mp_audio_realloc_min(af->data, data->samples);
+    if(data->samples == 0 && (flags & AF_FILTER_FLAG_EOF)) {
+	if(s->flushed)
+	    return 0;
+	/* Output the audio still delayed by the convolution, by feeding
+	   one block of (stereo) silence through the filter */
+	mp_audio_realloc_min(af->data, s->block);
+	mp_audio_copy_config(data, af->data);
+	data->planes[0] = af->data->planes[0];
+	data->samples = s->block;
+	mp_audio_fill_silence(data, 0, data->samples);
+	s->flushed = true;
+    } else {
+	s->flushed = false;
+    }
+    in = data->planes[0];
+    nch = MPMIN(data->nch, 6);
+
+    if(s->conv_buf_samples < data->samples) {
+	s->conv_buf = talloc_realloc(af, s->conv_buf, float,
+				     data->samples * NUM_IN);
+	s->conv_buf_samples = data->samples;
+	af->stats_allocs++;
+    }
+    buf = s->conv_buf;
 
     if(s->print_flag) {
 	s->print_flag = 0;
@@ -389,7 +486,9 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
 		 "channel\n");
     }
 
-    out = af->data->planes[0];
+    /* The 2 output channels are written over the input, which has at least
+     * 2 channels, after the frame has been read. */
+    out = data->planes[0];
 
     /* MPlayer's 5 channel layout (notation for the variable):
      *
@@ -407,12 +506,24 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
      *      CR
      *
      * or: C = center, A = same side, O = opposite, F = front, R = rear
+     *
+     * The decoding below only writes the channels into their delay
+     * lines; the FIR filtering of all of them is done afterwards for the
+     * whole buffer at once (see setup_filters()).
      */
 
-    while(in < end) {
+    for(i = 0; i < data->samples; i++) {
 	const int k = s->cyc_pos;
+	/* Missing channels are 0 (stereo input has only 2 channels). The
+	   processing works in the 16 bit integer range, for which the
+	   constants of the matrix decoder were tuned. */
+	float frame[6] = {0};
+	float *f = &buf[i * NUM_IN];
+	int c;
 
-	update_ch(s, in, k);
+	for(c = 0; c < nch; c++)
+	    frame[c] = in[i * data->nch + c] * 32768.0f;
+	update_ch(s, frame, k);
 
 	/* Simulate a 7.5 ms -20 dB echo of the center channel in the
 	   front channels (like reflection from a room wall) - a kind of
@@ -421,84 +532,37 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
 	s->lf[k] += CFECHOAMPL * s->cf[(k + CFECHODELAY) % s->dlbuflen];
 	s->rf[k] += CFECHOAMPL * s->cf[(k + CFECHODELAY) % s->dlbuflen];
 
-	switch (s->decode_mode) {
-	case HRTF_MIX_51:
-	case HRTF_MIX_MATRIX2CH:
-	   /* Mixer filter matrix */
-	   common = conv(dblen, hlen, s->cf, s->cf_ir, k + s->cf_o);
-	   if(s->matrix_mode) {
-	      /* In matrix decoding mode, the rear channel gain must be
-		 renormalized, as there is an additional channel. */
-	      matrix_decode(in, k, 2, 3, 0, s->dlbuflen,
-			    s->lr_fwr, s->rr_fwr,
-			    s->lrprr_fwr, s->lrmrr_fwr,
-			    &(s->adapt_lr_gain), &(s->adapt_rr_gain),
-			    &(s->adapt_lrprr_gain), &(s->adapt_lrmrr_gain),
-			    s->lr, s->rr, NULL, NULL, s->cr);
-	      common +=
-		 conv(dblen, hlen, s->cr, s->cr_ir, k + s->cr_o) *
-		 M1_76DB;
-	      left    =
-		 ( conv(dblen, hlen, s->lf, s->af_ir, k + s->af_o) +
-		   conv(dblen, hlen, s->rf, s->of_ir, k + s->of_o) +
-		   (conv(dblen, hlen, s->lr, s->ar_ir, k + s->ar_o) +
-		    conv(dblen, hlen, s->rr, s->or_ir, k + s->or_o)) *
-		   M1_76DB + common);
-	      right   =
-		 ( conv(dblen, hlen, s->rf, s->af_ir, k + s->af_o) +
-		   conv(dblen, hlen, s->lf, s->of_ir, k + s->of_o) +
-		   (conv(dblen, hlen, s->rr, s->ar_ir, k + s->ar_o) +
-		    conv(dblen, hlen, s->lr, s->or_ir, k + s->or_o)) *
-		   M1_76DB + common);
-	   } else {
-	      left    =
-		 ( conv(dblen, hlen, s->lf, s->af_ir, k + s->af_o) +
-		   conv(dblen, hlen, s->rf, s->of_ir, k + s->of_o) +
-		   conv(dblen, hlen, s->lr, s->ar_ir, k + s->ar_o) +
-		   conv(dblen, hlen, s->rr, s->or_ir, k + s->or_o) +
-		   common);
-	      right   =
-		 ( conv(dblen, hlen, s->rf, s->af_ir, k + s->af_o) +
-		   conv(dblen, hlen, s->lf, s->of_ir, k + s->of_o) +
-		   conv(dblen, hlen, s->rr, s->ar_ir, k + s->ar_o) +
-		   conv(dblen, hlen, s->lr, s->or_ir, k + s->or_o) +
-		   common);
-	   }
-	   break;
-	case HRTF_MIX_STEREO:
-	   left    =
-	      ( conv(dblen, hlen, s->lf, s->af_ir, k + s->af_o) +
-		conv(dblen, hlen, s->rf, s->of_ir, k + s->of_o));
-	   right   =
-	      ( conv(dblen, hlen, s->rf, s->af_ir, k + s->af_o) +
-		conv(dblen, hlen, s->lf, s->of_ir, k + s->of_o));
-	   break;
-	default:
-	    /* make gcc happy */
-	    left = 0.0;
-	    right = 0.0;
-	    break;
-	}
+	if(s->decode_mode != HRTF_MIX_STEREO && s->matrix_mode)
+	    matrix_decode(frame, k, 2, 3, 0, s->dlbuflen,
+			  s->lr_fwr, s->rr_fwr,
+			  s->lrprr_fwr, s->lrmrr_fwr,
+			  &(s->adapt_lr_gain), &(s->adapt_rr_gain),
+			  &(s->adapt_lrprr_gain), &(s->adapt_lrmrr_gain),
+			  s->lr, s->rr, NULL, NULL, s->cr);
+
+	f[IN_LF] = s->lf[k];
+	f[IN_RF] = s->rf[k];
+	f[IN_LR] = s->lr[k];
+	f[IN_RR] = s->rr[k];
+	f[IN_CF] = s->cf[k];
+	f[IN_CR] = s->cr[k];
+	f[IN_BA_L] = frame[0] + frame[4] + frame[2];
+	f[IN_BA_R] = frame[4] + frame[1] + frame[3];
+	f[IN_LFE] = frame[5];
 
-	/* Bass compensation for the lower frequency cut of the HRTF.  A
-	   cross talk of the left and right channel is introduced to
-	   match the directional characteristics of higher frequencies.
-	   The bass will not have any real 3D perception, but that is
-	   OK (note at 180 Hz, the wavelength is about 2 m, and any
-	   spatial perception is impossible). */
-	left_b  = conv(dblen, blen, s->ba_l, s->ba_ir, k);
-	right_b = conv(dblen, blen, s->ba_r, s->ba_ir, k);
-	left  += (1 - BASSCROSS) * left_b  + BASSCROSS * right_b;
-	right += (1 - BASSCROSS) * right_b + BASSCROSS * left_b;
-	/* Also mix the LFE channel (if available) */
-	if(data->nch >= 6) {
-	    left  += in[5] * M3_01DB;
-	    right += in[5] * M3_01DB;
-	}
+	/* Next sample... */
+	(s->cyc_pos)--;
+	if(s->cyc_pos < 0)
+	    s->cyc_pos += dblen;
+    }
+
+    /* Mixer filter matrix, bass compensation and LFE */
+    fft_conv_filter(s->conv, buf, buf, data->samples);
 
-	/* Amplitude renormalization. */
-	left  *= AMPLNORM;
-	right *= AMPLNORM;
+    for(i = 0; i < data->samples; i++) {
+	/* Amplitude renormalization (and back to the float range). */
+	left  = buf[i * 2 + 0] * (AMPLNORM / 32768.0f);
+	right = buf[i * 2 + 1] * (AMPLNORM / 32768.0f);
 
 	switch (s->decode_mode) {
 	case HRTF_MIX_51:
@@ -507,29 +571,22 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
 	      perception.  Note: Too much will destroy the acoustic space
 	      and may even result in headaches. */
 	   diff = STEXPAND2 * (left - right);
-	   out[0] = av_clip_int16(left  + diff);
-	   out[1] = av_clip_int16(right - diff);
+	   out[0] = left  + diff;
+	   out[1] = right - diff;
 	   break;
 	case HRTF_MIX_MATRIX2CH:
 	   /* Do attempt any stereo expansion with matrix encoded
 	      sources.  The L, R channels are already stereo expanded
 	      by the steering, any further stereo expansion will sound
 	      very unnatural. */
-	   out[0] = av_clip_int16(left);
-	   out[1] = av_clip_int16(right);
+	   out[0] = left;
+	   out[1] = right;
 	   break;
 	}
-
-	/* Next sample... */
-	in = &in[data->nch];
 	out = &out[af->data->nch];
-	(s->cyc_pos)--;
-	if(s->cyc_pos < 0)
-	    s->cyc_pos += dblen;
     }
 
     /* Set output data */
-    data->planes[0] = af->data->planes[0];
     mp_audio_set_num_channels(data, 2);
 
     return 0;
@@ -543,8 +600,6 @@ static int allocate(af_hrtf_t *s)
     if ((s->rr = malloc(s->dlbuflen * sizeof(float))) == NULL) return -1;
     if ((s->cf = malloc(s->dlbuflen * sizeof(float))) == NULL) return -1;
     if ((s->cr = malloc(s->dlbuflen * sizeof(float))) == NULL) return -1;
-    if ((s->ba_l = malloc(s->dlbuflen * sizeof(float))) == NULL) return -1;
-    if ((s->ba_r = malloc(s->dlbuflen * sizeof(float))) == NULL) return -1;
     if ((s->fwrbuf_l =
 	 malloc(s->dlbuflen * sizeof(float))) == NULL) return -1;
     if ((s->fwrbuf_r =
@@ -561,7 +616,6 @@ static int af_open(struct af_instance* af)
 {
     int i;
     af_hrtf_t *s;
-    float fc;
 
     af->control = control;
     af->uninit = uninit;
@@ -594,7 +648,15 @@ static int af_open(struct af_instance* af)
 
     s->print_flag = 1;
 
-    if (allocate(s) != 0) {
+    if(s->block & (s->block - 1)) {
+	MP_ERR(af, "[hrtf] block must be a power of 2.\n");
+	return AF_ERROR;
+    }
+    s->conv = fft_conv_create(af, s->block, NUM_IN, 2,
+			      MPMAX(2 * HRTFFILTLEN, BASSFILTLEN));
+    s->ir_mode = -1;
+
+    if (!s->conv || allocate(s) != 0) {
  	MP_ERR(af, "[hrtf] Memory allocation error.\n");
 	return AF_ERROR;
     }
@@ -606,26 +668,10 @@ static int af_open(struct af_instance* af)
     s->lr_fwr =
 	s->rr_fwr = 0;
 
-    s->cf_ir = cf_filt + (s->cf_o = pulse_detect(cf_filt));
-    s->af_ir = af_filt + (s->af_o = pulse_detect(af_filt));
-    s->of_ir = of_filt + (s->of_o = pulse_detect(of_filt));
-    s->ar_ir = ar_filt + (s->ar_o = pulse_detect(ar_filt));
-    s->or_ir = or_filt + (s->or_o = pulse_detect(or_filt));
-    s->cr_ir = cr_filt + (s->cr_o = pulse_detect(cr_filt));
-
     if((s->ba_ir = malloc(s->basslen * sizeof(float))) == NULL) {
  	MP_ERR(af, "[hrtf] Memory allocation error.\n");
 	return AF_ERROR;
     }
-    fc = 2.0 * BASSFILTFREQ / (float)af->data->rate;
-    if(af_filter_design_fir(s->basslen, s->ba_ir, &fc, LP | KAISER, 4 * M_PI) ==
-       -1) {
-	MP_ERR(af, "[hrtf] Unable to design low-pass "
-	       "filter.\n");
-	return AF_ERROR;
-    }
-    for(i = 0; i < s->basslen; i++)
-	s->ba_ir[i] *= BASSGAIN;
 
     return AF_OK;
 }
@@ -634,10 +680,12 @@ static int af_open(struct af_instance* af)
 struct af_info af_info_hrtf = {
     .info = "HRTF Headphone",
     .name = "hrtf",
+    .flags = AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(af_hrtf_t),
     .options = (const struct m_option[]) {
         OPT_CHOICE("mode", mode, 0, ({"m", 0}, {"s", 1}, {"0", 2})),
+        OPT_INTRANGE("block", block, 0, 8, 32768, OPTDEF_INT(128)),
         {0}
     },
 };
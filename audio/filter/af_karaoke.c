@@ -76,6 +76,6 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_karaoke = {
 	.info = "Simple karaoke/voice-removal audio filter",
 	.name = "karaoke",
-	.flags = AF_FLAGS_NOT_REENTRANT,
+	.flags = AF_FLAGS_NOT_REENTRANT | AF_FLAGS_INPLACE,
 	.open = af_open,
 };
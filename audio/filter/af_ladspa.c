@@ -107,6 +107,7 @@ static int af_ladspa_malloc_failed(char*);
 struct af_info af_info_ladspa = {
     .info = "LADSPA plugin loader",
     .name = "ladspa",
+    .flags = AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(af_ladspa_t),
     .options = (const struct m_option[]) {
@@ -569,7 +570,7 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags) {
     af_ladspa_t *setup = af->priv;
     const LADSPA_Descriptor *pdes = setup->plugin_descriptor;
     float *audio = (float*)data->planes[0];
-    int nsamples = data->samples*data->nch;
+    int nsamples = data->samples;
     int nch = data->nch;
     int rate = data->rate;
     int i, p;
@@ -578,17 +579,19 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags) {
         return -1;
 
     /* See if it's the first call. If so, setup inbufs/outbufs, instantiate
-     * plugin, connect ports and activate plugin
+     * plugin, connect ports and activate plugin. The buffers are only
+     * reallocated if they're too small, so that a varying chunk size
+     * doesn't cause an allocation on every call.
      */
 
-    if ( (setup->bufsize != nsamples/nch) || (setup->nch != nch) ) {
+    if ( (setup->bufsize < nsamples) || (setup->nch != nch) ) {
 
         /* if setup->nch==0, it's the first call, if not, something has
          * changed and all previous mallocs have to be freed
          */
 
         if (setup->nch != 0) {
-            MP_TRACE(af, "%s: bufsize change; free old buffer\n",
+            MP_TRACE(af, "%s: buffer too small; free old buffer\n",
                                                                 setup->myname);
 
             if(setup->inbufs) {
@@ -603,8 +606,9 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags) {
             }
         } /* everything is freed */
 
-        setup->bufsize = nsamples/nch;
+        setup->bufsize = nsamples;
         setup->nch = nch;
+        af->stats_allocs++;
 
         setup->inbufs = calloc(nch, sizeof(float*));
         setup->outbufs = calloc(nch, sizeof(float*));
@@ -699,7 +703,7 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags) {
 
     /* Fill inbufs */
 
-    for (p=0; p<setup->bufsize; p++) {
+    for (p=0; p<nsamples; p++) {
         for (i=0; i<nch; i++) {
             setup->inbufs[i][p] = audio[p*nch + i];
         }
@@ -708,12 +712,12 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags) {
     /* Run filter(s) */
 
     for (i=0; i<nch; i+=setup->ninputs) {
-        pdes->run(setup->chhandles[i], setup->bufsize);
+        pdes->run(setup->chhandles[i], nsamples);
     }
 
     /* Extract outbufs */
 
-    for (p=0; p<setup->bufsize; p++) {
+    for (p=0; p<nsamples; p++) {
         for (i=0; i<nch; i++) {
             audio[p*nch + i] = setup->outbufs[i][p];
         }
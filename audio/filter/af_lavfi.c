@@ -62,6 +62,14 @@ struct priv {
 
     AVRational timebase_out;
 
+    // Input configuration the current graph was created with
+    struct mp_audio graph_config;
+    char *graph_id;
+    bool eof_sent;
+
+    // Output frame referenced by the data returned from filter()
+    AVFrame *out_frame;
+
     // options
     char *cfg_graph;
     char *cfg_avopts;
@@ -70,8 +78,12 @@ struct priv {
 static void destroy_graph(struct af_instance *af)
 {
     struct priv *p = af->priv;
+    av_frame_free(&p->out_frame);
     avfilter_graph_free(&p->graph);
     p->in = p->out = NULL;
+    talloc_free(p->graph_id);
+    p->graph_id = NULL;
+    p->eof_sent = false;
 }
 
 static bool recreate_graph(struct af_instance *af, struct mp_audio *config)
@@ -83,10 +95,24 @@ static bool recreate_graph(struct af_instance *af, struct mp_audio *config)
 
     if (bstr0(p->cfg_graph).len == 0) {
         MP_FATAL(af, "lavfi: no filter graph set\n");
+        talloc_free(tmp);
         return false;
     }
 
+    // Keep the existing graph (and the samples buffered in it) if the input
+    // format and the graph didn't change.
+    char *id = talloc_asprintf(tmp, "%s:%s", p->cfg_graph,
+                               p->cfg_avopts ? p->cfg_avopts : "");
+    if (p->graph && p->graph_id && strcmp(p->graph_id, id) == 0 &&
+        !p->eof_sent && mp_audio_config_equals(&p->graph_config, config))
+    {
+        MP_VERBOSE(af, "lavfi: reusing graph\n");
+        talloc_free(tmp);
+        return true;
+    }
+
     destroy_graph(af);
+    p->samples_in = 0;
     MP_VERBOSE(af, "lavfi: create graph: '%s'\n", p->cfg_graph);
 
     AVFilterGraph *graph = avfilter_graph_alloc();
@@ -150,6 +176,8 @@ static bool recreate_graph(struct af_instance *af, struct mp_audio *config)
     p->in = in;
     p->out = out;
     p->graph = graph;
+    p->graph_id = talloc_steal(af, id);
+    p->graph_config = *config;
 
     assert(out->nb_inputs == 1);
     assert(in->nb_outputs == 1);
@@ -209,6 +237,17 @@ static int control(struct af_instance *af, int cmd, void *arg)
     return AF_UNKNOWN;
 }
 
+// Append the samples in frame to r.
+static void append_frame(struct mp_audio *r, AVFrame *frame)
+{
+    mp_audio_realloc_min(r, r->samples + frame->nb_samples);
+    for (int n = 0; n < r->num_planes; n++) {
+        memcpy((char *)r->planes[n] + r->samples * r->sstride,
+               frame->extended_data[n], frame->nb_samples * r->sstride);
+    }
+    r->samples += frame->nb_samples;
+}
+
 static int filter(struct af_instance *af, struct mp_audio *data, int flags)
 {
     struct priv *p = af->priv;
@@ -216,6 +255,9 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
     bool eof = data->samples == 0 && (flags & AF_FILTER_FLAG_EOF);
     AVFilterLink *l_in = p->in->outputs[0];
 
+    // The data returned by the previous call is not used anymore.
+    av_frame_free(&p->out_frame);
+
     AVFrame *frame = av_frame_alloc();
     frame->nb_samples = data->samples;
     frame->format = l_in->format;
@@ -227,6 +269,8 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
     av_frame_set_channel_layout(frame, l_in->channel_layout);
     av_frame_set_sample_rate(frame, l_in->sample_rate);
 
+    // The input data is not refcounted, and is valid only during this call,
+    // so libavfilter has to make a copy of it.
     frame->extended_data = frame->data;
     for (int n = 0; n < data->num_planes; n++)
         frame->data[n] = data->planes[n];
@@ -237,7 +281,12 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
         return -1;
     }
     av_frame_free(&frame);
+    p->eof_sent |= eof;
 
+    // If the graph returns a single frame, which is not referenced by anything
+    // else (so that following filters can write to it), return its data
+    // directly. Otherwise copy all output to r.
+    AVFrame *single = NULL;
     int64_t out_pts = AV_NOPTS_VALUE;
     r->samples = 0;
     for (;;) {
@@ -248,31 +297,42 @@ static int filter(struct af_instance *af, struct mp_audio *data, int flags)
             break;
         }
 
-        mp_audio_realloc_min(r, r->samples + frame->nb_samples);
-        for (int n = 0; n < r->num_planes; n++) {
-            memcpy((char *)r->planes[n] + r->samples * r->sstride,
-                   frame->extended_data[n], frame->nb_samples * r->sstride);
-        }
-        r->samples += frame->nb_samples;
-
         if (out_pts == AV_NOPTS_VALUE)
             out_pts = frame->pts;
 
+        if (!single && !r->samples && av_frame_is_writable(frame)) {
+            single = frame;
+            continue;
+        }
+        if (single) {
+            append_frame(r, single);
+            av_frame_free(&single);
+        }
+        append_frame(r, frame);
         av_frame_free(&frame);
     }
 
     p->samples_in += data->samples;
 
+    int out_samples = single ? single->nb_samples : r->samples;
     if (out_pts != AV_NOPTS_VALUE) {
         double in_time = p->samples_in / (double)data->rate;
         double out_time = out_pts * av_q2d(p->timebase_out);
         // Need pts past the last output sample.
-        out_time += r->samples / (double)r->rate;
+        out_time += out_samples / (double)r->rate;
 
         af->delay = in_time - out_time;
     }
 
     *data = *r;
+    if (single) {
+        for (int n = 0; n < data->num_planes; n++) {
+            data->planes[n] = single->extended_data[n];
+            data->allocated[n] = 0; // not owned by data
+        }
+        data->samples = single->nb_samples;
+        p->out_frame = single;
+    }
     return 0;
 }
 
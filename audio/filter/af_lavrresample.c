@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <math.h>
 #include <assert.h>
 
 #include <libavutil/opt.h>
@@ -49,6 +50,7 @@
 #define avresample_convert(ctx, out, out_planesize, out_samples, in, in_planesize, in_samples) \
     swr_convert(ctx, out, out_samples, (const uint8_t**)(in), in_samples)
 #define avresample_set_channel_mapping swr_set_channel_mapping
+#define avresample_set_compensation swr_set_compensation
 #define USE_SET_CHANNEL_MAPPING 1
 #else
 #error "config.h broken or no resampler found"
@@ -60,6 +62,7 @@
 #include "audio/filter/af.h"
 #include "audio/fmt-conversion.h"
 #include "audio/reorder_ch.h"
+#include "audio/filter/chmix.h"
 
 struct af_resample_opts {
     int filter_size;
@@ -86,6 +89,13 @@ struct af_resample {
     int reorder_in[MP_NUM_CHANNELS];
     int reorder_out[MP_NUM_CHANNELS];
     uint8_t *reorder_buffer;
+    // If not NULL, only the channel layout is converted, with this instead
+    // of libavresample.
+    struct mp_chmix *mix;
+    // Set by AF_CONTROL_SET_PLAYBACK_SPEED_RESAMPLE: resample even if the
+    // rates are equal, and compensate for speed != 1.
+    bool dynamic;
+    double speed;
 };
 
 #if HAVE_LIBAVRESAMPLE
@@ -97,6 +107,10 @@ static void drop_all_output(struct af_resample *s)
 {
     while (avresample_read(s->avrctx, NULL, 1000) > 0) {}
 }
+static void force_resampling(struct af_resample *s)
+{
+    av_opt_set_int(s->avrctx, "force_resampling", 1, 0);
+}
 #else
 static int get_delay(struct af_resample *s)
 {
@@ -106,6 +120,10 @@ static void drop_all_output(struct af_resample *s)
 {
     while (swr_drop_output(s->avrctx, 1000) > 0) {}
 }
+static void force_resampling(struct af_resample *s)
+{
+    av_opt_set_int(s->avrctx, "flags", SWR_FLAG_RESAMPLE, 0);
+}
 #endif
 
 static double af_resample_default_cutoff(int filter_size)
@@ -161,12 +179,35 @@ static int configure_lavrr(struct af_instance *af, struct mp_audio *in,
     s->ctx.linear      = s->opts.linear;
     s->ctx.cutoff      = s->opts.cutoff;
 
+    // Remixing without resampling or format conversion is done with the
+    // channel mixer, which is faster. (The AVOptions might change the mixing,
+    // so leave it to libavresample if they are set.)
+    talloc_free(s->mix);
+    s->mix = NULL;
+    if (!s->dynamic && in->rate == out->rate && in->format == out->format &&
+        (in->format == AF_FORMAT_FLOAT || in->format == AF_FORMAT_FLOATP) &&
+        !mp_chmap_is_unknown(&in->channels) &&
+        !mp_chmap_is_unknown(&out->channels) &&
+        !(s->avopts && s->avopts[0]))
+    {
+        s->mix = mp_chmix_create(s, in->nch, out->nch);
+        mp_chmix_set_layout(s->mix, &in->channels, &out->channels);
+        mp_chmix_commit(s->mix);
+        MP_VERBOSE(af, "Remixing with %s channel mixer.\n",
+                   mp_chmix_simd_name());
+        return AF_OK;
+    }
+
     av_opt_set_int(s->avrctx, "filter_size",        s->ctx.filter_size, 0);
     av_opt_set_int(s->avrctx, "phase_shift",        s->ctx.phase_shift, 0);
     av_opt_set_int(s->avrctx, "linear_interp",      s->ctx.linear, 0);
 
     av_opt_set_double(s->avrctx, "cutoff",          s->ctx.cutoff, 0);
 
+    // Compensation needs the resampler, even if the rates are equal.
+    if (s->dynamic)
+        force_resampling(s);
+
     if (parse_avopts(s->avrctx, s->avopts) < 0) {
         MP_FATAL(af, "af_lavrresample: could not set opts: '%s'\n", s->avopts);
         return AF_ERROR;
@@ -228,6 +269,25 @@ static int configure_lavrr(struct af_instance *af, struct mp_audio *in,
     return AF_OK;
 }
 
+// Configure the context again with the current formats.
+static int reconfigure_lavrr(struct af_instance *af)
+{
+    struct af_resample *s = af->priv;
+    struct mp_audio in = {0};
+    mp_audio_set_format(&in, s->ctx.in_format);
+    mp_audio_set_channels(&in, &s->ctx.in_channels);
+    in.rate = s->ctx.in_rate;
+    return configure_lavrr(af, &in, af->data);
+}
+
+static void set_compensation(struct af_resample *s)
+{
+    // Re-armed with every filter call, so it never runs out. The distance
+    // (in output samples) determines the precision of the speed factor.
+    int distance = s->ctx.out_rate * 10;
+    int delta = lrint(distance * (1.0 / s->speed - 1.0));
+    avresample_set_compensation(s->avrctx, delta, distance);
+}
 
 static int control(struct af_instance *af, int cmd, void *arg)
 {
@@ -242,7 +302,7 @@ static int control(struct af_instance *af, int cmd, void *arg)
         if (((out->rate    == in->rate) || (out->rate == 0)) &&
             (out->format   == in->format) &&
             (mp_chmap_equals(&out->channels, &in->channels) || out->nch == 0) &&
-            s->allow_detach)
+            s->allow_detach && !s->dynamic)
             return AF_DETACH;
 
         if (out->rate == 0)
@@ -280,8 +340,19 @@ static int control(struct af_instance *af, int cmd, void *arg)
     case AF_CONTROL_SET_RESAMPLE_RATE:
         out->rate = *(int *)arg;
         return AF_OK;
+    case AF_CONTROL_SET_PLAYBACK_SPEED_RESAMPLE:
+        s->speed = *(double *)arg;
+        if (!s->dynamic) {
+            s->dynamic = true;
+            // Switch to libavresample with forced resampling, if the filter
+            // is already configured.
+            if (s->ctx.in_rate && reconfigure_lavrr(af) != AF_OK)
+                return AF_ERROR;
+        }
+        return AF_OK;
     case AF_CONTROL_RESET:
-        drop_all_output(s);
+        if (!s->mix)
+            drop_all_output(s);
         return AF_OK;
     }
     return AF_UNKNOWN;
@@ -330,16 +401,52 @@ static void do_reorder(struct mp_audio *mpa, int *reorder)
 }
 #endif
 
+static int filter_mix(struct af_instance *af, struct mp_audio *data)
+{
+    struct af_resample *s = af->priv;
+    struct mp_audio *out  = af->data;
+    bool planar = af_fmt_is_planar(data->format);
+
+    af->delay = 0;
+
+    // With fewer output channels, the output is written over the input.
+    struct mp_audio *dst = data;
+    if (out->nch > data->nch) {
+        mp_audio_realloc_min(out, data->samples);
+        dst = out;
+    }
+    if (planar) {
+        mp_chmix_process_planar(s->mix, (float **)dst->planes,
+                                (float **)data->planes, data->samples);
+    } else {
+        mp_chmix_process(s->mix, dst->planes[0], data->planes[0],
+                         data->samples);
+    }
+    for (int n = 0; n < out->num_planes; n++)
+        data->planes[n] = dst->planes[n];
+    mp_audio_set_channels(data, &out->channels);
+    return 0;
+}
+
 static int filter(struct af_instance *af, struct mp_audio *data, int flags)
 {
     struct af_resample *s = af->priv;
     struct mp_audio *in   = data;
     struct mp_audio *out  = af->data;
 
+    if (s->mix)
+        return filter_mix(af, data);
+
     out->samples = avresample_available(s->avrctx) +
         av_rescale_rnd(get_delay(s) + in->samples,
                        s->ctx.out_rate, s->ctx.in_rate, AV_ROUND_UP);
 
+    if (s->dynamic) {
+        // Compensation can produce slightly more output.
+        out->samples = ceil(out->samples / s->speed) + 16;
+        set_compensation(s);
+    }
+
     mp_audio_realloc_min(out, out->samples);
 
     af->delay = get_delay(s) / (double)s->ctx.in_rate;
@@ -388,6 +495,8 @@ static int af_open(struct af_instance *af)
     af->uninit  = uninit;
     af->filter  = filter;
 
+    s->speed = 1.0;
+
     if (s->opts.cutoff <= 0.0)
         s->opts.cutoff = af_resample_default_cutoff(s->opts.filter_size);
 
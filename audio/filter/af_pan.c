@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <inttypes.h>
 #include <math.h>
@@ -27,6 +28,7 @@
 
 #include "common/common.h"
 #include "af.h"
+#include "chmix.h"
 
 // Data for specific instances of this filter
 typedef struct af_pan_s
@@ -34,6 +36,7 @@ typedef struct af_pan_s
   int nch; // Number of output channels; zero means same as input
   float level[AF_NCH][AF_NCH];	// Gain level for each channel
   char *matrixstr;
+  struct mp_chmix *mix;
 }af_pan_t;
 
 static void set_channels(struct mp_audio *mpa, int num)
@@ -45,26 +48,45 @@ static void set_channels(struct mp_audio *mpa, int num)
     mp_audio_set_channels(mpa, &map);
 }
 
+// Load the gain levels into the mixer
+static void update_matrix(af_pan_t* s)
+{
+  if(!s->mix)
+    return;
+  for(int j=0;j<AF_NCH;j++)
+    for(int k=0;k<AF_NCH;k++)
+      mp_chmix_set(s->mix, j, k, s->level[j][k]);
+  mp_chmix_commit(s->mix);
+}
+
 // Initialization and runtime control
 static int control(struct af_instance* af, int cmd, void* arg)
 {
   af_pan_t* s = af->priv;
 
   switch(cmd){
-  case AF_CONTROL_REINIT:
+  case AF_CONTROL_REINIT:{
+    struct mp_audio *in = arg;
     // Sanity check
     if(!arg) return AF_ERROR;
 
-    af->data->rate   = ((struct mp_audio*)arg)->rate;
-    mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
-    set_channels(af->data, s->nch ? s->nch: ((struct mp_audio*)arg)->nch);
+    af->data->rate   = in->rate;
+    set_channels(af->data, s->nch ? s->nch: in->nch);
+    if(af_fmt_is_planar(in->format))
+      mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
+    else
+      mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
 
-    if((af->data->format != ((struct mp_audio*)arg)->format) ||
-       (af->data->bps != ((struct mp_audio*)arg)->bps)){
-      mp_audio_set_format((struct mp_audio*)arg, af->data->format);
+    if((af->data->format != in->format) || (af->data->bps != in->bps)){
+      mp_audio_set_format(in, af->data->format);
       return AF_FALSE;
     }
+
+    talloc_free(s->mix);
+    s->mix = mp_chmix_create(af, in->nch, af->data->nch);
+    update_matrix(s);
     return AF_OK;
+  }
   case AF_CONTROL_SET_PAN_LEVEL:{
     int    i;
     int    ch = ((af_control_ext_t*)arg)->ch;
@@ -73,6 +95,7 @@ static int control(struct af_instance* af, int cmd, void* arg)
       return AF_FALSE;
     for(i=0;i<AF_NCH;i++)
       s->level[ch][i] = level[i];
+    update_matrix(s);
     return AF_OK;
   }
   case AF_CONTROL_SET_PAN_NOUT:
@@ -96,6 +119,7 @@ static int control(struct af_instance* af, int cmd, void* arg)
       s->level[1][0] = MPMAX(0.f, -val);
       s->level[1][1] = MPMIN(1.f, 1.f + val);
     }
+    update_matrix(s);
     return AF_OK;
   }
   case AF_CONTROL_GET_PAN_BALANCE:
@@ -110,36 +134,32 @@ static int control(struct af_instance* af, int cmd, void* arg)
 // Filter data through filter
 static int filter(struct af_instance* af, struct mp_audio* data, int flags)
 {
-  struct mp_audio*    c    = data;		// Current working data
-  struct mp_audio*	l    = af->data;	// Local data
   af_pan_t*  	s    = af->priv; 	// Setup for this instance
-  float*   	in   = c->planes[0];	// Input audio data
-  float*   	out  = NULL;		// Output audio data
-  float*	end  = in+c->samples*c->nch; 	// End of loop
-  int		nchi = c->nch;		// Number of input channels
-  int		ncho = l->nch;		// Number of output channels
-  register int  j,k;
-
-  mp_audio_realloc_min(af->data, data->samples);
-
-  out = l->planes[0];
-  // Execute panning
-  // FIXME: Too slow
-  while(in < end){
-    for(j=0;j<ncho;j++){
-      register float  x   = 0.0;
-      register float* tin = in;
-      for(k=0;k<nchi;k++)
-	x += tin[k] * s->level[j][k];
-      out[j] = x;
+  struct mp_audio*	l    = af->data;	// Local data
+
+  // If the output doesn't have more channels than the input, it is written
+  // over the input.
+  if(l->nch > data->nch){
+    mp_audio_realloc_min(af->data, data->samples);
+    if(af_fmt_is_planar(data->format)){
+      mp_chmix_process_planar(s->mix, (float **)l->planes,
+                              (float **)data->planes, data->samples);
+    }else{
+      mp_chmix_process(s->mix, l->planes[0], data->planes[0], data->samples);
+    }
+    for(int n=0;n<l->num_planes;n++)
+      data->planes[n] = l->planes[n];
+  }else{
+    if(af_fmt_is_planar(data->format)){
+      mp_chmix_process_planar(s->mix, (float **)data->planes,
+                              (float **)data->planes, data->samples);
+    }else{
+      mp_chmix_process(s->mix, data->planes[0], data->planes[0], data->samples);
     }
-    out+= ncho;
-    in+= nchi;
   }
 
   // Set output data
-  c->planes[0] = l->planes[0];
-  set_channels(c, l->nch);
+  set_channels(data, l->nch);
 
   return 0;
 }
@@ -155,6 +175,7 @@ static int af_open(struct af_instance* af){
     int nch = s->nch;
     if(AF_OK != control(af,AF_CONTROL_SET_PAN_NOUT, &nch))
         return AF_ERROR;
+    MP_VERBOSE(af, "Using %s channel mixing.\n", mp_chmix_simd_name());
 
     // Read pan values
     char *cp = s->matrixstr;
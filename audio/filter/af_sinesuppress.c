@@ -42,7 +42,7 @@ typedef struct af_sinesuppress_s
 }af_sinesuppress_t;
 
 static int play_s16(struct af_instance* af, struct mp_audio* data, int f);
-//static struct mp_audio* play_float(struct af_instance* af, struct mp_audio* data);
+static int play_float(struct af_instance* af, struct mp_audio* data, int f);
 
 // Initialization and runtime control
 static int control(struct af_instance* af, int cmd, void* arg)
@@ -54,14 +54,11 @@ static int control(struct af_instance* af, int cmd, void* arg)
 
     mp_audio_copy_config(af->data, (struct mp_audio*)arg);
     mp_audio_set_num_channels(af->data, 1);
-#if 0
-    if (((struct mp_audio*)arg)->format == AF_FORMAT_FLOAT)
+    // With a single channel, planar and interleaved are the same.
+    if (af_fmt_from_planar(af->data->format) == AF_FORMAT_FLOAT)
     {
-	af->data->format = AF_FORMAT_FLOAT;
-	af->data->bps = 4;
-	af->play = play_float;
-    }// else
-#endif
+	af->filter = play_float;
+    } else
     {
         mp_audio_set_format(af->data, AF_FORMAT_S16);
 	af->filter = play_s16;
@@ -104,29 +101,35 @@ static int play_s16(struct af_instance* af, struct mp_audio* data, int f)
   return 0;
 }
 
-#if 0
-static struct mp_audio* play_float(struct af_instance* af, struct mp_audio* data)
+static int play_float(struct af_instance* af, struct mp_audio* data, int f)
 {
-  af_sinesuppress_t *s = af->setup;
+  af_sinesuppress_t *s = af->priv;
   register int i = 0;
-  float *a = (float*)data->audio;	// Audio data
-  int len = data->len/4;		// Number of samples
-  float avg, l, r;
+  float *a = (float*)data->planes[0];	// Audio data
+  int len = data->samples*data->nch;		// Number of samples
 
-  for (i = 0; i < len; i+=2)
+  for (i = 0; i < len; i++)
   {
-    avg = (a[i] + a[i + 1]) / 2;
+    double co= cos(s->pos);
+    double si= sin(s->pos);
 
-/*    l = avg + (s->mul * (a[i] - avg));
-    r = avg + (s->mul * (a[i + 1] - avg));*/
+    s->real += co * a[i];
+    s->imag += si * a[i];
+    s->ref  += co * co;
 
-    a[i] = af_softclip(l);
-    a[i + 1] = af_softclip(r);
+    a[i] -= (s->real * co + s->imag * si) / s->ref;
+
+    s->real -= s->real * s->decay;
+    s->imag -= s->imag * s->decay;
+    s->ref  -= s->ref  * s->decay;
+
+    s->pos += 2 * M_PI * s->freq / data->rate;
   }
 
-  return data;
+   MP_VERBOSE(af, "[sinesuppress] f:%8.2f: amp:%8.5f\n", s->freq, sqrt(s->real*s->real + s->imag*s->imag) / s->ref);
+
+  return 0;
 }
-#endif
 
 // Allocate memory and set function pointers
 static int af_open(struct af_instance* af){
@@ -139,6 +142,7 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_sinesuppress = {
     .info = "Sine Suppress",
     .name = "sinesuppress",
+    .flags = AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(af_sinesuppress_t),
     .options = (const struct m_option[]) {
@@ -34,6 +34,7 @@
 
 #include "common/common.h"
 #include "af.h"
+#include "chmix.h"
 #include "dsp.h"
 
 // Q value for low-pass filter
@@ -57,7 +58,7 @@ typedef struct af_sub_s
   float	fc;		// Cutoff frequency [Hz] for low-pass filter
   float k;		// Filter gain;
   int ch;		// Channel number which to insert the filtered data
-
+  struct mp_chmix *mix;	// Mixes left and right into the sub channel
 }af_sub_t;
 
 // Initialization and runtime control
@@ -70,9 +71,21 @@ static int control(struct af_instance* af, int cmd, void* arg)
     // Sanity check
     if(!arg) return AF_ERROR;
 
-    af->data->rate   = ((struct mp_audio*)arg)->rate;
-    mp_audio_set_channels_old(af->data, MPMAX(s->ch+1,((struct mp_audio*)arg)->nch));
-    mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+    struct mp_audio *in = arg;
+    af->data->rate   = in->rate;
+    mp_audio_set_channels_old(af->data, MPMAX(s->ch+1,in->nch));
+    if(af_fmt_is_planar(in->format))
+      mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
+    else
+      mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+
+    int nch = af->data->nch;
+    talloc_free(s->mix);
+    s->mix = mp_chmix_create(af, nch, nch);
+    mp_chmix_set_identity(s->mix);
+    for(int i=0;i<nch;i++)
+      mp_chmix_set(s->mix, s->ch, i, i < 2 ? 0.5 : 0);
+    mp_chmix_commit(s->mix);
 
     // Design low-pass filter
     s->k = 1.0;
@@ -81,7 +94,7 @@ static int control(struct af_instance* af, int cmd, void* arg)
        (-1 == af_filter_szxform(sp[1].a, sp[1].b, Q, s->fc,
        (float)af->data->rate, &s->k, s->w[1])))
       return AF_ERROR;
-    return af_test_output(af,(struct mp_audio*)arg);
+    return af_test_output(af,in);
   }
   }
   return AF_UNKNOWN;
@@ -101,20 +114,25 @@ static int control(struct af_instance* af, int cmd, void* arg)
 // Filter data through filter
 static int filter(struct af_instance* af, struct mp_audio* data, int flags)
 {
-  struct mp_audio*    c   = data;	 // Current working data
   af_sub_t*  	s   = af->priv; // Setup for this instance
-  float*   	a   = c->planes[0];	 // Audio data
-  int		len = c->samples*c->nch;	 // Number of samples in current audio block
-  int		nch = c->nch;	 // Number of channels
-  int		ch  = s->ch;	 // Channel in which to insert the sub audio
+  bool		planar = af_fmt_is_planar(data->format);
+  int		stride = planar ? 1 : data->nch;
+  float*	a   = planar ? data->planes[s->ch] : (float*)data->planes[0] + s->ch;
+  int		len = data->samples * stride;
   register int  i;
 
+  // Average left and right into the sub channel
+  if(planar)
+    mp_chmix_process_planar(s->mix, (float **)data->planes,
+                            (float **)data->planes, data->samples);
+  else
+    mp_chmix_process(s->mix, data->planes[0], data->planes[0], data->samples);
+
   // Run filter
-  for(i=0;i<len;i+=nch){
-    // Average left and right
-    register float x = 0.5 * (a[i] + a[i+1]);
+  for(i=0;i<len;i+=stride){
+    register float x = a[i];
     IIR(x * s->k, s->w[0], s->q[0], x);
-    IIR(x , s->w[1], s->q[1], a[i+ch]);
+    IIR(x , s->w[1], s->q[1], a[i]);
   }
 
   return 0;
@@ -131,7 +149,7 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_sub = {
     .info = "Audio filter for adding a sub-base channel",
     .name = "sub",
-    .flags = AF_FLAGS_NOT_REENTRANT,
+    .flags = AF_FLAGS_NOT_REENTRANT | AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(af_sub_t),
     .options = (const struct m_option[]) {
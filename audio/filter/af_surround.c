@@ -40,6 +40,7 @@
 #include <string.h>
 
 #include "af.h"
+#include "chmix.h"
 #include "dsp.h"
 
 #define L  32    // Length of fir filter
@@ -83,8 +84,17 @@ typedef struct af_surround_s
   int i;       	 // Position in circular buffer
   int wi;	 // Write index for delay queue
   int ri;	 // Read index for delay queue
+  struct mp_chmix *mix; // Front outputs and surround feeds
 }af_surround_t;
 
+// The beginnings of an active matrix...
+static float steering_matrix[][12] = {
+//	LL	RL	LR	RR	LS	RS
+//	LLs	RLs	LRs	RRs	LC	RC
+       {.707,	.0,	.0,	.707,	.5,	-.5,
+	.5878,	-.3928,	.3928,	-.5878,	.5,	.5},
+};
+
 // Initialization and runtime control
 static int control(struct af_instance* af, int cmd, void* arg)
 {
@@ -124,30 +134,40 @@ static int control(struct af_instance* af, int cmd, void* arg)
 //    printf("%i\n",s->wi);
     s->ri = 0;
 
+    // The mixer computes the front left and right outputs, and the signals
+    // fed into the rear channel filters in channels 2 and 3.
+    float *m = steering_matrix[0];
+    talloc_free(s->mix);
+    s->mix = mp_chmix_create(af, 2, 4);
+    mp_chmix_set(s->mix, 0, 0, m[0]);
+    mp_chmix_set(s->mix, 0, 1, m[1]);
+    mp_chmix_set(s->mix, 1, 0, m[2]);
+    mp_chmix_set(s->mix, 1, 1, m[3]);
+#ifdef SPLITREAR
+    mp_chmix_set(s->mix, 2, 0, m[8]);
+    mp_chmix_set(s->mix, 2, 1, m[9]);
+    mp_chmix_set(s->mix, 3, 0, m[6]);
+    mp_chmix_set(s->mix, 3, 1, m[7]);
+#else
+    mp_chmix_set(s->mix, 2, 0, m[4]);
+    mp_chmix_set(s->mix, 2, 1, m[5]);
+#endif
+    mp_chmix_commit(s->mix);
+
     return AF_OK;
   }
   }
   return AF_UNKNOWN;
 }
 
-// The beginnings of an active matrix...
-static float steering_matrix[][12] = {
-//	LL	RL	LR	RR	LS	RS
-//	LLs	RLs	LRs	RRs	LC	RC
-       {.707,	.0,	.0,	.707,	.5,	-.5,
-	.5878,	-.3928,	.3928,	-.5878,	.5,	.5},
-};
-
 // Experimental moving average dominance
 //static int amp_L = 0, amp_R = 0, amp_C = 0, amp_S = 0;
 
 // Filter data through filter
 static int filter(struct af_instance* af, struct mp_audio* data, int flags){
   af_surround_t* s   = (af_surround_t*)af->priv;
-  float*	 m   = steering_matrix[0];
-  float*     	 in  = data->planes[0]; 	// Input audio data
   float*     	 out = NULL;		// Output audio data
-  float*	 end = in + data->samples * data->nch;
+  float*	 end = NULL;
   int 		 i   = s->i;	// Filter queue index
   int 		 ri  = s->ri;	// Read index for delay queue
   int 		 wi  = s->wi;	// Write index for delay queue
@@ -155,30 +175,26 @@ static int filter(struct af_instance* af, struct mp_audio* data, int flags){
   mp_audio_realloc_min(af->data, data->samples);
 
   out = af->data->planes[0];
-
-  while(in < end){
-    /* Dominance:
-       abs(in[0])  abs(in[1]);
-       abs(in[0]+in[1])  abs(in[0]-in[1]);
-       10 * log( abs(in[0]) / (abs(in[1])|1) );
-       10 * log( abs(in[0]+in[1]) / (abs(in[0]-in[1])|1) ); */
-
-    /* About volume balancing...
-       Surround encoding does the following:
-           Lt=L+.707*C+.707*S, Rt=R+.707*C-.707*S
-       So S should be extracted as:
-           (Lt-Rt)
-       But we are splitting the S to two output channels, so we
-       must take 3dB off as we split it:
-           Ls=Rs=.707*(Lt-Rt)
-       Trouble is, Lt could be +1, Rt -1, so possibility that S will
-       overflow. So to avoid that, we cut L/R by 3dB (*.707), and S by
-       6dB (/2). This keeps the overall balance, but guarantees no
-       overflow. */
-
-    // Output front left and right
-    out[0] = m[0]*in[0] + m[1]*in[1];
-    out[1] = m[2]*in[0] + m[3]*in[1];
+  end = out + data->samples * af->data->nch;
+
+  /* About volume balancing...
+     Surround encoding does the following:
+         Lt=L+.707*C+.707*S, Rt=R+.707*C-.707*S
+     So S should be extracted as:
+         (Lt-Rt)
+     But we are splitting the S to two output channels, so we
+     must take 3dB off as we split it:
+         Ls=Rs=.707*(Lt-Rt)
+     Trouble is, Lt could be +1, Rt -1, so possibility that S will
+     overflow. So to avoid that, we cut L/R by 3dB (*.707), and S by
+     6dB (/2). This keeps the overall balance, but guarantees no
+     overflow. */
+
+  // Output front left and right, and the surround signals
+  mp_chmix_process(s->mix, out, data->planes[0], data->samples);
+
+  while(out < end){
+    float sl = out[2], sr = out[3];
 
     // Low-pass output @ 7kHz
     FIR((&s->lq[i]), s->w, s->dl[wi]);
@@ -200,15 +216,14 @@ static int filter(struct af_instance* af, struct mp_audio* data, int flags){
     UPDATEQI(ri);
     UPDATEQI(wi);
 
-    // Calculate and save surround in circular queue
+    // Save surround in circular queue
 #ifdef SPLITREAR
-    ADDQUE(i, s->rq, s->lq, m[6]*in[0]+m[7]*in[1], m[8]*in[0]+m[9]*in[1]);
+    ADDQUE(i, s->rq, s->lq, sr, sl);
 #else
-    ADDQUE(i, s->lq, m[4]*in[0]+m[5]*in[1]);
+    ADDQUE(i, s->lq, sl);
 #endif
 
     // Next sample...
-    in = &in[data->nch];
     out = &out[af->data->nch];
   }
 
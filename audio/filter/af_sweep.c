@@ -41,7 +41,9 @@ static int control(struct af_instance* af, int cmd, void* arg)
   switch(cmd){
   case AF_CONTROL_REINIT:
     mp_audio_copy_config(af->data, data);
-    mp_audio_set_format(af->data, AF_FORMAT_S16);
+    mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+    if (af_fmt_is_planar(data->format))
+        mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
 
     return af_test_output(af, data);
   }
@@ -52,14 +54,17 @@ static int control(struct af_instance* af, int cmd, void* arg)
 static int filter(struct af_instance* af, struct mp_audio* data, int f)
 {
   af_sweept *s = af->priv;
-  int i, j;
-  int16_t *in = (int16_t*)data->planes[0];
-  int chans   = data->nch;
+  int i, j, p;
+  int chans   = data->spf;   // channels per plane
   int in_len  = data->samples;
 
   for(i=0; i<in_len; i++){
-      for(j=0; j<chans; j++)
-          in[i*chans+j]= 32000*sin(s->x*s->x);
+      float v = 32000 / 32768.0 * sin(s->x*s->x);
+      for(p=0; p<data->num_planes; p++){
+          float *in = data->planes[p];
+          for(j=0; j<chans; j++)
+              in[i*chans+j]= v;
+      }
       s->x += s->delta;
       if(2*s->x*s->delta >= 3.141592) s->x=0;
   }
@@ -77,6 +82,7 @@ static int af_open(struct af_instance* af){
 struct af_info af_info_sweep = {
     .info = "sine sweep",
     .name = "sweep",
+    .flags = AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(af_sweept),
     .options = (const struct m_option[]) {
@@ -0,0 +1,242 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Export the audio to other processes (visualizers, meters, ...) through a
+ * ring of packets in POSIX shared memory. See af_tap.h for the layout. The
+ * audio passes through unchanged.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "compat/atomics.h"
+#include "af.h"
+#include "af_tap.h"
+
+struct priv {
+    char *cfg_name;
+    int max_frames;
+    int num_packets;
+
+    char *name;                 // shm object name (with leading '/')
+    struct mp_tap_header *header;
+    size_t map_size;
+
+    uint64_t seq;
+    uint64_t frame_pos;
+    bool discontinuity;
+};
+
+static struct mp_tap_packet *get_packet(struct priv *p, uint64_t seq)
+{
+    struct mp_tap_header *h = p->header;
+    return (void *)((uint8_t *)h + h->header_size +
+                    (size_t)((seq - 1) % h->num_packets) * h->packet_size);
+}
+
+static void close_shm(struct priv *p)
+{
+    if (!p->header)
+        return;
+    mp_atomic_store(&p->header->closed, 1);
+    munmap(p->header, p->map_size);
+    // Readers keep their mapping until they notice the closed flag.
+    shm_unlink(p->name);
+    p->header = NULL;
+}
+
+static int open_shm(struct af_instance *af, struct mp_audio *fmt)
+{
+    struct priv *p = af->priv;
+
+    size_t header_size = MP_ALIGN_UP(sizeof(struct mp_tap_header), 64);
+    size_t packet_size = MP_ALIGN_UP(sizeof(struct mp_tap_packet) +
+                                     p->max_frames * fmt->nch * sizeof(float),
+                                     64);
+    p->map_size = header_size + packet_size * p->num_packets;
+
+    // Create a new object, so that readers of an old one (possibly with a
+    // different format) see its closed flag instead of garbage.
+    shm_unlink(p->name);
+    int fd = shm_open(p->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        MP_ERR(af, "Could not create shared memory object '%s'.\n", p->name);
+        return -1;
+    }
+    void *ptr = MAP_FAILED;
+    if (ftruncate(fd, p->map_size) == 0) {
+        ptr = mmap(NULL, p->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    }
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        MP_ERR(af, "Could not map shared memory object '%s'.\n", p->name);
+        shm_unlink(p->name);
+        return -1;
+    }
+
+    p->header = ptr;
+    *p->header = (struct mp_tap_header) {
+        .magic = MP_TAP_MAGIC,
+        .version = MP_TAP_VERSION,
+        .header_size = header_size,
+        .packet_size = packet_size,
+        .num_packets = p->num_packets,
+        .max_frames = p->max_frames,
+        .nch = fmt->nch,
+        .rate = fmt->rate,
+    };
+    for (int n = 0; n < fmt->nch; n++)
+        p->header->speakers[n] = fmt->channels.speaker[n];
+    mp_memory_barrier();
+
+    p->seq = 0;
+    p->frame_pos = 0;
+    p->discontinuity = true;
+    MP_VERBOSE(af, "Exporting %d packets of %d frames to '%s'.\n",
+               p->num_packets, p->max_frames, p->name);
+    return 0;
+}
+
+static int control(struct af_instance *af, int cmd, void *arg)
+{
+    struct priv *p = af->priv;
+
+    switch (cmd) {
+    case AF_CONTROL_REINIT: {
+        struct mp_audio *in = arg;
+
+        mp_audio_copy_config(af->data, in);
+        if (af_fmt_is_planar(in->format)) {
+            mp_audio_set_format(af->data, AF_FORMAT_FLOATP);
+        } else {
+            mp_audio_set_format(af->data, AF_FORMAT_FLOAT);
+        }
+
+        struct mp_tap_header *h = p->header;
+        if (!h || h->nch != af->data->nch || h->rate != af->data->rate ||
+            memcmp(h->speakers, af->data->channels.speaker, h->nch) != 0)
+        {
+            close_shm(p);
+            if (open_shm(af, af->data) < 0)
+                return AF_ERROR;
+        }
+        p->discontinuity = true;
+        return af_test_output(af, in);
+    }
+    case AF_CONTROL_RESET:
+        p->discontinuity = true;
+        return AF_OK;
+    }
+    return AF_UNKNOWN;
+}
+
+static int filter(struct af_instance *af, struct mp_audio *data, int flags)
+{
+    struct priv *p = af->priv;
+    int nch = data->nch;
+    bool planar = af_fmt_is_planar(data->format);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t time_ns = ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+
+    for (int pos = 0; pos < data->samples; pos += p->max_frames) {
+        int frames = MPMIN(data->samples - pos, p->max_frames);
+        uint64_t seq = p->seq + 1;
+        struct mp_tap_packet *pkt = get_packet(p, seq);
+
+        mp_atomic_store(&pkt->seq, 0);
+        // Readers must not see any payload writes before seq = 0.
+        mp_memory_barrier_release();
+        pkt->frame_pos = p->frame_pos;
+        pkt->time_ns = time_ns;
+        pkt->pts = af->pts == MP_NOPTS_VALUE ? NAN
+                                             : af->pts + pos / (double)data->rate;
+        pkt->frames = frames;
+        pkt->flags = p->discontinuity ? MP_TAP_DISCONTINUITY : 0;
+
+        float *dst = (float *)(pkt + 1);
+        if (planar) {
+            for (int c = 0; c < nch; c++) {
+                const float *src = (float *)data->planes[c] + pos;
+                for (int i = 0; i < frames; i++)
+                    dst[i * nch + c] = src[i];
+            }
+        } else {
+            memcpy(dst, (float *)data->planes[0] + pos * nch,
+                   frames * nch * sizeof(float));
+        }
+
+        mp_atomic_store(&pkt->seq, seq);
+        mp_atomic_store(&p->header->write_seq, seq);
+        p->seq = seq;
+        p->frame_pos += frames;
+        p->discontinuity = false;
+    }
+    return 0;
+}
+
+static void uninit(struct af_instance *af)
+{
+    close_shm(af->priv);
+}
+
+static int af_open(struct af_instance *af)
+{
+    struct priv *p = af->priv;
+
+    af->control = control;
+    af->filter = filter;
+    af->uninit = uninit;
+
+    if (!p->cfg_name || !p->cfg_name[0]) {
+        MP_ERR(af, "No shared memory object name set.\n");
+        return AF_ERROR;
+    }
+    p->name = p->cfg_name[0] == '/' ? talloc_strdup(p, p->cfg_name)
+                                    : talloc_asprintf(p, "/%s", p->cfg_name);
+    return AF_OK;
+}
+
+#define OPT_BASE_STRUCT struct priv
+
+struct af_info af_info_tap = {
+    .info = "Export audio through a shared memory ring",
+    .name = "tap",
+    .flags = AF_FLAGS_INPLACE,
+    .open = af_open,
+    .priv_size = sizeof(struct priv),
+    .priv_defaults = &(const struct priv) {
+        .cfg_name = "mpv-tap",
+    },
+    .options = (const struct m_option[]) {
+        OPT_STRING("name", cfg_name, 0),
+        OPT_INTRANGE("frames", max_frames, 0, 16, 65536, OPTDEF_INT(1024)),
+        OPT_INTRANGE("packets", num_packets, 0, 4, 4096, OPTDEF_INT(64)),
+        {0}
+    },
+};
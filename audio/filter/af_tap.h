@@ -0,0 +1,86 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_AF_TAP_H
+#define MP_AF_TAP_H
+
+/* Layout of the POSIX shared memory object written by the "tap" audio filter.
+ * This header doesn't depend on other mpv headers, so that external programs
+ * can use it.
+ *
+ * The object starts with struct mp_tap_header, followed by num_packets slots
+ * of packet_size bytes (at offset header_size + n * packet_size). Each slot
+ * holds a struct mp_tap_packet, followed by the audio as interleaved 32 bit
+ * floats. Packet number seq (counted from 1) is stored in slot
+ * (seq - 1) % num_packets. The writer never waits for readers, so any number
+ * of readers can read the same object; a reader that falls behind by more
+ * than num_packets packets loses audio.
+ *
+ * Fields marked as atomic must be accessed with atomic operations (such as
+ * __atomic_load_n(&field, __ATOMIC_SEQ_CST)). To read packet seq:
+ *   1. If seq > header.write_seq, the packet is not written yet.
+ *   2. If seq + num_packets <= header.write_seq, it was overwritten already.
+ *   3. Check that slot.seq == seq, copy the packet, issue an acquire fence
+ *      (__atomic_thread_fence(__ATOMIC_ACQUIRE)), then check slot.seq again.
+ *      If it changed, the writer overwrote the packet while it was copied,
+ *      and the copy must be discarded. Without the fence, the second check
+ *      could be ordered before reads of the copied data.
+ *
+ * The writer stores 0 to slot.seq, issues a release fence, writes the packet,
+ * and then stores the new seq to slot.seq and header.write_seq. The fence
+ * keeps the packet writes from becoming visible before seq = 0. If closed
+ * is set, the writer is gone (or has recreated the object with a different
+ * format under the same name), and the reader should reopen the object.
+ */
+
+#include <stdint.h>
+
+#define MP_TAP_MAGIC 0x5041544d // "MTAP" in little endian
+#define MP_TAP_VERSION 1
+
+// Flags for mp_tap_packet.flags
+#define MP_TAP_DISCONTINUITY 1  // not contiguous with the previous packet
+                                // (first packet, seek, or format change)
+
+struct mp_tap_header {
+    uint32_t magic;             // MP_TAP_MAGIC
+    uint32_t version;           // MP_TAP_VERSION
+    uint32_t header_size;       // offset of the first slot
+    uint32_t packet_size;       // size of a slot in bytes
+    uint32_t num_packets;       // number of slots
+    uint32_t max_frames;        // maximum number of frames in a packet
+    uint32_t nch;               // number of channels
+    uint32_t rate;              // sample rate in Hz
+    uint8_t speakers[16];       // channel layout (mpv speaker IDs, as in
+                                // audio/chmap.h), nch entries are valid
+    uint32_t closed;            // (atomic) see above
+    uint32_t reserved;
+    uint64_t write_seq;         // (atomic) number of the last packet written
+};
+
+struct mp_tap_packet {
+    uint64_t seq;               // (atomic) packet number, 0 while written
+    uint64_t frame_pos;         // number of frames written before this packet
+    int64_t time_ns;            // CLOCK_MONOTONIC time when it was written
+    double pts;                 // playback time of the first frame in
+                                // seconds, or NAN if unknown
+    uint32_t frames;            // number of frames (samples per channel)
+    uint32_t flags;             // MP_TAP_* flags
+    // followed by frames * nch floats
+};
+
+#endif
@@ -27,10 +27,16 @@
 #include <limits.h>
 
 #include "common/common.h"
+#include "demux/demux.h"
 #include "af.h"
 
 struct priv {
     float level;                // Gain level for each channel
+    float rgain;                // ReplayGain level
+    int rgain_track;            // Enable/disable track based replaygain
+    int rgain_album;            // Enable/disable album based replaygain
+    float rgain_preamp;         // Set replaygain pre-amplification
+    int rgain_clip;             // Enable/disable clipping prevention
     int soft;                   // Enable/disable soft clipping
     int fast;                   // Use fix-point volume control
     float cfg_volume;
@@ -54,6 +60,25 @@ static int control(struct af_instance *af, int cmd, void *arg)
         }
         if (af_fmt_is_planar(in->format))
             mp_audio_set_format(af->data, af_fmt_to_planar(af->data->format));
+        s->rgain = 1.0;
+        struct replaygain_data *rg = af->replaygain_data;
+        if ((s->rgain_track || s->rgain_album) && rg) {
+            float gain, peak;
+            if (s->rgain_track) {
+                gain = rg->track_gain;
+                peak = rg->track_peak;
+            } else {
+                gain = rg->album_gain;
+                peak = rg->album_peak;
+            }
+            gain += s->rgain_preamp;
+            af_from_dB(1, &gain, &s->rgain, 20.0, -200.0, 60.0);
+            MP_VERBOSE(af, "Applying replay-gain: %f\n", s->rgain);
+            if (!s->rgain_clip && peak > 0) { // clipping prevention
+                s->rgain = MPMIN(s->rgain, 1.0 / peak);
+                MP_VERBOSE(af, "...with clipping prevention: %f\n", s->rgain);
+            }
+        }
         return af_test_output(af, in);
     }
     case AF_CONTROL_SET_VOLUME:
@@ -72,7 +97,7 @@ static void filter_plane(struct af_instance *af, void *ptr, int num_samples)
 
     if (af_fmt_from_planar(af->data->format) == AF_FORMAT_S16) {
         int16_t *a = ptr;
-        int vol = 256.0 * s->level;
+        int vol = 256.0 * s->level * s->rgain;
         if (vol != 256) {
             for (int i = 0; i < num_samples; i++) {
                 int x = (a[i] * vol) >> 8;
@@ -81,7 +106,7 @@ static void filter_plane(struct af_instance *af, void *ptr, int num_samples)
         }
     } else if (af_fmt_from_planar(af->data->format) == AF_FORMAT_FLOAT) {
         float *a = ptr;
-        float vol = s->level;
+        float vol = s->level * s->rgain;
         if (vol != 1.0) {
             for (int i = 0; i < num_samples; i++) {
                 float x = a[i] * vol;
@@ -104,6 +129,7 @@ static int af_open(struct af_instance *af)
     struct priv *s = af->priv;
     af->control = control;
     af->filter = filter;
+    s->rgain = 1.0;
     af_from_dB(1, &s->cfg_volume, &s->level, 20.0, -200.0, 60.0);
     return AF_OK;
 }
@@ -114,13 +140,17 @@ static int af_open(struct af_instance *af)
 struct af_info af_info_volume = {
     .info = "Volume control audio filter",
     .name = "volume",
-    .flags = AF_FLAGS_NOT_REENTRANT,
+    .flags = AF_FLAGS_NOT_REENTRANT | AF_FLAGS_INPLACE,
     .open = af_open,
     .priv_size = sizeof(struct priv),
     .options = (const struct m_option[]) {
         OPT_FLOATRANGE("volumedb", cfg_volume, 0, -200, 60),
         OPT_FLAG("softclip", soft, 0),
         OPT_FLAG("s16", fast, 0),
+        OPT_FLAG("replaygain-track", rgain_track, 0),
+        OPT_FLAG("replaygain-album", rgain_album, 0),
+        OPT_FLOATRANGE("replaygain-preamp", rgain_preamp, 0, -15, 15),
+        OPT_FLAG("replaygain-clip", rgain_clip, 0),
         {0}
     },
 };
@@ -0,0 +1,412 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Biquad cascades in transposed direct form II.
+ *
+ * Each section computes the difference between output and input, with the
+ * coefficients d0 = b0 - 1, d1 = b1 - a1, d2 = b2 - a2:
+ *
+ *   e[n] = d0*x[n] + d1*x[n-1] + d2*x[n-2] - a1*e[n-1] - a2*e[n-2]
+ *   y[n] = x[n] + e[n]
+ *
+ * This is the same filter, but for the typical equalizer section (numerator
+ * close to the denominator) the small differences are computed in double
+ * precision instead of being lost in the rounding of b and a to float, and
+ * the state stays small. The identity section has all coefficients 0.
+ *
+ * The audio is copied in chunks into a buffer with one SIMD lane per channel
+ * (stride padded to 8 lanes), and each section is run over the whole chunk.
+ * Coefficients and state are stored as [section][coefficient][lane], so a
+ * section needs 7 vector registers for 4 (SSE) or 8 (AVX2) channels.
+ * Coefficient ramps are applied in steps of at most one chunk.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/cpudetect.h"
+#include "biquad.h"
+
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+
+// Frames per chunk; also the granularity of coefficient ramps.
+#define CHUNK 32
+
+enum { D0, D1, D2, A1, A2, NUM_COEFFS };
+
+// Run sections [0, sections) over buf (frames * stride floats), for the
+// lanes [0, width).
+typedef void (*run_fn)(float *buf, int frames, int stride, int width,
+                       const float *coef, float *state, int sections);
+
+struct mp_biquad {
+    int num_ch;
+    int stride;         // lanes per frame (num_ch padded to a multiple of 8)
+    int width;          // lanes that are actually processed
+    int max_sections;
+    int num_sections;   // running sections (during a ramp: old and new ones)
+    int new_sections;   // sections after the ramp
+    int ramp_left;      // samples until the ramp is done
+    run_fn run;
+
+    // All [max_sections][NUM_COEFFS][stride]
+    float *coef, *target, *step, *pending;
+    float *state;       // [max_sections][2][stride]
+    float *buf;         // [CHUNK][stride]
+};
+
+static const char *const type_names[] = {
+    [MP_BIQUAD_PEAK]        = "peak",
+    [MP_BIQUAD_LOWSHELF]    = "lowshelf",
+    [MP_BIQUAD_HIGHSHELF]   = "highshelf",
+    [MP_BIQUAD_NOTCH]       = "notch",
+    [MP_BIQUAD_LOWPASS]     = "lowpass",
+    [MP_BIQUAD_HIGHPASS]    = "highpass",
+};
+
+int mp_biquad_type_from_name(const char *name)
+{
+    for (int n = 0; n < MP_ARRAY_SIZE(type_names); n++) {
+        if (strcmp(type_names[n], name) == 0)
+            return n;
+    }
+    return -1;
+}
+
+void mp_biquad_design(struct mp_biquad_coeffs *c, enum mp_biquad_type type,
+                      double freq, double gain_db, double q, double rate)
+{
+    double A = pow(10, gain_db / 40);
+    double w0 = 2 * M_PI * freq / rate;
+    double cs = cos(w0);
+    double alpha = sin(w0) / (2 * q);
+    double sa = 2 * sqrt(A) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (type) {
+    case MP_BIQUAD_PEAK:
+        b0 = 1 + alpha * A;
+        b1 = -2 * cs;
+        b2 = 1 - alpha * A;
+        a0 = 1 + alpha / A;
+        a1 = -2 * cs;
+        a2 = 1 - alpha / A;
+        break;
+    case MP_BIQUAD_LOWSHELF:
+        b0 = A * ((A + 1) - (A - 1) * cs + sa);
+        b1 = 2 * A * ((A - 1) - (A + 1) * cs);
+        b2 = A * ((A + 1) - (A - 1) * cs - sa);
+        a0 = (A + 1) + (A - 1) * cs + sa;
+        a1 = -2 * ((A - 1) + (A + 1) * cs);
+        a2 = (A + 1) + (A - 1) * cs - sa;
+        break;
+    case MP_BIQUAD_HIGHSHELF:
+        b0 = A * ((A + 1) + (A - 1) * cs + sa);
+        b1 = -2 * A * ((A - 1) + (A + 1) * cs);
+        b2 = A * ((A + 1) + (A - 1) * cs - sa);
+        a0 = (A + 1) - (A - 1) * cs + sa;
+        a1 = 2 * ((A - 1) - (A + 1) * cs);
+        a2 = (A + 1) - (A - 1) * cs - sa;
+        break;
+    case MP_BIQUAD_NOTCH:
+        b0 = 1;
+        b1 = -2 * cs;
+        b2 = 1;
+        a0 = 1 + alpha;
+        a1 = -2 * cs;
+        a2 = 1 - alpha;
+        break;
+    case MP_BIQUAD_LOWPASS:
+        b0 = (1 - cs) / 2;
+        b1 = 1 - cs;
+        b2 = (1 - cs) / 2;
+        a0 = 1 + alpha;
+        a1 = -2 * cs;
+        a2 = 1 - alpha;
+        break;
+    case MP_BIQUAD_HIGHPASS:
+    default:
+        b0 = (1 + cs) / 2;
+        b1 = -(1 + cs);
+        b2 = (1 + cs) / 2;
+        a0 = 1 + alpha;
+        a1 = -2 * cs;
+        a2 = 1 - alpha;
+        break;
+    }
+
+    *c = (struct mp_biquad_coeffs) {
+        .b0 = b0 / a0, .b1 = b1 / a0, .b2 = b2 / a0,
+        .a1 = a1 / a0, .a2 = a2 / a0,
+    };
+}
+
+static void run_c(float *buf, int frames, int stride, int width,
+                  const float *coef, float *state, int sections)
+{
+    for (int s = 0; s < sections; s++) {
+        const float *c = coef + s * NUM_COEFFS * stride;
+        float *st = state + s * 2 * stride;
+        for (int l = 0; l < width; l++) {
+            float d0 = c[D0 * stride + l], d1 = c[D1 * stride + l],
+                  d2 = c[D2 * stride + l], a1 = c[A1 * stride + l],
+                  a2 = c[A2 * stride + l];
+            float s1 = st[l], s2 = st[stride + l];
+            for (int i = 0; i < frames; i++) {
+                float x = buf[i * stride + l];
+                float e = d0 * x + s1;
+                s1 = d1 * x - a1 * e + s2;
+                s2 = d2 * x - a2 * e;
+                buf[i * stride + l] = x + e;
+            }
+            st[l] = s1;
+            st[stride + l] = s2;
+        }
+    }
+}
+
+#if HAVE_X86_INTRINSICS
+__attribute__((target("sse")))
+static void run_sse(float *buf, int frames, int stride, int width,
+                    const float *coef, float *state, int sections)
+{
+    for (int s = 0; s < sections; s++) {
+        const float *c = coef + s * NUM_COEFFS * stride;
+        float *st = state + s * 2 * stride;
+        for (int l = 0; l < width; l += 4) {
+            __m128 d0 = _mm_loadu_ps(c + D0 * stride + l);
+            __m128 d1 = _mm_loadu_ps(c + D1 * stride + l);
+            __m128 d2 = _mm_loadu_ps(c + D2 * stride + l);
+            __m128 a1 = _mm_loadu_ps(c + A1 * stride + l);
+            __m128 a2 = _mm_loadu_ps(c + A2 * stride + l);
+            __m128 s1 = _mm_loadu_ps(st + l);
+            __m128 s2 = _mm_loadu_ps(st + stride + l);
+            for (int i = 0; i < frames; i++) {
+                float *p = buf + i * stride + l;
+                __m128 x = _mm_loadu_ps(p);
+                __m128 e = _mm_add_ps(_mm_mul_ps(d0, x), s1);
+                s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(d1, x),
+                                           _mm_mul_ps(a1, e)), s2);
+                s2 = _mm_sub_ps(_mm_mul_ps(d2, x), _mm_mul_ps(a2, e));
+                _mm_storeu_ps(p, _mm_add_ps(x, e));
+            }
+            _mm_storeu_ps(st + l, s1);
+            _mm_storeu_ps(st + stride + l, s2);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void run_avx2(float *buf, int frames, int stride, int width,
+                     const float *coef, float *state, int sections)
+{
+    for (int s = 0; s < sections; s++) {
+        const float *c = coef + s * NUM_COEFFS * stride;
+        float *st = state + s * 2 * stride;
+        for (int l = 0; l < width; l += 8) {
+            __m256 d0 = _mm256_loadu_ps(c + D0 * stride + l);
+            __m256 d1 = _mm256_loadu_ps(c + D1 * stride + l);
+            __m256 d2 = _mm256_loadu_ps(c + D2 * stride + l);
+            __m256 a1 = _mm256_loadu_ps(c + A1 * stride + l);
+            __m256 a2 = _mm256_loadu_ps(c + A2 * stride + l);
+            __m256 s1 = _mm256_loadu_ps(st + l);
+            __m256 s2 = _mm256_loadu_ps(st + stride + l);
+            for (int i = 0; i < frames; i++) {
+                float *p = buf + i * stride + l;
+                __m256 x = _mm256_loadu_ps(p);
+                __m256 e = _mm256_add_ps(_mm256_mul_ps(d0, x), s1);
+                s1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(d1, x),
+                                                 _mm256_mul_ps(a1, e)), s2);
+                s2 = _mm256_sub_ps(_mm256_mul_ps(d2, x), _mm256_mul_ps(a2, e));
+                _mm256_storeu_ps(p, _mm256_add_ps(x, e));
+            }
+            _mm256_storeu_ps(st + l, s1);
+            _mm256_storeu_ps(st + stride + l, s2);
+        }
+    }
+}
+#endif
+
+// Return the implementation, and the number of lanes it processes at once.
+static run_fn get_run(int *lanes, const char **name)
+{
+#if HAVE_X86_INTRINSICS
+    if (gCpuCaps.hasAVX2) {
+        *lanes = 8;
+        *name = "AVX2";
+        return run_avx2;
+    }
+    if (gCpuCaps.hasSSE) {
+        *lanes = 4;
+        *name = "SSE";
+        return run_sse;
+    }
+#endif
+    *lanes = 1;
+    *name = "C";
+    return run_c;
+}
+
+const char *mp_biquad_simd_name(void)
+{
+    int lanes;
+    const char *name;
+    get_run(&lanes, &name);
+    return name;
+}
+
+struct mp_biquad *mp_biquad_create(void *ta_parent, int num_ch,
+                                   int max_sections)
+{
+    struct mp_biquad *b = talloc_zero(ta_parent, struct mp_biquad);
+    int lanes;
+    const char *name;
+    b->run = get_run(&lanes, &name);
+    b->num_ch = num_ch;
+    b->stride = MP_ALIGN_UP(num_ch, 8);
+    b->width = MP_ALIGN_UP(num_ch, lanes);
+    b->max_sections = max_sections;
+
+    size_t size = max_sections * NUM_COEFFS * b->stride;
+    b->coef = talloc_zero_array(b, float, size);
+    b->target = talloc_zero_array(b, float, size);
+    b->step = talloc_zero_array(b, float, size);
+    b->pending = talloc_zero_array(b, float, size);
+    b->state = talloc_zero_array(b, float, max_sections * 2 * b->stride);
+    b->buf = talloc_zero_array(b, float, CHUNK * b->stride);
+    return b;
+}
+
+void mp_biquad_set(struct mp_biquad *b, int section, int ch,
+                   const struct mp_biquad_coeffs *c)
+{
+    float *p = b->pending + section * NUM_COEFFS * b->stride;
+    int ch0 = ch < 0 ? 0 : ch, ch1 = ch < 0 ? b->num_ch : ch + 1;
+    for (int l = ch0; l < ch1; l++) {
+        p[D0 * b->stride + l] = c->b0 - 1;
+        p[D1 * b->stride + l] = c->b1 - c->a1;
+        p[D2 * b->stride + l] = c->b2 - c->a2;
+        p[A1 * b->stride + l] = c->a1;
+        p[A2 * b->stride + l] = c->a2;
+    }
+}
+
+void mp_biquad_commit(struct mp_biquad *b, int num_sections, int ramp)
+{
+    int per_section = NUM_COEFFS * b->stride;
+    num_sections = MPCLAMP(num_sections, 0, b->max_sections);
+
+    for (int s = 0; s < b->max_sections; s++) {
+        float *t = b->target + s * per_section;
+        if (s < num_sections) {
+            memcpy(t, b->pending + s * per_section, per_section * sizeof(float));
+        } else {
+            memset(t, 0, per_section * sizeof(float));
+        }
+    }
+
+    b->new_sections = num_sections;
+    if (ramp > 0 && b->num_sections > 0) {
+        size_t size = b->max_sections * per_section;
+        for (size_t n = 0; n < size; n++)
+            b->step[n] = (b->target[n] - b->coef[n]) / ramp;
+        b->ramp_left = ramp;
+        b->num_sections = MPMAX(b->num_sections, num_sections);
+    } else {
+        // Nothing is running yet, so there is nothing to ramp from.
+        memcpy(b->coef, b->target, b->max_sections * per_section * sizeof(float));
+        b->ramp_left = 0;
+        b->num_sections = num_sections;
+    }
+}
+
+void mp_biquad_reset(struct mp_biquad *b)
+{
+    memset(b->state, 0, b->max_sections * 2 * b->stride * sizeof(float));
+}
+
+static void ramp_step(struct mp_biquad *b, int samples)
+{
+    size_t size = b->max_sections * NUM_COEFFS * b->stride;
+    b->ramp_left -= samples;
+    if (b->ramp_left > 0) {
+        for (size_t n = 0; n < size; n++)
+            b->coef[n] += b->step[n] * samples;
+    } else {
+        memcpy(b->coef, b->target, size * sizeof(float));
+        // Disabled sections have reached the identity, and their state is 0.
+        for (int s = b->new_sections; s < b->num_sections; s++)
+            memset(b->state + s * 2 * b->stride, 0, 2 * b->stride * sizeof(float));
+        b->num_sections = b->new_sections;
+        b->ramp_left = 0;
+    }
+}
+
+// Filter either interleaved data, or planes (one per channel) if not NULL.
+static void process(struct mp_biquad *b, float *data, float **planes,
+                    int samples)
+{
+    int nch = b->num_ch, stride = b->stride;
+    int pos = 0;
+
+    while (pos < samples && b->num_sections > 0) {
+        int n = MPMIN(samples - pos, CHUNK);
+        if (b->ramp_left > 0) {
+            n = MPMIN(n, b->ramp_left);
+            ramp_step(b, n);
+        }
+
+        for (int i = 0; i < n; i++) {
+            float *dst = b->buf + i * stride;
+            if (planes) {
+                for (int c = 0; c < nch; c++)
+                    dst[c] = planes[c][pos + i];
+            } else {
+                memcpy(dst, data + (pos + i) * nch, nch * sizeof(float));
+            }
+        }
+        b->run(b->buf, n, stride, b->width, b->coef, b->state, b->num_sections);
+        for (int i = 0; i < n; i++) {
+            float *src = b->buf + i * stride;
+            if (planes) {
+                for (int c = 0; c < nch; c++)
+                    planes[c][pos + i] = src[c];
+            } else {
+                memcpy(data + (pos + i) * nch, src, nch * sizeof(float));
+            }
+        }
+
+        pos += n;
+    }
+}
+
+void mp_biquad_process(struct mp_biquad *b, float *data, int samples)
+{
+    process(b, data, NULL, samples);
+}
+
+void mp_biquad_process_planar(struct mp_biquad *b, float **planes, int samples)
+{
+    process(b, NULL, planes, samples);
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_BIQUAD_H
+#define MP_BIQUAD_H
+
+enum mp_biquad_type {
+    MP_BIQUAD_PEAK,
+    MP_BIQUAD_LOWSHELF,
+    MP_BIQUAD_HIGHSHELF,
+    MP_BIQUAD_NOTCH,
+    MP_BIQUAD_LOWPASS,
+    MP_BIQUAD_HIGHPASS,
+};
+
+// Normalized coefficients of one section:
+//   y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+struct mp_biquad_coeffs {
+    double b0, b1, b2, a1, a2;
+};
+
+// Design a section (Audio EQ Cookbook formulas). freq is in Hz and must be
+// below rate / 2. gain_db is ignored for notch, lowpass and highpass. q is the
+// quality factor (for shelves, 1/sqrt(2) gives the steepest slope without
+// overshoot).
+void mp_biquad_design(struct mp_biquad_coeffs *c, enum mp_biquad_type type,
+                      double freq, double gain_db, double q, double rate);
+
+// Map a type name ("peak", "lowshelf", ...) to enum mp_biquad_type.
+// Returns -1 if unknown.
+int mp_biquad_type_from_name(const char *name);
+
+// Cascade of up to max_sections biquad sections, applied to interleaved float
+// audio with num_ch channels. Each channel has its own coefficients, and the
+// channels are processed in parallel (in SIMD lanes if possible).
+struct mp_biquad;
+
+struct mp_biquad *mp_biquad_create(void *ta_parent, int num_ch,
+                                   int max_sections);
+
+// Set the coefficients of a section for channel ch, or for all channels if
+// ch is -1. This takes effect with the next mp_biquad_commit().
+void mp_biquad_set(struct mp_biquad *b, int section, int ch,
+                   const struct mp_biquad_coeffs *c);
+
+// Use the coefficients set with mp_biquad_set() for sections [0, num_sections)
+// from now on; the following sections are disabled. The coefficients are
+// interpolated from the current ones over ramp samples (0 switches
+// immediately), so that parameter changes don't produce clicks.
+void mp_biquad_commit(struct mp_biquad *b, int num_sections, int ramp);
+
+// Clear the filter state.
+void mp_biquad_reset(struct mp_biquad *b);
+
+// Filter data in place. Does nothing if no section is enabled.
+void mp_biquad_process(struct mp_biquad *b, float *data, int samples);
+
+// Same as mp_biquad_process(), but with one plane per channel.
+void mp_biquad_process_planar(struct mp_biquad *b, float **planes, int samples);
+
+// Name of the implementation in use ("C", "SSE", "AVX2").
+const char *mp_biquad_simd_name(void);
+
+#endif
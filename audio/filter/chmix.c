@@ -0,0 +1,399 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Channel matrix mixing.
+ *
+ * Each output channel is computed as the sum of the input channels with a
+ * non-zero gain in its matrix row, vectorized over the samples. Interleaved
+ * audio is split into planes first (only the input channels that are used,
+ * so that for example LFE costs nothing in a stereo downmix), and the output
+ * is interleaved again.
+ *
+ * The audio is processed in chunks, and the chunk's input is read completely
+ * before the output is written, which makes in-place processing safe.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/cpudetect.h"
+#include "audio/chmap.h"
+#include "chmix.h"
+
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+
+// Frames per chunk.
+#define CHUNK 256
+
+// out[i] = sum of gain[e] * in[idx[e]][pos + i] over the num entries.
+typedef void (*row_fn)(float *out, float **in, int pos, const float *gain,
+                       const int *idx, int num, int n);
+
+struct mp_chmix {
+    int in_ch, out_ch;
+    float matrix[MP_NUM_CHANNELS][MP_NUM_CHANNELS]; // [out][in]
+
+    // Compiled by mp_chmix_commit()
+    row_fn row;
+    bool identity;
+    int used_in[MP_NUM_CHANNELS];   // input channels with a non-zero gain
+    int num_used;
+    struct {
+        float gain[MP_NUM_CHANNELS];
+        int in[MP_NUM_CHANNELS];
+        int num;
+    } rows[MP_NUM_CHANNELS];
+
+    float in_buf[MP_NUM_CHANNELS][CHUNK];
+    float out_buf[MP_NUM_CHANNELS][CHUNK];
+};
+
+static void row_c(float *out, float **in, int pos, const float *gain,
+                  const int *idx, int num, int n)
+{
+    if (!num) {
+        memset(out, 0, n * sizeof(float));
+        return;
+    }
+    const float *x = in[idx[0]] + pos;
+    for (int i = 0; i < n; i++)
+        out[i] = gain[0] * x[i];
+    for (int e = 1; e < num; e++) {
+        x = in[idx[e]] + pos;
+        for (int i = 0; i < n; i++)
+            out[i] += gain[e] * x[i];
+    }
+}
+
+#if HAVE_X86_INTRINSICS
+__attribute__((target("sse")))
+static void row_sse(float *out, float **in, int pos, const float *gain,
+                    const int *idx, int num, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 y = _mm_setzero_ps();
+        for (int e = 0; e < num; e++) {
+            __m128 x = _mm_loadu_ps(in[idx[e]] + pos + i);
+            y = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(gain[e]), x));
+        }
+        _mm_storeu_ps(out + i, y);
+    }
+    if (i < n)
+        row_c(out + i, in, pos + i, gain, idx, num, n - i);
+}
+
+__attribute__((target("avx2")))
+static void row_avx2(float *out, float **in, int pos, const float *gain,
+                     const int *idx, int num, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 y = _mm256_setzero_ps();
+        for (int e = 0; e < num; e++) {
+            __m256 x = _mm256_loadu_ps(in[idx[e]] + pos + i);
+            y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_set1_ps(gain[e]), x));
+        }
+        _mm256_storeu_ps(out + i, y);
+    }
+    if (i < n)
+        row_c(out + i, in, pos + i, gain, idx, num, n - i);
+}
+#endif
+
+static const char *select_simd(row_fn *row)
+{
+#if HAVE_X86_INTRINSICS
+    if (gCpuCaps.hasAVX2) {
+        *row = row_avx2;
+        return "AVX2";
+    }
+    if (gCpuCaps.hasSSE) {
+        *row = row_sse;
+        return "SSE";
+    }
+#endif
+    *row = row_c;
+    return "C";
+}
+
+const char *mp_chmix_simd_name(void)
+{
+    row_fn row;
+    return select_simd(&row);
+}
+
+struct mp_chmix *mp_chmix_create(void *ta_parent, int in_ch, int out_ch)
+{
+    assert(in_ch >= 1 && in_ch <= MP_NUM_CHANNELS);
+    assert(out_ch >= 1 && out_ch <= MP_NUM_CHANNELS);
+    struct mp_chmix *m = talloc_zero(ta_parent, struct mp_chmix);
+    m->in_ch = in_ch;
+    m->out_ch = out_ch;
+    mp_chmix_commit(m);
+    return m;
+}
+
+void mp_chmix_set(struct mp_chmix *m, int out, int in, float gain)
+{
+    if (out >= 0 && out < m->out_ch && in >= 0 && in < m->in_ch)
+        m->matrix[out][in] = gain;
+}
+
+float mp_chmix_get(struct mp_chmix *m, int out, int in)
+{
+    if (out >= 0 && out < m->out_ch && in >= 0 && in < m->in_ch)
+        return m->matrix[out][in];
+    return 0;
+}
+
+void mp_chmix_set_identity(struct mp_chmix *m)
+{
+    for (int o = 0; o < m->out_ch; o++) {
+        for (int i = 0; i < m->in_ch; i++)
+            m->matrix[o][i] = o == i;
+    }
+}
+
+#define NONE 0xFF
+#define S (float)M_SQRT1_2
+
+// Where to put an input speaker missing in the output: the first entry for
+// the speaker whose targets all exist in the output is used.
+static const struct {
+    uint8_t speaker;
+    uint8_t target[2];
+    float gain;
+} downmix_rules[] = {
+    {MP_SP(FL),  {MP_SP(FC), NONE},         S},
+    {MP_SP(FR),  {MP_SP(FC), NONE},         S},
+    {MP_SP(FC),  {MP_SP(FL), MP_SP(FR)},    S},
+    {MP_SP(BL),  {MP_SP(SL), NONE},         1},
+    {MP_SP(BL),  {MP_SP(FL), NONE},         S},
+    {MP_SP(BL),  {MP_SP(FC), NONE},         0.5},
+    {MP_SP(BR),  {MP_SP(SR), NONE},         1},
+    {MP_SP(BR),  {MP_SP(FR), NONE},         S},
+    {MP_SP(BR),  {MP_SP(FC), NONE},         0.5},
+    {MP_SP(FLC), {MP_SP(FL), NONE},         1},
+    {MP_SP(FLC), {MP_SP(FC), NONE},         S},
+    {MP_SP(FRC), {MP_SP(FR), NONE},         1},
+    {MP_SP(FRC), {MP_SP(FC), NONE},         S},
+    {MP_SP(BC),  {MP_SP(BL), MP_SP(BR)},    S},
+    {MP_SP(BC),  {MP_SP(SL), MP_SP(SR)},    S},
+    {MP_SP(BC),  {MP_SP(FL), MP_SP(FR)},    0.5},
+    {MP_SP(BC),  {MP_SP(FC), NONE},         0.5},
+    {MP_SP(SL),  {MP_SP(BL), NONE},         1},
+    {MP_SP(SL),  {MP_SP(FL), NONE},         S},
+    {MP_SP(SL),  {MP_SP(FC), NONE},         0.5},
+    {MP_SP(SR),  {MP_SP(BR), NONE},         1},
+    {MP_SP(SR),  {MP_SP(FR), NONE},         S},
+    {MP_SP(SR),  {MP_SP(FC), NONE},         0.5},
+    {MP_SP(TC),  {MP_SP(FL), MP_SP(FR)},    0.5},
+    {MP_SP(TC),  {MP_SP(FC), NONE},         S},
+    {MP_SP(TFL), {MP_SP(FL), NONE},         S},
+    {MP_SP(TFL), {MP_SP(FC), NONE},         0.5},
+    {MP_SP(TFC), {MP_SP(FC), NONE},         S},
+    {MP_SP(TFC), {MP_SP(FL), MP_SP(FR)},    0.5},
+    {MP_SP(TFR), {MP_SP(FR), NONE},         S},
+    {MP_SP(TFR), {MP_SP(FC), NONE},         0.5},
+    {MP_SP(TBL), {MP_SP(BL), NONE},         S},
+    {MP_SP(TBL), {MP_SP(SL), NONE},         S},
+    {MP_SP(TBL), {MP_SP(FL), NONE},         0.5},
+    {MP_SP(TBC), {MP_SP(BL), MP_SP(BR)},    0.5},
+    {MP_SP(TBC), {MP_SP(FL), MP_SP(FR)},    0.5},
+    {MP_SP(TBR), {MP_SP(BR), NONE},         S},
+    {MP_SP(TBR), {MP_SP(SR), NONE},         S},
+    {MP_SP(TBR), {MP_SP(FR), NONE},         0.5},
+    {MP_SP(DL),  {MP_SP(FL), NONE},         1},
+    {MP_SP(DL),  {MP_SP(FC), NONE},         S},
+    {MP_SP(DR),  {MP_SP(FR), NONE},         1},
+    {MP_SP(DR),  {MP_SP(FC), NONE},         S},
+    {MP_SP(WL),  {MP_SP(FL), NONE},         1},
+    {MP_SP(WL),  {MP_SP(FC), NONE},         S},
+    {MP_SP(WR),  {MP_SP(FR), NONE},         1},
+    {MP_SP(WR),  {MP_SP(FC), NONE},         S},
+    {MP_SP(SDL), {MP_SP(SL), NONE},         1},
+    {MP_SP(SDL), {MP_SP(BL), NONE},         1},
+    {MP_SP(SDL), {MP_SP(FL), NONE},         S},
+    {MP_SP(SDR), {MP_SP(SR), NONE},         1},
+    {MP_SP(SDR), {MP_SP(BR), NONE},         1},
+    {MP_SP(SDR), {MP_SP(FR), NONE},         S},
+    // LFE and LFE2 are dropped.
+};
+
+#undef S
+
+static int find_speaker(const struct mp_chmap *map, int speaker)
+{
+    for (int n = 0; n < map->num; n++) {
+        if (map->speaker[n] == speaker)
+            return n;
+    }
+    return -1;
+}
+
+void mp_chmix_set_layout(struct mp_chmix *m, const struct mp_chmap *in,
+                         const struct mp_chmap *out)
+{
+    memset(m->matrix, 0, sizeof(m->matrix));
+
+    if (mp_chmap_is_unknown(in) || mp_chmap_is_unknown(out) ||
+        in->num != m->in_ch || out->num != m->out_ch)
+    {
+        mp_chmix_set_identity(m);
+        return;
+    }
+
+    for (int i = 0; i < m->in_ch; i++) {
+        int sp = in->speaker[i];
+        int o = find_speaker(out, sp);
+        if (o >= 0) {
+            m->matrix[o][i] += 1;
+            continue;
+        }
+        for (int r = 0; r < MP_ARRAY_SIZE(downmix_rules); r++) {
+            if (downmix_rules[r].speaker != sp)
+                continue;
+            const uint8_t *t = downmix_rules[r].target;
+            int o0 = find_speaker(out, t[0]);
+            int o1 = t[1] == NONE ? -1 : find_speaker(out, t[1]);
+            if (o0 < 0 || (t[1] != NONE && o1 < 0))
+                continue;
+            m->matrix[o0][i] += downmix_rules[r].gain;
+            if (o1 >= 0)
+                m->matrix[o1][i] += downmix_rules[r].gain;
+            break;
+        }
+    }
+
+    // Scale down so that the output can't exceed the input peak.
+    float max = 0;
+    for (int o = 0; o < m->out_ch; o++) {
+        float sum = 0;
+        for (int i = 0; i < m->in_ch; i++)
+            sum += fabsf(m->matrix[o][i]);
+        max = MPMAX(max, sum);
+    }
+    if (max > 1) {
+        for (int o = 0; o < m->out_ch; o++) {
+            for (int i = 0; i < m->in_ch; i++)
+                m->matrix[o][i] /= max;
+        }
+    }
+}
+
+void mp_chmix_commit(struct mp_chmix *m)
+{
+    select_simd(&m->row);
+
+    m->identity = m->in_ch == m->out_ch;
+    m->num_used = 0;
+    for (int i = 0; i < m->in_ch; i++) {
+        bool used = false;
+        for (int o = 0; o < m->out_ch; o++) {
+            used |= m->matrix[o][i] != 0;
+            if (m->matrix[o][i] != (o == i))
+                m->identity = false;
+        }
+        if (used)
+            m->used_in[m->num_used++] = i;
+    }
+
+    for (int o = 0; o < m->out_ch; o++) {
+        m->rows[o].num = 0;
+        for (int i = 0; i < m->in_ch; i++) {
+            if (m->matrix[o][i] != 0) {
+                int e = m->rows[o].num++;
+                m->rows[o].gain[e] = m->matrix[o][i];
+                m->rows[o].in[e] = i;
+            }
+        }
+    }
+}
+
+bool mp_chmix_is_identity(struct mp_chmix *m)
+{
+    return m->identity;
+}
+
+void mp_chmix_process(struct mp_chmix *m, float *dst, const float *src,
+                      int samples)
+{
+    int in_ch = m->in_ch, out_ch = m->out_ch;
+    assert(dst != src || out_ch <= in_ch);
+
+    if (m->identity) {
+        if (dst != src)
+            memcpy(dst, src, samples * in_ch * sizeof(float));
+        return;
+    }
+
+    float *in[MP_NUM_CHANNELS];
+    for (int c = 0; c < in_ch; c++)
+        in[c] = m->in_buf[c];
+
+    for (int pos = 0; pos < samples; pos += CHUNK) {
+        int n = MPMIN(samples - pos, CHUNK);
+        const float *s = src + pos * in_ch;
+        for (int u = 0; u < m->num_used; u++) {
+            int c = m->used_in[u];
+            float *p = m->in_buf[c];
+            for (int i = 0; i < n; i++)
+                p[i] = s[i * in_ch + c];
+        }
+        for (int o = 0; o < out_ch; o++) {
+            m->row(m->out_buf[o], in, 0, m->rows[o].gain, m->rows[o].in,
+                   m->rows[o].num, n);
+        }
+        float *d = dst + pos * out_ch;
+        for (int o = 0; o < out_ch; o++) {
+            const float *p = m->out_buf[o];
+            for (int i = 0; i < n; i++)
+                d[i * out_ch + o] = p[i];
+        }
+    }
+}
+
+void mp_chmix_process_planar(struct mp_chmix *m, float **dst, float **src,
+                             int samples)
+{
+    if (m->identity) {
+        bool same = true;
+        for (int c = 0; c < m->out_ch; c++)
+            same &= dst[c] == src[c];
+        if (same)
+            return;
+    }
+
+    for (int pos = 0; pos < samples; pos += CHUNK) {
+        int n = MPMIN(samples - pos, CHUNK);
+        for (int o = 0; o < m->out_ch; o++) {
+            m->row(m->out_buf[o], src, pos, m->rows[o].gain, m->rows[o].in,
+                   m->rows[o].num, n);
+        }
+        for (int o = 0; o < m->out_ch; o++)
+            memcpy(dst[o] + pos, m->out_buf[o], n * sizeof(float));
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_CHMIX_H
+#define MP_CHMIX_H
+
+#include <stdbool.h>
+
+struct mp_chmap;
+
+// Channel matrix mixer for float audio: each output channel is a weighted sum
+// of the input channels. Up to MP_NUM_CHANNELS input and output channels.
+struct mp_chmix;
+
+// The matrix is initially all 0.
+struct mp_chmix *mp_chmix_create(void *ta_parent, int in_ch, int out_ch);
+
+// Set the gain from input channel in to output channel out. This takes effect
+// with the next mp_chmix_commit().
+void mp_chmix_set(struct mp_chmix *m, int out, int in, float gain);
+float mp_chmix_get(struct mp_chmix *m, int out, int in);
+
+// Set all gains to 0 (out != in) or 1 (out == in).
+void mp_chmix_set_identity(struct mp_chmix *m);
+
+// Set the usual up/downmix matrix between two channel layouts (with the
+// number of channels given to mp_chmix_create()): speakers present in both are
+// passed through, the others are mixed into the nearest output speakers
+// (center and surround at -3 dB, LFE is dropped). The matrix is scaled down
+// if needed, so that it can't clip. If a layout is unknown, channels are
+// mapped by index.
+void mp_chmix_set_layout(struct mp_chmix *m, const struct mp_chmap *in,
+                         const struct mp_chmap *out);
+
+// Prepare the matrix for processing (only the non-zero gains are applied).
+void mp_chmix_commit(struct mp_chmix *m);
+
+// Whether the committed matrix passes the audio through unchanged.
+bool mp_chmix_is_identity(struct mp_chmix *m);
+
+// Mix interleaved audio. dst can be the same as src if the output has no more
+// channels than the input.
+void mp_chmix_process(struct mp_chmix *m, float *dst, const float *src,
+                      int samples);
+
+// Mix planar audio. Planes in dst can be the same as planes in src.
+void mp_chmix_process_planar(struct mp_chmix *m, float **dst, float **src,
+                             int samples);
+
+// Name of the implementation in use ("C", "SSE", "AVX2").
+const char *mp_chmix_simd_name(void);
+
+#endif
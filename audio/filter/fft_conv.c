@@ -0,0 +1,314 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Uniformly partitioned overlap-save convolution:
+ *
+ * The impulse responses are cut into partitions of block samples, and the
+ * spectrum of each partition (zero-padded to 2 * block) is precomputed. For
+ * each block of input, the spectrum of the last 2 * block input samples is
+ * stored in a frequency domain delay line. The output spectrum is the sum of
+ * delay line entry p multiplied with the spectrum of partition p, and the
+ * second half of its inverse transform is the next block of output.
+ *
+ * Spectra are stored as separate real and imaginary arrays (bins padded to a
+ * multiple of 8), so that the complex multiply-accumulate is easy to
+ * vectorize.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libavcodec/avfft.h>
+#include <libavutil/common.h>
+#include <libavutil/mem.h>
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/cpudetect.h"
+#include "fft_conv.h"
+
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+
+// acc += x * h for n complex values. Each argument points to n real parts,
+// followed by n imaginary parts. n is a multiple of 8.
+typedef void (*cmac_fn)(float *acc, const float *x, const float *h, int n);
+
+struct fft_conv {
+    int block;          // partition size, also the latency
+    int bins;           // block + 1, padded to a multiple of 8
+    int num_in, num_out;
+    int num_parts;      // maximum number of partitions per impulse response
+    RDFTContext *fft, *ifft;
+    cmac_fn cmac;
+
+    float *in_buf;      // per input: the previous and the current block
+    float *out_buf;     // per output: the current block of output
+    int pos;            // number of samples in the current block
+
+    float *fdl;         // per input: num_parts spectra
+    int fdl_pos;        // index of the most recent spectrum
+    float *ir;          // per output/input pair: num_parts spectra
+    int *ir_parts;      // per output/input pair: used partitions
+    float *acc;         // output spectrum
+    float *tmp;         // FFT buffer (2 * block, aligned for libavcodec)
+};
+
+static void cmac_c(float *acc, const float *x, const float *h, int n)
+{
+    float *acc_im = acc + n;
+    const float *x_im = x + n, *h_im = h + n;
+    for (int k = 0; k < n; k++) {
+        acc[k]    += x[k] * h[k]    - x_im[k] * h_im[k];
+        acc_im[k] += x[k] * h_im[k] + x_im[k] * h[k];
+    }
+}
+
+#if HAVE_X86_INTRINSICS
+__attribute__((target("sse")))
+static void cmac_sse(float *acc, const float *x, const float *h, int n)
+{
+    float *acc_im = acc + n;
+    const float *x_im = x + n, *h_im = h + n;
+    for (int k = 0; k < n; k += 4) {
+        __m128 xr = _mm_loadu_ps(x + k), xi = _mm_loadu_ps(x_im + k);
+        __m128 hr = _mm_loadu_ps(h + k), hi = _mm_loadu_ps(h_im + k);
+        __m128 re = _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi));
+        __m128 im = _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr));
+        _mm_storeu_ps(acc + k, _mm_add_ps(_mm_loadu_ps(acc + k), re));
+        _mm_storeu_ps(acc_im + k, _mm_add_ps(_mm_loadu_ps(acc_im + k), im));
+    }
+}
+
+__attribute__((target("avx2")))
+static void cmac_avx2(float *acc, const float *x, const float *h, int n)
+{
+    float *acc_im = acc + n;
+    const float *x_im = x + n, *h_im = h + n;
+    for (int k = 0; k < n; k += 8) {
+        __m256 xr = _mm256_loadu_ps(x + k), xi = _mm256_loadu_ps(x_im + k);
+        __m256 hr = _mm256_loadu_ps(h + k), hi = _mm256_loadu_ps(h_im + k);
+        __m256 re = _mm256_sub_ps(_mm256_mul_ps(xr, hr),
+                                  _mm256_mul_ps(xi, hi));
+        __m256 im = _mm256_add_ps(_mm256_mul_ps(xr, hi),
+                                  _mm256_mul_ps(xi, hr));
+        _mm256_storeu_ps(acc + k, _mm256_add_ps(_mm256_loadu_ps(acc + k), re));
+        _mm256_storeu_ps(acc_im + k,
+                         _mm256_add_ps(_mm256_loadu_ps(acc_im + k), im));
+    }
+}
+#endif
+
+static cmac_fn get_cmac(const char **name)
+{
+    const char *dummy;
+    if (!name)
+        name = &dummy;
+#if HAVE_X86_INTRINSICS
+    if (gCpuCaps.hasAVX2) {
+        *name = "AVX2";
+        return cmac_avx2;
+    }
+    if (gCpuCaps.hasSSE) {
+        *name = "SSE";
+        return cmac_sse;
+    }
+#endif
+    *name = "C";
+    return cmac_c;
+}
+
+const char *fft_conv_simd_name(void)
+{
+    const char *name;
+    get_cmac(&name);
+    return name;
+}
+
+static void destroy_conv(void *ptr)
+{
+    struct fft_conv *c = ptr;
+    if (c->fft)
+        av_rdft_end(c->fft);
+    if (c->ifft)
+        av_rdft_end(c->ifft);
+    av_free(c->tmp);
+}
+
+struct fft_conv *fft_conv_create(void *ta_parent, int block, int num_in,
+                                 int num_out, int max_len)
+{
+    if (block < 8 || block > 32768 || (block & (block - 1)) ||
+        num_in < 1 || num_out < 1 || max_len < 1)
+        return NULL;
+
+    struct fft_conv *c = talloc_zero(ta_parent, struct fft_conv);
+    talloc_set_destructor(c, destroy_conv);
+
+    int nbits = av_log2(block) + 1;
+    c->block = block;
+    c->bins = (block + 1 + 7) & ~7;
+    c->num_in = num_in;
+    c->num_out = num_out;
+    c->num_parts = (max_len + block - 1) / block;
+    c->fft = av_rdft_init(nbits, DFT_R2C);
+    c->ifft = av_rdft_init(nbits, IDFT_C2R);
+    c->tmp = av_malloc(2 * block * sizeof(float));
+    if (!c->fft || !c->ifft || !c->tmp) {
+        talloc_free(c);
+        return NULL;
+    }
+
+    c->cmac = get_cmac(NULL);
+
+    size_t spectrum = 2 * c->bins;
+    c->in_buf = talloc_zero_array(c, float, num_in * 2 * block);
+    c->out_buf = talloc_zero_array(c, float, num_out * block);
+    c->fdl = talloc_zero_array(c, float, num_in * c->num_parts * spectrum);
+    c->ir = talloc_zero_array(c, float,
+                              num_out * num_in * c->num_parts * spectrum);
+    c->ir_parts = talloc_zero_array(c, int, num_out * num_in);
+    c->acc = talloc_zero_array(c, float, spectrum);
+    return c;
+}
+
+// Transform c->tmp, and store the result as separate real/imaginary arrays.
+static void forward_fft(struct fft_conv *c, float *dst)
+{
+    float *re = dst, *im = dst + c->bins;
+    av_rdft_calc(c->fft, c->tmp);
+    // Packed format: DC and Nyquist (both real), then complex pairs.
+    re[0] = c->tmp[0];
+    im[0] = 0;
+    re[c->block] = c->tmp[1];
+    im[c->block] = 0;
+    for (int k = 1; k < c->block; k++) {
+        re[k] = c->tmp[2 * k];
+        im[k] = c->tmp[2 * k + 1];
+    }
+}
+
+static float *ir_spectrum(struct fft_conv *c, int out, int in, int part)
+{
+    size_t pair = (size_t)out * c->num_in + in;
+    return c->ir + (pair * c->num_parts + part) * 2 * c->bins;
+}
+
+static float *fdl_spectrum(struct fft_conv *c, int in, int age)
+{
+    int part = (c->fdl_pos + age) % c->num_parts;
+    return c->fdl + ((size_t)in * c->num_parts + part) * 2 * c->bins;
+}
+
+void fft_conv_set_ir(struct fft_conv *c, int out, int in, const float *ir,
+                     int len, float gain)
+{
+    assert(out >= 0 && out < c->num_out && in >= 0 && in < c->num_in);
+    int block = c->block;
+    len = MPMIN(len, c->num_parts * block);
+    while (len > 0 && ir[len - 1] == 0)
+        len--;
+
+    // Also compensate for the unnormalized inverse transform (which scales
+    // by block).
+    gain /= block;
+
+    int parts = (len + block - 1) / block;
+    for (int p = 0; p < parts; p++) {
+        int n = MPMIN(len - p * block, block);
+        for (int i = 0; i < n; i++)
+            c->tmp[i] = ir[p * block + i] * gain;
+        memset(c->tmp + n, 0, (2 * block - n) * sizeof(float));
+        forward_fft(c, ir_spectrum(c, out, in, p));
+    }
+    c->ir_parts[out * c->num_in + in] = parts;
+}
+
+void fft_conv_reset(struct fft_conv *c)
+{
+    memset(c->in_buf, 0, c->num_in * 2 * c->block * sizeof(float));
+    memset(c->out_buf, 0, c->num_out * c->block * sizeof(float));
+    memset(c->fdl, 0,
+           c->num_in * c->num_parts * 2 * c->bins * sizeof(float));
+    c->pos = 0;
+}
+
+static void process_block(struct fft_conv *c)
+{
+    int block = c->block;
+
+    c->fdl_pos = (c->fdl_pos + c->num_parts - 1) % c->num_parts;
+    for (int i = 0; i < c->num_in; i++) {
+        float *buf = c->in_buf + i * 2 * block;
+        memcpy(c->tmp, buf, 2 * block * sizeof(float));
+        forward_fft(c, fdl_spectrum(c, i, 0));
+        memcpy(buf, buf + block, block * sizeof(float));
+    }
+
+    for (int o = 0; o < c->num_out; o++) {
+        float *re = c->acc, *im = c->acc + c->bins;
+        memset(c->acc, 0, 2 * c->bins * sizeof(float));
+        for (int i = 0; i < c->num_in; i++) {
+            int parts = c->ir_parts[o * c->num_in + i];
+            for (int p = 0; p < parts; p++) {
+                c->cmac(c->acc, fdl_spectrum(c, i, p), ir_spectrum(c, o, i, p),
+                        c->bins);
+            }
+        }
+        c->tmp[0] = re[0];
+        c->tmp[1] = re[block];
+        for (int k = 1; k < block; k++) {
+            c->tmp[2 * k] = re[k];
+            c->tmp[2 * k + 1] = im[k];
+        }
+        av_rdft_calc(c->ifft, c->tmp);
+        // The first half is the circular part; discard it.
+        memcpy(c->out_buf + o * block, c->tmp + block, block * sizeof(float));
+    }
+}
+
+void fft_conv_filter(struct fft_conv *c, const float *in, float *out,
+                     int samples)
+{
+    while (samples > 0) {
+        int n = MPMIN(samples, c->block - c->pos);
+        // Read all input of this chunk before writing output, so that in
+        // and out can be the same buffer.
+        for (int i = 0; i < c->num_in; i++) {
+            float *dst = c->in_buf + i * 2 * c->block + c->block + c->pos;
+            for (int s = 0; s < n; s++)
+                dst[s] = in[s * c->num_in + i];
+        }
+        for (int o = 0; o < c->num_out; o++) {
+            float *src = c->out_buf + o * c->block + c->pos;
+            for (int s = 0; s < n; s++)
+                out[s * c->num_out + o] = src[s];
+        }
+        in += n * c->num_in;
+        out += n * c->num_out;
+        samples -= n;
+        c->pos += n;
+        if (c->pos == c->block) {
+            process_block(c);
+            c->pos = 0;
+        }
+    }
+}
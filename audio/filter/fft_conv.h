@@ -0,0 +1,51 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_FFT_CONV_H
+#define MP_FFT_CONV_H
+
+// Uniformly partitioned FFT convolution (overlap-save) of num_in input
+// channels with a num_out x num_in matrix of impulse responses. Output
+// channel o is the sum of all input channels i convolved with IR (o, i).
+// The output is delayed by exactly block samples relative to the input.
+struct fft_conv;
+
+// block must be a power of 2 within [8, 32768]. max_len is the maximum length
+// of the impulse responses set with fft_conv_set_ir(). Returns NULL on error.
+// The initial impulse responses are all 0.
+struct fft_conv *fft_conv_create(void *ta_parent, int block, int num_in,
+                                 int num_out, int max_len);
+
+// Set the impulse response from input channel in to output channel out to
+// ir[0..len) * gain. len is clipped to max_len. ir can be NULL if len is 0.
+// This doesn't clear the filter state.
+void fft_conv_set_ir(struct fft_conv *c, int out, int in, const float *ir,
+                     int len, float gain);
+
+// Clear all buffered audio (but not the impulse responses).
+void fft_conv_reset(struct fft_conv *c);
+
+// Filter the given number of samples. in is interleaved with num_in channels,
+// out is interleaved with num_out channels. in and out may point to the same
+// memory if num_out <= num_in.
+void fft_conv_filter(struct fft_conv *c, const float *in, float *out,
+                     int samples);
+
+// Name of the complex multiply-accumulate implementation ("C", "SSE", "AVX2").
+const char *fft_conv_simd_name(void);
+
+#endif
@@ -56,8 +56,25 @@ struct priv {
 
     AVRational worst_time_base;
     int worst_time_base_is_stream;
+
+    // Frames are encoded and written by encode_job() on this queue's thread.
+    // Only buffer, stream and savepts are used there.
+    struct encode_lavc_queue *queue;
+};
+
+struct encode_job {
+    AVFrame *frame;             // NULL: drain the encoder
+    double apts, realapts;      // for log messages
 };
 
+static void free_job(void *p)
+{
+    struct encode_job *job = p;
+    avcodec_free_frame(&job->frame);
+}
+
+static void encode_job(void *priv, void *item);
+
 static void select_format(struct ao *ao, AVCodec *codec)
 {
     int best_score = INT_MIN;
@@ -166,13 +183,16 @@ static int init(struct ao *ao)
     ac->savepts = MP_NOPTS_VALUE;
     ac->lastpts = MP_NOPTS_VALUE;
 
+    ac->queue = encode_lavc_queue_create(ao->encode_lavc_ctx, ao, encode_job,
+                                         ac->framecount * 2);
+
     ao->untimed = true;
 
     return 0;
 }
 
 // close audio device
-static int encode(struct ao *ao, double apts, void **data);
+static void encode(struct ao *ao, double apts, void **data);
 static void uninit(struct ao *ao, bool cut_audio)
 {
     struct priv *ac = ao->priv;
@@ -180,17 +200,17 @@ static void uninit(struct ao *ao, bool cut_audio)
 
     if (!encode_lavc_start(ectx)) {
         MP_WARN(ao, "not even ready to encode audio at end -> dropped");
-        return;
-    }
-
-    if (ac->buffer) {
+    } else if (ac->buffer) {
         double outpts = ac->expected_next_pts;
         if (!ectx->options->rawts && ectx->options->copyts)
             outpts += ectx->discontinuity_pts_offset;
         outpts += encode_lavc_getoffset(ectx, ac->stream);
-        while (encode(ao, outpts, NULL) > 0) ;
+        encode(ao, outpts, NULL);
     }
 
+    encode_lavc_queue_destroy(ac->queue);
+    ac->queue = NULL;
+
     ao->priv = NULL;
 }
 
@@ -202,68 +222,24 @@ static int get_space(struct ao *ao)
     return ac->aframesize * ac->framecount;
 }
 
-// must get exactly ac->aframesize amount of data
-static int encode(struct ao *ao, double apts, void **data)
+// Called on the queue thread. Returns the packet size, 0 if the encoder did
+// not return a packet, or -1 on error.
+static int encode_frame(struct ao *ao, struct encode_job *job)
 {
-    AVFrame *frame;
-    AVPacket packet;
     struct priv *ac = ao->priv;
-    struct encode_lavc_context *ectx = ao->encode_lavc_ctx;
-    double realapts = ac->aframecount * (double) ac->aframesize /
-                      ao->samplerate;
+    AVFrame *frame = job->frame;
+    AVPacket packet;
     int status, gotpacket;
 
-    ac->aframecount++;
-
-    if (data)
-        ectx->audio_pts_offset = realapts - apts;
-
     av_init_packet(&packet);
     packet.data = ac->buffer;
     packet.size = ac->buffer_size;
-    if(data)
-    {
-        frame = avcodec_alloc_frame();
-        frame->nb_samples = ac->aframesize;
-
-        assert(ao->channels.num <= AV_NUM_DATA_POINTERS);
-        for (int n = 0; n < ao->channels.num; n++)
-            frame->extended_data[n] = data[n];
 
-        frame->linesize[0] = frame->nb_samples * ao->sstride;
+    status = avcodec_encode_audio2(ac->stream->codec, &packet, frame, &gotpacket);
 
-        if (ectx->options->rawts || ectx->options->copyts) {
-            // real audio pts
-            frame->pts = floor(apts * ac->stream->codec->time_base.den / ac->stream->codec->time_base.num + 0.5);
-        } else {
-            // audio playback time
-            frame->pts = floor(realapts * ac->stream->codec->time_base.den / ac->stream->codec->time_base.num + 0.5);
-        }
-
-        int64_t frame_pts = av_rescale_q(frame->pts, ac->stream->codec->time_base, ac->worst_time_base);
-        if (ac->lastpts != MP_NOPTS_VALUE && frame_pts <= ac->lastpts) {
-            // this indicates broken video
-            // (video pts failing to increase fast enough to match audio)
-            MP_WARN(ao, "audio frame pts went backwards (%d <- %d), autofixed\n",
-                    (int)frame->pts, (int)ac->lastpts);
-            frame_pts = ac->lastpts + 1;
-            frame->pts = av_rescale_q(frame_pts, ac->worst_time_base, ac->stream->codec->time_base);
-        }
-        ac->lastpts = frame_pts;
-
-        frame->quality = ac->stream->codec->global_quality;
-        status = avcodec_encode_audio2(ac->stream->codec, &packet, frame, &gotpacket);
-
-        if (!status) {
-            if (ac->savepts == MP_NOPTS_VALUE)
-                ac->savepts = frame->pts;
-        }
-
-        avcodec_free_frame(&frame);
-    }
-    else
-    {
-        status = avcodec_encode_audio2(ac->stream->codec, &packet, NULL, &gotpacket);
+    if (frame && !status) {
+        if (ac->savepts == MP_NOPTS_VALUE)
+            ac->savepts = frame->pts;
     }
 
     if(status) {
@@ -275,7 +251,7 @@ static int encode(struct ao *ao, double apts, void **data)
         return 0;
 
     MP_DBG(ao, "got pts %f (playback time: %f); out size: %d\n",
-           apts, realapts, packet.size);
+           job->apts, job->realapts, packet.size);
 
     encode_lavc_write_stats(ao->encode_lavc_ctx, ac->stream);
 
@@ -304,7 +280,7 @@ static int encode(struct ao *ao, double apts, void **data)
 
     if (encode_lavc_write_frame(ao->encode_lavc_ctx, &packet) < 0) {
         MP_ERR(ao, "error writing at %f %f/%f\n",
-               realapts, (double) ac->stream->time_base.num,
+               job->realapts, (double) ac->stream->time_base.num,
                (double) ac->stream->time_base.den);
         return -1;
     }
@@ -312,6 +288,77 @@ static int encode(struct ao *ao, double apts, void **data)
     return packet.size;
 }
 
+static void encode_job(void *priv, void *item)
+{
+    struct ao *ao = priv;
+    struct encode_job *job = item;
+
+    if (job->frame) {
+        encode_frame(ao, job);
+    } else {
+        while (encode_frame(ao, job) > 0) ;
+    }
+}
+
+// must get exactly ac->aframesize amount of data
+// data == NULL queues draining the encoder
+static void encode(struct ao *ao, double apts, void **data)
+{
+    struct priv *ac = ao->priv;
+    struct encode_lavc_context *ectx = ao->encode_lavc_ctx;
+    double realapts = ac->aframecount * (double) ac->aframesize /
+                      ao->samplerate;
+
+    ac->aframecount++;
+
+    if (data)
+        ectx->audio_pts_offset = realapts - apts;
+
+    struct encode_job *job = talloc_zero(NULL, struct encode_job);
+    talloc_set_destructor(job, free_job);
+    job->apts = apts;
+    job->realapts = realapts;
+
+    if(data)
+    {
+        AVFrame *frame = avcodec_alloc_frame();
+        job->frame = frame;
+        frame->nb_samples = ac->aframesize;
+
+        // The caller reuses its buffer, so the encoder thread gets a copy.
+        size_t num_planes = af_fmt_is_planar(ao->format) ? ao->channels.num : 1;
+        size_t plane_size = ac->aframesize * ao->sstride;
+        assert(num_planes <= AV_NUM_DATA_POINTERS);
+        for (int n = 0; n < num_planes; n++)
+            frame->extended_data[n] = talloc_memdup(job, data[n], plane_size);
+
+        frame->linesize[0] = plane_size;
+
+        if (ectx->options->rawts || ectx->options->copyts) {
+            // real audio pts
+            frame->pts = floor(apts * ac->stream->codec->time_base.den / ac->stream->codec->time_base.num + 0.5);
+        } else {
+            // audio playback time
+            frame->pts = floor(realapts * ac->stream->codec->time_base.den / ac->stream->codec->time_base.num + 0.5);
+        }
+
+        int64_t frame_pts = av_rescale_q(frame->pts, ac->stream->codec->time_base, ac->worst_time_base);
+        if (ac->lastpts != MP_NOPTS_VALUE && frame_pts <= ac->lastpts) {
+            // this indicates broken video
+            // (video pts failing to increase fast enough to match audio)
+            MP_WARN(ao, "audio frame pts went backwards (%d <- %d), autofixed\n",
+                    (int)frame->pts, (int)ac->lastpts);
+            frame_pts = ac->lastpts + 1;
+            frame->pts = av_rescale_q(frame_pts, ac->worst_time_base, ac->stream->codec->time_base);
+        }
+        ac->lastpts = frame_pts;
+
+        frame->quality = ac->stream->codec->global_quality;
+    }
+
+    encode_lavc_queue_add(ac->queue, job);
+}
+
 // this should round samples down to frame sizes
 // return: number of samples played
 static int play(struct ao *ao, void **data, int samples, int flags)
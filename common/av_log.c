@@ -145,9 +145,44 @@ static void mp_msg_av_log_callback(void *ptr, int level, const char *fmt,
     pthread_mutex_unlock(&log_lock);
 }
 
+// libavcodec requires serializing avcodec_open2()/avcodec_close() calls from
+// different threads (image writer threads, playlist prefetching), unless a
+// lock manager is registered.
+static int mp_av_lockmgr(void **mutex, enum AVLockOp op)
+{
+    pthread_mutex_t **m = (pthread_mutex_t **)mutex;
+    switch (op) {
+    case AV_LOCK_CREATE:
+        *m = malloc(sizeof(pthread_mutex_t));
+        if (!*m || pthread_mutex_init(*m, NULL)) {
+            free(*m);
+            *m = NULL;
+            return 1;
+        }
+        return 0;
+    case AV_LOCK_OBTAIN:
+        return !!pthread_mutex_lock(*m);
+    case AV_LOCK_RELEASE:
+        return !!pthread_mutex_unlock(*m);
+    case AV_LOCK_DESTROY:
+        pthread_mutex_destroy(*m);
+        free(*m);
+        *m = NULL;
+        return 0;
+    }
+    return 1;
+}
+
 void init_libav(struct mpv_global *global)
 {
+    static bool lockmgr_registered;
+
     pthread_mutex_lock(&log_lock);
+    if (!lockmgr_registered) {
+        lockmgr_registered = av_lockmgr_register(mp_av_lockmgr) == 0;
+        if (!lockmgr_registered)
+            mp_err(global->log, "Could not register libav lock manager.\n");
+    }
     if (!log_mpv_instance) {
         log_mpv_instance = global;
         log_root = mp_log_new(NULL, global->log, LIB_PREFIX);
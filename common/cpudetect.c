@@ -39,5 +39,9 @@ void GetCpuCaps(CpuCaps *c)
     c->hasSSE2 = (flags & AV_CPU_FLAG_SSE2) && !(flags & AV_CPU_FLAG_SSE2SLOW);
     c->hasSSE3 = (flags & AV_CPU_FLAG_SSE3) && !(flags & AV_CPU_FLAG_SSE3SLOW);
     c->hasSSSE3 = flags & AV_CPU_FLAG_SSSE3;
+#ifdef AV_CPU_FLAG_AVX2
+    // libavutil also checks OS support for saving the YMM registers
+    c->hasAVX2 = flags & AV_CPU_FLAG_AVX2;
+#endif
 #endif
 }
@@ -19,5 +19,9 @@ int encode_lavc_getstatus(struct encode_lavc_context *ctx, char *buf, int bufsiz
 void encode_lavc_expect_stream(struct encode_lavc_context *ctx, int mt);
 void encode_lavc_set_video_fps(struct encode_lavc_context *ctx, float fps);
 bool encode_lavc_didfail(struct encode_lavc_context *ctx); // check if encoding failed
+const char *encode_lavc_get_filename(struct encode_lavc_context *ctx);
+const char *encode_lavc_get_format(struct encode_lavc_context *ctx);
+int encode_lavc_append_file(struct encode_lavc_context *ctx,
+                            const char *filename);
 
 #endif
@@ -20,9 +20,12 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <inttypes.h>
+
 #include <libavutil/avutil.h>
 
 #include "encode_lavc.h"
+#include "common/common.h"
 #include "common/global.h"
 #include "common/msg.h"
 #include "video/vfcap.h"
@@ -32,6 +35,31 @@
 #include "talloc.h"
 #include "stream/stream.h"
 
+struct encode_lavc_queue {
+    struct encode_lavc_context *ctx;
+    void *priv;
+    void (*process)(void *priv, void *item);
+    int max_items;
+    pthread_t thread;
+    bool has_thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;  // signaled on any state change
+    // --- protected by lock
+    void **items;
+    int num_items;
+    bool busy;              // an item is being processed
+    bool terminate;         // the thread should exit; new items are dropped
+};
+
+// Packet queued for the mux thread.
+struct mux_packet {
+    AVPacket packet;
+};
+
+static void mux_packet(void *priv, void *item);
+static void stop_queue(struct encode_lavc_queue *q, bool discard);
+
 static int set_to_avdictionary(struct encode_lavc_context *ctx,
                                AVDictionary **dictp,
                                const char *key,
@@ -133,6 +161,7 @@ struct encode_lavc_context *encode_lavc_init(struct encode_output_conf *options,
         mp_msg_force_stderr(global, true);
 
     ctx = talloc_zero(NULL, struct encode_lavc_context);
+    pthread_mutex_init(&ctx->lock, NULL);
     ctx->log = mp_log_new(ctx, global->log, "encode-lavc");
     ctx->global = global;
     encode_lavc_discontinuity(ctx);
@@ -295,6 +324,10 @@ int encode_lavc_start(struct encode_lavc_context *ctx)
         MP_WARN(ctx, "ofopts: key '%s' not found.\n", de->key);
     av_dict_free(&ctx->foptions);
 
+    // av_interleaved_write_frame() can block on I/O, and buffers packets for
+    // interleaving anyway; a generous queue keeps the encoders busy.
+    ctx->mux_queue = encode_lavc_queue_create(ctx, ctx, mux_packet, 256);
+
     ctx->header_written = 1;
     return 1;
 }
@@ -308,6 +341,7 @@ void encode_lavc_free(struct encode_lavc_context *ctx)
         encode_lavc_fail(ctx,
                          "called encode_lavc_free without encode_lavc_finish\n");
 
+    pthread_mutex_destroy(&ctx->lock);
     talloc_free(ctx);
 }
 
@@ -321,6 +355,16 @@ void encode_lavc_finish(struct encode_lavc_context *ctx)
     if (ctx->finished)
         return;
 
+    // Encoder queues still existing at this point were left over because
+    // encoding failed. Their items are dropped. The muxer writes the
+    // remaining packets, unless encoding failed.
+    for (i = 0; i < ctx->num_queues; i++) {
+        if (ctx->queues[i] != ctx->mux_queue)
+            stop_queue(ctx->queues[i], true);
+    }
+    if (ctx->mux_queue)
+        stop_queue(ctx->mux_queue, ctx->failed);
+
     if (ctx->avc) {
         if (ctx->header_written > 0)
             av_write_trailer(ctx->avc);  // this is allowed to fail
@@ -702,15 +746,13 @@ void encode_lavc_write_stats(struct encode_lavc_context *ctx, AVStream *stream)
     }
 }
 
-int encode_lavc_write_frame(struct encode_lavc_context *ctx, AVPacket *packet)
+// Write the packet to the muxer. Called on the mux thread with --othreads.
+static int write_packet(struct encode_lavc_context *ctx, AVPacket *packet)
 {
     int r;
 
     CHECK_FAIL(ctx, -1);
 
-    if (ctx->header_written <= 0)
-        return -1;
-
     MP_DBG(ctx,
         "write frame: stream %d ptsi %d (%f) dtsi %d (%f) size %d\n",
         (int)packet->stream_index,
@@ -724,6 +766,8 @@ int encode_lavc_write_frame(struct encode_lavc_context *ctx, AVPacket *packet)
         / (double)ctx->avc->streams[packet->stream_index]->time_base.den,
         (int)packet->size);
 
+    pthread_mutex_lock(&ctx->lock);
+
     switch (ctx->avc->streams[packet->stream_index]->codec->codec_type) {
     case AVMEDIA_TYPE_VIDEO:
         ctx->vbytes += packet->size;
@@ -741,9 +785,278 @@ int encode_lavc_write_frame(struct encode_lavc_context *ctx, AVPacket *packet)
 
     r = av_interleaved_write_frame(ctx->avc, packet);
 
+    pthread_mutex_unlock(&ctx->lock);
+
     return r;
 }
 
+static void mux_packet(void *priv, void *item)
+{
+    struct encode_lavc_context *ctx = priv;
+    struct mux_packet *mp = item;
+
+    if (write_packet(ctx, &mp->packet) < 0)
+        MP_ERR(ctx, "error writing packet\n");
+}
+
+// With --othreads, this queues the packet for the mux thread, and returns
+// success; errors are reported by the mux thread.
+int encode_lavc_write_frame(struct encode_lavc_context *ctx, AVPacket *packet)
+{
+    CHECK_FAIL(ctx, -1);
+
+    if (ctx->header_written <= 0)
+        return -1;
+
+    if (!ctx->mux_queue || !ctx->mux_queue->has_thread)
+        return write_packet(ctx, packet);
+
+    // The packet data usually points to an encoder buffer that is reused for
+    // the next packet. (libavformat makes its own copy when writing it.)
+    struct mux_packet *mp = talloc_zero(NULL, struct mux_packet);
+    mp->packet = *packet;
+    mp->packet.data = talloc_memdup(mp, packet->data, packet->size);
+    encode_lavc_queue_add(ctx->mux_queue, mp);
+    return 0;
+}
+
+const char *encode_lavc_get_filename(struct encode_lavc_context *ctx)
+{
+    CHECK_FAIL(ctx, NULL);
+
+    return ctx->avc->filename;
+}
+
+const char *encode_lavc_get_format(struct encode_lavc_context *ctx)
+{
+    CHECK_FAIL(ctx, NULL);
+
+    return ctx->avc->oformat->name;
+}
+
+// Create the output streams from the streams of an input file.
+static bool copy_streams(struct encode_lavc_context *ctx, AVFormatContext *ic)
+{
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        AVStream *in = ic->streams[i];
+        AVStream *out = avformat_new_stream(ctx->avc, NULL);
+        if (!out || avcodec_copy_context(out->codec, in->codec) < 0) {
+            encode_lavc_fail(ctx, "could not create output stream\n");
+            return false;
+        }
+        out->time_base = in->time_base;
+        out->codec->codec_tag = 0;
+        if (ctx->avc->oformat->flags & AVFMT_GLOBALHEADER)
+            out->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    ctx->append_last_dts = talloc_array(ctx, int64_t, ic->nb_streams);
+    ctx->append_end = talloc_array(ctx, int64_t, ic->nb_streams);
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        ctx->append_last_dts[i] = AV_NOPTS_VALUE;
+        ctx->append_end[i] = AV_NOPTS_VALUE;
+    }
+    return true;
+}
+
+static AVFormatContext *open_append_file(struct encode_lavc_context *ctx,
+                                         const char *filename)
+{
+    AVFormatContext *ic = NULL;
+    if (avformat_open_input(&ic, filename, NULL, NULL) < 0) {
+        MP_ERR(ctx, "could not open '%s'\n", filename);
+        return NULL;
+    }
+    if (avformat_find_stream_info(ic, NULL) < 0) {
+        MP_ERR(ctx, "could not read stream info from '%s'\n", filename);
+        avformat_close_input(&ic);
+        return NULL;
+    }
+    return ic;
+}
+
+// Return the time (in AV_TIME_BASE units) at which the content of the file
+// starts. Audio packets start earlier by the encoder delay (the priming
+// samples), so this is the start of the video, or for audio-only files the
+// start of the audio after the encoder delay.
+static int64_t get_content_start(AVFormatContext *ic)
+{
+    int64_t start = AV_NOPTS_VALUE;
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        AVStream *st = ic->streams[i];
+        if (st->start_time == AV_NOPTS_VALUE)
+            continue;
+        int64_t t = av_rescale_q(st->start_time, st->time_base, AV_TIME_BASE_Q);
+        if (st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            return t;
+        if (st->codec->codec_type == AVMEDIA_TYPE_AUDIO &&
+            st->codec->delay > 0 && st->codec->sample_rate > 0)
+            t += av_rescale(st->codec->delay, AV_TIME_BASE,
+                            st->codec->sample_rate);
+        start = start == AV_NOPTS_VALUE ? t : FFMAX(start, t);
+    }
+    if (start == AV_NOPTS_VALUE)
+        start = ic->start_time != AV_NOPTS_VALUE ? ic->start_time : 0;
+    return start;
+}
+
+// Return how much later than planned (in AV_TIME_BASE units) the file must
+// start, so that the dts of its non-audio streams continue after the dts of
+// the previous file. Reads the first packets of the file.
+static int64_t get_dts_overlap(struct encode_lavc_context *ctx,
+                               AVFormatContext *ic, int64_t offset)
+{
+    int64_t shift = 0;
+    int missing = 0;
+    bool *seen = talloc_zero_array(NULL, bool, ic->nb_streams);
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        seen[i] = ctx->append_last_dts[i] == AV_NOPTS_VALUE ||
+                  ic->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO;
+        missing += !seen[i];
+    }
+
+    AVPacket packet;
+    while (missing && av_read_frame(ic, &packet) >= 0) {
+        int index = packet.stream_index;
+        if (!seen[index] && packet.dts != AV_NOPTS_VALUE) {
+            AVRational tb_in = ic->streams[index]->time_base;
+            AVRational tb_out = ctx->avc->streams[index]->time_base;
+            // Same computation as in encode_lavc_append_file().
+            int64_t dts = av_rescale_q(packet.dts +
+                            av_rescale_q(offset, AV_TIME_BASE_Q, tb_in),
+                            tb_in, tb_out);
+            int64_t overlap = ctx->append_last_dts[index] - dts + 1;
+            if (overlap > 0) {
+                shift = FFMAX(shift, av_rescale_q_rnd(overlap, tb_out,
+                                                      AV_TIME_BASE_Q,
+                                                      AV_ROUND_UP));
+            }
+            seen[index] = true;
+            missing--;
+        }
+        av_free_packet(&packet);
+    }
+    talloc_free(seen);
+    return shift;
+}
+
+// Copy the packets of an already encoded file (e.g. a segment written by a
+// --oparallel worker process) to the output, without re-encoding. The first
+// file determines the output streams; later files must have the same streams.
+// Each file is shifted as a whole so that its content starts where the
+// previous one ended. Audio packets that only contain encoder priming samples
+// overlapping the previous file are dropped. Returns 0 on success, -1 on
+// error.
+int encode_lavc_append_file(struct encode_lavc_context *ctx,
+                            const char *filename)
+{
+    AVFormatContext *ic = NULL;
+    AVPacket packet;
+    int ret = -1;
+
+    CHECK_FAIL(ctx, -1);
+
+    ic = open_append_file(ctx, filename);
+    if (!ic)
+        return -1;
+
+    if (!ctx->header_written && !ctx->avc->nb_streams) {
+        if (!copy_streams(ctx, ic))
+            goto done;
+    }
+    if (!encode_lavc_start(ctx))
+        goto done;
+
+    if (ic->nb_streams != ctx->avc->nb_streams || !ctx->append_last_dts) {
+        MP_ERR(ctx, "'%s' does not match the output streams\n", filename);
+        goto done;
+    }
+    for (unsigned i = 0; i < ic->nb_streams; i++) {
+        if (ic->streams[i]->codec->codec_id !=
+            ctx->avc->streams[i]->codec->codec_id)
+        {
+            MP_ERR(ctx, "'%s' does not match the output streams\n", filename);
+            goto done;
+        }
+    }
+
+    // Offset added to all timestamps of this file, in AV_TIME_BASE units.
+    int64_t offset = ctx->append_offset - get_content_start(ic);
+    int64_t shift = get_dts_overlap(ctx, ic, offset);
+    if (shift > 0) {
+        MP_VERBOSE(ctx, "'%s': delaying by %"PRId64" us to keep dts "
+                   "monotonic\n", filename, shift);
+        offset += shift;
+    }
+
+    // get_dts_overlap() read from the file; start over.
+    avformat_close_input(&ic);
+    ic = open_append_file(ctx, filename);
+    if (!ic)
+        goto done;
+
+    int64_t end = ctx->append_offset;
+    int dropped = 0;
+
+    while (av_read_frame(ic, &packet) >= 0) {
+        int index = packet.stream_index;
+        AVStream *st = ic->streams[index];
+        AVRational tb_in = st->time_base;
+        AVRational tb_out = ctx->avc->streams[index]->time_base;
+        int64_t offset_in = av_rescale_q(offset, AV_TIME_BASE_Q, tb_in);
+
+        if (packet.pts != AV_NOPTS_VALUE) {
+            packet.pts += offset_in;
+            end = FFMAX(end, av_rescale_q(packet.pts + packet.duration, tb_in,
+                                          AV_TIME_BASE_Q));
+            packet.pts = av_rescale_q(packet.pts, tb_in, tb_out);
+        }
+        if (packet.dts != AV_NOPTS_VALUE)
+            packet.dts = av_rescale_q(packet.dts + offset_in, tb_in, tb_out);
+        packet.duration = av_rescale_q(packet.duration, tb_in, tb_out);
+        packet.pos = -1;
+
+        // Priming samples at the start of an audio segment overlap with the
+        // end of the previous segment, which already contains that audio.
+        int64_t *last_end = &ctx->append_end[index];
+        bool drop = st->codec->codec_type == AVMEDIA_TYPE_AUDIO &&
+                    packet.pts != AV_NOPTS_VALUE &&
+                    *last_end != AV_NOPTS_VALUE &&
+                    packet.pts + packet.duration <= *last_end;
+        // Should not happen after the shift above.
+        int64_t *last_dts = &ctx->append_last_dts[index];
+        if (packet.dts != AV_NOPTS_VALUE && *last_dts != AV_NOPTS_VALUE &&
+            packet.dts <= *last_dts)
+            drop = true;
+        if (drop) {
+            dropped++;
+            av_free_packet(&packet);
+            continue;
+        }
+        if (packet.dts != AV_NOPTS_VALUE)
+            *last_dts = packet.dts;
+        if (packet.pts != AV_NOPTS_VALUE)
+            *last_end = FFMAX(*last_end, packet.pts + packet.duration);
+
+        int r = write_packet(ctx, &packet);
+        av_free_packet(&packet);
+        if (r < 0) {
+            MP_ERR(ctx, "error writing packet\n");
+            goto done;
+        }
+    }
+
+    if (dropped)
+        MP_VERBOSE(ctx, "'%s': dropped %d overlapping packets\n", filename,
+                   dropped);
+    ctx->append_offset = end;
+    ret = 0;
+
+done:
+    avformat_close_input(&ic);
+    return ret;
+}
+
 int encode_lavc_supports_pixfmt(struct encode_lavc_context *ctx,
                                 enum AVPixelFormat pix_fmt)
 {
@@ -1006,11 +1319,14 @@ int encode_lavc_getstatus(struct encode_lavc_context *ctx,
 
     CHECK_FAIL(ctx, -1);
 
+    pthread_mutex_lock(&ctx->lock);
     minutes = (now - ctx->t0) / 60.0 * (1 - f) / f;
     megabytes = ctx->avc->pb ? (avio_size(ctx->avc->pb) / 1048576.0 / f) : 0;
     fps = ctx->frames / (now - ctx->t0);
     x = ctx->audioseconds / (now - ctx->t0);
-    if (ctx->frames)
+    unsigned int frames = ctx->frames;
+    pthread_mutex_unlock(&ctx->lock);
+    if (frames)
         snprintf(buf, bufsize, "{%.1fmin %.1ffps %.1fMB}",
                  minutes, fps, megabytes);
     else if (ctx->audioseconds)
@@ -1099,4 +1415,131 @@ enum mp_csp_levels encode_lavc_get_csp_levels(struct encode_lavc_context *ctx,
     return avcol_range_to_mp_csp_levels(stream->codec->color_range);
 }
 
+static void *queue_thread(void *p)
+{
+    struct encode_lavc_queue *q = p;
+
+    pthread_mutex_lock(&q->lock);
+    while (1) {
+        if (q->num_items) {
+            void *item = q->items[0];
+            MP_TARRAY_REMOVE_AT(q->items, q->num_items, 0);
+            q->busy = true;
+            pthread_cond_broadcast(&q->wakeup);
+            pthread_mutex_unlock(&q->lock);
+            q->process(q->priv, item);
+            talloc_free(item);
+            pthread_mutex_lock(&q->lock);
+            q->busy = false;
+            pthread_cond_broadcast(&q->wakeup);
+        } else if (q->terminate) {
+            break;
+        } else {
+            pthread_cond_wait(&q->wakeup, &q->lock);
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+// Make the thread exit after processing the queued items (or after the
+// current item if discard is set), and wait for it. New items are dropped.
+static void stop_queue(struct encode_lavc_queue *q, bool discard)
+{
+    pthread_mutex_lock(&q->lock);
+    if (discard) {
+        for (int n = 0; n < q->num_items; n++)
+            talloc_free(q->items[n]);
+        q->num_items = 0;
+    }
+    q->terminate = true;
+    pthread_cond_broadcast(&q->wakeup);
+    pthread_mutex_unlock(&q->lock);
+
+    if (q->has_thread)
+        pthread_join(q->thread, NULL);
+    q->has_thread = false;
+}
+
+static void destroy_queue(void *p)
+{
+    struct encode_lavc_queue *q = p;
+
+    stop_queue(q, true);
+    pthread_cond_destroy(&q->wakeup);
+    pthread_mutex_destroy(&q->lock);
+}
+
+struct encode_lavc_queue *encode_lavc_queue_create(
+    struct encode_lavc_context *ctx, void *priv,
+    void (*process)(void *priv, void *item), int max_items)
+{
+    struct encode_lavc_queue *q = talloc_zero(ctx, struct encode_lavc_queue);
+    q->ctx = ctx;
+    q->priv = priv;
+    q->process = process;
+    q->max_items = MPMAX(max_items, 1);
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wakeup, NULL);
+    talloc_set_destructor(q, destroy_queue);
+
+    // With AVFMT_RAWPICTURE, packets point to the image data, which would
+    // have to stay valid until the muxer has written them.
+    bool rawpicture = ctx->avc && (ctx->avc->oformat->flags & AVFMT_RAWPICTURE);
+    if (ctx->options->threads && !rawpicture) {
+        q->has_thread = !pthread_create(&q->thread, NULL, queue_thread, q);
+        if (!q->has_thread)
+            MP_WARN(ctx, "could not create encoder thread\n");
+    }
+
+    MP_TARRAY_APPEND(ctx, ctx->queues, ctx->num_queues, q);
+    return q;
+}
+
+void encode_lavc_queue_add(struct encode_lavc_queue *q, void *item)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->has_thread && q->num_items >= q->max_items && !q->terminate)
+        pthread_cond_wait(&q->wakeup, &q->lock);
+    bool drop = q->terminate;
+    bool sync = !q->has_thread;
+    if (!drop && !sync) {
+        MP_TARRAY_APPEND(q, q->items, q->num_items, item);
+        pthread_cond_broadcast(&q->wakeup);
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    if (!drop && sync)
+        q->process(q->priv, item);
+    if (drop || sync)
+        talloc_free(item);
+}
+
+void encode_lavc_queue_flush(struct encode_lavc_queue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->num_items || q->busy)
+        pthread_cond_wait(&q->wakeup, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+}
+
+void encode_lavc_queue_destroy(struct encode_lavc_queue *q)
+{
+    if (!q)
+        return;
+
+    stop_queue(q, false);
+
+    struct encode_lavc_context *ctx = q->ctx;
+    for (int n = 0; n < ctx->num_queues; n++) {
+        if (ctx->queues[n] == q) {
+            MP_TARRAY_REMOVE_AT(ctx->queues, ctx->num_queues, n);
+            break;
+        }
+    }
+    if (ctx->mux_queue == q)
+        ctx->mux_queue = NULL;
+    talloc_free(q);
+}
+
 // vim: ts=4 sw=4 et
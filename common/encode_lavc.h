@@ -22,6 +22,8 @@
 #ifndef MPLAYER_ENCODE_LAVC_H
 #define MPLAYER_ENCODE_LAVC_H
 
+#include <pthread.h>
+
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/avstring.h>
@@ -59,6 +61,21 @@ struct encode_lavc_context {
     double next_in_pts;
     double discontinuity_pts_offset;
 
+    // protects the statistics below and the muxer (with --othreads, packets
+    // are written by the mux thread)
+    pthread_mutex_t lock;
+    struct encode_lavc_queue *mux_queue;
+    // all queues, so that they can be stopped if encoding fails
+    struct encode_lavc_queue **queues;
+    int num_queues;
+
+    // encode_lavc_append_file(): output time (in AV_TIME_BASE units) at which
+    // the next file starts, and the last dts and the end (pts + duration)
+    // written per stream (in stream time base)
+    int64_t append_offset;
+    int64_t *append_last_dts;
+    int64_t *append_end;
+
     long long abytes;
     long long vbytes;
     struct stream *twopass_bytebuffer_a;
@@ -77,6 +94,22 @@ struct encode_lavc_context {
     bool finished;
 };
 
+// A queue of work items processed in order by a separate thread (with
+// --othreads), or immediately by the caller.
+struct encode_lavc_queue;
+
+// process(priv, item) is called for each item, which is talloc_free()d
+// afterwards. At most max_items items are queued at once; adding more blocks.
+struct encode_lavc_queue *encode_lavc_queue_create(
+    struct encode_lavc_context *ctx, void *priv,
+    void (*process)(void *priv, void *item), int max_items);
+// Queue a talloc-allocated item (takes ownership).
+void encode_lavc_queue_add(struct encode_lavc_queue *q, void *item);
+// Wait until all queued items have been processed.
+void encode_lavc_queue_flush(struct encode_lavc_queue *q);
+// Process the remaining items, and stop and free the queue.
+void encode_lavc_queue_destroy(struct encode_lavc_queue *q);
+
 // interface for vo/ao drivers
 AVStream *encode_lavc_alloc_stream(struct encode_lavc_context *ctx, enum AVMediaType mt);
 void encode_lavc_write_stats(struct encode_lavc_context *ctx, AVStream *stream);
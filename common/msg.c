@@ -32,6 +32,7 @@
 #include "common/global.h"
 #include "options/options.h"
 #include "osdep/terminal.h"
+#include "osdep/timer.h"
 #include "osdep/io.h"
 
 #include "common/msg.h"
@@ -39,6 +40,64 @@
 /* maximum message length of mp_msg */
 #define MSGSIZE_MAX 6144
 
+/* Number of records in the log ring (must be a power of 2). */
+#define LOG_RING_SLOTS 512
+/* Maximum text size of a record in the log ring. Longer messages are written
+ * synchronously by the thread calling mp_msg. */
+#define LOG_RING_TEXT 1024
+
+// A log message as passed to the output sinks.
+struct log_rec {
+    int level;
+    bool terminal;      // write to terminal
+    bool file;          // write to --log-file
+    bool buffer;        // copy to mp_log_buffers (each filters by its level)
+    int64_t time;
+    const char *prefix; // short prefix, "" if none
+    const char *verbose_prefix;
+    const char *text;
+};
+
+struct log_slot {
+    // Accessed atomically. If seq == pos, the slot is free to be written as
+    // ring position pos. If seq == pos + 1, the record is complete.
+    unsigned int seq;
+    int level;
+    bool terminal, file, buffer;
+    int64_t time;
+    char prefix[48];
+    char verbose_prefix[64];
+    char text[LOG_RING_TEXT];
+};
+
+/* Multi-producer, single-consumer ring of log records. Writers reserve a slot
+ * by advancing head with a CAS, and publish it by setting the slot's seq. The
+ * drain thread is the only consumer, and writes the records to the sinks.
+ * Writers block only if the ring is full. */
+struct log_ring {
+    struct log_slot slots[LOG_RING_SLOTS];
+    unsigned int head;          // next position to reserve (atomic)
+    unsigned int tail;          // next position to drain (atomic)
+    int sleeping;               // drain thread waits on wakeup (atomic)
+    struct mp_log_root *root;
+    pthread_t thread;
+    pthread_mutex_t lock;       // for the condition variables only
+    pthread_cond_t wakeup;      // signaled when new records are available
+    pthread_cond_t drained;     // signaled when tail advanced
+    bool terminate;
+};
+
+struct mp_log_buffer {
+    struct mp_log_root *root;
+    int level;
+    // --- protected by mp_msg_lock
+    struct mp_log_buffer_entry **entries; // circular, size entries
+    int size, pos, num;
+    int dropped;
+    void (*wakeup_cb)(void *ctx);
+    void *wakeup_cb_ctx;
+};
+
 struct mp_log_root {
     struct mpv_global *global;
     // --- protected by mp_msg_lock
@@ -52,8 +111,17 @@ struct mp_log_root {
     bool color;
     int verbose;
     bool force_stderr;
+    char *log_file_path;
+    FILE *log_file;
+    bool log_file_binary;
+    bool log_file_header;
+    struct mp_log_buffer **buffers;
+    int num_buffers;
     // --- semi-atomic access
     bool mute;
+    bool async;         // terminal output is done by the drain thread
+    int buffer_level;   // maximum level of all buffers
+    struct log_ring *ring; // read and cleared under mp_ring_lock
     // --- must be accessed atomically
     /* This is incremented every time the msglevels must be reloaded.
      * (This is perhaps better than maintaining a globally accessible and
@@ -65,13 +133,21 @@ struct mp_log {
     struct mp_log_root *root;
     const char *prefix;
     const char *verbose_prefix;
-    int level;
+    int level;          // maximum of the levels below
+    int terminal_level;
+    int file_level;
     int64_t reload_counter;
 };
 
 // Protects some (not all) state in mp_log_root
 static pthread_mutex_t mp_msg_lock = PTHREAD_MUTEX_INITIALIZER;
 
+// Held for reading while a writer uses root->ring, and for writing while
+// destroy_ring() clears it. The ring is freed only after that, so a writer can
+// never use a freed ring. Never lock mp_msg_lock while holding this for
+// reading (ensure_ring() is called with mp_msg_lock held).
+static pthread_rwlock_t mp_ring_lock = PTHREAD_RWLOCK_INITIALIZER;
+
 static const struct mp_log null_log = {0};
 struct mp_log *const mp_null_log = (struct mp_log *)&null_log;
 
@@ -86,19 +162,25 @@ static bool match_mod(const char *name, bstr mod)
 
 static void update_loglevel(struct mp_log *log)
 {
+    struct mp_log_root *root = log->root;
     pthread_mutex_lock(&mp_msg_lock);
-    log->level = MSGL_STATUS + log->root->verbose; // default log level
+    log->terminal_level = MSGL_STATUS + root->verbose; // default log level
     // Stupid exception for the remains of -identify
     if (match_mod(log->verbose_prefix, bstr0("identify")))
-        log->level = -1;
-    bstr s = bstr0(log->root->msglevels);
+        log->terminal_level = -1;
+    bstr s = bstr0(root->msglevels);
     bstr mod;
     int level;
     while (mp_msg_split_msglevel(&s, &mod, &level) > 0) {
         if (match_mod(log->verbose_prefix, mod))
-            log->level = level;
+            log->terminal_level = level;
     }
-    log->reload_counter = log->root->reload_counter;
+    // The log file always gets debug output.
+    log->file_level = root->log_file ? MPMAX(log->terminal_level, MSGL_DEBUG)
+                                     : -1;
+    log->level = MPMAX(log->terminal_level,
+                       MPMAX(log->file_level, root->buffer_level));
+    log->reload_counter = root->reload_counter;
     pthread_mutex_unlock(&mp_msg_lock);
 }
 
@@ -116,9 +198,14 @@ bool mp_msg_test(struct mp_log *log, int lev)
     }
     if (log->reload_counter != log->root->reload_counter)
         update_loglevel(log);
+    // The status line is never logged anywhere but the terminal.
+    if (lev == MSGL_STATUS)
+        return lev <= log->terminal_level;
     return lev <= log->level || (log->root->smode && lev == MSGL_SMODE);
 }
 
+static void ring_sync(struct log_ring *ring);
+
 // Reposition cursor and clear lines for outputting the status line. In certain
 // cases, like term OSD and subtitle display, the status can consist of
 // multiple lines.
@@ -163,6 +250,12 @@ static void flush_status_line(struct mp_log_root *root)
 
 void mp_msg_flush_status_line(struct mpv_global *global)
 {
+    struct mp_log_root *root = global->log->root;
+    pthread_rwlock_rdlock(&mp_ring_lock);
+    mp_memory_barrier();
+    if (root->ring && root->async)
+        ring_sync(root->ring);
+    pthread_rwlock_unlock(&mp_ring_lock);
     pthread_mutex_lock(&mp_msg_lock);
     flush_status_line(global->log->root);
     pthread_mutex_unlock(&mp_msg_lock);
@@ -182,21 +275,14 @@ static void set_msg_color(FILE* stream, int lev)
     terminal_set_foreground_color(stream, v_colors[lev]);
 }
 
-void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
+static void write_term(struct mp_log_root *root, struct log_rec *rec)
 {
-    if (!mp_msg_test(log, lev))
-        return; // do not display
-
-    pthread_mutex_lock(&mp_msg_lock);
-
-    struct mp_log_root *root = log->root;
+    int lev = rec->level;
     FILE *stream = (root->force_stderr || lev == MSGL_STATUS) ? stderr : stdout;
 
+    // The status line code modifies the text, so use a copy.
     char tmp[MSGSIZE_MAX];
-    if (vsnprintf(tmp, MSGSIZE_MAX, format, va) < 0)
-        snprintf(tmp, MSGSIZE_MAX, "[fprintf error]\n");
-    tmp[MSGSIZE_MAX - 2] = '\n';
-    tmp[MSGSIZE_MAX - 1] = 0;
+    snprintf(tmp, sizeof(tmp), "%s", rec->text);
 
     bool header = root->header;
     char *terminate = "";
@@ -219,9 +305,9 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
         set_msg_color(stream, lev);
     if (header) {
         if ((lev >= MSGL_V && lev != MSGL_SMODE) || root->verbose || root->module) {
-            fprintf(stream, "[%s] ", log->verbose_prefix);
-        } else if (log->prefix) {
-            fprintf(stream, "[%s] ", log->prefix);
+            fprintf(stream, "[%s] ", rec->verbose_prefix);
+        } else if (rec->prefix[0]) {
+            fprintf(stream, "[%s] ", rec->prefix);
         }
     }
 
@@ -230,7 +316,296 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
     if (root->color)
         terminal_set_foreground_color(stream, -1);
     fflush(stream);
+}
+
+static void write_le(unsigned char *dst, uint64_t val, int bytes)
+{
+    for (int n = 0; n < bytes; n++)
+        dst[n] = (val >> (n * 8)) & 0xFF;
+}
+
+static void write_log_file(struct mp_log_root *root, struct log_rec *rec)
+{
+    FILE *f = root->log_file;
+    size_t len = strlen(rec->text);
+
+    if (root->log_file_binary) {
+        // See --log-file-format for the format description.
+        size_t prefix_len = MPMIN(strlen(rec->verbose_prefix), 255);
+        unsigned char hdr[14];
+        write_le(hdr + 0, 8 + 1 + 1 + prefix_len + len, 4);
+        write_le(hdr + 4, rec->time, 8);
+        hdr[12] = rec->level;
+        hdr[13] = prefix_len;
+        fwrite(hdr, sizeof(hdr), 1, f);
+        fwrite(rec->verbose_prefix, prefix_len, 1, f);
+        fwrite(rec->text, len, 1, f);
+        return;
+    }
+
+    if (root->log_file_header) {
+        fprintf(f, "[%10.6f][%c][%s] ", rec->time / 1e6,
+                mp_msg_level_name(rec->level)[0], rec->verbose_prefix);
+    }
+    fwrite(rec->text, len, 1, f);
+    root->log_file_header = len && rec->text[len - 1] == '\n';
+}
+
+static void write_buffers(struct mp_log_root *root, struct log_rec *rec)
+{
+    for (int n = 0; n < root->num_buffers; n++) {
+        struct mp_log_buffer *buffer = root->buffers[n];
+        if (rec->level > buffer->level)
+            continue;
+        struct mp_log_buffer_entry *entry =
+            talloc_ptrtype(NULL, entry);
+        *entry = (struct mp_log_buffer_entry) {
+            .prefix = talloc_strdup(entry, rec->verbose_prefix),
+            .level = rec->level,
+            .time = rec->time,
+            .text = talloc_strdup(entry, rec->text),
+        };
+        if (buffer->num == buffer->size) {
+            // Drop the oldest entry.
+            talloc_free(buffer->entries[buffer->pos]);
+            buffer->pos = (buffer->pos + 1) % buffer->size;
+            buffer->num--;
+            buffer->dropped++;
+        }
+        int idx = (buffer->pos + buffer->num) % buffer->size;
+        buffer->entries[idx] = entry;
+        buffer->num++;
+        if (buffer->num == 1 && buffer->wakeup_cb)
+            buffer->wakeup_cb(buffer->wakeup_cb_ctx);
+    }
+}
+
+// Write the message to all sinks it's meant for. Called with mp_msg_lock held.
+static void write_rec(struct mp_log_root *root, struct log_rec *rec)
+{
+    if (rec->terminal)
+        write_term(root, rec);
+    if (rec->file && root->log_file)
+        write_log_file(root, rec);
+    if (rec->buffer)
+        write_buffers(root, rec);
+}
+
+// Wait until all records before ring position pos have been drained.
+static void ring_wait(struct log_ring *ring, unsigned int pos)
+{
+    pthread_mutex_lock(&ring->lock);
+    while ((int)(pos - mp_atomic_load(&ring->tail)) > 0) {
+        pthread_cond_signal(&ring->wakeup);
+        pthread_cond_wait(&ring->drained, &ring->lock);
+    }
+    pthread_mutex_unlock(&ring->lock);
+}
+
+// Wait until all records written so far have been drained.
+static void ring_sync(struct log_ring *ring)
+{
+    ring_wait(ring, mp_atomic_load(&ring->head));
+}
+
+// Add the record to the ring. Blocks only if the ring is full. Returns false
+// if the text is too long for a ring slot.
+static bool ring_push(struct log_ring *ring, struct log_rec *rec)
+{
+    size_t len = strlen(rec->text);
+    if (len >= LOG_RING_TEXT)
+        return false;
+
+    struct log_slot *slot;
+    unsigned int pos = mp_atomic_load(&ring->head);
+    while (1) {
+        slot = &ring->slots[pos % LOG_RING_SLOTS];
+        int diff = (int)(mp_atomic_load(&slot->seq) - pos);
+        if (diff == 0) {
+            if (mp_atomic_bool_cas(&ring->head, pos, pos + 1))
+                break;
+        } else if (diff < 0) {
+            // Full; wait until the drain thread freed the slot.
+            ring_wait(ring, pos - LOG_RING_SLOTS + 1);
+        }
+        pos = mp_atomic_load(&ring->head);
+    }
+
+    slot->level = rec->level;
+    slot->terminal = rec->terminal;
+    slot->file = rec->file;
+    slot->buffer = rec->buffer;
+    slot->time = rec->time;
+    snprintf(slot->prefix, sizeof(slot->prefix), "%s", rec->prefix);
+    snprintf(slot->verbose_prefix, sizeof(slot->verbose_prefix), "%s",
+             rec->verbose_prefix);
+    memcpy(slot->text, rec->text, len + 1);
+    mp_atomic_store(&slot->seq, pos + 1);
+
+    if (mp_atomic_load(&ring->sleeping)) {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_signal(&ring->wakeup);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    return true;
+}
+
+static void *drain_thread(void *p)
+{
+    struct log_ring *ring = p;
+    struct mp_log_root *root = ring->root;
+
+    while (1) {
+        // Only this thread writes ring->tail.
+        unsigned int pos = ring->tail;
+        int drained = 0;
+        while (drained < LOG_RING_SLOTS) {
+            struct log_slot *slot = &ring->slots[pos % LOG_RING_SLOTS];
+            if (mp_atomic_load(&slot->seq) != pos + 1)
+                break;
+            if (!drained)
+                pthread_mutex_lock(&mp_msg_lock);
+            struct log_rec rec = {
+                .level = slot->level,
+                .terminal = slot->terminal,
+                .file = slot->file,
+                .buffer = slot->buffer,
+                .time = slot->time,
+                .prefix = slot->prefix,
+                .verbose_prefix = slot->verbose_prefix,
+                .text = slot->text,
+            };
+            write_rec(root, &rec);
+            mp_atomic_store(&slot->seq, pos + LOG_RING_SLOTS);
+            pos++;
+            mp_atomic_store(&ring->tail, pos);
+            drained++;
+        }
+        if (drained) {
+            if (root->log_file)
+                fflush(root->log_file);
+            pthread_mutex_unlock(&mp_msg_lock);
+        }
+
+        pthread_mutex_lock(&ring->lock);
+        if (drained) {
+            pthread_cond_broadcast(&ring->drained);
+        } else if (ring->terminate) {
+            pthread_mutex_unlock(&ring->lock);
+            break;
+        } else {
+            mp_atomic_store(&ring->sleeping, 1);
+            // Writers check sleeping after publishing, so either we see the
+            // new record here, or they see sleeping and signal us.
+            struct log_slot *slot = &ring->slots[pos % LOG_RING_SLOTS];
+            if (mp_atomic_load(&slot->seq) != pos + 1)
+                pthread_cond_wait(&ring->wakeup, &ring->lock);
+            mp_atomic_store(&ring->sleeping, 0);
+        }
+        pthread_mutex_unlock(&ring->lock);
+    }
+    return NULL;
+}
 
+// Create the ring and start the drain thread, if not done yet. Called with
+// mp_msg_lock held.
+static void ensure_ring(struct mp_log_root *root)
+{
+    if (root->ring)
+        return;
+    struct log_ring *ring = talloc_zero(root, struct log_ring);
+    ring->root = root;
+    for (int n = 0; n < LOG_RING_SLOTS; n++)
+        ring->slots[n].seq = n;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->wakeup, NULL);
+    pthread_cond_init(&ring->drained, NULL);
+    if (pthread_create(&ring->thread, NULL, drain_thread, ring)) {
+        // Everything will be written synchronously instead.
+        pthread_cond_destroy(&ring->wakeup);
+        pthread_cond_destroy(&ring->drained);
+        pthread_mutex_destroy(&ring->lock);
+        talloc_free(ring);
+        return;
+    }
+    // Make the initialized ring visible before the pointer to it.
+    mp_memory_barrier();
+    root->ring = ring;
+}
+
+static void destroy_ring(struct mp_log_root *root)
+{
+    // Wait until no writer uses the ring anymore. The drain thread is still
+    // running at this point, so writers blocked on a full ring get through.
+    pthread_rwlock_wrlock(&mp_ring_lock);
+    struct log_ring *ring = root->ring;
+    root->ring = NULL;
+    pthread_rwlock_unlock(&mp_ring_lock);
+    if (!ring)
+        return;
+    pthread_mutex_lock(&ring->lock);
+    ring->terminate = true;
+    pthread_cond_signal(&ring->wakeup);
+    pthread_mutex_unlock(&ring->lock);
+    pthread_join(ring->thread, NULL);
+    pthread_cond_destroy(&ring->wakeup);
+    pthread_cond_destroy(&ring->drained);
+    pthread_mutex_destroy(&ring->lock);
+    talloc_free(ring);
+}
+
+void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
+{
+    if (!mp_msg_test(log, lev))
+        return; // do not display
+
+    struct mp_log_root *root = log->root;
+
+    char tmp[MSGSIZE_MAX];
+    if (vsnprintf(tmp, MSGSIZE_MAX, format, va) < 0)
+        snprintf(tmp, MSGSIZE_MAX, "[fprintf error]\n");
+    tmp[MSGSIZE_MAX - 2] = '\n';
+    tmp[MSGSIZE_MAX - 1] = 0;
+
+    // Status line and -identify output go to the terminal only.
+    bool log_it = lev != MSGL_STATUS && lev != MSGL_SMODE;
+    struct log_rec rec = {
+        .level = lev,
+        .terminal = lev <= log->terminal_level ||
+                    (root->smode && lev == MSGL_SMODE),
+        .file = log_it && lev <= log->file_level,
+        .buffer = log_it && lev <= root->buffer_level,
+        .time = mp_time_us(),
+        .prefix = log->prefix ? log->prefix : "",
+        .verbose_prefix = log->verbose_prefix,
+        .text = tmp,
+    };
+
+    pthread_rwlock_rdlock(&mp_ring_lock);
+    struct log_ring *ring = root->ring;
+    bool async = ring && root->async;
+    if (ring && ((rec.terminal && async) || rec.file || rec.buffer)) {
+        struct log_rec ring_rec = rec;
+        ring_rec.terminal = rec.terminal && async;
+        if (ring_push(ring, &ring_rec)) {
+            if (lev == MSGL_FATAL)
+                ring_sync(ring);
+            if (!rec.terminal || async) {
+                pthread_rwlock_unlock(&mp_ring_lock);
+                return;
+            }
+            rec.file = rec.buffer = false;
+        } else {
+            // Too long for the ring: write it directly, but keep the order.
+            ring_sync(ring);
+        }
+    }
+    pthread_rwlock_unlock(&mp_ring_lock);
+
+    pthread_mutex_lock(&mp_msg_lock);
+    write_rec(root, &rec);
+    if (rec.file && root->log_file)
+        fflush(root->log_file);
     pthread_mutex_unlock(&mp_msg_lock);
 }
 
@@ -279,6 +654,7 @@ void mp_msg_init(struct mpv_global *global)
     root->global = global;
     root->header = true;
     root->reload_counter = 1;
+    root->buffer_level = -1;
 
     struct mp_log dummy = { .root = root };
     struct mp_log *log = mp_log_new(root, &dummy, "");
@@ -288,6 +664,32 @@ void mp_msg_init(struct mpv_global *global)
     mp_msg_update_msglevels(global);
 }
 
+// Open or close the log file according to path. Called with mp_msg_lock held.
+// Returns false if opening failed.
+static bool update_log_file(struct mp_log_root *root, const char *path,
+                            bool binary)
+{
+    if (root->log_file && path && strcmp(root->log_file_path, path) == 0 &&
+        root->log_file_binary == binary)
+        return true;
+    if (root->log_file)
+        fclose(root->log_file);
+    root->log_file = NULL;
+    talloc_free(root->log_file_path);
+    root->log_file_path = NULL;
+    if (!path || !path[0])
+        return true;
+    root->log_file = fopen(path, binary ? "wb" : "w");
+    if (!root->log_file)
+        return false;
+    root->log_file_path = talloc_strdup(root, path);
+    root->log_file_binary = binary;
+    root->log_file_header = true;
+    if (binary)
+        fwrite("mpvlog1\n", 8, 1, root->log_file);
+    return true;
+}
+
 void mp_msg_update_msglevels(struct mpv_global *global)
 {
     struct mp_log_root *root = global->log->root;
@@ -296,6 +698,13 @@ void mp_msg_update_msglevels(struct mpv_global *global)
     if (!opts)
         return;
 
+    // Make sure messages written with the old settings are output first.
+    pthread_rwlock_rdlock(&mp_ring_lock);
+    mp_memory_barrier();
+    if (root->ring)
+        ring_sync(root->ring);
+    pthread_rwlock_unlock(&mp_ring_lock);
+
     pthread_mutex_lock(&mp_msg_lock);
 
     root->verbose = opts->verbose;
@@ -307,9 +716,19 @@ void mp_msg_update_msglevels(struct mpv_global *global)
     talloc_free(root->msglevels);
     root->msglevels = talloc_strdup(root, global->opts->msglevels);
 
+    bool log_file_ok = update_log_file(root, opts->log_file,
+                                       opts->log_file_format == 1);
+
+    root->async = opts->msg_async;
+    if (root->async || root->log_file)
+        ensure_ring(root);
+
     mp_atomic_add_and_fetch(&root->reload_counter, 1);
     mp_memory_barrier();
     pthread_mutex_unlock(&mp_msg_lock);
+
+    if (!log_file_ok)
+        mp_err(global->log, "Failed to open log file '%s'.\n", opts->log_file);
 }
 
 void mp_msg_mute(struct mpv_global *global, bool mute)
@@ -328,7 +747,10 @@ void mp_msg_force_stderr(struct mpv_global *global, bool force_stderr)
 
 void mp_msg_uninit(struct mpv_global *global)
 {
-    talloc_free(global->log->root);
+    struct mp_log_root *root = global->log->root;
+    destroy_ring(root);
+    update_log_file(root, NULL, false);
+    talloc_free(root);
     global->log = NULL;
 }
 
@@ -343,6 +765,92 @@ void mp_msg(struct mp_log *log, int lev, const char *format, ...)
     va_end(va);
 }
 
+// Create a buffer, which receives a copy of all log messages up to the given
+// level. If the buffer is full, the oldest entries are dropped. wakeup_cb is
+// called when a message is added to an empty buffer; it's called from the
+// log drain thread with internal locks held, so it must not block, and it
+// must not log anything.
+struct mp_log_buffer *mp_msg_log_buffer_new(struct mpv_global *global,
+                                            int size, int level,
+                                            void (*wakeup_cb)(void *ctx),
+                                            void *wakeup_cb_ctx)
+{
+    struct mp_log_root *root = global->log->root;
+    assert(size > 0);
+
+    struct mp_log_buffer *buffer = talloc_ptrtype(NULL, buffer);
+    *buffer = (struct mp_log_buffer) {
+        .root = root,
+        .level = level,
+        .size = size,
+        .entries = talloc_zero_array(buffer, struct mp_log_buffer_entry *, size),
+        .wakeup_cb = wakeup_cb,
+        .wakeup_cb_ctx = wakeup_cb_ctx,
+    };
+
+    pthread_mutex_lock(&mp_msg_lock);
+    MP_TARRAY_APPEND(root, root->buffers, root->num_buffers, buffer);
+    root->buffer_level = MPMAX(root->buffer_level, level);
+    ensure_ring(root);
+    mp_atomic_add_and_fetch(&root->reload_counter, 1);
+    mp_memory_barrier();
+    pthread_mutex_unlock(&mp_msg_lock);
+
+    return buffer;
+}
+
+void mp_msg_log_buffer_destroy(struct mp_log_buffer *buffer)
+{
+    if (!buffer)
+        return;
+
+    struct mp_log_root *root = buffer->root;
+    pthread_mutex_lock(&mp_msg_lock);
+    root->buffer_level = -1;
+    for (int n = root->num_buffers - 1; n >= 0; n--) {
+        if (root->buffers[n] == buffer) {
+            MP_TARRAY_REMOVE_AT(root->buffers, root->num_buffers, n);
+        } else {
+            root->buffer_level = MPMAX(root->buffer_level,
+                                       root->buffers[n]->level);
+        }
+    }
+    mp_atomic_add_and_fetch(&root->reload_counter, 1);
+    mp_memory_barrier();
+    pthread_mutex_unlock(&mp_msg_lock);
+
+    for (int n = 0; n < buffer->num; n++)
+        talloc_free(buffer->entries[(buffer->pos + n) % buffer->size]);
+    talloc_free(buffer);
+}
+
+// Return the oldest entry in the buffer and remove it, or NULL if the buffer
+// is empty. The caller has to free the entry with talloc_free().
+struct mp_log_buffer_entry *mp_msg_log_buffer_read(struct mp_log_buffer *buffer)
+{
+    struct mp_log_buffer_entry *res = NULL;
+
+    pthread_mutex_lock(&mp_msg_lock);
+    if (buffer->dropped) {
+        res = talloc_ptrtype(NULL, res);
+        *res = (struct mp_log_buffer_entry) {
+            .prefix = "overflow",
+            .level = MSGL_WARN,
+            .time = mp_time_us(),
+            .text = talloc_asprintf(res, "log message buffer overflow: "
+                                    "%d messages skipped\n", buffer->dropped),
+        };
+        buffer->dropped = 0;
+    } else if (buffer->num) {
+        res = buffer->entries[buffer->pos];
+        buffer->pos = (buffer->pos + 1) % buffer->size;
+        buffer->num--;
+    }
+    pthread_mutex_unlock(&mp_msg_lock);
+
+    return res;
+}
+
 static const char *level_names[] = {
     [MSGL_FATAL]        = "fatal",
     [MSGL_ERR]          = "error",
@@ -354,6 +862,24 @@ static const char *level_names[] = {
     [MSGL_TRACE]        = "trace",
 };
 
+// Return the name of the level as used by --msglevel, or NULL.
+const char *mp_msg_level_name(int level)
+{
+    if (level < 0 || level >= MP_ARRAY_SIZE(level_names))
+        return NULL;
+    return level_names[level];
+}
+
+// Return the level for the name as used by --msglevel, or -1.
+int mp_msg_find_level(const char *s)
+{
+    for (int n = 0; n < MP_ARRAY_SIZE(level_names); n++) {
+        if (level_names[n] && strcmp(s, level_names[n]) == 0)
+            return n;
+    }
+    return -1;
+}
+
 int mp_msg_split_msglevel(struct bstr *s, struct bstr *out_mod, int *out_level)
 {
     if (s->len == 0)
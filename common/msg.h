@@ -85,6 +85,24 @@ void mp_msg_force_stderr(struct mpv_global *global, bool force_stderr);
 void mp_msg_flush_status_line(struct mpv_global *global);
 bool mp_msg_has_status_line(struct mpv_global *global);
 
+struct mp_log_buffer_entry {
+    char *prefix;
+    int level;
+    int64_t time;       // mp_time_us()
+    char *text;
+};
+
+struct mp_log_buffer;
+struct mp_log_buffer *mp_msg_log_buffer_new(struct mpv_global *global,
+                                            int size, int level,
+                                            void (*wakeup_cb)(void *ctx),
+                                            void *wakeup_cb_ctx);
+void mp_msg_log_buffer_destroy(struct mp_log_buffer *buffer);
+struct mp_log_buffer_entry *mp_msg_log_buffer_read(struct mp_log_buffer *buffer);
+
+const char *mp_msg_level_name(int level);
+int mp_msg_find_level(const char *s);
+
 struct bstr;
 int mp_msg_split_msglevel(struct bstr *s, struct bstr *out_mod, int *out_level);
 
@@ -0,0 +1,265 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Low overhead timing of the per-frame pipeline stages.
+ *
+ * Each thread records into its own buffer, which contains the most recent
+ * events (for trace export) and the most recent durations of each stage (for
+ * the percentiles). The buffer lock is only contended while a reader copies
+ * data out of it.
+ *
+ * The statistics use the CPU time of the thread, so that time the thread was
+ * preempted or waiting on other threads doesn't count against the stage.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "talloc.h"
+
+#include "common/common.h"
+#include "osdep/timer.h"
+#include "trace.h"
+
+// Number of most recent events kept per thread for trace export.
+#define TRACE_EVENTS 8192
+// Number of most recent durations kept per thread and stage.
+#define TRACE_WINDOW 512
+
+static const char *const trace_names[MP_TRACE_ID_COUNT] = {
+    [MP_TRACE_DEMUX_READ]       = "demux-read",
+    [MP_TRACE_VIDEO_DECODE]     = "video-decode",
+    [MP_TRACE_VIDEO_FILTER]     = "video-filter",
+    [MP_TRACE_VO_DRAW]          = "vo-draw",
+    [MP_TRACE_VO_FLIP]          = "vo-flip",
+    [MP_TRACE_AUDIO_FILL]       = "audio-fill",
+};
+
+struct trace_event {
+    int64_t start;          // wall clock
+    int32_t duration;       // wall clock
+    int32_t cpu_duration;
+    int32_t id;
+};
+
+struct trace_thread {
+    pthread_mutex_t lock;
+    int index;
+    // --- protected by lock
+    struct trace_event events[TRACE_EVENTS];
+    uint64_t num_events;                    // total number ever recorded
+    int32_t window[MP_TRACE_ID_COUNT][TRACE_WINDOW];
+    uint64_t num_window[MP_TRACE_ID_COUNT]; // total number ever recorded
+    int64_t total[MP_TRACE_ID_COUNT];       // sum of all durations
+};
+
+struct mp_trace {
+    pthread_key_t key;
+    bool cpu_time;          // thread CPU time is available
+    pthread_mutex_t lock;
+    // --- protected by lock
+    struct trace_thread **threads;
+    int num_threads;
+};
+
+static void destroy_trace(void *p)
+{
+    struct mp_trace *trace = p;
+    pthread_key_delete(trace->key);
+    for (int n = 0; n < trace->num_threads; n++)
+        pthread_mutex_destroy(&trace->threads[n]->lock);
+    pthread_mutex_destroy(&trace->lock);
+}
+
+struct mp_trace *mp_trace_new(void *talloc_ctx)
+{
+    struct mp_trace *trace = talloc_zero(talloc_ctx, struct mp_trace);
+    if (pthread_key_create(&trace->key, NULL)) {
+        talloc_free(trace);
+        return NULL;
+    }
+    trace->cpu_time = mp_thread_cpu_time_us() >= 0;
+    pthread_mutex_init(&trace->lock, NULL);
+    talloc_set_destructor(trace, destroy_trace);
+    return trace;
+}
+
+static struct trace_thread *get_thread(struct mp_trace *trace)
+{
+    struct trace_thread *t = pthread_getspecific(trace->key);
+    if (t)
+        return t;
+
+    pthread_mutex_lock(&trace->lock);
+    t = talloc_zero(trace, struct trace_thread);
+    pthread_mutex_init(&t->lock, NULL);
+    t->index = trace->num_threads;
+    MP_TARRAY_APPEND(trace, trace->threads, trace->num_threads, t);
+    pthread_mutex_unlock(&trace->lock);
+
+    pthread_setspecific(trace->key, t);
+    return t;
+}
+
+struct mp_trace_start mp_trace_begin(struct mp_trace *trace)
+{
+    struct mp_trace_start start = {0};
+    if (trace) {
+        start.wall = mp_time_us();
+        start.cpu = trace->cpu_time ? mp_thread_cpu_time_us() : start.wall;
+    }
+    return start;
+}
+
+void mp_trace_end(struct mp_trace *trace, enum mp_trace_id id,
+                  struct mp_trace_start start)
+{
+    if (!trace)
+        return;
+    assert(id >= 0 && id < MP_TRACE_ID_COUNT);
+
+    int64_t wall = mp_time_us();
+    int64_t cpu = trace->cpu_time ? mp_thread_cpu_time_us() : wall;
+    int64_t duration = MPCLAMP(wall - start.wall, 0, INT32_MAX);
+    int64_t cpu_duration = MPCLAMP(cpu - start.cpu, 0, INT32_MAX);
+    struct trace_thread *t = get_thread(trace);
+
+    pthread_mutex_lock(&t->lock);
+    t->events[t->num_events % TRACE_EVENTS] = (struct trace_event){
+        .start = start.wall,
+        .duration = duration,
+        .cpu_duration = cpu_duration,
+        .id = id,
+    };
+    t->num_events++;
+    t->window[id][t->num_window[id] % TRACE_WINDOW] = cpu_duration;
+    t->num_window[id]++;
+    t->total[id] += cpu_duration;
+    pthread_mutex_unlock(&t->lock);
+}
+
+static int cmp_int32(const void *a, const void *b)
+{
+    int32_t va = *(const int32_t *)a, vb = *(const int32_t *)b;
+    return va < vb ? -1 : (va > vb);
+}
+
+bool mp_trace_get_stats(struct mp_trace *trace, enum mp_trace_id id,
+                        struct mp_trace_stats *stats)
+{
+    *stats = (struct mp_trace_stats){0};
+    if (!trace || id < 0 || id >= MP_TRACE_ID_COUNT)
+        return false;
+    stats->cpu_time = trace->cpu_time;
+
+    int32_t *samples = NULL;
+    int num_samples = 0;
+    int64_t total = 0;
+
+    pthread_mutex_lock(&trace->lock);
+    for (int n = 0; n < trace->num_threads; n++) {
+        struct trace_thread *t = trace->threads[n];
+        pthread_mutex_lock(&t->lock);
+        stats->calls += t->num_window[id];
+        total += t->total[id];
+        int num = MPMIN(t->num_window[id], TRACE_WINDOW);
+        MP_TARRAY_GROW(NULL, samples, num_samples + num);
+        memcpy(samples + num_samples, t->window[id], num * sizeof(samples[0]));
+        num_samples += num;
+        pthread_mutex_unlock(&t->lock);
+    }
+    pthread_mutex_unlock(&trace->lock);
+
+    if (num_samples) {
+        qsort(samples, num_samples, sizeof(samples[0]), cmp_int32);
+        stats->count = num_samples;
+        stats->p50 = samples[(num_samples - 1) * 50 / 100] / 1e6;
+        stats->p90 = samples[(num_samples - 1) * 90 / 100] / 1e6;
+        stats->p99 = samples[(num_samples - 1) * 99 / 100] / 1e6;
+        stats->max = samples[num_samples - 1] / 1e6;
+        stats->total = total / 1e6;
+    }
+    talloc_free(samples);
+    return num_samples > 0;
+}
+
+bool mp_trace_write_json(struct mp_trace *trace, const char *filename)
+{
+    if (!trace)
+        return false;
+    FILE *f = fopen(filename, "w");
+    if (!f)
+        return false;
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    bool first = true;
+
+    pthread_mutex_lock(&trace->lock);
+    for (int n = 0; n < trace->num_threads; n++) {
+        struct trace_thread *t = trace->threads[n];
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", t->index, t->index);
+        first = false;
+        // Copy the events, so that the thread isn't blocked by file I/O.
+        pthread_mutex_lock(&t->lock);
+        uint64_t num = t->num_events;
+        int count = MPMIN(num, TRACE_EVENTS);
+        struct trace_event *events = talloc_array(NULL, struct trace_event,
+                                                  count);
+        for (int i = 0; i < count; i++)
+            events[i] = t->events[(num - count + i) % TRACE_EVENTS];
+        pthread_mutex_unlock(&t->lock);
+        for (int i = 0; i < count; i++) {
+            struct trace_event *ev = &events[i];
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%"PRId64",\"dur\":%d", trace_names[ev->id],
+                    t->index, ev->start, (int)ev->duration);
+            if (trace->cpu_time)
+                fprintf(f, ",\"tdur\":%d", (int)ev->cpu_duration);
+            fprintf(f, "}");
+        }
+        talloc_free(events);
+    }
+    pthread_mutex_unlock(&trace->lock);
+
+    fprintf(f, "\n]}\n");
+    bool ok = !ferror(f);
+    if (fclose(f) != 0)
+        ok = false;
+    return ok;
+}
+
+const char *mp_trace_id_name(enum mp_trace_id id)
+{
+    if (id < 0 || id >= MP_TRACE_ID_COUNT)
+        return NULL;
+    return trace_names[id];
+}
+
+int mp_trace_find_id(const char *name)
+{
+    for (int n = 0; n < MP_TRACE_ID_COUNT; n++) {
+        if (strcmp(trace_names[n], name) == 0)
+            return n;
+    }
+    return -1;
+}
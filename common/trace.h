@@ -0,0 +1,83 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_TRACE_H
+#define MP_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Instrumented stages. Add the name to trace_names[] in trace.c as well.
+enum mp_trace_id {
+    MP_TRACE_DEMUX_READ,
+    MP_TRACE_VIDEO_DECODE,
+    MP_TRACE_VIDEO_FILTER,
+    MP_TRACE_VO_DRAW,
+    MP_TRACE_VO_FLIP,
+    MP_TRACE_AUDIO_FILL,
+    MP_TRACE_ID_COUNT
+};
+
+struct mp_trace;
+
+// Start of a stage, as returned by mp_trace_begin().
+struct mp_trace_start {
+    int64_t wall;           // mp_time_us()
+    int64_t cpu;            // mp_thread_cpu_time_us(), or wall if unavailable
+};
+
+// The durations are the CPU time of the thread that ran the stage if the OS
+// provides it (cpu_time is true), and wall clock time otherwise. Time spent
+// in worker threads the stage waits for (like decoder threads) is not counted
+// in the former case.
+struct mp_trace_stats {
+    int count;              // number of samples the values are based on
+    double p50, p90, p99;   // percentiles in seconds
+    double max;
+    int64_t calls;          // number of times the stage ran overall
+    double total;           // sum of all durations in seconds
+    bool cpu_time;          // durations are thread CPU time, not wall time
+};
+
+struct mp_trace *mp_trace_new(void *talloc_ctx);
+
+// Start timing a stage. Pass the return value to mp_trace_end(). trace can be
+// NULL, in which case nothing is done.
+struct mp_trace_start mp_trace_begin(struct mp_trace *trace);
+
+// Record that the stage id ran from start (as returned by mp_trace_begin())
+// until now. The begin/end pairs of a thread must be properly nested.
+// Thread-safety: can be called from any thread; each thread uses its own
+//                buffer, so calls from different threads don't contend.
+void mp_trace_end(struct mp_trace *trace, enum mp_trace_id id,
+                  struct mp_trace_start start);
+
+// Return the percentiles over the most recent durations of the given stage.
+// Returns false if there are no samples.
+bool mp_trace_get_stats(struct mp_trace *trace, enum mp_trace_id id,
+                        struct mp_trace_stats *stats);
+
+// Write the recorded events in Chrome trace event format (JSON) to the given
+// file. The events are placed by wall clock time; the thread CPU time is
+// included as thread duration if available. Returns false on I/O errors.
+bool mp_trace_write_json(struct mp_trace *trace, const char *filename);
+
+const char *mp_trace_id_name(enum mp_trace_id id);
+// Return the ID for the name, or -1.
+int mp_trace_find_id(const char *name);
+
+#endif
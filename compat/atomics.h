@@ -17,16 +17,28 @@
  */
 
 // At this point both gcc and clang had __sync_synchronize support for some
-// time. We only support a full memory barrier.
+// time. We only support a full memory barrier, and sequentially consistent
+// versions of the few operations below.
 
 #include "config.h"
 
 #if HAVE_ATOMIC_BUILTINS
 # define mp_memory_barrier()           __atomic_thread_fence(__ATOMIC_SEQ_CST)
+# define mp_memory_barrier_release()   __atomic_thread_fence(__ATOMIC_RELEASE)
 # define mp_atomic_add_and_fetch(a, b) __atomic_add_fetch(a, b,__ATOMIC_SEQ_CST)
+# define mp_atomic_load(a)             __atomic_load_n(a, __ATOMIC_SEQ_CST)
+# define mp_atomic_store(a, b)         __atomic_store_n(a, b, __ATOMIC_SEQ_CST)
+# define mp_atomic_bool_cas(a, o, n)   __atomic_compare_exchange_n(a, \
+                                            &(__typeof__(*(a))){o}, n, 0, \
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
 #elif HAVE_SYNC_BUILTINS
 # define mp_memory_barrier()           __sync_synchronize()
+# define mp_memory_barrier_release()   __sync_synchronize()
 # define mp_atomic_add_and_fetch(a, b) __sync_add_and_fetch(a, b)
+# define mp_atomic_load(a)             __sync_fetch_and_add(a, 0)
+# define mp_atomic_store(a, b)         do { __sync_synchronize(); *(a) = (b); \
+                                            __sync_synchronize(); } while (0)
+# define mp_atomic_bool_cas(a, o, n)   __sync_bool_compare_and_swap(a, o, n)
 #else
 # error "this should have been a configuration error, report a bug please"
 #endif
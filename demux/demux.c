@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <assert.h>
 #include <unistd.h>
 
@@ -499,6 +500,55 @@ static const char *d_level(enum demux_check level)
     abort();
 }
 
+static bool decode_float(char *str, float *out)
+{
+    char *rest;
+    double dec_val = str ? strtod(str, &rest) : 0;
+    if (!str || rest == str || !isfinite(dec_val))
+        return false;
+    *out = dec_val;
+    return true;
+}
+
+// Parse ReplayGain tags ("REPLAYGAIN_TRACK_GAIN=-6.5 dB" etc.). The track
+// gain is required; missing peaks default to 1.0, missing album values to
+// the track values.
+static struct replaygain_data *decode_rgain(struct demuxer *demuxer)
+{
+    struct mp_tags *tags = demuxer->metadata;
+    struct replaygain_data rg = { .track_peak = 1.0 };
+
+    if (!decode_float(mp_tags_get_str(tags, "REPLAYGAIN_TRACK_GAIN"),
+                      &rg.track_gain))
+        return NULL;
+    decode_float(mp_tags_get_str(tags, "REPLAYGAIN_TRACK_PEAK"),
+                 &rg.track_peak);
+    rg.album_peak = rg.track_peak;
+    if (decode_float(mp_tags_get_str(tags, "REPLAYGAIN_ALBUM_GAIN"),
+                     &rg.album_gain))
+    {
+        decode_float(mp_tags_get_str(tags, "REPLAYGAIN_ALBUM_PEAK"),
+                     &rg.album_peak);
+    } else {
+        rg.album_gain = rg.track_gain;
+    }
+
+    MP_VERBOSE(demuxer, "ReplayGain: track %.2f dB (peak %f), album %.2f dB "
+               "(peak %f)\n", rg.track_gain, rg.track_peak, rg.album_gain,
+               rg.album_peak);
+    return talloc_memdup(demuxer, &rg, sizeof(rg));
+}
+
+static void demux_update_replaygain(struct demuxer *demuxer)
+{
+    struct replaygain_data *rg = decode_rgain(demuxer);
+    for (int n = 0; rg && n < demuxer->num_streams; n++) {
+        struct sh_stream *sh = demuxer->streams[n];
+        if (sh->audio && !sh->audio->replaygain_data)
+            sh->audio->replaygain_data = rg;
+    }
+}
+
 static struct demuxer *open_given_type(struct mpv_global *global,
                                        struct mp_log *log,
                                        const struct demuxer_desc *desc,
@@ -548,6 +598,7 @@ static struct demuxer *open_given_type(struct mpv_global *global,
         add_stream_chapters(demuxer);
         demuxer_sort_chapters(demuxer);
         demux_info_update(demuxer);
+        demux_update_replaygain(demuxer);
         // Pretend we can seek if we can't seek, but there's a cache.
         if (!demuxer->seekable && stream->uncached_stream) {
             mp_warn(log,
@@ -64,6 +64,14 @@ struct sh_stream {
     struct demux_stream *ds;
 };
 
+// Gains in dB, peaks as linear amplitude (1.0 is full scale).
+struct replaygain_data {
+    float track_gain;
+    float track_peak;
+    float album_gain;
+    float album_peak;
+};
+
 typedef struct sh_audio {
     int samplerate;
     struct mp_chmap channels;
@@ -73,6 +81,8 @@ typedef struct sh_audio {
     // note codec extradata may be either under "wf" or "codecdata"
     unsigned char *codecdata;
     int codecdata_len;
+    // From ReplayGain tags or the loudness cache; NULL if unknown.
+    struct replaygain_data *replaygain_data;
 } sh_audio_t;
 
 typedef struct sh_video {
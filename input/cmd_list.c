@@ -118,6 +118,7 @@ const struct mp_cmd_def mp_cmds[] = {
                       {"window", 1},
                       {"subtitles", 2})),
   }},
+  { MP_CMD_WRITE_TRACE, "write_trace", { ARG_STRING } },
   { MP_CMD_LOADFILE, "loadfile", {
       ARG_STRING,
       OARG_CHOICE(0, ({"replace", 0},          {"0", 0},
@@ -161,6 +162,7 @@ const struct mp_cmd_def mp_cmds[] = {
   { MP_CMD_DVDNAV, "dvdnav", { ARG_STRING } },
 
   { MP_CMD_AF, "af", { ARG_STRING, ARG_STRING } },
+  { MP_CMD_AF_CMDLINE, "af_cmdline", { ARG_STRING, ARG_STRING } },
 
   { MP_CMD_VF, "vf", { ARG_STRING, ARG_STRING } },
 
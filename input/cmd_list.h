@@ -49,6 +49,7 @@ enum mp_command_type {
     MP_CMD_TV_STEP_CHANNEL_LIST,
     MP_CMD_SCREENSHOT,
     MP_CMD_SCREENSHOT_TO_FILE,
+    MP_CMD_WRITE_TRACE,
     MP_CMD_LOADFILE,
     MP_CMD_LOADLIST,
     MP_CMD_PLAYLIST_CLEAR,
@@ -89,6 +90,7 @@ enum mp_command_type {
 
     /// Audio Filter commands
     MP_CMD_AF,
+    MP_CMD_AF_CMDLINE,
 
     /// Video filter commands
     MP_CMD_VF,
@@ -104,6 +106,7 @@ enum mp_command_type {
 
     // Internal
     MP_CMD_COMMAND_LIST, // list of sub-commands in args[0].v.p
+    MP_CMD_IPC_REQUESTS, // struct mp_ipc_batch in args[0].v.p
 };
 
 // Executing this command will abort playback (play something else, or quit).
@@ -85,7 +85,7 @@ struct cmd_bind_section {
     struct cmd_bind_section *next;
 };
 
-#define MP_MAX_FDS 10
+#define MP_MAX_FDS 50
 
 struct input_fd {
     struct mp_log *log;
@@ -175,6 +175,11 @@ struct input_ctx {
 
     struct cmd_queue cmd_queue;
 
+    // Whether redundant commands get folded into already queued commands,
+    // and how many commands were folded so far (statistics only).
+    bool coalesce;
+    unsigned int num_coalesced;
+
     bool in_select;
     int wakeup_pipe[2];
 };
@@ -195,8 +200,10 @@ static const m_option_t input_config[] = {
     OPT_PRINT("cmdlist", mp_print_cmd_list),
     OPT_STRING("js-dev", input.js_dev, CONF_GLOBAL),
     OPT_STRING("file", input.in_file, CONF_GLOBAL),
+    OPT_STRING("unix-socket", input.ipc_path, CONF_GLOBAL),
     OPT_FLAG("default-bindings", input.default_bindings, CONF_GLOBAL),
     OPT_FLAG("test", input.test, CONF_GLOBAL),
+    OPT_FLAG("coalesce", input.coalesce, CONF_GLOBAL),
     { NULL, NULL, 0, 0, 0, 0, NULL}
 };
 
@@ -285,6 +292,129 @@ static struct mp_cmd *queue_peek_tail(struct cmd_queue *queue)
     return cur;
 }
 
+// Whether string arguments of the given command might be changed by property
+// expansion (in which case the result depends on the state at execution time).
+static bool cmd_arg_expands(struct mp_cmd *cmd, int arg)
+{
+    return (cmd->flags & MP_EXPAND_PROPERTIES) && cmd->args[arg].v.s &&
+           strchr(cmd->args[arg].v.s, '$');
+}
+
+static bool cmd_same_property(struct mp_cmd *a, struct mp_cmd *b)
+{
+    return !cmd_arg_expands(a, 0) && !cmd_arg_expands(b, 0) &&
+           strcmp(a->args[0].v.s, b->args[0].v.s) == 0;
+}
+
+// Properties for which "add <prop> <a>" followed by "add <prop> <b>" has the
+// same effect as "add <prop> <a+b>". Many properties don't qualify, because
+// their switch action moves by a fixed step regardless of the increment
+// (volume, track selection, choices).
+static const char *const add_coalesce_properties[] = {
+    "chapter", "speed", "audio-delay", "sub-delay", "sub-pos", "sub-scale",
+    "brightness", "contrast", "saturation", "hue", "gamma", "panscan",
+    "video-zoom", "video-pan-x", "video-pan-y", "video-align-x",
+    "video-align-y", NULL
+};
+
+// Likewise for "multiply". This requires the property value to be positive.
+static const char *const multiply_coalesce_properties[] = {
+    "speed", NULL
+};
+
+static bool can_coalesce(const char *const *list, const char *name)
+{
+    for (int n = 0; list[n]; n++) {
+        if (strcmp(list[n], name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Try to fold cmd into prev, which is the last command in the queue. On
+// success, prev is updated to have the combined effect of both commands, and
+// true is returned (cmd is not touched and must be freed by the caller).
+// prev is modified in place instead of being replaced, because the player
+// might be holding a reference to it via mp_input_get_cmd(..., peek_only).
+static bool coalesce_cmd(struct mp_cmd *prev, struct mp_cmd *cmd)
+{
+    if (!prev || prev->id != cmd->id || prev->flags != cmd->flags ||
+        prev->key_up_follows || cmd->key_up_follows ||
+        prev->mouse_move || cmd->mouse_move || prev->repeated != cmd->repeated)
+        return false;
+
+    switch (cmd->id) {
+    case MP_CMD_SEEK: {
+        // Relative seeks are added, an absolute seek overrides everything.
+        double a = prev->args[0].v.d * prev->scale;
+        double b = cmd->args[0].v.d * cmd->scale;
+        if (prev->args[2].v.i != cmd->args[2].v.i)
+            return false;
+        if (cmd->args[1].v.i != 0) {
+            prev->args[0].v.d = b;
+            prev->args[1].v.i = cmd->args[1].v.i;
+        } else if (prev->args[1].v.i == 0) {
+            prev->args[0].v.d = a + b;
+        } else {
+            return false;
+        }
+        prev->scale = 1;
+        return true;
+    }
+    case MP_CMD_ADD: {
+        if (!cmd_same_property(prev, cmd) ||
+            !can_coalesce(add_coalesce_properties, cmd->args[0].v.s))
+            return false;
+        // Like command.c: a value of 0 means "add 1".
+        double a = prev->args[1].v.d ? prev->args[1].v.d * prev->scale : 1;
+        double b = cmd->args[1].v.d ? cmd->args[1].v.d * cmd->scale : 1;
+        // Properties are clamped on each step, so folding increments with
+        // different signs could end up with a different value.
+        if ((a < 0) != (b < 0))
+            return false;
+        prev->args[1].v.d = a + b;
+        prev->scale = 1;
+        return true;
+    }
+    case MP_CMD_MULTIPLY: {
+        if (!cmd_same_property(prev, cmd) ||
+            !can_coalesce(multiply_coalesce_properties, cmd->args[0].v.s))
+            return false;
+        double a = prev->args[1].v.d, b = cmd->args[1].v.d;
+        // Same as with add: both factors must move the value in the same
+        // direction, or the clamping on each step would be skipped.
+        if (a <= 0 || b <= 0 || (a < 1) != (b < 1))
+            return false;
+        prev->args[1].v.d = a * b;
+        return true;
+    }
+    case MP_CMD_SET:
+        // The last value wins.
+        if (!cmd_same_property(prev, cmd) || cmd_arg_expands(cmd, 1))
+            return false;
+        talloc_free(prev->args[1].v.s);
+        prev->args[1].v.s = talloc_strdup(prev, cmd->args[1].v.s);
+        return true;
+    }
+    return false;
+}
+
+// Append the command to the queue, possibly folding it into the command at
+// the end of the queue. Consumes cmd.
+static void queue_add_tail_coalesce(struct input_ctx *ictx, struct mp_cmd *cmd)
+{
+    struct cmd_queue *queue = &ictx->cmd_queue;
+    struct mp_cmd *tail = queue_peek_tail(queue);
+    if (ictx->coalesce && coalesce_cmd(tail, cmd)) {
+        ictx->num_coalesced++;
+        MP_DBG(ictx, "Folded command '%.*s' into queued command.\n",
+               BSTR_P(cmd->original));
+        talloc_free(cmd);
+        return;
+    }
+    queue_add_tail(queue, cmd);
+}
+
 static bool bind_matches_key(struct cmd_bind *bind, int n, const int *keys);
 
 static void append_bind_info(struct input_ctx *ictx, char **pmsg,
@@ -686,7 +816,7 @@ static void interpret_key(struct input_ctx *ictx, int code, double scale)
 
     if (cmd->key_up_follows)
         ictx->current_down_cmd_need_release = true;
-    queue_add_tail(&ictx->cmd_queue, cmd);
+    queue_add_tail_coalesce(ictx, cmd);
 }
 
 static void mp_input_feed_key(struct input_ctx *ictx, int code, double scale)
@@ -832,17 +962,17 @@ int mp_input_add_fd(struct input_ctx *ictx, int unix_fd, int select,
         MP_ERR(ictx, "Too many file descriptors.\n");
     } else {
         fd = &ictx->fds[ictx->num_fds];
+        *fd = (struct input_fd){
+            .log = ictx->log,
+            .fd = unix_fd,
+            .select = select,
+            .read_cmd = read_cmd_func,
+            .read_key = read_key_func,
+            .close_func = close_func,
+            .ctx = ctx,
+        };
+        ictx->num_fds++;
     }
-    *fd = (struct input_fd){
-        .log = ictx->log,
-        .fd = unix_fd,
-        .select = select,
-        .read_cmd = read_cmd_func,
-        .read_key = read_key_func,
-        .close_func = close_func,
-        .ctx = ctx,
-    };
-    ictx->num_fds++;
     input_unlock(ictx);
     return !!fd;
 }
@@ -967,7 +1097,7 @@ static void read_cmd_fd(struct input_ctx *ictx, struct input_fd *cmd_fd)
         struct mp_cmd *cmd = mp_input_parse_cmd(ictx, bstr0(text), "<pipe>");
         talloc_free(text);
         if (cmd)
-            queue_add_tail(&ictx->cmd_queue, cmd);
+            queue_add_tail_coalesce(ictx, cmd);
         if (!cmd_fd->got_cmd)
             return;
     }
@@ -990,6 +1120,8 @@ static void read_key_fd(struct input_ctx *ictx, struct input_fd *key_fd)
     else if (code == MP_INPUT_DEAD) {
         MP_ERR(ictx, "Dead key input on file descriptor %d\n", key_fd->fd);
         key_fd->dead = true;
+    } else if (code == MP_INPUT_EOF) {
+        key_fd->dead = true;
     }
 }
 
@@ -1100,7 +1232,7 @@ int mp_input_queue_cmd(struct input_ctx *ictx, mp_cmd_t *cmd)
     input_lock(ictx);
     ictx->got_new_events = true;
     if (cmd)
-        queue_add_tail(&ictx->cmd_queue, cmd);
+        queue_add_tail_coalesce(ictx, cmd);
     input_unlock(ictx);
     mp_input_wakeup(ictx);
     return 1;
@@ -1471,6 +1603,7 @@ struct input_ctx *mp_input_init(struct mpv_global *global)
         .default_bindings = input_conf->default_bindings,
         .mouse_section = "default",
         .test = input_conf->test,
+        .coalesce = input_conf->coalesce,
         .wakeup_pipe = {-1, -1},
     };
 
@@ -1625,6 +1758,12 @@ void mp_input_wakeup(struct input_ctx *ictx)
         write(ictx->wakeup_pipe[1], &(char){0}, 1);
 }
 
+void mp_input_wakeup_nolock(struct input_ctx *ictx)
+{
+    if (ictx->wakeup_pipe[1] >= 0)
+        write(ictx->wakeup_pipe[1], &(char){0}, 1);
+}
+
 static bool test_abort(struct input_ctx *ictx)
 {
     if (async_quit_request || queue_has_abort_cmds(&ictx->cmd_queue)) {
@@ -1650,6 +1789,14 @@ int mp_input_check_interrupt(struct input_ctx *ictx, int time)
     return res;
 }
 
+unsigned int mp_input_get_coalesced_count(struct input_ctx *ictx)
+{
+    input_lock(ictx);
+    unsigned int res = ictx->num_coalesced;
+    input_unlock(ictx);
+    return res;
+}
+
 bool mp_input_use_alt_gr(struct input_ctx *ictx)
 {
     return ictx->using_alt_gr;
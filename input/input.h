@@ -37,6 +37,9 @@
 #define MP_INPUT_RETRY -4
 // Key FIFO was full - release events may be lost, zero button-down status
 #define MP_INPUT_RELEASE_ALL -5
+// The source was closed regularly, and should be removed (like MP_INPUT_DEAD,
+// but without printing an error)
+#define MP_INPUT_EOF -6
 
 enum mp_cmd_flags {
     MP_ON_OSD_NO = 0,           // prefer not using OSD
@@ -203,9 +206,17 @@ void mp_input_uninit(struct input_ctx *ictx);
 // Wake up sleeping input loop from another thread.
 void mp_input_wakeup(struct input_ctx *ictx);
 
+// Like mp_input_wakeup(), but doesn't take any locks, and may cause spurious
+// wakeups. Can be called with other locks held.
+void mp_input_wakeup_nolock(struct input_ctx *ictx);
+
 // Interruptible usleep:  (used by demux)
 int mp_input_check_interrupt(struct input_ctx *ictx, int time);
 
+// Number of queued commands that were folded into a preceding command of the
+// same type (e.g. consecutive relative seeks), instead of being run separately.
+unsigned int mp_input_get_coalesced_count(struct input_ctx *ictx);
+
 // If this returns true, use Right Alt key as Alt Gr to produce special
 // characters. If false, count Right Alt as the modifier Alt key.
 bool mp_input_use_alt_gr(struct input_ctx *ictx);
@@ -0,0 +1,436 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Unix domain socket server for the JSON IPC protocol.
+ *
+ * The listening socket and all client sockets are added to the input context
+ * as normal input file descriptors, so everything is driven by the input
+ * select() loop. Clients send one JSON request per line. All requests that
+ * could be read at once are parsed and passed to the player as a single
+ * MP_CMD_IPC_REQUESTS command, which avoids waking up the player for every
+ * single request. Replies and events are buffered per client, and written
+ * without blocking; a client that doesn't read its replies is disconnected
+ * once its output buffer is full.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "osdep/io.h"
+
+#include "common/common.h"
+#include "common/global.h"
+#include "common/msg.h"
+#include "options/options.h"
+#include "options/path.h"
+#include "misc/json.h"
+#include "talloc.h"
+
+#include "input.h"
+#include "ipc.h"
+
+// Maximum size of an incomplete request line.
+#define MAX_LINE_SIZE (1024 * 1024)
+// Maximum amount of unsent output per client.
+#define MAX_OUTPUT_SIZE (4 * 1024 * 1024)
+// Maximum number of bytes read from a client in one go.
+#define MAX_READ_SIZE (64 * 1024)
+
+struct ipc_client {
+    struct mp_ipc_ctx *ipc;
+    int id;
+    int fd;
+    bool dead;
+    char *in_buf;
+    int in_len;
+    char *out_buf;
+    int out_len;
+};
+
+struct mp_ipc_ctx {
+    struct mp_log *log;
+    struct input_ctx *input;
+    char *path;
+    int listen_fd;
+
+    pthread_mutex_t lock;
+    // --- protected by lock
+    struct ipc_client **clients;
+    int num_clients;
+    int next_id;
+};
+
+static void set_nonblock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags >= 0)
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Caller must hold ipc->lock.
+static struct ipc_client *find_client(struct mp_ipc_ctx *ipc, int id)
+{
+    for (int n = 0; n < ipc->num_clients; n++) {
+        if (ipc->clients[n]->id == id)
+            return ipc->clients[n];
+    }
+    return NULL;
+}
+
+// Disconnect the client as soon as possible. We can't remove it from the
+// input context directly (lock order), so make the socket signal EOF, and let
+// the input loop remove it.
+// Caller must hold ipc->lock.
+static void kill_client(struct ipc_client *cl)
+{
+    if (!cl->dead) {
+        cl->dead = true;
+        shutdown(cl->fd, SHUT_RDWR);
+    }
+}
+
+// Caller must hold ipc->lock.
+static void flush_client(struct ipc_client *cl)
+{
+    int pos = 0;
+    while (pos < cl->out_len && !cl->dead) {
+        ssize_t r = send(cl->fd, cl->out_buf + pos, cl->out_len - pos,
+                         MSG_NOSIGNAL);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                MP_VERBOSE(cl->ipc, "Client %d: write error: %s\n", cl->id,
+                           strerror(errno));
+                kill_client(cl);
+            }
+            break;
+        }
+        pos += r;
+    }
+    memmove(cl->out_buf, cl->out_buf + pos, cl->out_len - pos);
+    cl->out_len -= pos;
+}
+
+// Caller must hold ipc->lock.
+static void client_send(struct ipc_client *cl, const char *line)
+{
+    if (cl->dead)
+        return;
+    int len = strlen(line);
+    if (cl->out_len + len + 1 > MAX_OUTPUT_SIZE) {
+        MP_WARN(cl->ipc, "Client %d is not reading replies, disconnecting.\n",
+                cl->id);
+        kill_client(cl);
+        return;
+    }
+    cl->out_buf = talloc_realloc_size(cl, cl->out_buf, cl->out_len + len + 1);
+    memcpy(cl->out_buf + cl->out_len, line, len);
+    cl->out_buf[cl->out_len + len] = '\n';
+    cl->out_len += len + 1;
+    flush_client(cl);
+}
+
+bool mp_ipc_send(struct mp_ipc_ctx *ipc, int client, const char *line)
+{
+    if (!ipc)
+        return false;
+    pthread_mutex_lock(&ipc->lock);
+    struct ipc_client *cl = find_client(ipc, client);
+    if (cl)
+        client_send(cl, line);
+    bool ok = cl && !cl->dead;
+    pthread_mutex_unlock(&ipc->lock);
+    return ok;
+}
+
+void mp_ipc_broadcast(struct mp_ipc_ctx *ipc, const char *line)
+{
+    if (!ipc)
+        return;
+    pthread_mutex_lock(&ipc->lock);
+    for (int n = 0; n < ipc->num_clients; n++)
+        client_send(ipc->clients[n], line);
+    pthread_mutex_unlock(&ipc->lock);
+}
+
+void mp_ipc_flush(struct mp_ipc_ctx *ipc)
+{
+    if (!ipc)
+        return;
+    pthread_mutex_lock(&ipc->lock);
+    for (int n = 0; n < ipc->num_clients; n++)
+        flush_client(ipc->clients[n]);
+    pthread_mutex_unlock(&ipc->lock);
+}
+
+static void send_parse_error(struct ipc_client *cl)
+{
+    client_send(cl, "{\"error\":\"invalid parameter\"}");
+}
+
+// Parse all complete lines in the input buffer, and return them as batch.
+// Caller must hold ipc->lock.
+static struct mp_ipc_batch *parse_requests(struct ipc_client *cl)
+{
+    struct mp_ipc_batch *batch = NULL;
+    char *cur = cl->in_buf;
+    char *end = cl->in_buf + cl->in_len;
+    while (cur < end) {
+        char *nl = memchr(cur, '\n', end - cur);
+        if (!nl)
+            break;
+        *nl = '\0';
+        char *line = cur;
+        cur = nl + 1;
+        json_skip_whitespace(&line);
+        if (!line[0])
+            continue;
+        if (!batch) {
+            batch = talloc_zero(NULL, struct mp_ipc_batch);
+            batch->client = cl->id;
+        }
+        struct json_node req;
+        if (json_parse(batch, &req, &line, MAX_JSON_DEPTH) < 0 || line[0] ||
+            req.type != JSON_OBJECT)
+        {
+            MP_VERBOSE(cl->ipc, "Client %d: invalid request.\n", cl->id);
+            send_parse_error(cl);
+            continue;
+        }
+        MP_TARRAY_APPEND(batch, batch->requests, batch->num_requests, req);
+    }
+    cl->in_len = end - cur;
+    memmove(cl->in_buf, cur, cl->in_len);
+    if (batch && !batch->num_requests) {
+        talloc_free(batch);
+        batch = NULL;
+    }
+    return batch;
+}
+
+static int client_read(void *ctx, int fd)
+{
+    struct ipc_client *cl = ctx;
+    struct mp_ipc_ctx *ipc = cl->ipc;
+    int res = MP_INPUT_NOTHING;
+
+    pthread_mutex_lock(&ipc->lock);
+    int total = 0;
+    while (total < MAX_READ_SIZE && !cl->dead) {
+        char buf[4096];
+        ssize_t r = recv(fd, buf, sizeof(buf), 0);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                MP_VERBOSE(ipc, "Client %d: read error: %s\n", cl->id,
+                           strerror(errno));
+                cl->dead = true;
+            }
+            break;
+        }
+        if (r == 0) {
+            cl->dead = true;
+            break;
+        }
+        if (cl->in_len + r > MAX_LINE_SIZE) {
+            MP_WARN(ipc, "Client %d: request too long, disconnecting.\n",
+                    cl->id);
+            cl->dead = true;
+            break;
+        }
+        cl->in_buf = talloc_realloc_size(cl, cl->in_buf, cl->in_len + r);
+        memcpy(cl->in_buf + cl->in_len, buf, r);
+        cl->in_len += r;
+        total += r;
+    }
+    struct mp_ipc_batch *batch = parse_requests(cl);
+    flush_client(cl);
+    if (cl->dead)
+        res = MP_INPUT_EOF;
+    pthread_mutex_unlock(&ipc->lock);
+
+    if (batch) {
+        struct mp_cmd *cmd = talloc_ptrtype(NULL, cmd);
+        *cmd = (struct mp_cmd) {
+            .id = MP_CMD_IPC_REQUESTS,
+            .name = "ipc_requests",
+            .scale = 1,
+        };
+        cmd->args[0].v.p = talloc_steal(cmd, batch);
+        mp_input_queue_cmd(ipc->input, cmd);
+    }
+    return res;
+}
+
+static int client_close(void *ctx, int fd)
+{
+    struct ipc_client *cl = ctx;
+    struct mp_ipc_ctx *ipc = cl->ipc;
+    pthread_mutex_lock(&ipc->lock);
+    for (int n = 0; n < ipc->num_clients; n++) {
+        if (ipc->clients[n] == cl) {
+            MP_TARRAY_REMOVE_AT(ipc->clients, ipc->num_clients, n);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ipc->lock);
+    MP_VERBOSE(ipc, "Client %d disconnected.\n", cl->id);
+    close(fd);
+    talloc_free(cl);
+    return 0;
+}
+
+static int listen_accept(void *ctx, int fd)
+{
+    struct mp_ipc_ctx *ipc = ctx;
+    while (1) {
+        int client_fd = accept(fd, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                MP_ERR(ipc, "Could not accept connection: %s\n",
+                       strerror(errno));
+            break;
+        }
+        mp_set_cloexec(client_fd);
+        set_nonblock(client_fd);
+
+        struct ipc_client *cl = talloc_ptrtype(NULL, cl);
+        pthread_mutex_lock(&ipc->lock);
+        *cl = (struct ipc_client) {
+            .ipc = ipc,
+            .id = ipc->next_id++,
+            .fd = client_fd,
+        };
+        MP_TARRAY_APPEND(ipc, ipc->clients, ipc->num_clients, cl);
+        pthread_mutex_unlock(&ipc->lock);
+
+        if (!mp_input_add_fd(ipc->input, client_fd, 1, NULL, client_read,
+                             client_close, cl))
+        {
+            client_close(cl, client_fd);
+            continue;
+        }
+        MP_VERBOSE(ipc, "Client %d connected.\n", cl->id);
+    }
+    return MP_INPUT_NOTHING;
+}
+
+static int listen_close(void *ctx, int fd)
+{
+    struct mp_ipc_ctx *ipc = ctx;
+    close(fd);
+    unlink(ipc->path);
+    return 0;
+}
+
+struct mp_ipc_ctx *mp_init_ipc(struct input_ctx *ictx,
+                               struct mpv_global *global)
+{
+    struct MPOpts *opts = global->opts;
+    if (!opts->input.ipc_path || !opts->input.ipc_path[0])
+        return NULL;
+
+    struct mp_ipc_ctx *ipc = talloc_ptrtype(NULL, ipc);
+    *ipc = (struct mp_ipc_ctx) {
+        .log = mp_log_new(ipc, global->log, "ipc"),
+        .input = ictx,
+        .listen_fd = -1,
+        .next_id = 1,
+    };
+    pthread_mutex_init(&ipc->lock, NULL);
+    ipc->path = mp_get_user_path(ipc, global, opts->input.ipc_path);
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(ipc->path) + 1 > sizeof(addr.sun_path)) {
+        MP_ERR(ipc, "Socket path '%s' is too long.\n", ipc->path);
+        goto error;
+    }
+    strcpy(addr.sun_path, ipc->path);
+
+    ipc->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (ipc->listen_fd < 0) {
+        MP_ERR(ipc, "Could not create socket: %s\n", strerror(errno));
+        goto error;
+    }
+    mp_set_cloexec(ipc->listen_fd);
+    set_nonblock(ipc->listen_fd);
+
+    // Remove a stale socket left over by a previous instance.
+    unlink(ipc->path);
+
+    if (bind(ipc->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        MP_ERR(ipc, "Could not bind socket '%s': %s\n", ipc->path,
+               strerror(errno));
+        goto error;
+    }
+    if (listen(ipc->listen_fd, 10) < 0) {
+        MP_ERR(ipc, "Could not listen on socket '%s': %s\n", ipc->path,
+               strerror(errno));
+        goto error;
+    }
+    if (!mp_input_add_fd(ictx, ipc->listen_fd, 1, NULL, listen_accept,
+                         listen_close, ipc))
+        goto error;
+
+    MP_VERBOSE(ipc, "Listening on '%s'.\n", ipc->path);
+    return ipc;
+
+error:
+    if (ipc->listen_fd >= 0) {
+        close(ipc->listen_fd);
+        unlink(ipc->path);
+    }
+    pthread_mutex_destroy(&ipc->lock);
+    talloc_free(ipc);
+    return NULL;
+}
+
+void mp_uninit_ipc(struct mp_ipc_ctx *ipc)
+{
+    if (!ipc)
+        return;
+
+    pthread_mutex_lock(&ipc->lock);
+    int num_fds = ipc->num_clients;
+    int *fds = talloc_array(NULL, int, num_fds);
+    for (int n = 0; n < num_fds; n++) {
+        flush_client(ipc->clients[n]);
+        fds[n] = ipc->clients[n]->fd;
+    }
+    pthread_mutex_unlock(&ipc->lock);
+
+    // This calls client_close() for each client.
+    for (int n = 0; n < num_fds; n++)
+        mp_input_rm_key_fd(ipc->input, fds[n]);
+    talloc_free(fds);
+    mp_input_rm_key_fd(ipc->input, ipc->listen_fd);
+
+    pthread_mutex_destroy(&ipc->lock);
+    talloc_free(ipc);
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_INPUT_IPC_H
+#define MP_INPUT_IPC_H
+
+#include <stdbool.h>
+
+struct input_ctx;
+struct mpv_global;
+struct mp_ipc_ctx;
+
+// All requests read from a client in one go. This is passed to the player
+// as MP_CMD_IPC_REQUESTS command (in args[0].v.p), and the player is supposed
+// to answer each request with mp_ipc_send().
+struct mp_ipc_batch {
+    int client;                     // client ID for mp_ipc_send()
+    struct json_node *requests;     // each a parsed JSON request
+    int num_requests;
+};
+
+// Create the socket given by --input-unix-socket, and register it with the
+// input context. Returns NULL if the option is not set or on errors.
+struct mp_ipc_ctx *mp_init_ipc(struct input_ctx *ictx,
+                               struct mpv_global *global);
+void mp_uninit_ipc(struct mp_ipc_ctx *ipc);
+
+// Queue a line of JSON text to be sent to the given client. The line must
+// not contain a newline; it's appended by this function. Returns false if
+// the client doesn't exist (anymore).
+bool mp_ipc_send(struct mp_ipc_ctx *ipc, int client, const char *line);
+
+// Like mp_ipc_send(), but send to all clients.
+void mp_ipc_broadcast(struct mp_ipc_ctx *ipc, const char *line);
+
+// Try to write pending output for all clients (never blocks).
+void mp_ipc_flush(struct mp_ipc_ctx *ipc);
+
+#endif
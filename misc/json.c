@@ -0,0 +1,304 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* JSON parser and writer, as used by the IPC protocol.
+ *
+ * Numbers are always parsed as double. Strings are required to be UTF-8, but
+ * this is not validated. The parser is somewhat lenient with number syntax
+ * (it uses strtod()).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "common/common.h"
+#include "bstr/bstr.h"
+#include "talloc.h"
+#include "json.h"
+
+static bool eat_c(char **s, char c)
+{
+    if (**s == c) {
+        *s += 1;
+        return true;
+    }
+    return false;
+}
+
+void json_skip_whitespace(char **src)
+{
+    while (**src == ' ' || **src == '\t' || **src == '\n' || **src == '\r')
+        *src += 1;
+}
+
+static int read_hex(char **src, int digits, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (int n = 0; n < digits; n++) {
+        char c = **src;
+        v <<= 4;
+        if (c >= '0' && c <= '9') {
+            v |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            v |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            v |= c - 'A' + 10;
+        } else {
+            return -1;
+        }
+        *src += 1;
+    }
+    *out = v;
+    return 0;
+}
+
+static int read_str(void *ta_parent, struct json_node *dst, char **src)
+{
+    if (!eat_c(src, '"'))
+        return -1;
+    bstr str = {0};
+    char *cur = *src;
+    while (1) {
+        char c = *cur;
+        if (!c)
+            return -1;
+        if (c == '"')
+            break;
+        if ((unsigned char)c < 0x20)
+            return -1; // unescaped control character
+        if (c != '\\') {
+            char *end = cur;
+            while (*end && *end != '"' && *end != '\\' &&
+                   (unsigned char)*end >= 0x20)
+                end++;
+            bstr_xappend(ta_parent, &str, (bstr){cur, end - cur});
+            cur = end;
+            continue;
+        }
+        cur++;
+        char esc = *cur++;
+        const char *rep = NULL;
+        switch (esc) {
+        case '"':  rep = "\""; break;
+        case '\\': rep = "\\"; break;
+        case '/':  rep = "/"; break;
+        case 'b':  rep = "\b"; break;
+        case 'f':  rep = "\f"; break;
+        case 'n':  rep = "\n"; break;
+        case 'r':  rep = "\r"; break;
+        case 't':  rep = "\t"; break;
+        case 'u': {
+            uint32_t cp;
+            if (read_hex(&cur, 4, &cp) < 0)
+                return -1;
+            // Surrogate pair
+            if (cp >= 0xD800 && cp <= 0xDBFF && cur[0] == '\\' && cur[1] == 'u')
+            {
+                char *next = cur + 2;
+                uint32_t lo;
+                if (read_hex(&next, 4, &lo) >= 0 && lo >= 0xDC00 && lo <= 0xDFFF)
+                {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    cur = next;
+                }
+            }
+            mp_append_utf8_bstr(ta_parent, &str, cp);
+            continue;
+        }
+        default:
+            return -1;
+        }
+        bstr_xappend(ta_parent, &str, bstr0(rep));
+    }
+    *src = cur + 1;
+    dst->type = JSON_STRING;
+    // Make sure the string is allocated and 0-terminated
+    dst->u.s = bstrdup0(ta_parent, str);
+    talloc_free(str.start);
+    return 0;
+}
+
+static int read_sub(void *ta_parent, struct json_node *dst, char **src,
+                    int max_depth)
+{
+    bool is_obj = eat_c(src, '{');
+    if (!is_obj && !eat_c(src, '['))
+        return -1;
+    char term = is_obj ? '}' : ']';
+
+    struct json_list *list = talloc_zero(ta_parent, struct json_list);
+    dst->type = is_obj ? JSON_OBJECT : JSON_ARRAY;
+    dst->u.list = list;
+
+    json_skip_whitespace(src);
+    if (eat_c(src, term))
+        return 0;
+
+    while (1) {
+        char *key = NULL;
+        if (is_obj) {
+            struct json_node keynode;
+            if (read_str(list, &keynode, src) < 0)
+                return -1;
+            key = keynode.u.s;
+            json_skip_whitespace(src);
+            if (!eat_c(src, ':'))
+                return -1;
+            json_skip_whitespace(src);
+        }
+        struct json_node val;
+        if (json_parse(list, &val, src, max_depth) < 0)
+            return -1;
+        MP_TARRAY_GROW(list, list->values, list->num);
+        if (is_obj)
+            MP_TARRAY_GROW(list, list->keys, list->num);
+        list->values[list->num] = val;
+        if (is_obj)
+            list->keys[list->num] = key;
+        list->num++;
+        if (eat_c(src, term))
+            return 0;
+        if (!eat_c(src, ','))
+            return -1;
+        json_skip_whitespace(src);
+    }
+}
+
+static bool eat_word(char **src, const char *word)
+{
+    size_t len = strlen(word);
+    if (strncmp(*src, word, len) == 0) {
+        *src += len;
+        return true;
+    }
+    return false;
+}
+
+int json_parse(void *ta_parent, struct json_node *dst, char **src, int max_depth)
+{
+    max_depth -= 1;
+    if (max_depth < 0)
+        return -1;
+
+    json_skip_whitespace(src);
+    char c = **src;
+    int r = -1;
+    if (eat_word(src, "null")) {
+        *dst = (struct json_node){ .type = JSON_NULL };
+        r = 0;
+    } else if (eat_word(src, "true")) {
+        *dst = (struct json_node){ .type = JSON_BOOL, .u.b = true };
+        r = 0;
+    } else if (eat_word(src, "false")) {
+        *dst = (struct json_node){ .type = JSON_BOOL, .u.b = false };
+        r = 0;
+    } else if (c == '"') {
+        r = read_str(ta_parent, dst, src);
+    } else if (c == '[' || c == '{') {
+        r = read_sub(ta_parent, dst, src, max_depth);
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+        char *end;
+        double d = strtod(*src, &end);
+        if (end > *src && isfinite(d)) {
+            *src = end;
+            *dst = (struct json_node){ .type = JSON_NUMBER, .u.d = d };
+            r = 0;
+        }
+    }
+    if (r >= 0)
+        json_skip_whitespace(src);
+    return r;
+}
+
+void json_write_string(char **s, const char *str)
+{
+    static const char special[] = "\"\\\b\f\n\r\t";
+    static const char replace[] = "\"\\bfnrt";
+    *s = talloc_strdup_append_buffer(*s, "\"");
+    while (*str) {
+        const char *cur = str;
+        while (*cur && (unsigned char)*cur >= 0x20 && *cur != '"' &&
+               *cur != '\\')
+            cur++;
+        *s = talloc_strndup_append_buffer(*s, str, cur - str);
+        if (!*cur)
+            break;
+        const char *p = strchr(special, *cur);
+        if (p) {
+            *s = talloc_asprintf_append_buffer(*s, "\\%c",
+                                               replace[p - special]);
+        } else {
+            *s = talloc_asprintf_append_buffer(*s, "\\u%04x",
+                                               (unsigned char)*cur);
+        }
+        str = cur + 1;
+    }
+    *s = talloc_strdup_append_buffer(*s, "\"");
+}
+
+void json_write(char **s, struct json_node *src)
+{
+    switch (src->type) {
+    case JSON_NULL:
+        *s = talloc_strdup_append_buffer(*s, "null");
+        break;
+    case JSON_BOOL:
+        *s = talloc_strdup_append_buffer(*s, src->u.b ? "true" : "false");
+        break;
+    case JSON_NUMBER:
+        if (isfinite(src->u.d)) {
+            *s = talloc_asprintf_append_buffer(*s, "%.17g", src->u.d);
+        } else {
+            *s = talloc_strdup_append_buffer(*s, "null");
+        }
+        break;
+    case JSON_STRING:
+        json_write_string(s, src->u.s);
+        break;
+    case JSON_ARRAY:
+    case JSON_OBJECT: {
+        bool is_obj = src->type == JSON_OBJECT;
+        struct json_list *list = src->u.list;
+        *s = talloc_strdup_append_buffer(*s, is_obj ? "{" : "[");
+        for (int n = 0; n < list->num; n++) {
+            if (n)
+                *s = talloc_strdup_append_buffer(*s, ",");
+            if (is_obj) {
+                json_write_string(s, list->keys[n]);
+                *s = talloc_strdup_append_buffer(*s, ":");
+            }
+            json_write(s, &list->values[n]);
+        }
+        *s = talloc_strdup_append_buffer(*s, is_obj ? "}" : "]");
+        break;
+    }
+    }
+}
+
+struct json_node *json_find_key(struct json_node *obj, const char *key)
+{
+    if (obj->type != JSON_OBJECT)
+        return NULL;
+    struct json_list *list = obj->u.list;
+    for (int n = 0; n < list->num; n++) {
+        if (strcmp(list->keys[n], key) == 0)
+            return &list->values[n];
+    }
+    return NULL;
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_JSON_H
+#define MP_JSON_H
+
+#include <stdbool.h>
+
+enum json_type {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+};
+
+struct json_list;
+
+struct json_node {
+    enum json_type type;
+    union {
+        bool b;
+        double d;
+        char *s;
+        struct json_list *list;     // JSON_ARRAY, JSON_OBJECT
+    } u;
+};
+
+struct json_list {
+    int num;
+    struct json_node *values;
+    char **keys;                    // NULL for JSON_ARRAY
+};
+
+// Default maximum nesting depth for json_parse().
+#define MAX_JSON_DEPTH 50
+
+// Parse the JSON value at *src, and advance *src past it (and past trailing
+// whitespace). All allocations are made with ta_parent as parent.
+// Returns 0 on success, and a negative value on syntax errors.
+int json_parse(void *ta_parent, struct json_node *dst, char **src, int max_depth);
+
+void json_skip_whitespace(char **src);
+
+// Append the JSON text for src to *s (a talloc'ed string, can be NULL).
+void json_write(char **s, struct json_node *src);
+
+// Append str as quoted and escaped JSON string to *s.
+void json_write_string(char **s, const char *str);
+
+// Return the value for the given key, or NULL if it doesn't exist or obj is
+// not an object.
+struct json_node *json_find_key(struct json_node *obj, const char *key);
+
+#endif
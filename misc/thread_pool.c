@@ -0,0 +1,140 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "talloc.h"
+
+#include "common/common.h"
+#include "osdep/numcores.h"
+#include "thread_pool.h"
+
+#define MAX_THREADS 64
+
+struct mp_thread_pool {
+    pthread_t *threads;
+    int num_threads;        // not including the thread calling run()
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;  // workers wait on this for new work
+    pthread_cond_t done;    // run() waits on this for completion
+    // --- protected by lock
+    bool terminate;
+    void (*fn)(void *ctx, int n);
+    void *ctx;
+    int count;
+    int next;               // next index to hand out
+    int pending;            // number of started but unfinished calls
+};
+
+// Process work items until none are left. Called with pool->lock held.
+static void run_items(struct mp_thread_pool *pool)
+{
+    while (pool->next < pool->count) {
+        int n = pool->next++;
+        pool->pending++;
+        pthread_mutex_unlock(&pool->lock);
+        pool->fn(pool->ctx, n);
+        pthread_mutex_lock(&pool->lock);
+        pool->pending--;
+        if (pool->next >= pool->count && !pool->pending)
+            pthread_cond_signal(&pool->done);
+    }
+}
+
+static void *worker_thread(void *p)
+{
+    struct mp_thread_pool *pool = p;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->terminate) {
+        run_items(pool);
+        if (!pool->terminate)
+            pthread_cond_wait(&pool->wakeup, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void destroy_pool(void *p)
+{
+    struct mp_thread_pool *pool = p;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->terminate = true;
+    pthread_cond_broadcast(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int n = 0; n < pool->num_threads; n++)
+        pthread_join(pool->threads[n], NULL);
+
+    pthread_cond_destroy(&pool->wakeup);
+    pthread_cond_destroy(&pool->done);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+struct mp_thread_pool *mp_thread_pool_create(void *ta_parent, int threads)
+{
+    if (threads <= 0)
+        threads = default_thread_count();
+    threads = MPCLAMP(threads, 1, MAX_THREADS);
+
+    struct mp_thread_pool *pool = talloc_zero(ta_parent, struct mp_thread_pool);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wakeup, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    talloc_set_destructor(pool, destroy_pool);
+
+    pool->threads = talloc_array(pool, pthread_t, threads - 1);
+    for (int n = 0; n < threads - 1; n++) {
+        if (pthread_create(&pool->threads[n], NULL, worker_thread, pool))
+            break; // run with fewer threads
+        pool->num_threads++;
+    }
+    return pool;
+}
+
+int mp_thread_pool_get_threads(struct mp_thread_pool *pool)
+{
+    return pool ? pool->num_threads + 1 : 1;
+}
+
+void mp_thread_pool_run(struct mp_thread_pool *pool,
+                        void (*fn)(void *ctx, int n), void *ctx, int count)
+{
+    if (!pool || !pool->num_threads || count < 2) {
+        for (int n = 0; n < count; n++)
+            fn(ctx, n);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->count = count;
+    pool->next = 0;
+    pool->pending = 0;
+    pthread_cond_broadcast(&pool->wakeup);
+    run_items(pool);
+    while (pool->next < pool->count || pool->pending)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pool->fn = NULL;
+    pool->ctx = NULL;
+    pool->count = pool->next = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
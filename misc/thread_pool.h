@@ -0,0 +1,40 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_THREAD_POOL_H
+#define MP_THREAD_POOL_H
+
+struct mp_thread_pool;
+
+// Create a pool with the given number of threads. If threads is <= 0, use the
+// number of CPUs. The calling thread counts as one of them, so a pool with 1
+// thread runs everything synchronously and creates no threads at all.
+// Freeing the pool (with talloc_free()) waits for and joins all threads.
+struct mp_thread_pool *mp_thread_pool_create(void *ta_parent, int threads);
+
+// Total number of threads (including the calling thread).
+int mp_thread_pool_get_threads(struct mp_thread_pool *pool);
+
+// Call fn(ctx, n) for each n in [0, count), distributed over the pool threads
+// and the calling thread. Returns after all calls have finished. There is no
+// guarantee about the order or the thread a given n runs on.
+// pool can be NULL, in which case everything is run on the calling thread.
+// Must not be called concurrently on the same pool.
+void mp_thread_pool_run(struct mp_thread_pool *pool,
+                        void (*fn)(void *ctx, int n), void *ctx, int count);
+
+#endif
@@ -751,3 +751,52 @@ void *m_config_alloc_struct(void *talloc_ctx,
         memcpy(substruct, subopts->defaults, subopts->size);
     return substruct;
 }
+
+// Dynamic values duplicated by m_config_copy_struct(). Allocated as child of
+// the copy, so the copy is still valid when the destructor runs.
+struct struct_copy {
+    char *data;
+    struct struct_copy_entry {
+        const struct m_option *opt;
+        size_t offset;
+    } *entries;
+    int num_entries;
+};
+
+static void struct_copy_destroy(void *p)
+{
+    struct struct_copy *c = p;
+    for (int n = 0; n < c->num_entries; n++)
+        m_option_free(c->entries[n].opt, c->data + c->entries[n].offset);
+}
+
+void *m_config_copy_struct(void *talloc_ctx, struct m_config *config,
+                           size_t size)
+{
+    char *src = config->optstruct;
+    char *dst = talloc_size(talloc_ctx, size);
+    memcpy(dst, src, size);
+
+    struct struct_copy *c = talloc_ptrtype(dst, c);
+    *c = (struct struct_copy){ .data = dst };
+    talloc_set_destructor(c, struct_copy_destroy);
+
+    for (int n = 0; n < config->num_opts; n++) {
+        struct m_config_option *co = &config->opts[n];
+        char *data = co->data;
+        if (co->is_generated || !data || data < src || data >= src + size ||
+            !(co->opt->type->flags & M_OPT_TYPE_DYNAMIC))
+            continue;
+        size_t offset = data - src;
+        bool dup = false;
+        for (int i = 0; i < c->num_entries; i++)
+            dup |= c->entries[i].offset == offset;
+        if (dup) // aliases
+            continue;
+        memset(dst + offset, 0, co->opt->type->size);
+        m_option_copy(co->opt, dst + offset, data);
+        struct struct_copy_entry e = { .opt = co->opt, .offset = offset };
+        MP_TARRAY_APPEND(c, c->entries, c->num_entries, e);
+    }
+    return dst;
+}
@@ -218,4 +218,12 @@ void m_config_set_profile(struct m_config *config, struct m_profile *p,
 void *m_config_alloc_struct(void *talloc_ctx,
                             const struct m_sub_options *subopts);
 
+// Return a copy of config's option struct (of the given size), which another
+// thread can read while the options in config are changed. Values stored in
+// the struct itself are duplicated. Sub-structs and options backed by global
+// variables are shared with config, and must not be read through the copy.
+// Free with talloc_free().
+void *m_config_copy_struct(void *talloc_ctx, struct m_config *config,
+                           size_t size);
+
 #endif /* MPLAYER_M_CONFIG_H */
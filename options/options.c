@@ -197,6 +197,7 @@ extern const struct m_sub_options image_writer_conf;
 static const m_option_t screenshot_conf[] = {
     OPT_SUBSTRUCT("", screenshot_image_opts, image_writer_conf, 0),
     OPT_STRING("template", screenshot_template, 0),
+    OPT_INTRANGE("threads", screenshot_threads, 0, 0, 16),
     {0},
 };
 
@@ -230,6 +231,10 @@ const m_option_t mp_opts[] = {
                 .type = &m_option_type_msglevels),
     OPT_FLAG("msgcolor", msg_color, CONF_GLOBAL | CONF_PRE_PARSE),
     OPT_FLAG("msgmodule", msg_module, CONF_GLOBAL),
+    OPT_FLAG("msgasync", msg_async, CONF_GLOBAL),
+    OPT_STRING("log-file", log_file, CONF_GLOBAL | CONF_PRE_PARSE),
+    OPT_CHOICE("log-file-format", log_file_format, CONF_GLOBAL | CONF_PRE_PARSE,
+               ({"text", 0}, {"binary", 1})),
     OPT_FLAG("identify", msg_identify, CONF_GLOBAL),
 #if HAVE_PRIORITY
     {"priority", &proc_priority, CONF_TYPE_STRING, 0, 0, 0, NULL},
@@ -347,6 +352,11 @@ const m_option_t mp_opts[] = {
 
     // set A-V sync correction speed (0=disables it):
     OPT_FLOATRANGE("mc", default_max_pts_correction, 0, 0, 100),
+    OPT_CHOICE("video-sync", video_sync, 0,
+               ({"audio", VS_AUDIO},
+                {"resample", VS_RESAMPLE})),
+    OPT_FLOATRANGE("video-sync-max-audio-change", video_sync_max_audio_change,
+                   0, 0, 1),
 
     // force video/audio rate:
     OPT_DOUBLE("fps", force_fps, CONF_MIN, 0),
@@ -472,6 +482,7 @@ const m_option_t mp_opts[] = {
                 {"yes", 1}, {"", 1})),
     OPT_STRING("volume-restore-data", mixer_restore_volume_data, 0),
     OPT_FLAG("gapless-audio", gapless_audio, 0),
+    OPT_FLAG("prefetch-playlist", prefetch_playlist, 0),
 
     OPT_GEOMETRY("geometry", vo.geometry, 0),
     OPT_SIZE_BOX("autofit", vo.autofit, 0),
@@ -559,6 +570,13 @@ const m_option_t mp_opts[] = {
                 {"hard", 2})),
 
     OPT_FLAG("untimed", untimed, 0),
+    OPT_STRING("benchmark", benchmark_file, CONF_GLOBAL),
+    OPT_STRING("thumbnail-atlas", thumbnail_file, CONF_GLOBAL),
+    OPT_INTRANGE("thumbnail-count", thumbnail_count, CONF_GLOBAL, 1, 10000),
+    OPT_INTRANGE("thumbnail-columns", thumbnail_columns, CONF_GLOBAL, 1, 1000),
+    OPT_INTRANGE("thumbnail-width", thumbnail_width, CONF_GLOBAL, 16, 4096),
+    OPT_INTRANGE("thumbnail-height", thumbnail_height, CONF_GLOBAL, 0, 4096),
+    OPT_FLAG("loudness-scan", loudness_scan, CONF_GLOBAL),
 
     OPT_STRING("stream-capture", stream_capture, 0),
     OPT_STRING("stream-dump", stream_dump, 0),
@@ -642,6 +660,8 @@ const m_option_t mp_opts[] = {
     OPT_FLAG("oneverdrop", encode_output.neverdrop, CONF_GLOBAL),
     OPT_FLAG("ovfirst", encode_output.video_first, CONF_GLOBAL),
     OPT_FLAG("oafirst", encode_output.audio_first, CONF_GLOBAL),
+    OPT_FLAG("othreads", encode_output.threads, CONF_GLOBAL),
+    OPT_INTRANGE("oparallel", encode_output.parallel, CONF_GLOBAL, 1, 64),
 #endif
 
     {NULL, NULL, 0, 0, 0, 0, NULL}
@@ -689,6 +709,9 @@ const struct MPOpts mp_default_opts = {
     .osd_scale_by_window = 1,
     .lua_load_osc = 1,
     .loop_times = -1,
+    .thumbnail_count = 25,
+    .thumbnail_columns = 5,
+    .thumbnail_width = 160,
     .ordered_chapters = 1,
     .chapter_merge_threshold = 100,
     .chapter_seek_threshold = 5.0,
@@ -701,6 +724,7 @@ const struct MPOpts mp_default_opts = {
     .chapterrange = {-1, -1},
     .edition_id = -1,
     .default_max_pts_correction = -1,
+    .video_sync_max_audio_change = 0.5,
     .correct_pts = 1,
     .user_pts_assoc_mode = 1,
     .initial_audio_sync = 1,
@@ -770,6 +794,11 @@ const struct MPOpts mp_default_opts = {
         .use_media_keys = 1,
 #endif
         .default_bindings = 1,
+        .coalesce = 1,
+    },
+    .encode_output = {
+        .threads = 1,
+        .parallel = 1,
     },
 };
 
@@ -49,6 +49,9 @@ typedef struct MPOpts {
     int msg_identify;
     int msg_color;
     int msg_module;
+    int msg_async;
+    char *log_file;
+    int log_file_format;
 
     char **reset_options;
     char **lua_files;
@@ -64,6 +67,7 @@ typedef struct MPOpts {
     int volstep;
     float softvol_max;
     int gapless_audio;
+    int prefetch_playlist;
 
     mp_vo_opts vo;
 
@@ -92,6 +96,13 @@ typedef struct MPOpts {
     int osd_duration;
     int osd_fractions;
     int untimed;
+    char *benchmark_file;
+    char *thumbnail_file;
+    int thumbnail_count;
+    int thumbnail_columns;
+    int thumbnail_width;
+    int thumbnail_height;
+    int loudness_scan;
     char *stream_capture;
     char *stream_dump;
     int loop_times;
@@ -120,6 +131,8 @@ typedef struct MPOpts {
     float hr_seek_demuxer_offset;
     float audio_delay;
     float default_max_pts_correction;
+    int video_sync;
+    float video_sync_max_audio_change;
     int autosync;
     int softsleep;
     int frame_dropping;
@@ -174,6 +187,7 @@ typedef struct MPOpts {
 
     struct image_writer_opts *screenshot_image_opts;
     char *screenshot_template;
+    int screenshot_threads;
 
     double force_fps;
     int index_mode; // -1=untouched  0=don't use index  1=use (generate) index
@@ -234,6 +248,7 @@ typedef struct MPOpts {
         char *skip_loop_filter_str;
         char *skip_idct_str;
         char *skip_frame_str;
+        int lowres;
         int threads;
         int bitexact;
         int check_hw_profile;
@@ -267,6 +282,7 @@ typedef struct MPOpts {
         int ar_rate;
         char *js_dev;
         char *in_file;
+        char *ipc_path;
         int use_joystick;
         int use_lirc;
         char *lirc_configfile;
@@ -276,6 +292,7 @@ typedef struct MPOpts {
         int use_media_keys;
         int default_bindings;
         int test;
+        int coalesce;
     } input;
 
     struct encode_output_conf {
@@ -297,9 +314,17 @@ typedef struct MPOpts {
         int neverdrop;
         int video_first;
         int audio_first;
+        int threads;
+        int parallel;
     } encode_output;
 } MPOpts;
 
+// Values for MPOpts.video_sync
+enum {
+    VS_AUDIO = 0,       // time video by the audio clock
+    VS_RESAMPLE,        // also resample audio so that it follows video
+};
+
 extern const m_option_t mp_opts[];
 extern const struct MPOpts mp_default_opts;
 
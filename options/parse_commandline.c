@@ -260,6 +260,35 @@ err_out:
     return ret;
 }
 
+// Return the global options set on the command line (the bstrs point into
+// argv), i.e. without filenames, --playlist and options between --{ and --}.
+// This is for starting mpv with the same options on other files.
+int m_config_get_cmdline_options(m_config_t *config, void *ta_parent,
+                                 int argc, char **argv,
+                                 struct playlist_param **out_params)
+{
+    int num_params = 0;
+    struct playlist_param *params = NULL;
+    bool local = false;
+
+    struct parse_state p = {config, argc, argv};
+    while (split_opt_silent(&p) == 0) {
+        if (!p.is_opt)
+            continue;
+        if (!bstrcmp0(p.arg, "{") || !bstrcmp0(p.arg, "}")) {
+            local = !bstrcmp0(p.arg, "{");
+            continue;
+        }
+        if (local || !bstrcmp0(p.arg, "playlist"))
+            continue;
+        MP_TARRAY_APPEND(ta_parent, params, num_params,
+                         (struct playlist_param) {p.arg, p.param});
+    }
+
+    *out_params = params;
+    return num_params;
+}
+
 /* Parse some command line options early before main parsing.
  * --no-config prevents reading configuration files (otherwise done before
  * command line parsing), and --really-quiet suppresses messages printed
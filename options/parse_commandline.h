@@ -22,12 +22,16 @@
 #include <stdbool.h>
 
 struct playlist;
+struct playlist_param;
 struct m_config;
 struct mpv_global;
 
 int m_config_parse_mp_command_line(m_config_t *config, struct playlist *files,
                                    struct mpv_global *global,
                                    int argc, char **argv);
+int m_config_get_cmdline_options(m_config_t *config, void *ta_parent,
+                                 int argc, char **argv,
+                                 struct playlist_param **out_params);
 void m_config_preparse_command_line(m_config_t *config, struct mpv_global *global,
                                     int argc, char **argv);
 
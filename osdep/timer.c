@@ -16,6 +16,7 @@
  */
 
 #include <stdlib.h>
+#include <time.h>
 
 #include "timer.h"
 
@@ -42,6 +43,16 @@ double mp_time_sec(void)
     return mp_time_us() / (double)(1000 * 1000);
 }
 
+int64_t mp_thread_cpu_time_us(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+#endif
+    return -1;
+}
+
 #if 0
 #include <stdio.h>
 
@@ -31,6 +31,10 @@ int64_t mp_time_us(void);
 // be much worse when casted to float.
 double mp_time_sec(void);
 
+// Return the CPU time used by the calling thread in microseconds, or -1 if
+// the OS doesn't provide it.
+int64_t mp_thread_cpu_time_us(void);
+
 // Provided by OS specific functions (timer-linux.c)
 void mp_raw_time_init(void);
 uint64_t mp_raw_time_us(void);
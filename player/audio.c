@@ -28,6 +28,8 @@
 #include "common/msg.h"
 #include "options/options.h"
 #include "common/common.h"
+#include "common/global.h"
+#include "common/trace.h"
 
 #include "audio/mixer.h"
 #include "audio/audio.h"
@@ -81,6 +83,21 @@ static int recreate_audio_filters(struct MPContext *mpctx)
         return -1;
     }
 
+    if (mpctx->opts->video_sync == VS_RESAMPLE) {
+        struct af_stream *afs = mpctx->d_audio->afilter;
+        double speed = mpctx->audio_speed_correction;
+        if (!af_control_any_rev(afs, AF_CONTROL_SET_PLAYBACK_SPEED_RESAMPLE,
+                                &speed))
+        {
+            MP_VERBOSE(mpctx, "Inserting resampler for A/V sync.\n");
+            char *args[] = {"detach", "no", NULL};
+            if (!(af_add(afs, "lavrresample", args) &&
+                  af_control_any_rev(afs, AF_CONTROL_SET_PLAYBACK_SPEED_RESAMPLE,
+                                     &speed)))
+                MP_ERR(mpctx, "Can't resample audio for A/V sync.\n");
+        }
+    }
+
     mixer_reinit_audio(mpctx->mixer, mpctx->ao, mpctx->d_audio->afilter);
 
     return 0;
@@ -101,6 +118,16 @@ int reinit_audio_filters(struct MPContext *mpctx)
     return 0;
 }
 
+// Set the audio speed factor for --video-sync=resample (see playloop.c).
+void set_audio_speed_correction(struct MPContext *mpctx, double speed)
+{
+    mpctx->audio_speed_correction = speed;
+    if (mpctx->d_audio && mpctx->d_audio->afilter) {
+        af_control_any_rev(mpctx->d_audio->afilter,
+                           AF_CONTROL_SET_PLAYBACK_SPEED_RESAMPLE, &speed);
+    }
+}
+
 void reinit_audio_chain(struct MPContext *mpctx)
 {
     struct MPOpts *opts = mpctx->opts;
@@ -121,6 +148,10 @@ void reinit_audio_chain(struct MPContext *mpctx)
         mpctx->d_audio->header = sh;
         if (!audio_init_best_codec(mpctx->d_audio, opts->audio_decoders))
             goto init_error;
+        if (!sh->audio->replaygain_data) {
+            sh->audio->replaygain_data =
+                mp_load_loudness_cache(mpctx, sh, sh->demuxer->filename);
+        }
     }
     assert(mpctx->d_audio);
 
@@ -228,7 +259,8 @@ double written_audio_pts(struct MPContext *mpctx)
 
     // Filters divide audio length by playback_speed, so multiply by it
     // to get the length in original units without speedup or slowdown
-    a_pts -= buffered_output * mpctx->opts->playback_speed;
+    a_pts -= buffered_output * mpctx->opts->playback_speed *
+             mpctx->audio_speed_correction;
 
     return a_pts + mpctx->video_offset;
 }
@@ -239,7 +271,8 @@ double playing_audio_pts(struct MPContext *mpctx)
     double pts = written_audio_pts(mpctx);
     if (pts == MP_NOPTS_VALUE)
         return pts;
-    return pts - mpctx->opts->playback_speed * ao_get_delay(mpctx->ao);
+    return pts - mpctx->opts->playback_speed * mpctx->audio_speed_correction *
+                 ao_get_delay(mpctx->ao);
 }
 
 static int write_to_ao(struct MPContext *mpctx, struct mp_audio *data, int flags,
@@ -249,7 +282,8 @@ static int write_to_ao(struct MPContext *mpctx, struct mp_audio *data, int flags
         return 0;
     struct ao *ao = mpctx->ao;
     ao->pts = pts;
-    double real_samplerate = ao->samplerate / mpctx->opts->playback_speed;
+    double real_samplerate = ao->samplerate /
+        (mpctx->opts->playback_speed * mpctx->audio_speed_correction);
     int played = ao_play(mpctx->ao, data->planes, data->samples, flags);
     assert(played <= data->samples);
     if (played > 0) {
@@ -359,7 +393,7 @@ static int audio_start_sync(struct MPContext *mpctx, int playsize)
     return audio_decode(d_audio, ao->buffer, playsize);
 }
 
-int fill_audio_out_buffers(struct MPContext *mpctx, double endpts)
+static int fill_audio_out_buffers_(struct MPContext *mpctx, double endpts)
 {
     struct MPOpts *opts = mpctx->opts;
     struct ao *ao = mpctx->ao;
@@ -455,6 +489,14 @@ int fill_audio_out_buffers(struct MPContext *mpctx, double endpts)
     return signal_eof ? -2 : -partial_fill;
 }
 
+int fill_audio_out_buffers(struct MPContext *mpctx, double endpts)
+{
+    struct mp_trace_start t = mp_trace_begin(mpctx->global->trace);
+    int r = fill_audio_out_buffers_(mpctx, endpts);
+    mp_trace_end(mpctx->global->trace, MP_TRACE_AUDIO_FILL, t);
+    return r;
+}
+
 // Drop data queued for output, or which the AO is currently outputting.
 void clear_audio_output_buffers(struct MPContext *mpctx)
 {
@@ -0,0 +1,380 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Collects per-file statistics while --benchmark is set, and writes them as
+ * JSON report on exit. The pipeline stage timings come from common/trace.c.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "config.h"
+
+#ifndef __MINGW32__
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/global.h"
+#include "common/msg.h"
+#include "common/trace.h"
+#include "options/options.h"
+#include "osdep/timer.h"
+#include "misc/json.h"
+#include "stream/stream.h"
+#include "demux/demux.h"
+#include "audio/decode/dec_audio.h"
+#include "audio/filter/af.h"
+#include "video/decode/dec_video.h"
+#include "video/filter/vf.h"
+
+#include "core.h"
+
+struct benchmark_filter {
+    char *name;
+    double time;
+    int64_t frames, pixels;     // video
+    int64_t calls, samples;     // audio
+    int64_t allocs;             // audio: output buffer (re)allocations
+};
+
+struct benchmark_file {
+    char *filename;
+    double wall_time;
+    int64_t vframes_decoded, vframes_filtered, vframes_dropped;
+    int64_t vframes_shown, aframes_shown;
+    int64_t bytes_read;
+    int64_t cache_hits, cache_misses;
+    bool has_cache;
+    int64_t thumbnails;
+    double thumbnail_time;
+    struct benchmark_filter *filters;
+    int num_filters;
+    struct benchmark_filter *afilters;
+    int num_afilters;
+};
+
+struct benchmark_ctx {
+    double start_time;
+    // State at the start of the current file
+    double file_start_time;
+    int64_t vframes_decoded, vframes_filtered, vframes_dropped;
+    int64_t thumbnails;
+    double thumbnail_time;
+
+    struct benchmark_file *files;
+    int num_files;
+};
+
+void benchmark_init(struct MPContext *mpctx)
+{
+    struct benchmark_ctx *ctx = talloc_zero(mpctx, struct benchmark_ctx);
+    ctx->start_time = mp_time_sec();
+    mpctx->benchmark_ctx = ctx;
+}
+
+void benchmark_start_file(struct MPContext *mpctx)
+{
+    struct benchmark_ctx *ctx = mpctx->benchmark_ctx;
+    if (!ctx)
+        return;
+    ctx->file_start_time = mp_time_sec();
+    ctx->vframes_decoded = mpctx->decoded_vframes;
+    ctx->vframes_filtered = mpctx->filtered_vframes;
+    ctx->vframes_dropped = mpctx->dropped_vframes;
+    ctx->thumbnails = mpctx->thumbnails;
+    ctx->thumbnail_time = mpctx->thumbnail_time;
+}
+
+static void add_stream_stats(struct benchmark_file *f, struct stream *s)
+{
+    f->bytes_read += s->bytes_read;
+    struct stream_cache_stats stats;
+    if (stream_control(s, STREAM_CTRL_GET_CACHE_STATS, &stats) == STREAM_OK) {
+        f->cache_hits += stats.hits;
+        f->cache_misses += stats.misses;
+        f->has_cache = true;
+    }
+}
+
+// Only the filters of the current chain are reported; the chain is recreated
+// on reconfiguration (e.g. format changes).
+static void add_filter_stats(struct benchmark_file *f, void *talloc_ctx,
+                             struct vf_chain *c)
+{
+    for (struct vf_instance *vf = c ? c->first : NULL; vf; vf = vf->next) {
+        // Skip the "in" and "out" pseudo-filters
+        if (!vf->filter && !vf->filter_ext)
+            continue;
+        struct benchmark_filter bf = {
+            .name = talloc_strdup(talloc_ctx, vf->info->name),
+            .time = vf->stats_time,
+            .frames = vf->stats_frames,
+            .pixels = vf->stats_pixels,
+        };
+        MP_TARRAY_APPEND(talloc_ctx, f->filters, f->num_filters, bf);
+    }
+}
+
+static void add_afilter_stats(struct benchmark_file *f, void *talloc_ctx,
+                              struct af_stream *s)
+{
+    for (struct af_instance *af = s ? s->first : NULL; af; af = af->next) {
+        // Skip the "in" and "out" pseudo-filters
+        if (af == s->first || af == s->last)
+            continue;
+        struct benchmark_filter bf = {
+            .name = talloc_strdup(talloc_ctx, af->info->name),
+            .time = af->stats_time,
+            .calls = af->stats_calls,
+            .samples = af->stats_samples,
+            .allocs = af->stats_allocs,
+        };
+        MP_TARRAY_APPEND(talloc_ctx, f->afilters, f->num_afilters, bf);
+    }
+}
+
+// Must be called before the demuxers and streams are destroyed.
+void benchmark_end_file(struct MPContext *mpctx)
+{
+    struct benchmark_ctx *ctx = mpctx->benchmark_ctx;
+    if (!ctx || !mpctx->filename)
+        return;
+
+    struct benchmark_file f = {
+        .filename = talloc_strdup(ctx, mpctx->filename),
+        .wall_time = mp_time_sec() - ctx->file_start_time,
+        .vframes_decoded = mpctx->decoded_vframes - ctx->vframes_decoded,
+        .vframes_filtered = mpctx->filtered_vframes - ctx->vframes_filtered,
+        .vframes_dropped = mpctx->dropped_vframes - ctx->vframes_dropped,
+        .vframes_shown = mpctx->shown_vframes,
+        .aframes_shown = mpctx->shown_aframes,
+        .thumbnails = mpctx->thumbnails - ctx->thumbnails,
+        .thumbnail_time = mpctx->thumbnail_time - ctx->thumbnail_time,
+    };
+
+    // Several demuxers can share a stream (e.g. ordered chapters).
+    struct stream **seen = NULL;
+    int num_seen = 0;
+    for (int n = 0; n < mpctx->num_sources; n++) {
+        struct stream *s = mpctx->sources[n]->stream;
+        bool dup = false;
+        for (int i = 0; i < num_seen; i++)
+            dup |= seen[i] == s;
+        if (s && !dup) {
+            add_stream_stats(&f, s);
+            MP_TARRAY_APPEND(NULL, seen, num_seen, s);
+        }
+    }
+    talloc_free(seen);
+
+    if (mpctx->d_video)
+        add_filter_stats(&f, ctx, mpctx->d_video->vfilter);
+    if (mpctx->d_audio)
+        add_afilter_stats(&f, ctx, mpctx->d_audio->afilter);
+
+    MP_TARRAY_APPEND(ctx, ctx->files, ctx->num_files, f);
+}
+
+static void write_cache_stats(char **s, int64_t hits, int64_t misses)
+{
+    int64_t total = hits + misses;
+    *s = talloc_asprintf_append_buffer(*s, ",\"cache_hits\":%"PRId64
+                                       ",\"cache_misses\":%"PRId64
+                                       ",\"cache_hit_rate\":", hits, misses);
+    if (total) {
+        *s = talloc_asprintf_append_buffer(*s, "%f", hits / (double)total);
+    } else {
+        *s = talloc_strdup_append_buffer(*s, "null");
+    }
+}
+
+// Append the time per unit in microseconds, or null.
+static void write_time_per(char **s, double time, int64_t count)
+{
+    if (count > 0) {
+        *s = talloc_asprintf_append_buffer(*s, "%f", time / count * 1e6);
+    } else {
+        *s = talloc_strdup_append_buffer(*s, "null");
+    }
+}
+
+static void write_file(char **s, struct benchmark_file *f)
+{
+    *s = talloc_strdup_append_buffer(*s, "{\"filename\":");
+    json_write_string(s, f->filename);
+    *s = talloc_asprintf_append_buffer(*s,
+        ",\"wall_time\":%f"
+        ",\"video_frames_decoded\":%"PRId64
+        ",\"video_frames_filtered\":%"PRId64
+        ",\"video_frames_dropped\":%"PRId64
+        ",\"video_frames_shown\":%"PRId64
+        ",\"audio_samples_played\":%"PRId64
+        ",\"demux_bytes_read\":%"PRId64,
+        f->wall_time, f->vframes_decoded, f->vframes_filtered,
+        f->vframes_dropped, f->vframes_shown, f->aframes_shown, f->bytes_read);
+    if (f->has_cache)
+        write_cache_stats(s, f->cache_hits, f->cache_misses);
+    if (f->thumbnails) {
+        *s = talloc_asprintf_append_buffer(*s,
+            ",\"thumbnails\":%"PRId64",\"thumbnails_per_sec\":", f->thumbnails);
+        if (f->thumbnail_time > 0) {
+            *s = talloc_asprintf_append_buffer(*s, "%f",
+                                               f->thumbnails / f->thumbnail_time);
+        } else {
+            *s = talloc_strdup_append_buffer(*s, "null");
+        }
+    }
+    *s = talloc_strdup_append_buffer(*s, ",\"video_filters\":[");
+    for (int n = 0; n < f->num_filters; n++) {
+        struct benchmark_filter *bf = &f->filters[n];
+        if (n)
+            *s = talloc_strdup_append_buffer(*s, ",");
+        *s = talloc_strdup_append_buffer(*s, "{\"name\":");
+        json_write_string(s, bf->name);
+        *s = talloc_asprintf_append_buffer(*s,
+            ",\"frames\":%"PRId64",\"pixels\":%"PRId64",\"time\":%f"
+            ",\"mpix_per_sec\":", bf->frames, bf->pixels, bf->time);
+        if (bf->time > 0) {
+            *s = talloc_asprintf_append_buffer(*s, "%f",
+                                               bf->pixels / bf->time / 1e6);
+        } else {
+            *s = talloc_strdup_append_buffer(*s, "null");
+        }
+        *s = talloc_strdup_append_buffer(*s, ",\"us_per_frame\":");
+        write_time_per(s, bf->time, bf->frames);
+        *s = talloc_strdup_append_buffer(*s, "}");
+    }
+    *s = talloc_strdup_append_buffer(*s, "],\"audio_filters\":[");
+    for (int n = 0; n < f->num_afilters; n++) {
+        struct benchmark_filter *bf = &f->afilters[n];
+        if (n)
+            *s = talloc_strdup_append_buffer(*s, ",");
+        *s = talloc_strdup_append_buffer(*s, "{\"name\":");
+        json_write_string(s, bf->name);
+        *s = talloc_asprintf_append_buffer(*s,
+            ",\"calls\":%"PRId64",\"samples\":%"PRId64",\"allocs\":%"PRId64
+            ",\"time\":%f,\"us_per_call\":", bf->calls, bf->samples,
+            bf->allocs, bf->time);
+        write_time_per(s, bf->time, bf->calls);
+        *s = talloc_strdup_append_buffer(*s, "}");
+    }
+    *s = talloc_strdup_append_buffer(*s, "]}");
+}
+
+static char *create_report(struct MPContext *mpctx, void *talloc_ctx)
+{
+    struct benchmark_ctx *ctx = mpctx->benchmark_ctx;
+    char *s = talloc_asprintf(talloc_ctx, "{\"version\":1,\"wall_time\":%f",
+                              mp_time_sec() - ctx->start_time);
+
+#ifndef __MINGW32__
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        s = talloc_asprintf_append_buffer(s,
+            ",\"cpu_time\":{\"user\":%f,\"system\":%f}",
+            ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6,
+            ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6);
+#ifdef __APPLE__
+        int64_t peak = ru.ru_maxrss;          // bytes
+#else
+        int64_t peak = ru.ru_maxrss * 1024LL; // kilobytes
+#endif
+        s = talloc_asprintf_append_buffer(s, ",\"peak_memory\":%"PRId64, peak);
+    }
+#endif
+
+    struct benchmark_file total = {0};
+    s = talloc_strdup_append_buffer(s, ",\"files\":[");
+    for (int n = 0; n < ctx->num_files; n++) {
+        struct benchmark_file *f = &ctx->files[n];
+        if (n)
+            s = talloc_strdup_append_buffer(s, ",");
+        write_file(&s, f);
+        total.vframes_decoded += f->vframes_decoded;
+        total.vframes_filtered += f->vframes_filtered;
+        total.vframes_dropped += f->vframes_dropped;
+        total.vframes_shown += f->vframes_shown;
+        total.aframes_shown += f->aframes_shown;
+        total.bytes_read += f->bytes_read;
+        total.cache_hits += f->cache_hits;
+        total.cache_misses += f->cache_misses;
+        total.has_cache |= f->has_cache;
+    }
+    s = talloc_asprintf_append_buffer(s,
+        "],\"totals\":{"
+        "\"video_frames_decoded\":%"PRId64
+        ",\"video_frames_filtered\":%"PRId64
+        ",\"video_frames_dropped\":%"PRId64
+        ",\"video_frames_shown\":%"PRId64
+        ",\"audio_samples_played\":%"PRId64
+        ",\"demux_bytes_read\":%"PRId64,
+        total.vframes_decoded, total.vframes_filtered, total.vframes_dropped,
+        total.vframes_shown, total.aframes_shown, total.bytes_read);
+    if (total.has_cache)
+        write_cache_stats(&s, total.cache_hits, total.cache_misses);
+
+    s = talloc_strdup_append_buffer(s, "},\"stages\":{");
+    bool first = true;
+    for (int id = 0; id < MP_TRACE_ID_COUNT; id++) {
+        struct mp_trace_stats st;
+        if (!mp_trace_get_stats(mpctx->global->trace, id, &st))
+            continue;
+        if (!first)
+            s = talloc_strdup_append_buffer(s, ",");
+        first = false;
+        json_write_string(&s, mp_trace_id_name(id));
+        s = talloc_asprintf_append_buffer(s,
+            ":{\"clock\":\"%s\",\"calls\":%"PRId64",\"total\":%f"
+            ",\"p50\":%f,\"p90\":%f,\"p99\":%f,\"max\":%f}",
+            st.cpu_time ? "thread_cpu" : "wall",
+            st.calls, st.total, st.p50, st.p90, st.p99, st.max);
+    }
+    s = talloc_strdup_append_buffer(s, "}}\n");
+    return s;
+}
+
+void benchmark_write_report(struct MPContext *mpctx)
+{
+    struct benchmark_ctx *ctx = mpctx->benchmark_ctx;
+    if (!ctx)
+        return;
+
+    void *tmp = talloc_new(NULL);
+    char *report = create_report(mpctx, tmp);
+    const char *filename = mpctx->opts->benchmark_file;
+
+    bool ok = false;
+    if (strcmp(filename, "-") == 0) {
+        ok = fputs(report, stdout) >= 0 && fflush(stdout) == 0;
+    } else {
+        FILE *f = fopen(filename, "w");
+        if (f) {
+            ok = fputs(report, f) >= 0;
+            if (fclose(f) != 0)
+                ok = false;
+        }
+    }
+    if (!ok)
+        MP_ERR(mpctx, "Could not write benchmark report to '%s'.\n", filename);
+
+    talloc_free(tmp);
+}
@@ -17,6 +17,7 @@
  */
 
 #include <stdlib.h>
+#include <math.h>
 #include <inttypes.h>
 #include <unistd.h>
 #include <string.h>
@@ -40,6 +41,8 @@
 #include "stream/resolve/resolve.h"
 #include "common/playlist.h"
 #include "common/playlist_parser.h"
+#include "common/global.h"
+#include "common/trace.h"
 #include "sub/osd.h"
 #include "sub/dec_sub.h"
 #include "options/m_option.h"
@@ -74,6 +77,11 @@
 #include "core.h"
 #include "lua.h"
 
+#if HAVE_POSIX_SELECT
+#include "input/ipc.h"
+#include "misc/json.h"
+#endif
+
 struct command_ctx {
     int events;
 
@@ -85,6 +93,12 @@ struct command_ctx {
 
 #define OVERLAY_MAX_ID 64
     void *overlay_map[OVERLAY_MAX_ID];
+
+    struct ipc_observer *ipc_observers;
+    int num_ipc_observers;
+    double ipc_last_poll;   // mp_time_sec() of the last full observer poll
+    struct ipc_log *ipc_logs;
+    int num_ipc_logs;
 };
 
 static int edit_filters(struct MPContext *mpctx, enum stream_type mediatype,
@@ -345,6 +359,15 @@ static int mp_property_avsync(m_option_t *prop, int action, void *arg,
     return m_property_double_ro(prop, action, arg, mpctx->last_av_difference);
 }
 
+static int mp_property_audio_speed_correction(m_option_t *prop, int action,
+                                              void *arg, MPContext *mpctx)
+{
+    if (!mpctx->d_audio)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_double_ro(prop, action, arg,
+                                mpctx->audio_speed_correction);
+}
+
 /// Current position in percent (RW)
 static int mp_property_percent_pos(m_option_t *prop, int action,
                                    void *arg, MPContext *mpctx)
@@ -789,6 +812,79 @@ static int mp_property_cache(m_option_t *prop, int action, void *arg,
     return m_property_int_ro(prop, action, arg, cache);
 }
 
+static int mp_property_input_coalesced(m_option_t *prop, int action, void *arg,
+                                       MPContext *mpctx)
+{
+    return m_property_int_ro(prop, action, arg,
+                             mp_input_get_coalesced_count(mpctx->input));
+}
+
+/// Rolling percentiles of the per-frame stage durations (RO)
+/// "timing/<stage>/<p50|p90|p99|max>" returns a single value in milliseconds.
+static int mp_property_timing(m_option_t *prop, int action, void *arg,
+                              MPContext *mpctx)
+{
+    struct mp_trace *trace = mpctx->global->trace;
+    if (!trace)
+        return M_PROPERTY_UNAVAILABLE;
+
+    switch (action) {
+    case M_PROPERTY_GET:
+    case M_PROPERTY_PRINT: {
+        char *res = NULL;
+        for (int n = 0; n < MP_TRACE_ID_COUNT; n++) {
+            struct mp_trace_stats st;
+            if (!mp_trace_get_stats(trace, n, &st))
+                continue;
+            res = talloc_asprintf_append_buffer(res,
+                "%s: p50 %.3f p90 %.3f p99 %.3f max %.3f ms (%s)\n",
+                mp_trace_id_name(n), st.p50 * 1e3, st.p90 * 1e3,
+                st.p99 * 1e3, st.max * 1e3,
+                st.cpu_time ? "thread CPU time" : "wall time");
+        }
+        *(char **)arg = res;
+        return res ? M_PROPERTY_OK : M_PROPERTY_UNAVAILABLE;
+    }
+    case M_PROPERTY_KEY_ACTION: {
+        struct m_property_action_arg *ka = arg;
+        bstr stage, stat;
+        bstr_split_tok(bstr0(ka->key), "/", &stage, &stat);
+        char *name = bstrdup0(NULL, stage);
+        int id = mp_trace_find_id(name);
+        talloc_free(name);
+        if (id < 0)
+            return M_PROPERTY_UNKNOWN;
+        struct mp_trace_stats st;
+        bool ok = mp_trace_get_stats(trace, id, &st);
+        double val;
+        if (bstr_equals0(stat, "p50")) {
+            val = st.p50;
+        } else if (bstr_equals0(stat, "p90")) {
+            val = st.p90;
+        } else if (bstr_equals0(stat, "p99")) {
+            val = st.p99;
+        } else if (bstr_equals0(stat, "max")) {
+            val = st.max;
+        } else {
+            return M_PROPERTY_UNKNOWN;
+        }
+        switch (ka->action) {
+        case M_PROPERTY_GET:
+            if (!ok)
+                return M_PROPERTY_UNAVAILABLE;
+            *(double *)ka->arg = val * 1e3;
+            return M_PROPERTY_OK;
+        case M_PROPERTY_GET_TYPE:
+            *(struct m_option *)ka->arg = (struct m_option){
+                .type = CONF_TYPE_DOUBLE,
+            };
+            return M_PROPERTY_OK;
+        }
+    }
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
 static int mp_property_clock(m_option_t *prop, int action, void *arg,
                              MPContext *mpctx)
 {
@@ -1920,6 +2016,8 @@ static const m_option_t mp_properties[] = {
     { "length", mp_property_length, CONF_TYPE_TIME,
       M_OPT_MIN, 0, 0, NULL },
     { "avsync", mp_property_avsync, CONF_TYPE_DOUBLE },
+    { "audio-speed-correction", mp_property_audio_speed_correction,
+      CONF_TYPE_DOUBLE },
     { "percent-pos", mp_property_percent_pos, CONF_TYPE_DOUBLE,
       M_OPT_RANGE, 0, 100, NULL },
     { "time-pos", mp_property_time_pos, CONF_TYPE_TIME,
@@ -1944,6 +2042,8 @@ static const m_option_t mp_properties[] = {
     M_OPTION_PROPERTY("hr-seek"),
     { "clock", mp_property_clock, CONF_TYPE_STRING,
       0, 0, 0, NULL },
+    { "input-coalesced", mp_property_input_coalesced, CONF_TYPE_INT },
+    { "timing", mp_property_timing, CONF_TYPE_STRING },
 
     { "chapter-list", mp_property_list_chapters, CONF_TYPE_STRING },
     { "track-list", property_list_tracks, CONF_TYPE_STRING },
@@ -2068,7 +2168,11 @@ const struct m_option *mp_get_property_list(void)
 int mp_property_do(const char *name, int action, void *val,
                    struct MPContext *ctx)
 {
-    return m_property_do(ctx->log, mp_properties, name, action, val, ctx);
+    int r = m_property_do(ctx->log, mp_properties, name, action, val, ctx);
+    if (r > 0 && (action == M_PROPERTY_SET || action == M_PROPERTY_SET_STRING ||
+                  action == M_PROPERTY_SWITCH))
+        mp_notify_property(ctx, name);
+    return r;
 }
 
 char *mp_property_expand_string(struct MPContext *mpctx, const char *str)
@@ -2456,6 +2560,380 @@ static void overlay_uninit(struct MPContext *mpctx){}
 
 #endif
 
+#if HAVE_POSIX_SELECT
+
+struct ipc_observer {
+    int client;
+    double id;
+    char *name;
+    char *last;     // last value sent (JSON text), NULL if none sent yet
+    bool dirty;     // value might have changed, re-read on the next update
+};
+
+// Properties that change with playback progress, without notification.
+// Observers of these are updated on every playback tick.
+static const char *const ipc_tick_properties[] = {
+    "time-pos", "time-remaining", "percent-pos", "ratio-pos", "chapter",
+    "stream-pos", "stream-time-pos", "avsync", "audio-speed-correction",
+    "cache", NULL
+};
+
+// Properties that only change through commands, or are notified with
+// mp_notify_property() wherever the player changes them. All other properties
+// can change internally (volume from the AO, fullscreen from the window
+// manager, metadata from the demuxer, ...), so their observers are polled
+// every IPC_POLL_INTERVAL seconds.
+static const char *const ipc_notified_properties[] = {
+    "pause", "vid", "aid", "sid", NULL
+};
+
+#define IPC_POLL_INTERVAL 0.1
+
+static bool ipc_name_in_list(const char *name, const char *const *list)
+{
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(name, list[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Mark observers of the given property (or all observers if name is NULL) as
+// needing an update.
+static void ipc_mark_dirty(struct command_ctx *ctx, const char *name)
+{
+    for (int n = 0; n < ctx->num_ipc_observers; n++) {
+        struct ipc_observer *obs = &ctx->ipc_observers[n];
+        if (!name || strcmp(obs->name, name) == 0)
+            obs->dirty = true;
+    }
+}
+
+static void ipc_mark_tick_dirty(struct command_ctx *ctx)
+{
+    double now = mp_time_sec();
+    bool poll = now - ctx->ipc_last_poll >= IPC_POLL_INTERVAL;
+    if (poll)
+        ctx->ipc_last_poll = now;
+    for (int n = 0; n < ctx->num_ipc_observers; n++) {
+        struct ipc_observer *obs = &ctx->ipc_observers[n];
+        if (ipc_name_in_list(obs->name, ipc_tick_properties) ||
+            (poll && !ipc_name_in_list(obs->name, ipc_notified_properties)))
+            obs->dirty = true;
+    }
+}
+
+// A client that requested log messages.
+struct ipc_log {
+    int client;
+    struct mp_log_buffer *buffer;
+};
+
+static const char *ipc_error_string(int r)
+{
+    switch (r) {
+    case M_PROPERTY_OK:                 return "success";
+    case M_PROPERTY_UNAVAILABLE:        return "property unavailable";
+    case M_PROPERTY_NOT_IMPLEMENTED:    return "unsupported";
+    case M_PROPERTY_UNKNOWN:            return "property not found";
+    default:                            return "error";
+    }
+}
+
+// Return the value of the property as JSON text. Numeric and flag properties
+// are returned as numbers and booleans, everything else as string.
+static int property_to_json(struct MPContext *mpctx, void *ta_parent,
+                            const char *name, bool as_string, char **out)
+{
+    struct m_option opt = {0};
+    int r = mp_property_do(name, M_PROPERTY_GET_TYPE, &opt, mpctx);
+    if (r <= 0)
+        return r;
+    const struct m_option_type *t = opt.type;
+    struct json_node node = { .type = JSON_NUMBER };
+    if (!as_string && (t == &m_option_type_flag || t == &m_option_type_int ||
+                       t == &m_option_type_int64 || t == &m_option_type_float ||
+                       t == &m_option_type_double || t == &m_option_type_time))
+    {
+        union { int i; int64_t i64; float f; double d; } v = {0};
+        r = mp_property_do(name, M_PROPERTY_GET, &v, mpctx);
+        if (r <= 0)
+            return r;
+        if (t == &m_option_type_flag) {
+            node = (struct json_node){ .type = JSON_BOOL, .u.b = v.i };
+        } else if (t == &m_option_type_int) {
+            node.u.d = v.i;
+        } else if (t == &m_option_type_int64) {
+            node.u.d = v.i64;
+        } else if (t == &m_option_type_float) {
+            node.u.d = v.f;
+        } else {
+            node.u.d = v.d;
+        }
+        *out = NULL;
+        json_write(out, &node);
+    } else {
+        char *str = NULL;
+        r = mp_property_do(name, M_PROPERTY_GET_STRING, &str, mpctx);
+        if (r <= 0)
+            return r;
+        *out = NULL;
+        json_write_string(out, str ? str : "");
+        talloc_free(str);
+    }
+    talloc_steal(ta_parent, *out);
+    return M_PROPERTY_OK;
+}
+
+// Convert a JSON argument to the string syntax used by commands and options.
+static char *json_arg_to_string(void *ta_parent, struct json_node *node)
+{
+    switch (node->type) {
+    case JSON_STRING:   return talloc_strdup(ta_parent, node->u.s);
+    case JSON_BOOL:     return talloc_strdup(ta_parent, node->u.b ? "yes" : "no");
+    case JSON_NUMBER:   return talloc_asprintf(ta_parent, "%.17g", node->u.d);
+    default:            return NULL;
+    }
+}
+
+static void ipc_unobserve(struct command_ctx *ctx, int client, double id)
+{
+    for (int n = ctx->num_ipc_observers - 1; n >= 0; n--) {
+        struct ipc_observer *obs = &ctx->ipc_observers[n];
+        if (obs->client == client && (isnan(id) || obs->id == id)) {
+            talloc_free(obs->name);
+            talloc_free(obs->last);
+            MP_TARRAY_REMOVE_AT(ctx->ipc_observers, ctx->num_ipc_observers, n);
+        }
+    }
+}
+
+static void ipc_drop_log(struct command_ctx *ctx, int client)
+{
+    for (int n = ctx->num_ipc_logs - 1; n >= 0; n--) {
+        if (ctx->ipc_logs[n].client == client) {
+            mp_msg_log_buffer_destroy(ctx->ipc_logs[n].buffer);
+            MP_TARRAY_REMOVE_AT(ctx->ipc_logs, ctx->num_ipc_logs, n);
+        }
+    }
+}
+
+// Forget all state associated with a client that went away.
+static void ipc_drop_client(struct command_ctx *ctx, int client)
+{
+    ipc_unobserve(ctx, client, NAN);
+    ipc_drop_log(ctx, client);
+}
+
+static void ipc_log_wakeup(void *p)
+{
+    struct MPContext *mpctx = p;
+    mp_input_wakeup_nolock(mpctx->input);
+}
+
+// Run a single request, and append the reply to *reply.
+static void handle_ipc_request(struct MPContext *mpctx, int client,
+                               struct json_node *req, char **reply)
+{
+    struct command_ctx *ctx = mpctx->command_ctx;
+    void *tmp = talloc_new(NULL);
+    const char *error = "invalid parameter";
+    char *data = NULL;
+
+    struct json_node *cmd = json_find_key(req, "command");
+    if (!cmd || cmd->type != JSON_ARRAY || cmd->u.list->num < 1)
+        goto done;
+    int num_args = cmd->u.list->num;
+    if (num_args > MP_CMD_MAX_ARGS)
+        goto done;
+    // NULL-terminated (the last entry is never set)
+    char *args[MP_CMD_MAX_ARGS + 1] = {0};
+    for (int n = 0; n < num_args; n++) {
+        args[n] = json_arg_to_string(tmp, &cmd->u.list->values[n]);
+        if (!args[n])
+            goto done;
+    }
+    const char *name = args[0];
+
+    if (strcmp(name, "get_property") == 0 ||
+        strcmp(name, "get_property_string") == 0)
+    {
+        if (num_args != 2)
+            goto done;
+        bool as_string = strcmp(name, "get_property_string") == 0;
+        int r = property_to_json(mpctx, tmp, args[1], as_string, &data);
+        error = ipc_error_string(r);
+    } else if (strcmp(name, "set_property") == 0 ||
+               strcmp(name, "set_property_string") == 0)
+    {
+        if (num_args != 3)
+            goto done;
+        int r = mp_property_do(args[1], M_PROPERTY_SET_STRING, args[2], mpctx);
+        error = ipc_error_string(r);
+    } else if (strcmp(name, "observe_property") == 0) {
+        if (num_args != 3 || cmd->u.list->values[1].type != JSON_NUMBER)
+            goto done;
+        double id = cmd->u.list->values[1].u.d;
+        struct ipc_observer obs = {
+            .client = client,
+            .id = id,
+            .name = talloc_strdup(ctx, args[2]),
+            .dirty = true,
+        };
+        MP_TARRAY_APPEND(ctx, ctx->ipc_observers, ctx->num_ipc_observers, obs);
+        error = "success";
+    } else if (strcmp(name, "unobserve_property") == 0) {
+        if (num_args != 2 || cmd->u.list->values[1].type != JSON_NUMBER)
+            goto done;
+        ipc_unobserve(ctx, client, cmd->u.list->values[1].u.d);
+        error = "success";
+    } else if (strcmp(name, "request_log_messages") == 0) {
+        if (num_args != 2)
+            goto done;
+        int level = mp_msg_find_level(args[1]);
+        if (level < 0 && strcmp(args[1], "no") != 0)
+            goto done;
+        ipc_drop_log(ctx, client);
+        if (level >= 0) {
+            struct ipc_log log = {
+                .client = client,
+                .buffer = mp_msg_log_buffer_new(mpctx->global, 1000, level,
+                                                ipc_log_wakeup, mpctx),
+            };
+            MP_TARRAY_APPEND(ctx, ctx->ipc_logs, ctx->num_ipc_logs, log);
+        }
+        error = "success";
+    } else {
+        // Everything else is an input command, like in input.conf.
+        struct mp_cmd *mpcmd = mp_input_parse_cmd_strv(mpctx->log, 0,
+                                                       (const char **)args,
+                                                       "<ipc>");
+        if (!mpcmd)
+            goto done;
+        run_command(mpctx, mpcmd);
+        mp_cmd_free(mpcmd);
+        error = "success";
+    }
+
+done:
+    if (*reply)
+        *reply = talloc_strdup_append_buffer(*reply, "\n");
+    *reply = talloc_strdup_append_buffer(*reply, "{");
+    if (data)
+        *reply = talloc_asprintf_append_buffer(*reply, "\"data\":%s,", data);
+    struct json_node *id = json_find_key(req, "request_id");
+    if (id) {
+        *reply = talloc_strdup_append_buffer(*reply, "\"request_id\":");
+        json_write(reply, id);
+        *reply = talloc_strdup_append_buffer(*reply, ",");
+    }
+    *reply = talloc_strdup_append_buffer(*reply, "\"error\":");
+    json_write_string(reply, error);
+    *reply = talloc_strdup_append_buffer(*reply, "}");
+    talloc_free(tmp);
+}
+
+static void handle_ipc_requests(struct MPContext *mpctx,
+                                struct mp_ipc_batch *batch)
+{
+    // All replies to a batch are sent at once.
+    char *reply = NULL;
+    for (int n = 0; n < batch->num_requests; n++)
+        handle_ipc_request(mpctx, batch->client, &batch->requests[n], &reply);
+    if (reply && !mp_ipc_send(mpctx->ipc_ctx, batch->client, reply))
+        ipc_drop_client(mpctx->command_ctx, batch->client);
+    talloc_free(reply);
+}
+
+// Send change events for observed properties, and send player events.
+static void update_ipc(struct MPContext *mpctx, const char *event)
+{
+    struct command_ctx *ctx = mpctx->command_ctx;
+    if (!mpctx->ipc_ctx)
+        return;
+
+    if (event) {
+        char *line = talloc_strdup(NULL, "{\"event\":");
+        json_write_string(&line, event);
+        line = talloc_strdup_append_buffer(line, "}");
+        mp_ipc_broadcast(mpctx->ipc_ctx, line);
+        talloc_free(line);
+        return;
+    }
+
+    for (int n = ctx->num_ipc_observers - 1; n >= 0; n--) {
+        struct ipc_observer *obs = &ctx->ipc_observers[n];
+        if (!obs->dirty)
+            continue;
+        obs->dirty = false;
+        char *val = NULL;
+        if (property_to_json(mpctx, NULL, obs->name, false, &val) <= 0)
+            val = talloc_strdup(NULL, "null");
+        if (obs->last && strcmp(obs->last, val) == 0) {
+            talloc_free(val);
+            continue;
+        }
+        talloc_free(obs->last);
+        obs->last = talloc_steal(ctx, val);
+        char *line = talloc_asprintf(NULL,
+            "{\"event\":\"property-change\",\"id\":%.17g,\"name\":",
+            obs->id);
+        json_write_string(&line, obs->name);
+        line = talloc_asprintf_append_buffer(line, ",\"data\":%s}", val);
+        bool ok = mp_ipc_send(mpctx->ipc_ctx, obs->client, line);
+        talloc_free(line);
+        if (!ok)
+            ipc_drop_client(ctx, obs->client);
+        // ipc_drop_client() can remove multiple entries
+        n = MPMIN(n, ctx->num_ipc_observers);
+    }
+
+    for (int n = ctx->num_ipc_logs - 1; n >= 0; n--) {
+        struct ipc_log *log = &ctx->ipc_logs[n];
+        char *lines = NULL;
+        struct mp_log_buffer_entry *entry;
+        while ((entry = mp_msg_log_buffer_read(log->buffer))) {
+            if (lines)
+                lines = talloc_strdup_append_buffer(lines, "\n");
+            lines = talloc_strdup_append_buffer(lines,
+                                    "{\"event\":\"log-message\",\"prefix\":");
+            json_write_string(&lines, entry->prefix);
+            lines = talloc_strdup_append_buffer(lines, ",\"level\":");
+            json_write_string(&lines, mp_msg_level_name(entry->level));
+            lines = talloc_asprintf_append_buffer(lines, ",\"time\":%.6f,"
+                                                  "\"text\":",
+                                                  entry->time / 1e6);
+            json_write_string(&lines, entry->text);
+            lines = talloc_strdup_append_buffer(lines, "}");
+            talloc_free(entry);
+        }
+        bool ok = !lines || mp_ipc_send(mpctx->ipc_ctx, log->client, lines);
+        talloc_free(lines);
+        if (!ok)
+            ipc_drop_client(ctx, log->client);
+        n = MPMIN(n, ctx->num_ipc_logs);
+    }
+
+    mp_ipc_flush(mpctx->ipc_ctx);
+}
+
+static void ipc_uninit(struct MPContext *mpctx)
+{
+    struct command_ctx *ctx = mpctx->command_ctx;
+    for (int n = 0; n < ctx->num_ipc_logs; n++)
+        mp_msg_log_buffer_destroy(ctx->ipc_logs[n].buffer);
+    ctx->num_ipc_logs = 0;
+}
+
+#else
+
+static void update_ipc(struct MPContext *mpctx, const char *event){}
+static void ipc_mark_dirty(struct command_ctx *ctx, const char *name){}
+static void ipc_mark_tick_dirty(struct command_ctx *ctx){}
+static void ipc_uninit(struct MPContext *mpctx){}
+
+#endif
+
 struct cycle_counter {
     char **args;
     int counter;
@@ -3061,6 +3539,17 @@ void run_command(MPContext *mpctx, mp_cmd_t *cmd)
         screenshot_to_file(mpctx, cmd->args[0].v.s, cmd->args[1].v.i, msg_osd);
         break;
 
+    case MP_CMD_WRITE_TRACE: {
+        char *filename = mp_get_user_path(NULL, mpctx->global, cmd->args[0].v.s);
+        if (mp_trace_write_json(mpctx->global->trace, filename)) {
+            MP_INFO(mpctx, "Timing trace written to '%s'.\n", filename);
+        } else {
+            MP_ERR(mpctx, "Writing timing trace to '%s' failed.\n", filename);
+        }
+        talloc_free(filename);
+        break;
+    }
+
     case MP_CMD_RUN: {
 #ifndef __MINGW32__
         mp_msg_flush_status_line(mpctx->global);
@@ -3117,6 +3606,19 @@ void run_command(MPContext *mpctx, mp_cmd_t *cmd)
                          cmd->args[1].v.s, msg_osd);
         break;
 
+    case MP_CMD_AF_CMDLINE:
+        if (mpctx->d_audio) {
+            char *name = cmd->args[0].v.s, *s = cmd->args[1].v.s;
+            MP_INFO(mpctx, "Setting %s cmd line to '%s'.\n", name, s);
+            if (af_send_command_line(mpctx->d_audio->afilter, name, s) > 0) {
+                set_osd_msg(mpctx, OSD_MSG_TEXT, osdl, osd_duration,
+                            "%s='%s'", name, s);
+            } else {
+                set_osd_msg(mpctx, OSD_MSG_TEXT, osdl, osd_duration, "Failed!");
+            }
+        }
+        break;
+
     case MP_CMD_VF:
         edit_filters_osd(mpctx, STREAM_VIDEO, cmd->args[0].v.s,
                          cmd->args[1].v.s, msg_osd);
@@ -3150,6 +3652,12 @@ void run_command(MPContext *mpctx, mp_cmd_t *cmd)
         break;
     }
 
+#if HAVE_POSIX_SELECT
+    case MP_CMD_IPC_REQUESTS:
+        handle_ipc_requests(mpctx, cmd->args[0].v.p);
+        break;
+#endif
+
     case MP_CMD_IGNORE:
         break;
 
@@ -3170,6 +3678,7 @@ void run_command(MPContext *mpctx, mp_cmd_t *cmd)
 void command_uninit(struct MPContext *mpctx)
 {
     overlay_uninit(mpctx);
+    ipc_uninit(mpctx);
     talloc_free(mpctx->command_ctx);
     mpctx->command_ctx = NULL;
 }
@@ -3185,6 +3694,7 @@ void command_init(struct MPContext *mpctx)
 // Notify that a property might have changed.
 void mp_notify_property(struct MPContext *mpctx, const char *property)
 {
+    ipc_mark_dirty(mpctx->command_ctx, property);
     mp_notify(mpctx, MP_EVENT_PROPERTY, (void *)property);
 }
 
@@ -3225,8 +3735,17 @@ void mp_flush_events(struct MPContext *mpctx)
             }
             if (name)
                 handle_script_event(mpctx, name, "");
+            if (name && event != MP_EVENT_TICK) {
+                // Anything could have changed.
+                ipc_mark_dirty(ctx, NULL);
+                update_ipc(mpctx, name);
+            }
+            if (event == MP_EVENT_TICK)
+                ipc_mark_tick_dirty(ctx);
             if (event == MP_EVENT_START_FILE)
                 ctx->last_seek_pts = MP_NOPTS_VALUE;
         }
     }
+
+    update_ipc(mpctx, NULL);
 }
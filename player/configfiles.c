@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <math.h>
 
 #include <libavutil/md5.h>
 
@@ -40,6 +41,9 @@
 #include "options/m_property.h"
 
 #include "stream/stream.h"
+#include "demux/demux.h"
+#include "audio/decode/dec_audio.h"
+#include "audio/filter/af.h"
 
 #include "core.h"
 #include "command.h"
@@ -167,9 +171,17 @@ void mp_load_auto_profiles(struct MPContext *mpctx)
 }
 
 #define MP_WATCH_LATER_CONF "watch_later"
+#define MP_LOUDNESS_CACHE_CONF "loudness_cache"
 
-static char *mp_get_playback_resume_config_filename(struct mpv_global *global,
-                                                    const char *fname)
+// ReplayGain 2.0 reference level (LUFS), used to turn measured loudness into
+// a ReplayGain gain.
+#define REPLAYGAIN_REFERENCE -18.0
+
+// Name of a file in the user config subdirectory dir, derived from a hash of
+// the absolute path or URL of fname.
+static char *mp_get_per_file_config_filename(struct mpv_global *global,
+                                             const char *dir,
+                                             const char *fname)
 {
     char *res = NULL;
     void *tmp = talloc_new(NULL);
@@ -196,7 +208,7 @@ static char *mp_get_playback_resume_config_filename(struct mpv_global *global,
     for (int i = 0; i < 16; i++)
         conf = talloc_asprintf_append(conf, "%02X", md5[i]);
 
-    conf = talloc_asprintf(tmp, "%s/%s", MP_WATCH_LATER_CONF, conf);
+    conf = talloc_asprintf(tmp, "%s/%s", dir, conf);
 
     res = mp_find_user_config_file(NULL, global, conf);
 
@@ -205,6 +217,12 @@ exit:
     return res;
 }
 
+static char *mp_get_playback_resume_config_filename(struct mpv_global *global,
+                                                    const char *fname)
+{
+    return mp_get_per_file_config_filename(global, MP_WATCH_LATER_CONF, fname);
+}
+
 static const char *backup_properties[] = {
     "osd-level",
     //"loop",
@@ -333,3 +351,81 @@ struct playlist_entry *mp_check_playlist_resume(struct MPContext *mpctx,
     return NULL;
 }
 
+// Write the result of the ebur128 filter (inserted by --loudness-scan) for the
+// file the current audio track comes from.
+void mp_write_loudness_cache(struct MPContext *mpctx)
+{
+    struct dec_audio *d_audio = mpctx->d_audio;
+    struct af_loudness l;
+    if (!d_audio || !d_audio->afilter ||
+        !af_control_any_rev(d_audio->afilter, AF_CONTROL_GET_LOUDNESS, &l))
+        return;
+
+    const char *filename = d_audio->header->demuxer->filename;
+    MP_INFO(mpctx, "Loudness: %.1f LUFS integrated, %.1f dBTP true peak "
+            "(%.1f seconds of audio).\n", l.integrated, l.true_peak,
+            l.duration);
+    if (mpctx->stop_play != AT_END_OF_FILE) {
+        MP_WARN(mpctx, "Loudness scan incomplete, not saving it.\n");
+        return;
+    }
+    if (!isfinite(l.integrated) || !isfinite(l.true_peak)) {
+        MP_WARN(mpctx, "No audio was measured, not saving the loudness.\n");
+        return;
+    }
+
+    mp_mk_config_dir(mpctx->global, MP_LOUDNESS_CACHE_CONF);
+    char *conffile = mp_get_per_file_config_filename(mpctx->global,
+                                                     MP_LOUDNESS_CACHE_CONF,
+                                                     filename);
+    FILE *file = conffile ? fopen(conffile, "wb") : NULL;
+    if (!file) {
+        MP_ERR(mpctx, "Can't write loudness cache file.\n");
+    } else {
+        fprintf(file, "# %s\n", filename);
+        fprintf(file, "integrated=%f\n", l.integrated);
+        fprintf(file, "true-peak=%f\n", l.true_peak);
+        fclose(file);
+    }
+    talloc_free(conffile);
+}
+
+// Return the cached loudness of the given file as ReplayGain data (relative to
+// the ReplayGain 2.0 reference level), or NULL if the file wasn't scanned.
+struct replaygain_data *mp_load_loudness_cache(struct MPContext *mpctx,
+                                               void *talloc_ctx,
+                                               const char *filename)
+{
+    struct replaygain_data *rg = NULL;
+    char *conffile = mp_get_per_file_config_filename(mpctx->global,
+                                                     MP_LOUDNESS_CACHE_CONF,
+                                                     filename);
+    FILE *file = conffile ? fopen(conffile, "r") : NULL;
+    if (!file)
+        goto done;
+
+    double integrated = NAN, true_peak = NAN;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        double val;
+        if (sscanf(line, "integrated=%lf", &val) == 1)
+            integrated = val;
+        if (sscanf(line, "true-peak=%lf", &val) == 1)
+            true_peak = val;
+    }
+    fclose(file);
+
+    if (!isfinite(integrated) || !isfinite(true_peak)) {
+        MP_WARN(mpctx, "Ignoring invalid loudness cache file %s\n", conffile);
+        goto done;
+    }
+    rg = talloc_ptrtype(talloc_ctx, rg);
+    rg->track_gain = rg->album_gain = REPLAYGAIN_REFERENCE - integrated;
+    rg->track_peak = rg->album_peak = pow(10, true_peak / 20);
+    MP_VERBOSE(mpctx, "Using cached loudness: %.1f LUFS, %.1f dBTP.\n",
+               integrated, true_peak);
+
+done:
+    talloc_free(conffile);
+    return rg;
+}
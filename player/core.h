@@ -158,6 +158,7 @@ typedef struct MPContext {
     struct mp_log *statusline;
     struct m_config *mconfig;
     struct input_ctx *input;
+    struct mp_ipc_ctx *ipc_ctx;
     struct osd_state *osd;
     struct mp_osd_msg *osd_msg_stack;
     char *term_osd_text;
@@ -174,6 +175,8 @@ typedef struct MPContext {
     struct playlist *playlist;
     char *filename; // currently playing file
     struct mp_resolve_result *resolve_result;
+    // Next playlist entry being opened in advance (loadfile.c)
+    struct mp_prefetch *prefetch;
     enum stop_play_reason stop_play;
     unsigned int initialized_flags;  // which subsystems have been initialized
 
@@ -184,6 +187,10 @@ typedef struct MPContext {
     bool error_playing;
 
     int64_t shown_vframes, shown_aframes;
+    // Cumulative over all played files (unlike the above).
+    int64_t decoded_vframes, filtered_vframes, dropped_vframes;
+    int64_t thumbnails;
+    double thumbnail_time;
 
     struct demuxer **sources;
     int num_sources;
@@ -255,6 +262,10 @@ typedef struct MPContext {
     // How much video timing has been changed to make it match the audio
     // timeline. Used for status line information only.
     double total_avsync_change;
+    // Audio speed factor applied by resampling with --video-sync=resample
+    // (1 if not used), and the integral term of the controller setting it.
+    double audio_speed_correction;
+    double audio_speed_integral;
     // Total number of dropped frames that were "approved" to be dropped.
     // Actual dropping depends on --framedrop and decoder internals.
     int drop_frame_cnt;
@@ -342,26 +353,44 @@ typedef struct MPContext {
     bool drop_message_shown;
 
     struct screenshot_ctx *screenshot_ctx;
+    struct benchmark_ctx *benchmark_ctx;
     struct command_ctx *command_ctx;
     struct encode_lavc_context *encode_lavc_ctx;
     struct lua_ctx *lua_ctx;
     struct mp_nav_state *nav_state;
+
+    // Program name and command line arguments, if started by mpv_main().
+    // Used to run worker processes with the same options (--oparallel).
+    char *exe_name;
+    int argc;
+    char **argv;
 } MPContext;
 
 // audio.c
 void reinit_audio_chain(struct MPContext *mpctx);
 int reinit_audio_filters(struct MPContext *mpctx);
+void set_audio_speed_correction(struct MPContext *mpctx, double speed);
 double playing_audio_pts(struct MPContext *mpctx);
 int fill_audio_out_buffers(struct MPContext *mpctx, double endpts);
 double written_audio_pts(struct MPContext *mpctx);
 void clear_audio_output_buffers(struct MPContext *mpctx);
 void clear_audio_decode_buffers(struct MPContext *mpctx);
 
+// benchmark.c
+void benchmark_init(struct MPContext *mpctx);
+void benchmark_start_file(struct MPContext *mpctx);
+void benchmark_end_file(struct MPContext *mpctx);
+void benchmark_write_report(struct MPContext *mpctx);
+
 // configfiles.c
 bool mp_parse_cfgfiles(struct MPContext *mpctx);
 void mp_load_auto_profiles(struct MPContext *mpctx);
 void mp_load_playback_resume(struct MPContext *mpctx, const char *file);
 void mp_write_watch_later_conf(struct MPContext *mpctx);
+void mp_write_loudness_cache(struct MPContext *mpctx);
+struct replaygain_data *mp_load_loudness_cache(struct MPContext *mpctx,
+                                               void *talloc_ctx,
+                                               const char *filename);
 struct playlist_entry *mp_check_playlist_resume(struct MPContext *mpctx,
                                                 struct playlist *playlist);
 
@@ -372,8 +401,13 @@ void mp_nav_destroy(struct MPContext *mpctx);
 void mp_nav_user_input(struct MPContext *mpctx, char *command);
 void mp_handle_nav(struct MPContext *mpctx);
 
+// encode_parallel.c
+int encode_parallel_run(struct MPContext *mpctx);
+
 // loadfile.c
 void uninit_player(struct MPContext *mpctx, unsigned int mask);
+void mp_prefetch_next(struct MPContext *mpctx);
+void mp_prefetch_cancel(struct MPContext *mpctx);
 struct track *mp_add_subtitles(struct MPContext *mpctx, char *filename);
 void mp_switch_track(struct MPContext *mpctx, enum stream_type type,
                      struct track *track);
@@ -448,10 +482,16 @@ void reinit_subs(struct MPContext *mpctx, int order);
 void update_osd_msg(struct MPContext *mpctx);
 void update_subtitles(struct MPContext *mpctx);
 
+// thumbnail.c
+void thumbnail_setup_decoder(struct MPContext *mpctx, struct dec_video *d_video);
+int thumbnail_run(struct MPContext *mpctx);
+
 // timeline/tl_matroska.c
 void build_ordered_chapter_timeline(struct MPContext *mpctx);
 // timeline/tl_mpv_edl.c
 void build_mpv_edl_timeline(struct MPContext *mpctx);
+char *mp_edl_range_url(void *talloc_ctx, const char *filename, double start,
+                       double length);
 // timeline/tl_cue.c
 void build_cue_timeline(struct MPContext *mpctx);
 
@@ -0,0 +1,254 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Implements --oparallel: split the file at keyframes into segments, encode
+ * each segment with a separate mpv process (playing an edl:// URL that
+ * covers the segment, with the same options), and then copy the encoded
+ * segments into the output file without re-encoding them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifndef __MINGW32__
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/encode.h"
+#include "common/msg.h"
+#include "common/playlist.h"
+#include "options/options.h"
+#include "options/m_config.h"
+#include "options/parse_commandline.h"
+#include "osdep/timer.h"
+#include "demux/demux.h"
+
+#include "core.h"
+
+// Options that must not be passed to the workers: they are handled by this
+// process, or would apply to each segment instead of the whole file.
+static const char *const skip_options[] = {
+    "o", "of", "oparallel", "start", "end", "length", "frames", "loop",
+    "shuffle", NULL
+};
+
+static bool skip_option(bstr name)
+{
+    for (int n = 0; skip_options[n]; n++) {
+        if (bstr_equals0(name, skip_options[n]))
+            return true;
+    }
+    return false;
+}
+
+static void add_option(void *ta_parent, char ***args, int *num_args,
+                       struct playlist_param p)
+{
+    if (skip_option(p.name))
+        return;
+    char *arg = p.value.start
+        ? talloc_asprintf(ta_parent, "--%.*s=%.*s", BSTR_P(p.name),
+                          BSTR_P(p.value))
+        : talloc_asprintf(ta_parent, "--%.*s", BSTR_P(p.name));
+    MP_TARRAY_APPEND(ta_parent, *args, *num_args, arg);
+}
+
+// Command line of the worker process for one segment.
+static char **worker_args(struct MPContext *mpctx, void *ta_parent,
+                          const char *url, const char *outfile)
+{
+    char **args = NULL;
+    int num_args = 0;
+
+    MP_TARRAY_APPEND(ta_parent, args, num_args, mpctx->exe_name);
+
+    struct playlist_param *params;
+    int num_params = m_config_get_cmdline_options(mpctx->mconfig, ta_parent,
+                                                  mpctx->argc, mpctx->argv,
+                                                  &params);
+    for (int n = 0; n < num_params; n++)
+        add_option(ta_parent, &args, &num_args, params[n]);
+
+    // Per-file options (--{ ... --}) of the current file.
+    struct playlist_entry *e = mpctx->playlist->current;
+    for (int n = 0; e && n < e->num_params; n++)
+        add_option(ta_parent, &args, &num_args, e->params[n]);
+
+    char *extra[] = {
+        "--oparallel=1",
+        "--no-consolecontrols",
+        // Several workers writing status lines and messages to the same
+        // terminal would be unreadable; the parent shows the progress.
+        "--quiet",
+        "--msglevel=all=error",
+        talloc_asprintf(ta_parent, "--o=%s", outfile),
+        talloc_asprintf(ta_parent, "--of=%s",
+                        encode_lavc_get_format(mpctx->encode_lavc_ctx)),
+        "--",
+        (char *)url,
+        NULL,
+    };
+    for (int n = 0; n < MP_ARRAY_SIZE(extra); n++)
+        MP_TARRAY_APPEND(ta_parent, args, num_args, extra[n]);
+
+    return args;
+}
+
+// Return the pts of the keyframe at or before pos, or MP_NOPTS_VALUE.
+static double keyframe_before(struct MPContext *mpctx, struct sh_stream *sh,
+                              double pos)
+{
+    if (!demux_seek(mpctx->demuxer, pos, SEEK_ABSOLUTE | SEEK_BACKWARD))
+        return MP_NOPTS_VALUE;
+    struct demux_packet *pkt = demux_read_packet(sh);
+    double pts = pkt ? pkt->pts : MP_NOPTS_VALUE;
+    talloc_free(pkt);
+    return pts;
+}
+
+#ifndef __MINGW32__
+static pid_t start_worker(char **args)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(args[0], args);
+        // mp_msg() is not safe to be called from a forked process.
+        char s[] = "Executing encoder process failed.\n";
+        write(2, s, sizeof(s) - 1);
+        _exit(1);
+    }
+    return pid;
+}
+
+static bool wait_worker(pid_t pid)
+{
+    int st;
+    if (pid < 0)
+        return false;
+    while (waitpid(pid, &st, 0) < 0) {
+        if (errno != EINTR)
+            return false;
+    }
+    return WIFEXITED(st) && WEXITSTATUS(st) == 0;
+}
+#endif
+
+// Encode the current file. Returns 1 on success, 0 on error.
+int encode_parallel_run(struct MPContext *mpctx)
+{
+#ifdef __MINGW32__
+    MP_ERR(mpctx, "--oparallel is not supported on this platform.\n");
+    return 0;
+#else
+    struct MPOpts *opts = mpctx->opts;
+    struct encode_lavc_context *ectx = mpctx->encode_lavc_ctx;
+    double start_time = mp_time_sec();
+
+    if (!mpctx->argv) {
+        MP_ERR(mpctx, "--oparallel: not started from the command line.\n");
+        return 0;
+    }
+    if (mpctx->timeline) {
+        MP_ERR(mpctx, "--oparallel: files with a timeline are not supported.\n");
+        return 0;
+    }
+    double len = get_time_length(mpctx);
+    if (len <= 0 || !mpctx->demuxer->seekable) {
+        MP_ERR(mpctx, "--oparallel: unknown duration or unseekable file.\n");
+        return 0;
+    }
+    if (opts->play_frames > 0)
+        MP_WARN(mpctx, "--oparallel: ignoring --frames.\n");
+
+    double start = rel_time_to_abs(mpctx, opts->play_start,
+                                   get_start_time(mpctx));
+    double end = get_play_end_pts(mpctx);
+    bool cut_end = end != MP_NOPTS_VALUE;
+    if (!cut_end)
+        end = get_start_time(mpctx) + len;
+
+    // Cut at the keyframes before evenly spaced positions. The segments then
+    // start exactly at a keyframe, so the workers don't need to decode
+    // anything before their segment. Audio-only files are cut anywhere.
+    struct track *track = mpctx->current_track[0][STREAM_VIDEO];
+    struct sh_stream *sh = NULL;
+    if (track && track->demuxer == mpctx->demuxer)
+        sh = track->stream;
+
+    void *tmp = talloc_new(NULL);
+    double *cuts = NULL;
+    int num_cuts = 0;
+    MP_TARRAY_APPEND(tmp, cuts, num_cuts, start);
+    int num = opts->encode_output.parallel;
+    for (int n = 1; n < num; n++) {
+        double pos = start + (end - start) * n / num;
+        if (sh)
+            pos = keyframe_before(mpctx, sh, pos);
+        if (pos != MP_NOPTS_VALUE && pos > cuts[num_cuts - 1] && pos < end)
+            MP_TARRAY_APPEND(tmp, cuts, num_cuts, pos);
+    }
+
+    const char *out = encode_lavc_get_filename(ectx);
+    char **parts = talloc_array(tmp, char *, num_cuts);
+    pid_t *pids = talloc_array(tmp, pid_t, num_cuts);
+
+    mp_msg_flush_status_line(mpctx->global);
+    MP_INFO(mpctx, "Encoding %d segments in parallel.\n", num_cuts);
+
+    for (int n = 0; n < num_cuts; n++) {
+        double length = -1;
+        if (n + 1 < num_cuts) {
+            length = cuts[n + 1] - cuts[n];
+        } else if (cut_end) {
+            length = end - cuts[n];
+        }
+        char *url = mp_edl_range_url(tmp, mpctx->filename, cuts[n], length);
+        parts[n] = talloc_asprintf(tmp, "%s.part%03d", out, n);
+        MP_VERBOSE(mpctx, "Segment %d: %s -> %s\n", n, url, parts[n]);
+        pids[n] = start_worker(worker_args(mpctx, tmp, url, parts[n]));
+    }
+
+    int ok = 1;
+    for (int n = 0; n < num_cuts; n++) {
+        if (!wait_worker(pids[n])) {
+            MP_ERR(mpctx, "--oparallel: encoding segment %d failed.\n", n);
+            ok = 0;
+        }
+    }
+
+    for (int n = 0; n < num_cuts; n++) {
+        if (ok && encode_lavc_append_file(ectx, parts[n]) < 0)
+            ok = 0;
+        unlink(parts[n]);
+    }
+
+    if (ok) {
+        MP_INFO(mpctx, "Encoded %d segments in %.1f seconds.\n", num_cuts,
+                mp_time_sec() - start_time);
+    }
+
+    talloc_free(tmp);
+    return ok;
+#endif
+}
@@ -20,6 +20,7 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include <libavutil/avutil.h>
 
@@ -30,6 +31,7 @@
 #include "osdep/terminal.h"
 #include "osdep/timer.h"
 
+#include "common/global.h"
 #include "common/msg.h"
 #include "options/path.h"
 #include "options/m_config.h"
@@ -1019,6 +1021,217 @@ static bool demux_was_interrupted(struct MPContext *mpctx)
     return false;
 }
 
+// Opening the next playlist entry in advance (--prefetch-playlist), so that
+// it starts without delay when the current one ends.
+struct mp_prefetch {
+    pthread_t thread;
+
+    // Copies of mpctx->global and the options, which are only read by the
+    // thread. The main thread keeps changing the real options.
+    struct mpv_global *global;
+    struct MPOpts *opts;
+
+    // Entry being opened (only compared, never accessed by the thread)
+    struct playlist_entry *entry;
+    char *entry_filename;
+    char *filename;
+
+    // Values of prefetch_opts[] at the time the thread was started
+    char **opt_values;
+
+    // Result, valid after the thread was joined
+    struct stream *stream;
+    struct demuxer *demuxer;
+};
+
+// Options that affect opening the stream and the demuxer (in addition to all
+// "demuxer-*" options). If any of them has a different value for the new file
+// (auto profiles, resume config), the prefetched stream is not used.
+static const char *const prefetch_opts[] = {
+    "demuxer", "sb", "cache", "cache-default", "cache-min", "cache-seek-min",
+    "http-header-fields", "user-agent", "referrer", "cookies", "cookies-file",
+    "rtsp-transport", "tls-verify", "tls-ca-file", NULL
+};
+
+static bool is_prefetch_opt(struct m_config_option *co)
+{
+    if (co->is_generated)
+        return false;
+    if (bstr_startswith0(bstr0(co->name), "demuxer-"))
+        return true;
+    for (int n = 0; prefetch_opts[n]; n++) {
+        if (strcmp(co->name, prefetch_opts[n]) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Return the current values of all options that affect prefetching, as a
+// NULL-terminated list of "name=value" strings.
+static char **get_prefetch_opt_values(void *ta_parent, struct m_config *conf)
+{
+    char **list = NULL;
+    int num = 0;
+    for (int n = 0; n < conf->num_opts; n++) {
+        struct m_config_option *co = &conf->opts[n];
+        if (!co->data || !is_prefetch_opt(co))
+            continue;
+        char *val = m_option_print(co->opt, co->data);
+        MP_TARRAY_APPEND(ta_parent, list, num,
+                         talloc_asprintf(ta_parent, "%s=%s", co->name,
+                                         val ? val : ""));
+        talloc_free(val);
+    }
+    MP_TARRAY_APPEND(ta_parent, list, num, NULL);
+    return list;
+}
+
+static bool prefetch_opts_changed(struct MPContext *mpctx, char **old)
+{
+    void *tmp = talloc_new(NULL);
+    char **cur = get_prefetch_opt_values(tmp, mpctx->mconfig);
+    bool changed = false;
+    for (int n = 0; old[n] || cur[n]; n++) {
+        if (!old[n] || !cur[n] || strcmp(old[n], cur[n]) != 0) {
+            MP_VERBOSE(mpctx, "Not using prefetched file: option %s changed.\n",
+                       cur[n] ? cur[n] : old[n]);
+            changed = true;
+            break;
+        }
+    }
+    talloc_free(tmp);
+    return changed;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct mp_prefetch *p = arg;
+    struct MPOpts *opts = p->opts;
+
+    struct stream *stream = stream_open(p->filename, p->global);
+    if (!stream)
+        return NULL;
+
+    // Discs etc. need interactive setup by the player before reading.
+    if (stream->type != STREAMTYPE_GENERIC && stream->type != STREAMTYPE_FILE) {
+        free_stream(stream);
+        return NULL;
+    }
+
+    stream->start_pos += opts->seek_to_byte;
+    if (stream_enable_cache_percent(&stream, opts->stream_cache_size,
+                                    opts->stream_cache_def_size,
+                                    opts->stream_cache_min_percent,
+                                    opts->stream_cache_seek_min_percent) == 0)
+    {
+        free_stream(stream);    // interrupted
+        return NULL;
+    }
+
+    p->demuxer = demux_open(stream, opts->demuxer_name, NULL, p->global);
+    if (!p->demuxer) {
+        free_stream(stream);
+        return NULL;
+    }
+    p->stream = stream;
+    return NULL;
+}
+
+// Start opening the next playlist entry, if the current one is about to end.
+void mp_prefetch_next(struct MPContext *mpctx)
+{
+    struct MPOpts *opts = mpctx->opts;
+
+    if (!opts->prefetch_playlist || mpctx->prefetch || !mpctx->demuxer ||
+        mpctx->stop_play || mpctx->restart_playback)
+        return;
+
+    // Start when the current file was read completely, or is near its end.
+    double len = get_time_length(mpctx);
+    double remaining = len > 0 ? len - get_current_time(mpctx) : 1e99;
+    if (remaining > 10 && !mpctx->demuxer->stream->eof)
+        return;
+
+    // Not for entries with per-file options, which could affect opening.
+    struct playlist_entry *e = playlist_get_next(mpctx->playlist, 1);
+    if (!e || e->num_params || (opts->stream_dump && opts->stream_dump[0]))
+        return;
+    char *filename = e->filename;
+    char *local_filename = mp_file_url_to_filename(NULL, bstr0(filename));
+#if HAVE_LIBQUVI
+    // The URL could need resolving first.
+    if (!local_filename && mp_is_url(bstr0(filename)))
+        return;
+#endif
+
+    struct mp_prefetch *p = talloc_ptrtype(NULL, p);
+    *p = (struct mp_prefetch) {
+        .global = talloc_ptrtype(p, p->global),
+        .opts = m_config_copy_struct(p, mpctx->mconfig, sizeof(struct MPOpts)),
+        .entry = e,
+        .entry_filename = talloc_strdup(p, filename),
+        .filename = talloc_strdup(p, local_filename ? local_filename : filename),
+        .opt_values = get_prefetch_opt_values(p, mpctx->mconfig),
+    };
+    *p->global = *mpctx->global;
+    p->global->opts = p->opts;
+    talloc_free(local_filename);
+
+    if (pthread_create(&p->thread, NULL, prefetch_thread, p)) {
+        talloc_free(p);
+        return;
+    }
+    MP_VERBOSE(mpctx, "Prefetching %s\n", p->filename);
+    mpctx->prefetch = p;
+}
+
+// Wait for the prefetch thread to finish. The result must be passed to
+// prefetch_take(), which frees it.
+static struct mp_prefetch *prefetch_join(struct MPContext *mpctx)
+{
+    struct mp_prefetch *p = mpctx->prefetch;
+    if (p) {
+        mpctx->prefetch = NULL;
+        pthread_join(p->thread, NULL);
+    }
+    return p;
+}
+
+// Return the stream and demuxer opened for e. Returns false if there are none,
+// or if the options they were opened with changed since (the result is freed
+// in this case). Frees p.
+static bool prefetch_take(struct MPContext *mpctx, struct mp_prefetch *p,
+                          struct playlist_entry *e,
+                          struct stream **stream, struct demuxer **demuxer)
+{
+    if (!p)
+        return false;
+
+    bool ok = p->stream && e && e == p->entry && !e->num_params &&
+              strcmp(e->filename, p->entry_filename) == 0 &&
+              !prefetch_opts_changed(mpctx, p->opt_values);
+    if (ok) {
+        *stream = p->stream;
+        *demuxer = p->demuxer;
+        // The stream and demuxer keep using the option copy. The demuxer is
+        // always freed before the stream.
+        talloc_steal(p->stream, p->global);
+        talloc_steal(p->stream, p->opts);
+    } else if (p->stream) {
+        free_demuxer(p->demuxer);
+        free_stream(p->stream);
+    }
+    talloc_free(p);
+    return ok;
+}
+
+void mp_prefetch_cancel(struct MPContext *mpctx)
+{
+    struct stream *stream;
+    struct demuxer *demuxer;
+    prefetch_take(mpctx, prefetch_join(mpctx), NULL, &stream, &demuxer);
+}
+
 static void load_per_file_options(m_config_t *conf,
                                   struct playlist_param *params,
                                   int params_count)
@@ -1046,6 +1259,7 @@ static void play_current_file(struct MPContext *mpctx)
     mpctx->filename = NULL;
     mpctx->shown_aframes = 0;
     mpctx->shown_vframes = 0;
+    benchmark_start_file(mpctx);
 
     if (mpctx->playlist->current)
         mpctx->filename = mpctx->playlist->current->filename;
@@ -1063,6 +1277,10 @@ static void play_current_file(struct MPContext *mpctx)
 
     mpctx->add_osd_seek_info &= OSD_SEEK_INFO_EDITION;
 
+    // The prefetch thread reads the option snapshot only, but make sure it's
+    // done before changing the options for the new file.
+    struct mp_prefetch *prefetch = prefetch_join(mpctx);
+
     if (opts->reset_options) {
         for (int n = 0; opts->reset_options[n]; n++) {
             const char *opt = opts->reset_options[n];
@@ -1103,6 +1321,16 @@ static void play_current_file(struct MPContext *mpctx)
     assert(mpctx->d_sub[0] == NULL);
     assert(mpctx->d_sub[1] == NULL);
 
+    // Use the stream and demuxer opened by mp_prefetch_next(), if any.
+    struct demuxer *prefetched = NULL;
+    if (prefetch_take(mpctx, prefetch, mpctx->playlist->current,
+                      &mpctx->stream, &prefetched))
+    {
+        mpctx->initialized_flags |= INITIALIZED_STREAM;
+        stream_set_capture_file(mpctx->stream, opts->stream_capture);
+        goto goto_reopen_demuxer;
+    }
+
     char *stream_filename = mpctx->filename;
     mpctx->resolve_result = resolve_url(stream_filename, mpctx->global);
     if (mpctx->resolve_result) {
@@ -1151,8 +1379,13 @@ goto_reopen_demuxer: ;
 
     mpctx->audio_delay = opts->audio_delay;
 
-    mpctx->demuxer = demux_open(mpctx->stream, opts->demuxer_name, NULL,
-                                mpctx->global);
+    if (prefetched) {
+        mpctx->demuxer = prefetched;
+        prefetched = NULL;
+    } else {
+        mpctx->demuxer = demux_open(mpctx->stream, opts->demuxer_name, NULL,
+                                    mpctx->global);
+    }
     mpctx->master_demuxer = mpctx->demuxer;
     if (!mpctx->demuxer) {
         MP_ERR(mpctx, "Failed to recognize file format.\n");
@@ -1251,8 +1484,17 @@ goto_reopen_demuxer: ;
         encode_lavc_expect_stream(mpctx->encode_lavc_ctx, AVMEDIA_TYPE_VIDEO);
     if (mpctx->encode_lavc_ctx && mpctx->current_track[0][STREAM_AUDIO])
         encode_lavc_expect_stream(mpctx->encode_lavc_ctx, AVMEDIA_TYPE_AUDIO);
+
+    if (mpctx->encode_lavc_ctx && opts->encode_output.parallel > 1) {
+        mpctx->error_playing = !encode_parallel_run(mpctx);
+        mpctx->stop_play = AT_END_OF_FILE;
+        goto terminate_playback;
+    }
 #endif
 
+    mpctx->audio_speed_correction = 1;
+    mpctx->audio_speed_integral = 0;
+
     reinit_video_chain(mpctx);
     reinit_audio_chain(mpctx);
     reinit_subs(mpctx, 0);
@@ -1333,6 +1575,12 @@ goto_reopen_demuxer: ;
 
     playback_start = mp_time_sec();
     mpctx->error_playing = false;
+    if (opts->thumbnail_file && opts->thumbnail_file[0]) {
+        if (!thumbnail_run(mpctx))
+            mpctx->error_playing = true;
+        if (!mpctx->stop_play)
+            mpctx->stop_play = AT_END_OF_FILE;
+    }
     while (!mpctx->stop_play)
         run_playloop(mpctx);
 
@@ -1364,6 +1612,11 @@ terminate_playback:  // don't jump here after ao/vo/getch initialization!
 
     MP_INFO(mpctx, "\n");
 
+    benchmark_end_file(mpctx);
+
+    if (opts->loudness_scan)
+        mp_write_loudness_cache(mpctx);
+
     // time to uninit all, except global stuff:
     int uninitialize_parts = INITIALIZED_ALL;
     if (opts->fixed_vo)
@@ -1497,6 +1750,8 @@ void mp_play_files(struct MPContext *mpctx)
         if (!mpctx->playlist->current && !mpctx->opts->player_idle_mode)
             break;
     }
+
+    mp_prefetch_cancel(mpctx);
 }
 
 // Abort current playback and set the given entry to play next.
@@ -41,6 +41,7 @@ struct script_ctx {
     lua_State *state;
     struct mp_log *log;
     struct MPContext *mpctx;
+    struct mp_log_buffer *messages;
 };
 
 struct lua_ctx {
@@ -236,6 +237,7 @@ static void mp_lua_load_script(struct MPContext *mpctx, const char *fname)
 error_out:
     if (ctx->state)
         lua_close(ctx->state);
+    mp_msg_log_buffer_destroy(ctx->messages);
     talloc_free(ctx);
 }
 
@@ -245,6 +247,7 @@ static void kill_script(struct script_ctx *ctx)
         return;
     struct lua_ctx *lctx = ctx->mpctx->lua_ctx;
     lua_close(ctx->state);
+    mp_msg_log_buffer_destroy(ctx->messages);
     for (int n = 0; n < lctx->num_scripts; n++) {
         if (lctx->scripts[n] == ctx) {
             MP_TARRAY_REMOVE_AT(lctx->scripts, lctx->num_scripts, n);
@@ -295,6 +298,50 @@ static int script_log(lua_State *L)
     return 0;
 }
 
+// Start (or stop, with level "no") collecting log messages up to the given
+// level (as in --msglevel). They are retrieved with mp.get_messages().
+static int script_enable_messages(lua_State *L)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    const char *level = luaL_checkstring(L, 1);
+    int msgl = mp_msg_find_level(level);
+    if (msgl < 0 && strcmp(level, "no") != 0)
+        luaL_error(L, "Invalid log level '%s'", level);
+    mp_msg_log_buffer_destroy(ctx->messages);
+    ctx->messages = NULL;
+    if (msgl >= 0)
+        ctx->messages = mp_msg_log_buffer_new(ctx->mpctx->global, 1000, msgl,
+                                              NULL, NULL);
+    return 0;
+}
+
+// Return an array of all log messages collected since the last call, each a
+// table with the fields prefix, level, time and text.
+static int script_get_messages(lua_State *L)
+{
+    struct script_ctx *ctx = get_ctx(L);
+    lua_newtable(L); // list
+    if (!ctx->messages)
+        return 1;
+    struct mp_log_buffer_entry *entry;
+    int n = 1;
+    while ((entry = mp_msg_log_buffer_read(ctx->messages))) {
+        lua_pushinteger(L, n++); // list n
+        lua_newtable(L); // list n entry
+        lua_pushstring(L, entry->prefix);
+        lua_setfield(L, -2, "prefix");
+        lua_pushstring(L, mp_msg_level_name(entry->level));
+        lua_setfield(L, -2, "level");
+        lua_pushnumber(L, entry->time / 1e6);
+        lua_setfield(L, -2, "time");
+        lua_pushstring(L, entry->text);
+        lua_setfield(L, -2, "text");
+        lua_settable(L, -3); // list
+        talloc_free(entry);
+    }
+    return 1;
+}
+
 static int script_find_config_file(lua_State *L)
 {
     struct MPContext *mpctx = get_mpctx(L);
@@ -645,6 +692,8 @@ struct fn_entry {
 
 static struct fn_entry fn_list[] = {
     FN_ENTRY(log),
+    FN_ENTRY(enable_messages),
+    FN_ENTRY(get_messages),
     FN_ENTRY(find_config_file),
     FN_ENTRY(send_command),
     FN_ENTRY(send_commandv),
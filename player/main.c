@@ -42,12 +42,16 @@
 #include "common/common.h"
 #include "common/msg.h"
 #include "common/global.h"
+#include "common/trace.h"
 #include "options/parse_configfile.h"
 #include "options/parse_commandline.h"
 #include "common/playlist.h"
 #include "common/playlist_parser.h"
 #include "options/options.h"
 #include "input/input.h"
+#if HAVE_POSIX_SELECT
+#include "input/ipc.h"
+#endif
 
 #include "audio/decode/dec_audio.h"
 #include "audio/out/ao.h"
@@ -110,6 +114,9 @@ static MP_NORETURN void exit_player(struct MPContext *mpctx,
     int rc;
     uninit_player(mpctx, INITIALIZED_ALL);
 
+    screenshot_flush(mpctx);
+    benchmark_write_report(mpctx);
+
 #if HAVE_ENCODING
     encode_lavc_finish(mpctx->encode_lavc_ctx);
     encode_lavc_free(mpctx->encode_lavc_ctx);
@@ -131,6 +138,11 @@ static MP_NORETURN void exit_player(struct MPContext *mpctx,
 
     command_uninit(mpctx);
 
+#if HAVE_POSIX_SELECT
+    mp_uninit_ipc(mpctx->ipc_ctx);
+    mpctx->ipc_ctx = NULL;
+#endif
+
     mp_input_uninit(mpctx->input);
 
     osd_free(mpctx->osd);
@@ -279,6 +291,7 @@ static int mpv_main(int argc, char *argv[])
 {
     osdep_preinit(&argc, &argv);
 
+    char *exe_name = argc >= 1 ? argv[0] : "mpv";
     if (argc >= 1) {
         argc--;
         argv++;
@@ -286,12 +299,17 @@ static int mpv_main(int argc, char *argv[])
 
     struct MPContext *mpctx = talloc(NULL, MPContext);
     *mpctx = (struct MPContext){
+        .exe_name = exe_name,
+        .argc = argc,
+        .argv = argv,
         .last_dvb_step = 1,
+        .audio_speed_correction = 1,
         .term_osd_contents = talloc_strdup(mpctx, ""),
         .playlist = talloc_struct(mpctx, struct playlist, {0}),
     };
 
     mpctx->global = talloc_zero(mpctx, struct mpv_global);
+    mpctx->global->trace = mp_trace_new(mpctx->global);
 
     // Nothing must call mp_msg*() and related before this
     mp_msg_init(mpctx->global);
@@ -367,6 +385,9 @@ static int mpv_main(int argc, char *argv[])
 
     mpctx->input = mp_input_init(mpctx->global);
     stream_set_interrupt_callback(mp_input_check_interrupt, mpctx->input);
+#if HAVE_POSIX_SELECT
+    mpctx->ipc_ctx = mp_init_ipc(mpctx->input, mpctx->global);
+#endif
 #if HAVE_COCOA
     cocoa_set_input_context(mpctx->input);
 #endif
@@ -388,6 +409,34 @@ static int mpv_main(int argc, char *argv[])
     }
 #endif
 
+    if (opts->benchmark_file && opts->benchmark_file[0]) {
+        benchmark_init(mpctx);
+        m_config_set_option0(mpctx->mconfig, "untimed", "yes");
+        if (!opts->vo.video_driver_list)
+            m_config_set_option0(mpctx->mconfig, "vo", "null");
+        if (!opts->audio_driver_list)
+            m_config_set_option0(mpctx->mconfig, "ao", "null:untimed");
+    }
+
+    if (opts->loudness_scan) {
+        m_config_set_option0(mpctx->mconfig, "untimed", "yes");
+        m_config_set_option0(mpctx->mconfig, "vid", "no");
+        m_config_set_option0(mpctx->mconfig, "sid", "no");
+        if (!opts->vo.video_driver_list)
+            m_config_set_option0(mpctx->mconfig, "vo", "null");
+        if (!opts->audio_driver_list)
+            m_config_set_option0(mpctx->mconfig, "ao", "null:untimed");
+        m_config_set_option0(mpctx->mconfig, "af-pre", "ebur128");
+    }
+
+    if (opts->thumbnail_file && opts->thumbnail_file[0]) {
+        if (!opts->vo.video_driver_list)
+            m_config_set_option0(mpctx->mconfig, "vo", "null");
+        m_config_set_option0(mpctx->mconfig, "aid", "no");
+        m_config_set_option0(mpctx->mconfig, "sid", "no");
+        m_config_set_option0(mpctx->mconfig, "hwdec", "no");
+    }
+
     if (mpctx->opts->slave_mode)
         terminal_setup_stdin_cmd_input(mpctx->input);
     else if (mpctx->opts->consolecontrols)
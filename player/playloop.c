@@ -588,6 +588,32 @@ do_seek:
     return true;
 }
 
+/* With --video-sync=resample, change the audio speed slightly, so that audio
+ * follows the video instead of video frames being dropped when video timing
+ * can't keep up (such as with a display refresh rate slightly lower than the
+ * video frame rate). This is a PI controller on the A/V difference, updated
+ * with each video frame: the integral term converges to the rate mismatch,
+ * the proportional term corrects the remaining difference.
+ */
+static void adjust_audio_speed(struct MPContext *mpctx)
+{
+    struct MPOpts *opts = mpctx->opts;
+    double diff = mpctx->last_av_difference;
+
+    // Large differences (after seeks etc.) are left to the normal sync.
+    if (diff == MP_NOPTS_VALUE || fabs(diff) > 0.5 || mpctx->syncing_audio)
+        return;
+
+    // Positive difference: video is late, so slow down the audio.
+    double max_change = opts->video_sync_max_audio_change / 100;
+    mpctx->audio_speed_integral = MPCLAMP(mpctx->audio_speed_integral -
+                                          diff * 0.0002, -max_change, max_change);
+    double change = mpctx->audio_speed_integral - diff * 0.05;
+    double speed = 1 + MPCLAMP(change, -max_change, max_change);
+    if (speed != mpctx->audio_speed_correction)
+        set_audio_speed_correction(mpctx, speed);
+}
+
 static void update_avsync(struct MPContext *mpctx)
 {
     if (!mpctx->d_audio || !mpctx->d_video)
@@ -606,6 +632,8 @@ static void update_avsync(struct MPContext *mpctx)
         MP_WARN(mpctx, "%s", av_desync_help_text);
         mpctx->drop_message_shown = true;
     }
+    if (mpctx->opts->video_sync == VS_RESAMPLE)
+        adjust_audio_speed(mpctx);
 }
 
 /* Modify video timing to match the audio timeline. There are two main
@@ -1228,6 +1256,8 @@ void run_playloop(struct MPContext *mpctx)
 
     mp_handle_nav(mpctx);
 
+    mp_prefetch_next(mpctx);
+
     if (!mpctx->stop_play && !mpctx->restart_playback) {
 
         // If no more video is available, one frame means one playloop iteration.
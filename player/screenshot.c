@@ -51,6 +51,9 @@ typedef struct screenshot_ctx {
     bool osd;
 
     int frameno;
+
+    // Created on first use
+    struct image_writer_queue *queue;
 } screenshot_ctx;
 
 void screenshot_init(struct MPContext *mpctx)
@@ -87,6 +90,33 @@ static void screenshot_msg(screenshot_ctx *ctx, int status, const char *msg,
     talloc_free(s);
 }
 
+static struct image_writer_queue *get_queue(screenshot_ctx *ctx)
+{
+    if (!ctx->queue) {
+        struct MPContext *mpctx = ctx->mpctx;
+        int threads = mpctx->opts->screenshot_threads;
+        ctx->queue = image_writer_queue_create(ctx, mpctx->log, threads, 0);
+    }
+    return ctx->queue;
+}
+
+// Report errors of screenshots written in the background since the last call.
+static void report_errors(screenshot_ctx *ctx)
+{
+    int errors = ctx->queue ? image_writer_queue_get_errors(ctx->queue) : 0;
+    if (errors == 1) {
+        screenshot_msg(ctx, SMSG_ERR, "Error writing screenshot!");
+    } else if (errors > 1) {
+        screenshot_msg(ctx, SMSG_ERR, "Error writing %d screenshots!", errors);
+    }
+}
+
+static bool file_exists(screenshot_ctx *ctx, const char *filename)
+{
+    return mp_path_exists(filename) ||
+           (ctx->queue && image_writer_queue_has_file(ctx->queue, filename));
+}
+
 static char *stripext(void *talloc_ctx, const char *s)
 {
     const char *end = strrchr(s, '.');
@@ -282,7 +312,7 @@ static char *gen_fname(screenshot_ctx *ctx, const char *file_ext)
             return NULL;
         }
 
-        if (!mp_path_exists(fname))
+        if (!file_exists(ctx, fname))
             return fname;
 
         if (sequence == prev_sequence) {
@@ -322,8 +352,7 @@ static void screenshot_save(struct MPContext *mpctx, struct mp_image *image)
     char *filename = gen_fname(ctx, image_writer_file_ext(opts));
     if (filename) {
         screenshot_msg(ctx, SMSG_OK, "Screenshot: '%s'", filename);
-        if (!write_image(image, opts, filename, mpctx->log))
-            screenshot_msg(ctx, SMSG_ERR, "Error writing screenshot!");
+        image_writer_queue_add(get_queue(ctx), image, opts, filename);
         talloc_free(filename);
     }
 }
@@ -361,7 +390,7 @@ void screenshot_to_file(struct MPContext *mpctx, const char *filename, int mode,
     bool old_osd = ctx->osd;
     ctx->osd = osd;
 
-    if (mp_path_exists(filename)) {
+    if (file_exists(ctx, filename)) {
         screenshot_msg(ctx, SMSG_ERR, "Screenshot: file '%s' already exists.",
                        filename);
         goto end;
@@ -375,8 +404,7 @@ void screenshot_to_file(struct MPContext *mpctx, const char *filename, int mode,
         goto end;
     }
     screenshot_msg(ctx, SMSG_OK, "Screenshot: '%s'", filename);
-    if (!write_image(image, &opts, filename, mpctx->log))
-        screenshot_msg(ctx, SMSG_ERR, "Error writing screenshot!");
+    image_writer_queue_add(get_queue(ctx), image, &opts, filename);
     talloc_free(image);
 
 end:
@@ -402,6 +430,8 @@ void screenshot_request(struct MPContext *mpctx, int mode, bool each_frame,
     ctx->mode = mode;
     ctx->osd = osd;
 
+    report_errors(ctx);
+
     struct mp_image *image = screenshot_get(mpctx, mode);
 
     if (image) {
@@ -423,3 +453,13 @@ void screenshot_flip(struct MPContext *mpctx)
     ctx->each_frame = false;
     screenshot_request(mpctx, ctx->mode, true, ctx->osd);
 }
+
+void screenshot_flush(struct MPContext *mpctx)
+{
+    screenshot_ctx *ctx = mpctx->screenshot_ctx;
+
+    if (ctx && ctx->queue) {
+        image_writer_queue_flush(ctx->queue);
+        report_errors(ctx);
+    }
+}
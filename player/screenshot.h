@@ -43,4 +43,7 @@ void screenshot_to_file(struct MPContext *mpctx, const char *filename, int mode,
 // Called by the playback core code when a new frame is displayed.
 void screenshot_flip(struct MPContext *mpctx);
 
+// Screenshots are written in the background. Wait until all of them are done.
+void screenshot_flush(struct MPContext *mpctx);
+
 #endif /* MPLAYER_SCREENSHOT_H */
@@ -0,0 +1,215 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Implements --thumbnail-atlas: instead of playing the file, seek to evenly
+ * spaced positions, decode the keyframe at or before each of them, and write
+ * them downscaled into a grid image. Only keyframes are decoded (and at a
+ * lower resolution if the decoder supports it), so no output device, audio
+ * or hardware decoding is involved.
+ */
+
+#include <string.h>
+
+#include "config.h"
+#include "talloc.h"
+
+#include "common/common.h"
+#include "common/msg.h"
+#include "options/options.h"
+#include "osdep/timer.h"
+#include "demux/demux.h"
+#include "demux/stheader.h"
+#include "video/mp_image.h"
+#include "video/sws_utils.h"
+#include "video/image_writer.h"
+#include "video/decode/dec_video.h"
+
+#include "core.h"
+
+// Upper bound for the number of packets read to get a single image.
+#define MAX_PACKETS 1000
+
+// Called before the video decoder is opened.
+void thumbnail_setup_decoder(struct MPContext *mpctx, struct dec_video *d_video)
+{
+    struct MPOpts *opts = mpctx->opts;
+    struct sh_video *sh_video = d_video->header->video;
+
+    d_video->keyframes_only = true;
+
+    // Decode at the smallest scale that is still at least as large as the
+    // thumbnails (lavc supports dividing the size by up to 8).
+    int lowres = 0;
+    while (lowres < 3 &&
+           (sh_video->disp_w >> (lowres + 1)) >= opts->thumbnail_width &&
+           (sh_video->disp_h >> (lowres + 1)) >= opts->thumbnail_height)
+        lowres++;
+    d_video->lowres = lowres;
+}
+
+// Return the next decoded image after a seek, or NULL on EOF or error.
+// If the first packet is the same keyframe as the one of the previous seek,
+// *same is set and nothing is decoded.
+static struct mp_image *decode_image(struct MPContext *mpctx, double *last_pts,
+                                     bool *same)
+{
+    struct dec_video *d_video = mpctx->d_video;
+    *same = false;
+    for (int n = 0; n < MAX_PACKETS; n++) {
+        struct demux_packet *pkt = demux_read_packet(d_video->header);
+        if (!pkt)
+            break;
+        if (n == 0) {
+            if (pkt->pts != MP_NOPTS_VALUE && pkt->pts == *last_pts) {
+                talloc_free(pkt);
+                *same = true;
+                return NULL;
+            }
+            *last_pts = pkt->pts;
+        }
+        struct mp_image *img = video_decode(d_video, pkt, 0);
+        talloc_free(pkt);
+        if (img)
+            return img;
+    }
+    // Drain the frames delayed by the decoder.
+    return video_decode(d_video, NULL, 0);
+}
+
+// Scale img into the given atlas cell, keeping the aspect ratio.
+static void draw_cell(struct mp_sws_context *sws, struct mp_image *atlas,
+                      struct mp_image *img, int x, int y, int cell_w, int cell_h)
+{
+    int d_w = img->display_w ? img->display_w : img->w;
+    int d_h = img->display_h ? img->display_h : img->h;
+    int w = cell_w, h = cell_h;
+    if ((int64_t)d_w * cell_h > (int64_t)d_h * cell_w) {
+        h = MPMAX((int64_t)cell_w * d_h / d_w, 1);
+    } else {
+        w = MPMAX((int64_t)cell_h * d_w / d_h, 1);
+    }
+    x += (cell_w - w) / 2;
+    y += (cell_h - h) / 2;
+
+    struct mp_image area = *atlas;
+    mp_image_crop(&area, x, y, x + w, y + h);
+    mp_sws_scale(sws, &area, img);
+}
+
+static void copy_cell(struct mp_image *atlas, int dx, int dy, int sx, int sy,
+                      int cell_w, int cell_h)
+{
+    struct mp_image dst = *atlas, src = *atlas;
+    mp_image_crop(&dst, dx, dy, dx + cell_w, dy + cell_h);
+    mp_image_crop(&src, sx, sy, sx + cell_w, sy + cell_h);
+    mp_image_copy(&dst, &src);
+}
+
+// Write the atlas for the current file. Returns 1 on success, 0 on error.
+int thumbnail_run(struct MPContext *mpctx)
+{
+    struct MPOpts *opts = mpctx->opts;
+    struct dec_video *d_video = mpctx->d_video;
+    double start_time = mp_time_sec();
+
+    if (!d_video) {
+        MP_ERR(mpctx, "Thumbnails: no video.\n");
+        return 0;
+    }
+    if (mpctx->timeline) {
+        MP_ERR(mpctx, "Thumbnails: files with a timeline are not supported.\n");
+        return 0;
+    }
+    double len = get_time_length(mpctx);
+    if (len <= 0 || !mpctx->demuxer->seekable) {
+        MP_ERR(mpctx, "Thumbnails: unknown duration or unseekable file.\n");
+        return 0;
+    }
+
+    int count = opts->thumbnail_count;
+    int columns = MPMIN(opts->thumbnail_columns, count);
+    int rows = (count + columns - 1) / columns;
+    int cell_w = opts->thumbnail_width;
+    int cell_h = opts->thumbnail_height;
+
+    void *tmp = talloc_new(NULL);
+    struct mp_sws_context *sws = mp_sws_alloc(tmp);
+    sws->flags = mp_sws_fast_flags;
+    struct mp_image *atlas = NULL;
+    double last_pts = MP_NOPTS_VALUE;
+    int done = 0, decoded = 0;
+
+    for (int n = 0; n < count && !mpctx->stop_play; n++) {
+        double pos = get_start_time(mpctx) + len * (n + 0.5) / count;
+        if (!demux_seek(mpctx->demuxer, pos, SEEK_ABSOLUTE | SEEK_BACKWARD))
+            break;
+        video_reset_decoding(d_video);
+
+        bool same;
+        struct mp_image *img = decode_image(mpctx, &last_pts, &same);
+        if (!img && !(same && done > 0)) {
+            MP_WARN(mpctx, "Thumbnails: no image at %f.\n", pos);
+            last_pts = MP_NOPTS_VALUE;
+            continue;
+        }
+
+        if (img) {
+            decoded++;
+            mpctx->decoded_vframes++;
+            if (!atlas) {
+                if (!cell_h) {
+                    int d_w = img->display_w ? img->display_w : img->w;
+                    int d_h = img->display_h ? img->display_h : img->h;
+                    cell_h = MPMAX((cell_w * d_h / d_w + 1) & ~1, 2);
+                }
+                atlas = mp_image_alloc(IMGFMT_RGB24, columns * cell_w,
+                                       rows * cell_h);
+                talloc_steal(tmp, atlas);
+                mp_image_clear(atlas, 0, 0, atlas->w, atlas->h);
+            }
+        }
+
+        int x = (done % columns) * cell_w, y = (done / columns) * cell_h;
+        if (img) {
+            draw_cell(sws, atlas, img, x, y, cell_w, cell_h);
+            talloc_free(img);
+        } else {
+            int prev = done - 1;
+            copy_cell(atlas, x, y, (prev % columns) * cell_w,
+                      (prev / columns) * cell_h, cell_w, cell_h);
+        }
+        done++;
+    }
+
+    int ok = 0;
+    if (!atlas) {
+        MP_ERR(mpctx, "Thumbnails: could not decode any image.\n");
+    } else if (write_image(atlas, opts->screenshot_image_opts,
+                           opts->thumbnail_file, mpctx->log))
+    {
+        double time = mp_time_sec() - start_time;
+        mpctx->thumbnails += done;
+        mpctx->thumbnail_time += time;
+        MP_INFO(mpctx, "Wrote %d thumbnails (%d decoded) to '%s' "
+                "(%.1f thumbnails/s).\n", done, decoded, opts->thumbnail_file,
+                time > 0 ? done / time : 0);
+        ok = 1;
+    }
+
+    talloc_free(tmp);
+    return ok;
+}
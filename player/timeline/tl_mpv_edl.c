@@ -271,3 +271,16 @@ void build_mpv_edl_timeline(struct MPContext *mpctx)
     build_timeline(mpctx, parts);
     talloc_free(parts);
 }
+
+// Return an edl:// URL that plays the given range of a file. If length is
+// negative, play until the end of the file. Times are written exactly, so
+// that segments ending and starting at the same time don't overlap.
+char *mp_edl_range_url(void *talloc_ctx, const char *filename, double start,
+                       double length)
+{
+    char *url = talloc_asprintf(talloc_ctx, "edl://%%%zu%%%s,start=%.17g",
+                                strlen(filename), filename, start);
+    if (length >= 0)
+        url = talloc_asprintf_append(url, ",length=%.17g", length);
+    return url;
+}
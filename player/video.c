@@ -29,6 +29,8 @@
 #include "options/options.h"
 #include "common/common.h"
 #include "common/encode.h"
+#include "common/global.h"
+#include "common/trace.h"
 #include "options/m_property.h"
 
 #include "audio/out/ao.h"
@@ -194,6 +196,9 @@ int reinit_video_chain(struct MPContext *mpctx)
 
     recreate_video_filters(mpctx);
 
+    if (opts->thumbnail_file && opts->thumbnail_file[0])
+        thumbnail_setup_decoder(mpctx, d_video);
+
     if (!video_init_best_codec(d_video, opts->video_decoders))
         goto err_out;
 
@@ -254,8 +259,10 @@ static bool filter_output_queued_frame(struct MPContext *mpctx)
     struct vo *video_out = mpctx->video_out;
 
     struct mp_image *img = vf_output_queued_frame(d_video->vfilter);
-    if (img)
+    if (img) {
+        mpctx->filtered_vframes++;
         vo_queue_image(video_out, img);
+    }
     talloc_free(img);
 
     return !!img;
@@ -312,7 +319,9 @@ static void filter_video(struct MPContext *mpctx, struct mp_image *frame,
     }
 
     mp_image_set_params(frame, &d_video->vf_input); // force csp/aspect overrides
+    struct mp_trace_start t = mp_trace_begin(mpctx->global->trace);
     vf_filter_frame(d_video->vfilter, frame);
+    mp_trace_end(mpctx->global->trace, MP_TRACE_VIDEO_FILTER, t);
     filter_output_queued_frame(mpctx);
 }
 
@@ -350,6 +359,7 @@ static int check_framedrop(struct MPContext *mpctx, double frame_time)
             && !mpctx->restart_playback) {
             mpctx->drop_frame_cnt++;
             mpctx->dropped_frames++;
+            mpctx->dropped_vframes++;
             return mpctx->opts->frame_dropping;
         } else
             mpctx->dropped_frames = 0;
@@ -390,7 +400,10 @@ double update_video(struct MPContext *mpctx, double endpts)
             return -1;
     } else {
         // Decode a new frame
+        struct mp_trace *trace = mpctx->global->trace;
+        struct mp_trace_start t = mp_trace_begin(trace);
         struct demux_packet *pkt = demux_read_packet(d_video->header);
+        mp_trace_end(trace, MP_TRACE_DEMUX_READ, t);
         if (pkt && pkt->pts != MP_NOPTS_VALUE)
             pkt->pts += mpctx->video_offset;
         if ((pkt && pkt->pts >= mpctx->hrseek_pts - .005) ||
@@ -400,10 +413,13 @@ double update_video(struct MPContext *mpctx, double endpts)
         }
         int framedrop_type = mpctx->hrseek_active && mpctx->hrseek_framedrop ?
                              1 : check_framedrop(mpctx, -1);
+        t = mp_trace_begin(trace);
         struct mp_image *decoded_frame =
             video_decode(d_video, pkt, framedrop_type);
+        mp_trace_end(trace, MP_TRACE_VIDEO_DECODE, t);
         talloc_free(pkt);
         if (decoded_frame) {
+            mpctx->decoded_vframes++;
             filter_video(mpctx, decoded_frame, false);
         } else if (!pkt) {
             if (!load_next_vo_frame(mpctx, true))
@@ -92,6 +92,7 @@ struct priv {
 
     bool idle;              // cache thread has stopped reading
     int64_t reads;          // number of actual read attempts performed
+    int64_t hits, misses;   // client reads served without/after waiting
 
     int64_t read_filepos;   // client read position (mirrors cache->pos)
     int control;            // requested STREAM_CTRL_... or CACHE_CTRL_...
@@ -175,9 +176,11 @@ static int cache_read(struct priv *s, unsigned char *buf, int size)
 
     double retry = 0;
     int64_t eof_retry = s->reads - 1; // try at least 1 read on EOF
+    bool waited = false;
     while (s->read_filepos >= s->max_filepos ||
            s->read_filepos < s->min_filepos)
     {
+        waited = true;
         if (s->eof && s->read_filepos >= s->max_filepos && s->reads >= eof_retry)
             return 0;
         if (cache_wakeup_and_wait(s, &retry) == CACHE_INTERRUPTED)
@@ -199,6 +202,11 @@ static int cache_read(struct priv *s, unsigned char *buf, int size)
 
     memcpy(buf, &s->buffer[pos], newb);
 
+    if (waited) {
+        s->misses++;
+    } else {
+        s->hits++;
+    }
     s->read_filepos += newb;
     return newb;
 }
@@ -326,6 +334,12 @@ static int cache_get_cached_control(stream_t *cache, int cmd, void *arg)
     case STREAM_CTRL_GET_CACHE_IDLE:
         *(int *)arg = s->idle;
         return STREAM_OK;
+    case STREAM_CTRL_GET_CACHE_STATS:
+        *(struct stream_cache_stats *)arg = (struct stream_cache_stats){
+            .hits = s->hits,
+            .misses = s->misses,
+        };
+        return STREAM_OK;
     case STREAM_CTRL_GET_TIME_LENGTH:
         *(double *)arg = s->stream_time_length;
         return s->stream_time_length ? STREAM_OK : STREAM_UNSUPPORTED;
@@ -485,6 +485,7 @@ eof_out:
     // When reading succeeded we are obviously not at eof.
     s->eof = 0;
     s->pos += len;
+    s->bytes_read += len;
     stream_capture_write(s, buf, len);
     return len;
 }
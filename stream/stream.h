@@ -87,6 +87,7 @@ enum stream_ctrl {
     STREAM_CTRL_GET_CACHE_SIZE,
     STREAM_CTRL_GET_CACHE_FILL,
     STREAM_CTRL_GET_CACHE_IDLE,
+    STREAM_CTRL_GET_CACHE_STATS,        // struct stream_cache_stats*
     STREAM_CTRL_RESUME_CACHE,
     STREAM_CTRL_RECONNECT,
     // DVD/Bluray, signal general support for GET_CURRENT_TIME etc.
@@ -107,6 +108,11 @@ struct stream_lang_req {
     char name[50];
 };
 
+struct stream_cache_stats {
+    int64_t hits;       // reads served from the cache without waiting
+    int64_t misses;     // reads that had to wait for the cache thread
+};
+
 struct stream_dvd_info_req {
     unsigned int palette[16];
     int num_subs;
@@ -148,6 +154,7 @@ typedef struct stream {
     int read_chunk; // maximum amount of data to read at once to limit latency
     unsigned int buf_pos, buf_len;
     int64_t pos, start_pos, end_pos;
+    int64_t bytes_read; // total bytes returned by fill_buffer
     int eof;
     int mode; //STREAM_READ or STREAM_WRITE
     bool streaming;     // known to be a network stream if true
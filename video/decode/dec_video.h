@@ -79,6 +79,11 @@ struct dec_video {
     float fps;            // FPS from demuxer or from user override
     float initial_decoder_aspect;
 
+    // Set by the player before the decoder is opened (thumbnail mode). They
+    // take precedence over the --vd-lavc-skipframe/lowres options.
+    bool keyframes_only;    // decode only keyframes
+    int lowres;             // if > 0, decode at 1/2^lowres of the size
+
     // State used only by player/video.c
     double last_pts;
 };
@@ -77,6 +77,7 @@ const m_option_t lavc_decode_opts_conf[] = {
     OPT_STRING("skiploopfilter", lavc_param.skip_loop_filter_str, 0),
     OPT_STRING("skipidct", lavc_param.skip_idct_str, 0),
     OPT_STRING("skipframe", lavc_param.skip_frame_str, 0),
+    OPT_INTRANGE("lowres", lavc_param.lowres, 0, 0, 3),
     OPT_INTRANGE("threads", lavc_param.threads, 0, 0, 16),
     OPT_FLAG_CONSTANTS("bitexact", lavc_param.bitexact, 0, 0, CODEC_FLAG_BITEXACT),
     OPT_FLAG("check-hw-profile", lavc_param.check_hw_profile, 0),
@@ -387,6 +388,16 @@ static void init_avctx(struct dec_video *vd, const char *decoder,
     avctx->skip_loop_filter = str2AVDiscard(vd, lavc_param->skip_loop_filter_str);
     avctx->skip_idct = str2AVDiscard(vd, lavc_param->skip_idct_str);
     avctx->skip_frame = str2AVDiscard(vd, lavc_param->skip_frame_str);
+    if (vd->keyframes_only)
+        avctx->skip_frame = AVDISCARD_NONKEY;
+
+    // Only some decoders support this (and only FFmpeg has it at all). lavc
+    // limits it to what the decoder supports when opening it.
+    int lowres = vd->lowres > 0 ? vd->lowres : lavc_param->lowres;
+    if (lowres > 0 && !ctx->hwdec) {
+        if (av_opt_set_int(avctx, "lowres", lowres, 0) < 0)
+            MP_VERBOSE(vd, "Decoding at lower resolution not supported.\n");
+    }
 
     if (lavc_param->avopt) {
         if (parse_avopts(avctx, lavc_param->avopt) < 0) {
@@ -0,0 +1,757 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#include "common/common.h"
+#include "common/cpudetect.h"
+#include "pixel_kernels.h"
+
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+#if HAVE_NEON_INTRINSICS
+#include <arm_neon.h>
+#endif
+
+static void affine_c(uint8_t *dst, const uint8_t *src, int w,
+                     int contrast, int brightness)
+{
+    for (int x = 0; x < w; x++) {
+        int pel = ((src[x] * contrast) >> 12) + brightness;
+        dst[x] = MPCLAMP(pel, 0, 255);
+    }
+}
+
+static void add_noise_c(uint8_t *dst, const uint8_t *src, const int8_t *noise,
+                        int w)
+{
+    for (int x = 0; x < w; x++) {
+        int v = src[x] + noise[x];
+        dst[x] = MPCLAMP(v, 0, 255);
+    }
+}
+
+static void add_noise_avg_c(uint8_t *dst, const uint8_t *src,
+                            int8_t *const shift[3], int w)
+{
+    const int8_t *src2 = (const int8_t *)src;
+    for (int x = 0; x < w; x++) {
+        int n = shift[0][x] + shift[1][x] + shift[2][x];
+        dst[x] = src2[x] + ((n * src2[x]) >> 7);
+    }
+}
+
+static void pair_sum_c(uint32_t *buf, int w)
+{
+    for (int x = 0; x < w; x++)
+        buf[x] += buf[x + 1];
+}
+
+// Run the C version on [x0, w).
+static void blur_v_tail(uint32_t *row, uint32_t *const *st, int n, int x0,
+                        int w)
+{
+    for (int x = x0; x < w; x++) {
+        uint32_t t = row[x];
+        for (int i = 0; i < n; i++) {
+            uint32_t prev = st[i][x];
+            st[i][x] = t;
+            t += prev;
+        }
+        row[x] = t;
+    }
+}
+
+static void blur_v_c(uint32_t *row, uint32_t *const *st, int n, int w)
+{
+    blur_v_tail(row, st, n, 0, w);
+}
+
+static void sharpen_c(uint8_t *dst, const uint8_t *src, const uint32_t *blur,
+                      int w, int amount, int scalebits)
+{
+    uint32_t half = 1u << (scalebits - 1);
+    for (int x = 0; x < w; x++) {
+        int32_t b = (blur[x] + half) >> scalebits;
+        int32_t res = src[x] + (((src[x] - b) * amount) >> 16);
+        dst[x] = MPCLAMP(res, 0, 255);
+    }
+}
+
+static void blend_c(uint8_t *dst, const uint8_t *a, const uint8_t *b, int w,
+                    int weight)
+{
+    for (int x = 0; x < w; x++)
+        dst[x] = (a[x] * (256 - weight) + b[x] * weight + 128) >> 8;
+}
+
+static unsigned int sad_row_c(const uint8_t *a, const uint8_t *b, int x0, int w)
+{
+    unsigned int sum = 0;
+    for (int x = x0; x < w; x++)
+        sum += abs(a[x] - b[x]);
+    return sum;
+}
+
+static unsigned int sad_c(const uint8_t *a, int a_stride,
+                          const uint8_t *b, int b_stride, int w, int h)
+{
+    unsigned int sum = 0;
+    for (int y = 0; y < h; y++)
+        sum += sad_row_c(a + y * a_stride, b + y * b_stride, 0, w);
+    return sum;
+}
+
+static const struct mp_pixel_kernels kernels_c = {
+    .name = "C",
+    .affine = affine_c,
+    .add_noise = add_noise_c,
+    .add_noise_avg = add_noise_avg_c,
+    .pair_sum = pair_sum_c,
+    .blur_v = blur_v_c,
+    .sharpen = sharpen_c,
+    .blend = blend_c,
+    .sad = sad_c,
+};
+
+#if HAVE_X86_INTRINSICS
+
+__attribute__((target("sse2")))
+static void affine_sse2(uint8_t *dst, const uint8_t *src, int w,
+                        int contrast, int brightness)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i c = _mm_set1_epi16(contrast), b = _mm_set1_epi16(brightness);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + x));
+        // (s << 4) * c >> 16 == s * c >> 12
+        __m128i lo = _mm_slli_epi16(_mm_unpacklo_epi8(s, zero), 4);
+        __m128i hi = _mm_slli_epi16(_mm_unpackhi_epi8(s, zero), 4);
+        // Saturate, so that large brightness values don't wrap around.
+        lo = _mm_adds_epi16(_mm_mulhi_epi16(lo, c), b);
+        hi = _mm_adds_epi16(_mm_mulhi_epi16(hi, c), b);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    affine_c(dst + x, src + x, w - x, contrast, brightness);
+}
+
+__attribute__((target("sse2")))
+static void add_noise_sse2(uint8_t *dst, const uint8_t *src,
+                           const int8_t *noise, int w)
+{
+    // Signed saturation around 0x80 is unsigned saturation.
+    __m128i sign = _mm_set1_epi8(0x80);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i n = _mm_loadu_si128((const __m128i *)(noise + x));
+        s = _mm_adds_epi8(_mm_xor_si128(s, sign), n);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_xor_si128(s, sign));
+    }
+    add_noise_c(dst + x, src + x, noise + x, w - x);
+}
+
+// Sign extend the low/high 8 bytes to int16.
+#define SEXT_LO_SSE2(v) _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8)
+#define SEXT_HI_SSE2(v) _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8)
+
+__attribute__((target("sse2")))
+static __m128i noise_avg_sse2(__m128i s, __m128i a, __m128i b, __m128i c)
+{
+    // Only the low 8 bits of the result are needed, and bits 7-14 of the
+    // product are the same in the 16 bit product.
+    __m128i n = _mm_add_epi16(_mm_add_epi16(a, b), c);
+    __m128i t = _mm_srai_epi16(_mm_mullo_epi16(n, s), 7);
+    return _mm_and_si128(_mm_add_epi16(s, t), _mm_set1_epi16(0xFF));
+}
+
+__attribute__((target("sse2")))
+static void add_noise_avg_sse2(uint8_t *dst, const uint8_t *src,
+                               int8_t *const shift[3], int w)
+{
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i a = _mm_loadu_si128((const __m128i *)(shift[0] + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(shift[1] + x));
+        __m128i c = _mm_loadu_si128((const __m128i *)(shift[2] + x));
+        __m128i lo = noise_avg_sse2(SEXT_LO_SSE2(s), SEXT_LO_SSE2(a),
+                                    SEXT_LO_SSE2(b), SEXT_LO_SSE2(c));
+        __m128i hi = noise_avg_sse2(SEXT_HI_SSE2(s), SEXT_HI_SSE2(a),
+                                    SEXT_HI_SSE2(b), SEXT_HI_SSE2(c));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    int8_t *const shift2[3] = {shift[0] + x, shift[1] + x, shift[2] + x};
+    add_noise_avg_c(dst + x, src + x, shift2, w - x);
+}
+
+__attribute__((target("sse2")))
+static void pair_sum_sse2(uint32_t *buf, int w)
+{
+    int x = 0;
+    for (; x + 4 <= w; x += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(buf + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(buf + x + 1));
+        _mm_storeu_si128((__m128i *)(buf + x), _mm_add_epi32(a, b));
+    }
+    pair_sum_c(buf + x, w - x);
+}
+
+__attribute__((target("sse2")))
+static void blur_v_sse2(uint32_t *row, uint32_t *const *st, int n, int w)
+{
+    int x = 0;
+    for (; x + 4 <= w; x += 4) {
+        __m128i t = _mm_loadu_si128((const __m128i *)(row + x));
+        for (int i = 0; i < n; i++) {
+            __m128i prev = _mm_loadu_si128((const __m128i *)(st[i] + x));
+            _mm_storeu_si128((__m128i *)(st[i] + x), t);
+            t = _mm_add_epi32(t, prev);
+        }
+        _mm_storeu_si128((__m128i *)(row + x), t);
+    }
+    blur_v_tail(row, st, n, x, w);
+}
+
+// Low 32 bits of a * b (SSE2 has no pmulld).
+__attribute__((target("sse2")))
+static __m128i mullo32_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__attribute__((target("sse2")))
+static __m128i sharpen4_sse2(__m128i s, const uint32_t *blur, __m128i half,
+                             __m128i shift, __m128i amount)
+{
+    __m128i b = _mm_loadu_si128((const __m128i *)blur);
+    b = _mm_srl_epi32(_mm_add_epi32(b, half), shift);
+    __m128i d = mullo32_sse2(_mm_sub_epi32(s, b), amount);
+    return _mm_add_epi32(s, _mm_srai_epi32(d, 16));
+}
+
+__attribute__((target("sse2")))
+static void sharpen_sse2(uint8_t *dst, const uint8_t *src, const uint32_t *blur,
+                         int w, int amount, int scalebits)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i half = _mm_set1_epi32(1u << (scalebits - 1));
+    __m128i shift = _mm_cvtsi32_si128(scalebits);
+    __m128i am = _mm_set1_epi32(amount);
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        __m128i s = _mm_loadl_epi64((const __m128i *)(src + x));
+        s = _mm_unpacklo_epi8(s, zero);
+        __m128i lo = sharpen4_sse2(_mm_unpacklo_epi16(s, zero), blur + x,
+                                   half, shift, am);
+        __m128i hi = sharpen4_sse2(_mm_unpackhi_epi16(s, zero), blur + x + 4,
+                                   half, shift, am);
+        __m128i r = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(r, r));
+    }
+    sharpen_c(dst + x, src + x, blur + x, w - x, amount, scalebits);
+}
+
+// The products and the sum fit into 16 bits: 255 * 256 + 128 < 65536.
+__attribute__((target("sse2")))
+static void blend_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b, int w,
+                       int weight)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i wa = _mm_set1_epi16(256 - weight), wb = _mm_set1_epi16(weight);
+    __m128i round = _mm_set1_epi16(128);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + x));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + x));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    blend_c(dst + x, a + x, b + x, w - x, weight);
+}
+
+__attribute__((target("sse2")))
+static unsigned int sad_sse2(const uint8_t *a, int a_stride,
+                             const uint8_t *b, int b_stride, int w, int h)
+{
+    __m128i acc = _mm_setzero_si128();
+    unsigned int sum = 0;
+    for (int y = 0; y < h; y++) {
+        int x = 0;
+        for (; x + 16 <= w; x += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + x));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + x));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+        }
+        if (x + 8 <= w) {
+            __m128i va = _mm_loadl_epi64((const __m128i *)(a + x));
+            __m128i vb = _mm_loadl_epi64((const __m128i *)(b + x));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+            x += 8;
+        }
+        sum += sad_row_c(a, b, x, w);
+        a += a_stride;
+        b += b_stride;
+    }
+    acc = _mm_add_epi64(acc, _mm_srli_si128(acc, 8));
+    return sum + _mm_cvtsi128_si32(acc);
+}
+
+static const struct mp_pixel_kernels kernels_sse2 = {
+    .name = "SSE2",
+    .simd = true,
+    .affine = affine_sse2,
+    .add_noise = add_noise_sse2,
+    .add_noise_avg = add_noise_avg_sse2,
+    .pair_sum = pair_sum_sse2,
+    .blur_v = blur_v_sse2,
+    .sharpen = sharpen_sse2,
+    .blend = blend_sse2,
+    .sad = sad_sse2,
+};
+
+// The AVX2 versions unpack and pack within 128 bit lanes, which keeps the
+// byte order intact without any permutes.
+//
+// The explicit _mm256_zeroupper() before handing the rest of the line to the
+// SSE2/C versions is needed with gcc (checked with 12.2 at -O2): normally it
+// inserts vzeroupper before calls, but with -fipa-ra it omits it for calls
+// to functions defined earlier in the same file, because it knows that they
+// don't use the ymm registers. affine_avx2 then compiles to a plain
+// "jmp affine_sse2", and the dirty upper halves make the following SSE code
+// (in the callee and in the caller after return) slower on most CPUs. The
+// AVX2 functions in vf_gradfun.c are in the same situation.
+
+__attribute__((target("avx2")))
+static void affine_avx2(uint8_t *dst, const uint8_t *src, int w,
+                        int contrast, int brightness)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i c = _mm256_set1_epi16(contrast), b = _mm256_set1_epi16(brightness);
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + x));
+        __m256i lo = _mm256_slli_epi16(_mm256_unpacklo_epi8(s, zero), 4);
+        __m256i hi = _mm256_slli_epi16(_mm256_unpackhi_epi8(s, zero), 4);
+        lo = _mm256_adds_epi16(_mm256_mulhi_epi16(lo, c), b);
+        hi = _mm256_adds_epi16(_mm256_mulhi_epi16(hi, c), b);
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper();
+    affine_sse2(dst + x, src + x, w - x, contrast, brightness);
+}
+
+__attribute__((target("avx2")))
+static void add_noise_avx2(uint8_t *dst, const uint8_t *src,
+                           const int8_t *noise, int w)
+{
+    __m256i sign = _mm256_set1_epi8(0x80);
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + x));
+        __m256i n = _mm256_loadu_si256((const __m256i *)(noise + x));
+        s = _mm256_adds_epi8(_mm256_xor_si256(s, sign), n);
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_xor_si256(s, sign));
+    }
+    _mm256_zeroupper();
+    add_noise_sse2(dst + x, src + x, noise + x, w - x);
+}
+
+#define SEXT_LO_AVX2(v) _mm256_srai_epi16(_mm256_unpacklo_epi8(v, v), 8)
+#define SEXT_HI_AVX2(v) _mm256_srai_epi16(_mm256_unpackhi_epi8(v, v), 8)
+
+__attribute__((target("avx2")))
+static __m256i noise_avg_avx2(__m256i s, __m256i a, __m256i b, __m256i c)
+{
+    __m256i n = _mm256_add_epi16(_mm256_add_epi16(a, b), c);
+    __m256i t = _mm256_srai_epi16(_mm256_mullo_epi16(n, s), 7);
+    return _mm256_and_si256(_mm256_add_epi16(s, t), _mm256_set1_epi16(0xFF));
+}
+
+__attribute__((target("avx2")))
+static void add_noise_avg_avx2(uint8_t *dst, const uint8_t *src,
+                               int8_t *const shift[3], int w)
+{
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + x));
+        __m256i a = _mm256_loadu_si256((const __m256i *)(shift[0] + x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(shift[1] + x));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(shift[2] + x));
+        __m256i lo = noise_avg_avx2(SEXT_LO_AVX2(s), SEXT_LO_AVX2(a),
+                                    SEXT_LO_AVX2(b), SEXT_LO_AVX2(c));
+        __m256i hi = noise_avg_avx2(SEXT_HI_AVX2(s), SEXT_HI_AVX2(a),
+                                    SEXT_HI_AVX2(b), SEXT_HI_AVX2(c));
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper();
+    int8_t *const shift2[3] = {shift[0] + x, shift[1] + x, shift[2] + x};
+    add_noise_avg_sse2(dst + x, src + x, shift2, w - x);
+}
+
+__attribute__((target("avx2")))
+static void pair_sum_avx2(uint32_t *buf, int w)
+{
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(buf + x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(buf + x + 1));
+        _mm256_storeu_si256((__m256i *)(buf + x), _mm256_add_epi32(a, b));
+    }
+    _mm256_zeroupper();
+    pair_sum_c(buf + x, w - x);
+}
+
+__attribute__((target("avx2")))
+static void blur_v_avx2(uint32_t *row, uint32_t *const *st, int n, int w)
+{
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        __m256i t = _mm256_loadu_si256((const __m256i *)(row + x));
+        for (int i = 0; i < n; i++) {
+            __m256i prev = _mm256_loadu_si256((const __m256i *)(st[i] + x));
+            _mm256_storeu_si256((__m256i *)(st[i] + x), t);
+            t = _mm256_add_epi32(t, prev);
+        }
+        _mm256_storeu_si256((__m256i *)(row + x), t);
+    }
+    _mm256_zeroupper();
+    blur_v_tail(row, st, n, x, w);
+}
+
+// Returns the 8 results as int16.
+__attribute__((target("avx2")))
+static __m128i sharpen8_avx2(const uint8_t *src, const uint32_t *blur,
+                             __m256i half, __m128i shift, __m256i amount)
+{
+    __m256i s = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)src));
+    __m256i b = _mm256_loadu_si256((const __m256i *)blur);
+    b = _mm256_srl_epi32(_mm256_add_epi32(b, half), shift);
+    __m256i d = _mm256_mullo_epi32(_mm256_sub_epi32(s, b), amount);
+    d = _mm256_add_epi32(s, _mm256_srai_epi32(d, 16));
+    return _mm_packs_epi32(_mm256_castsi256_si128(d),
+                           _mm256_extracti128_si256(d, 1));
+}
+
+__attribute__((target("avx2")))
+static void sharpen_avx2(uint8_t *dst, const uint8_t *src, const uint32_t *blur,
+                         int w, int amount, int scalebits)
+{
+    __m256i half = _mm256_set1_epi32(1u << (scalebits - 1));
+    __m128i shift = _mm_cvtsi32_si128(scalebits);
+    __m256i am = _mm256_set1_epi32(amount);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i lo = sharpen8_avx2(src + x, blur + x, half, shift, am);
+        __m128i hi = sharpen8_avx2(src + x + 8, blur + x + 8, half, shift, am);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper();
+    sharpen_sse2(dst + x, src + x, blur + x, w - x, amount, scalebits);
+}
+
+__attribute__((target("avx2")))
+static void blend_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b, int w,
+                       int weight)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i wa = _mm256_set1_epi16(256 - weight), wb = _mm256_set1_epi16(weight);
+    __m256i round = _mm256_set1_epi16(128);
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + x));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + x));
+        __m256i lo = _mm256_add_epi16(
+                        _mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), wa),
+                        _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), wb));
+        __m256i hi = _mm256_add_epi16(
+                        _mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), wa),
+                        _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), wb));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper();
+    blend_sse2(dst + x, a + x, b + x, w - x, weight);
+}
+
+__attribute__((target("avx2")))
+static unsigned int sad_avx2(const uint8_t *a, int a_stride,
+                             const uint8_t *b, int b_stride, int w, int h)
+{
+    __m256i acc = _mm256_setzero_si256();
+    __m128i acc2 = _mm_setzero_si128();
+    unsigned int sum = 0;
+    for (int y = 0; y < h; y++) {
+        int x = 0;
+        for (; x + 32 <= w; x += 32) {
+            __m256i va = _mm256_loadu_si256((const __m256i *)(a + x));
+            __m256i vb = _mm256_loadu_si256((const __m256i *)(b + x));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+        }
+        if (x + 16 <= w) {
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + x));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + x));
+            acc2 = _mm_add_epi64(acc2, _mm_sad_epu8(va, vb));
+            x += 16;
+        }
+        if (x + 8 <= w) {
+            __m128i va = _mm_loadl_epi64((const __m128i *)(a + x));
+            __m128i vb = _mm_loadl_epi64((const __m128i *)(b + x));
+            acc2 = _mm_add_epi64(acc2, _mm_sad_epu8(va, vb));
+            x += 8;
+        }
+        sum += sad_row_c(a, b, x, w);
+        a += a_stride;
+        b += b_stride;
+    }
+    acc2 = _mm_add_epi64(acc2, _mm256_castsi256_si128(acc));
+    acc2 = _mm_add_epi64(acc2, _mm256_extracti128_si256(acc, 1));
+    acc2 = _mm_add_epi64(acc2, _mm_srli_si128(acc2, 8));
+    return sum + _mm_cvtsi128_si32(acc2);
+}
+
+static const struct mp_pixel_kernels kernels_avx2 = {
+    .name = "AVX2",
+    .simd = true,
+    .affine = affine_avx2,
+    .add_noise = add_noise_avx2,
+    .add_noise_avg = add_noise_avg_avx2,
+    .pair_sum = pair_sum_avx2,
+    .blur_v = blur_v_avx2,
+    .sharpen = sharpen_avx2,
+    .blend = blend_avx2,
+    .sad = sad_avx2,
+};
+
+#endif /* HAVE_X86_INTRINSICS */
+
+#if HAVE_NEON_INTRINSICS
+
+#ifdef __aarch64__
+// 256 entry table lookup with 4 64 byte tables. Out of range indexes return
+// 0 with tbl, so the 4 partial results can be ORed together.
+static void lut_neon(uint8_t *dst, const uint8_t *src, int w, const uint8_t *lut)
+{
+    uint8x16x4_t t[4];
+    for (int n = 0; n < 4; n++) {
+        for (int i = 0; i < 4; i++)
+            t[n].val[i] = vld1q_u8(lut + n * 64 + i * 16);
+    }
+    uint8x16_t off = vdupq_n_u8(64);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        uint8x16_t i = vld1q_u8(src + x);
+        uint8x16_t r = vqtbl4q_u8(t[0], i);
+        i = vsubq_u8(i, off);
+        r = vorrq_u8(r, vqtbl4q_u8(t[1], i));
+        i = vsubq_u8(i, off);
+        r = vorrq_u8(r, vqtbl4q_u8(t[2], i));
+        i = vsubq_u8(i, off);
+        r = vorrq_u8(r, vqtbl4q_u8(t[3], i));
+        vst1q_u8(dst + x, r);
+    }
+    for (; x < w; x++)
+        dst[x] = lut[src[x]];
+}
+#endif
+
+static void affine_neon(uint8_t *dst, const uint8_t *src, int w,
+                        int contrast, int brightness)
+{
+    int16x4_t c = vdup_n_s16(contrast);
+    int32x4_t b = vdupq_n_s32(brightness);
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        int16x8_t s = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src + x)));
+        int32x4_t lo = vshrq_n_s32(vmull_s16(vget_low_s16(s), c), 12);
+        int32x4_t hi = vshrq_n_s32(vmull_s16(vget_high_s16(s), c), 12);
+        lo = vaddq_s32(lo, b);
+        hi = vaddq_s32(hi, b);
+        int16x8_t r = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+        vst1_u8(dst + x, vqmovun_s16(r));
+    }
+    affine_c(dst + x, src + x, w - x, contrast, brightness);
+}
+
+static void add_noise_neon(uint8_t *dst, const uint8_t *src,
+                           const int8_t *noise, int w)
+{
+    uint8x16_t sign = vdupq_n_u8(0x80);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        int8x16_t s = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(src + x), sign));
+        s = vqaddq_s8(s, vld1q_s8(noise + x));
+        vst1q_u8(dst + x, veorq_u8(vreinterpretq_u8_s8(s), sign));
+    }
+    add_noise_c(dst + x, src + x, noise + x, w - x);
+}
+
+static void add_noise_avg_neon(uint8_t *dst, const uint8_t *src,
+                               int8_t *const shift[3], int w)
+{
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        int16x8_t s = vmovl_s8(vld1_s8((const int8_t *)src + x));
+        int16x8_t n = vmovl_s8(vld1_s8(shift[0] + x));
+        n = vaddw_s8(n, vld1_s8(shift[1] + x));
+        n = vaddw_s8(n, vld1_s8(shift[2] + x));
+        // Only the low 8 bits of the result are needed, and bits 7-14 of the
+        // product are the same in the 16 bit product.
+        int16x8_t r = vaddq_s16(s, vshrq_n_s16(vmulq_s16(n, s), 7));
+        vst1_u8(dst + x, vreinterpret_u8_s8(vmovn_s16(r)));
+    }
+    int8_t *const shift2[3] = {shift[0] + x, shift[1] + x, shift[2] + x};
+    add_noise_avg_c(dst + x, src + x, shift2, w - x);
+}
+
+static void pair_sum_neon(uint32_t *buf, int w)
+{
+    int x = 0;
+    for (; x + 4 <= w; x += 4)
+        vst1q_u32(buf + x, vaddq_u32(vld1q_u32(buf + x), vld1q_u32(buf + x + 1)));
+    pair_sum_c(buf + x, w - x);
+}
+
+static void blur_v_neon(uint32_t *row, uint32_t *const *st, int n, int w)
+{
+    int x = 0;
+    for (; x + 4 <= w; x += 4) {
+        uint32x4_t t = vld1q_u32(row + x);
+        for (int i = 0; i < n; i++) {
+            uint32x4_t prev = vld1q_u32(st[i] + x);
+            vst1q_u32(st[i] + x, t);
+            t = vaddq_u32(t, prev);
+        }
+        vst1q_u32(row + x, t);
+    }
+    blur_v_tail(row, st, n, x, w);
+}
+
+static int16x4_t sharpen4_neon(uint16x4_t src, const uint32_t *blur,
+                               uint32x4_t half, int32x4_t shift, int32_t amount)
+{
+    int32x4_t s = vreinterpretq_s32_u32(vmovl_u16(src));
+    uint32x4_t b = vshlq_u32(vaddq_u32(vld1q_u32(blur), half), shift);
+    int32x4_t d = vmulq_n_s32(vsubq_s32(s, vreinterpretq_s32_u32(b)), amount);
+    return vqmovn_s32(vaddq_s32(s, vshrq_n_s32(d, 16)));
+}
+
+static void sharpen_neon(uint8_t *dst, const uint8_t *src, const uint32_t *blur,
+                         int w, int amount, int scalebits)
+{
+    uint32x4_t half = vdupq_n_u32(1u << (scalebits - 1));
+    int32x4_t shift = vdupq_n_s32(-scalebits);
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        uint16x8_t s = vmovl_u8(vld1_u8(src + x));
+        int16x4_t lo = sharpen4_neon(vget_low_u16(s), blur + x, half, shift,
+                                     amount);
+        int16x4_t hi = sharpen4_neon(vget_high_u16(s), blur + x + 4, half,
+                                     shift, amount);
+        vst1_u8(dst + x, vqmovun_s16(vcombine_s16(lo, hi)));
+    }
+    sharpen_c(dst + x, src + x, blur + x, w - x, amount, scalebits);
+}
+
+static void blend_neon(uint8_t *dst, const uint8_t *a, const uint8_t *b, int w,
+                       int weight)
+{
+    // The weights must fit into 8 bits for vmull_u8.
+    if (weight <= 0 || weight >= 256) {
+        memcpy(dst, weight <= 0 ? a : b, w);
+        return;
+    }
+    uint8x8_t wa = vdup_n_u8(256 - weight), wb = vdup_n_u8(weight);
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        uint16x8_t t = vmull_u8(vld1_u8(a + x), wa);
+        t = vmlal_u8(t, vld1_u8(b + x), wb);
+        vst1_u8(dst + x, vrshrn_n_u16(t, 8));
+    }
+    blend_c(dst + x, a + x, b + x, w - x, weight);
+}
+
+static unsigned int sad_neon(const uint8_t *a, int a_stride,
+                             const uint8_t *b, int b_stride, int w, int h)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    unsigned int sum = 0;
+    for (int y = 0; y < h; y++) {
+        // At most 1024/8 * 255 per lane, which fits into 16 bits.
+        uint16x8_t row = vdupq_n_u16(0);
+        int x = 0;
+        for (; x + 8 <= w; x += 8)
+            row = vabal_u8(row, vld1_u8(a + x), vld1_u8(b + x));
+        acc = vpadalq_u16(acc, row);
+        sum += sad_row_c(a, b, x, w);
+        a += a_stride;
+        b += b_stride;
+    }
+    uint64x2_t t = vpaddlq_u32(acc);
+    return sum + (unsigned int)(vgetq_lane_u64(t, 0) + vgetq_lane_u64(t, 1));
+}
+
+static const struct mp_pixel_kernels kernels_neon = {
+    .name = "NEON",
+    .simd = true,
+#ifdef __aarch64__
+    .lut = lut_neon,
+#endif
+    .affine = affine_neon,
+    .add_noise = add_noise_neon,
+    .add_noise_avg = add_noise_avg_neon,
+    .pair_sum = pair_sum_neon,
+    .blur_v = blur_v_neon,
+    .sharpen = sharpen_neon,
+    .blend = blend_neon,
+    .sad = sad_neon,
+};
+
+#endif /* HAVE_NEON_INTRINSICS */
+
+const struct mp_pixel_kernels *mp_get_pixel_kernels(void)
+{
+#if HAVE_NEON_INTRINSICS
+    return &kernels_neon;
+#endif
+#if HAVE_X86_INTRINSICS
+    if (gCpuCaps.hasAVX2)
+        return &kernels_avx2;
+    if (gCpuCaps.hasSSE2)
+        return &kernels_sse2;
+#endif
+    return &kernels_c;
+}
+
+const struct mp_pixel_kernels *mp_get_pixel_kernels_c(void)
+{
+    return &kernels_c;
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_PIXEL_KERNELS_H
+#define MP_PIXEL_KERNELS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-line kernels shared by the simple 8 bit video filters (eq, unsharp,
+// noise, interpolate). All versions of a kernel produce bit-identical results
+// (run TOOLS/simd_check after changing any of them).
+// None of them requires any particular alignment of the pointers or the width.
+struct mp_pixel_kernels {
+    const char *name;   // "C", "SSE2", "AVX2", "NEON"
+    bool simd;          // false for the plain C versions
+
+    // dst[x] = lut[src[x]]
+    // NULL if there is no accelerated version; the caller is expected to
+    // use its own C implementation then.
+    void (*lut)(uint8_t *dst, const uint8_t *src, int w, const uint8_t *lut);
+
+    // dst[x] = clip_uint8(((src[x] * contrast) >> 12) + brightness)
+    // contrast and brightness must be within [-32768, 32767], and
+    // src[x] * contrast must fit into int32_t.
+    void (*affine)(uint8_t *dst, const uint8_t *src, int w,
+                   int contrast, int brightness);
+
+    // dst[x] = clip_uint8(src[x] + noise[x])
+    void (*add_noise)(uint8_t *dst, const uint8_t *src, const int8_t *noise,
+                      int w);
+
+    // dst[x] = s + ((n * s) >> 7) (truncated to 8 bits), with s being
+    // src[x] interpreted as int8_t, and n = shift[0][x]+shift[1][x]+shift[2][x]
+    void (*add_noise_avg)(uint8_t *dst, const uint8_t *src,
+                          int8_t *const shift[3], int w);
+
+    // buf[x] += buf[x + 1] for x in [0, w). buf has w + 1 elements.
+    // Applying this n times to a row is a binomial filter of order n.
+    void (*pair_sum)(uint32_t *buf, int w);
+
+    // One row step of a vertical binomial filter of order n. st[] are n rows
+    // of filter state (all zero initially):
+    //   for each x: t = row[x]; for each i: swap(st[i][x], t), t += st[i][x];
+    //   row[x] = t
+    void (*blur_v)(uint32_t *row, uint32_t *const *st, int n, int w);
+
+    // Unsharp mask with the blurred row:
+    //   b = (blur[x] + (1 << (scalebits - 1))) >> scalebits
+    //   dst[x] = clip_uint8(src[x] + (((src[x] - b) * amount) >> 16))
+    // scalebits must be within [1, 31], |amount| < (1 << 23).
+    void (*sharpen)(uint8_t *dst, const uint8_t *src, const uint32_t *blur,
+                    int w, int amount, int scalebits);
+
+    // dst[x] = (a[x] * (256 - weight) + b[x] * weight + 128) >> 8
+    // weight must be within [0, 256].
+    void (*blend)(uint8_t *dst, const uint8_t *a, const uint8_t *b, int w,
+                  int weight);
+
+    // Sum of absolute differences between the w*h blocks at a and b.
+    // w must be at most 1024.
+    unsigned int (*sad)(const uint8_t *a, int a_stride,
+                        const uint8_t *b, int b_stride, int w, int h);
+};
+
+// Return the fastest kernels supported by the CPU (this uses gCpuCaps).
+const struct mp_pixel_kernels *mp_get_pixel_kernels(void);
+
+// Return the plain C kernels.
+const struct mp_pixel_kernels *mp_get_pixel_kernels_c(void);
+
+#endif
@@ -21,8 +21,17 @@
 #include <string.h>
 #include "config.h"
 #include "pullup.h"
+#include "talloc.h"
 #include "common/cpudetect.h"
 #include "common/common.h"
+#include "misc/thread_pool.h"
+
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+#if HAVE_NEON_INTRINSICS
+#include <arm_neon.h>
+#endif
 
 
 
@@ -212,6 +221,148 @@ static int var_y_mmx(unsigned char *a, unsigned char *b, int s)
 #endif
 #endif
 
+#if HAVE_X86_INTRINSICS
+/* These are bit-exact with the C versions below. Each call handles one 8x4
+ * block (8x3 rows for var); the rows are s bytes apart. */
+
+#define LOAD_2ROWS(p, s) _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(p)), \
+                                            _mm_loadl_epi64((const __m128i *)((p) + (s))))
+
+__attribute__((target("sse2")))
+static int hsum_epi64_sse2(__m128i v)
+{
+	return _mm_cvtsi128_si32(v) + _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+}
+
+__attribute__((target("sse2")))
+static int diff_y_sse2(unsigned char *a, unsigned char *b, int s)
+{
+	__m128i d0 = _mm_sad_epu8(LOAD_2ROWS(a, s), LOAD_2ROWS(b, s));
+	__m128i d1 = _mm_sad_epu8(LOAD_2ROWS(a + 2*s, s), LOAD_2ROWS(b + 2*s, s));
+	return hsum_epi64_sse2(_mm_add_epi64(d0, d1));
+}
+
+__attribute__((target("sse2")))
+static int licomb_y_sse2(unsigned char *a, unsigned char *b, int s)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = zero;
+	int i;
+	for (i = 0; i < 4; i++) {
+		__m128i va  = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)a), zero);
+		__m128i vap = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(a + s)), zero);
+		__m128i vb  = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)b), zero);
+		__m128i vbm = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(b - s)), zero);
+		__m128i t0 = _mm_sub_epi16(_mm_add_epi16(va, va), _mm_add_epi16(vbm, vb));
+		__m128i t1 = _mm_sub_epi16(_mm_add_epi16(vb, vb), _mm_add_epi16(va, vap));
+		acc = _mm_add_epi16(acc, _mm_max_epi16(t0, _mm_sub_epi16(zero, t0)));
+		acc = _mm_add_epi16(acc, _mm_max_epi16(t1, _mm_sub_epi16(zero, t1)));
+		a += s; b += s;
+	}
+	acc = _mm_madd_epi16(acc, _mm_set1_epi16(1));
+	acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+	acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 4));
+	return _mm_cvtsi128_si32(acc);
+}
+
+__attribute__((target("sse2")))
+static int var_y_sse2(unsigned char *a, unsigned char *b, int s)
+{
+	__m128i d0 = _mm_sad_epu8(LOAD_2ROWS(a, s), LOAD_2ROWS(a + s, s));
+	__m128i d1 = _mm_sad_epu8(_mm_loadl_epi64((const __m128i *)(a + 2*s)),
+	                          _mm_loadl_epi64((const __m128i *)(a + 3*s)));
+	return 4*hsum_epi64_sse2(_mm_add_epi64(d0, d1));
+}
+
+#define LOAD_4ROWS(p, s) _mm256_inserti128_si256(_mm256_castsi128_si256( \
+                             LOAD_2ROWS(p, s)), LOAD_2ROWS((p) + 2*(s), s), 1)
+
+__attribute__((target("avx2")))
+static int hsum_epi64_avx2(__m256i v)
+{
+	__m128i r = _mm_add_epi64(_mm256_castsi256_si128(v),
+	                          _mm256_extracti128_si256(v, 1));
+	return _mm_cvtsi128_si32(r) + _mm_cvtsi128_si32(_mm_srli_si128(r, 8));
+}
+
+__attribute__((target("avx2")))
+static int diff_y_avx2(unsigned char *a, unsigned char *b, int s)
+{
+	return hsum_epi64_avx2(_mm256_sad_epu8(LOAD_4ROWS(a, s), LOAD_4ROWS(b, s)));
+}
+
+__attribute__((target("avx2")))
+static int licomb_y_avx2(unsigned char *a, unsigned char *b, int s)
+{
+	__m256i acc = _mm256_setzero_si256();
+	int i;
+	/* two rows per iteration, 8 pixels each */
+	for (i = 0; i < 2; i++) {
+		__m256i va  = _mm256_cvtepu8_epi16(LOAD_2ROWS(a, s));
+		__m256i vap = _mm256_cvtepu8_epi16(LOAD_2ROWS(a + s, s));
+		__m256i vb  = _mm256_cvtepu8_epi16(LOAD_2ROWS(b, s));
+		__m256i vbm = _mm256_cvtepu8_epi16(LOAD_2ROWS(b - s, s));
+		__m256i t0 = _mm256_sub_epi16(_mm256_add_epi16(va, va), _mm256_add_epi16(vbm, vb));
+		__m256i t1 = _mm256_sub_epi16(_mm256_add_epi16(vb, vb), _mm256_add_epi16(va, vap));
+		acc = _mm256_add_epi16(acc, _mm256_abs_epi16(t0));
+		acc = _mm256_add_epi16(acc, _mm256_abs_epi16(t1));
+		a += 2*s; b += 2*s;
+	}
+	acc = _mm256_madd_epi16(acc, _mm256_set1_epi16(1));
+	__m128i r = _mm_add_epi32(_mm256_castsi256_si128(acc),
+	                          _mm256_extracti128_si256(acc, 1));
+	r = _mm_add_epi32(r, _mm_srli_si128(r, 8));
+	r = _mm_add_epi32(r, _mm_srli_si128(r, 4));
+	return _mm_cvtsi128_si32(r);
+}
+
+#undef LOAD_2ROWS
+#undef LOAD_4ROWS
+#endif /* HAVE_X86_INTRINSICS */
+
+#if HAVE_NEON_INTRINSICS
+static int hsum_u16_neon(uint16x8_t v)
+{
+	uint64x2_t s = vpaddlq_u32(vpaddlq_u16(v));
+	return vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1);
+}
+
+static int diff_y_neon(unsigned char *a, unsigned char *b, int s)
+{
+	uint16x8_t acc = vabdl_u8(vld1_u8(a), vld1_u8(b));
+	acc = vabal_u8(acc, vld1_u8(a + s), vld1_u8(b + s));
+	acc = vabal_u8(acc, vld1_u8(a + 2*s), vld1_u8(b + 2*s));
+	acc = vabal_u8(acc, vld1_u8(a + 3*s), vld1_u8(b + 3*s));
+	return hsum_u16_neon(acc);
+}
+
+static int licomb_y_neon(unsigned char *a, unsigned char *b, int s)
+{
+	int16x8_t acc = vdupq_n_s16(0);
+	int i;
+	for (i = 0; i < 4; i++) {
+		int16x8_t va  = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(a)));
+		int16x8_t vap = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(a + s)));
+		int16x8_t vb  = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(b)));
+		int16x8_t vbm = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(b - s)));
+		int16x8_t t0 = vsubq_s16(vshlq_n_s16(va, 1), vaddq_s16(vbm, vb));
+		int16x8_t t1 = vsubq_s16(vshlq_n_s16(vb, 1), vaddq_s16(va, vap));
+		acc = vaddq_s16(acc, vabsq_s16(t0));
+		acc = vaddq_s16(acc, vabsq_s16(t1));
+		a += s; b += s;
+	}
+	return hsum_u16_neon(vreinterpretq_u16_s16(acc));
+}
+
+static int var_y_neon(unsigned char *a, unsigned char *b, int s)
+{
+	uint16x8_t acc = vabdl_u8(vld1_u8(a), vld1_u8(a + s));
+	acc = vabal_u8(acc, vld1_u8(a + s), vld1_u8(a + 2*s));
+	acc = vabal_u8(acc, vld1_u8(a + 2*s), vld1_u8(a + 3*s));
+	return 4*hsum_u16_neon(acc);
+}
+#endif /* HAVE_NEON_INTRINSICS */
+
 #define ABS(a) (((a)^((a)>>31))-((a)>>31))
 
 static int diff_y(unsigned char *a, unsigned char *b, int s)
@@ -341,18 +492,25 @@ struct pullup_buffer *pullup_get_buffer(struct pullup_context *c, int parity)
 
 
 
-static void compute_metric(struct pullup_context *c,
+struct metric_job {
+	int (*func)(unsigned char *, unsigned char *, int);
+	unsigned char *a, *b;
+	int *dest;
+};
+
+struct metric_jobs {
+	struct pullup_context *c;
+	struct metric_job jobs[3];
+	int num_jobs;
+	int bands;
+};
+
+static void setup_metric(struct pullup_context *c, struct metric_jobs *j,
 	struct pullup_field *fa, int pa,
 	struct pullup_field *fb, int pb,
 	int (*func)(unsigned char *, unsigned char *, int), int *dest)
 {
-	unsigned char *a, *b;
-	int x, y;
 	int mp = c->metric_plane;
-	int xstep = c->bpp[mp];
-	int ystep = c->stride[mp]<<3;
-	int s = c->stride[mp]<<1; /* field stride */
-	int w = c->metric_w*xstep;
 
 	if (!fa->buffer || !fb->buffer) return;
 
@@ -362,17 +520,49 @@ static void compute_metric(struct pullup_context *c,
 		return;
 	}
 
-	a = fa->buffer->planes[mp] + pa * c->stride[mp] + c->metric_offset;
-	b = fb->buffer->planes[mp] + pb * c->stride[mp] + c->metric_offset;
+	j->jobs[j->num_jobs++] = (struct metric_job){
+		.func = func,
+		.a = fa->buffer->planes[mp] + pa * c->stride[mp] + c->metric_offset,
+		.b = fb->buffer->planes[mp] + pb * c->stride[mp] + c->metric_offset,
+		.dest = dest,
+	};
+}
+
+/* Compute one band of block rows of one metric. */
+static void compute_metric_band(void *ctx, int n)
+{
+	struct metric_jobs *j = ctx;
+	struct pullup_context *c = j->c;
+	struct metric_job *job = &j->jobs[n / j->bands];
+	int band = n % j->bands;
+	int x, y;
+	int mp = c->metric_plane;
+	int xstep = c->bpp[mp];
+	int ystep = c->stride[mp]<<3;
+	int s = c->stride[mp]<<1; /* field stride */
+	int w = c->metric_w*xstep;
+	int y0 = c->metric_h *  band    / j->bands;
+	int y1 = c->metric_h * (band+1) / j->bands;
+	unsigned char *a = job->a + y0 * ystep;
+	unsigned char *b = job->b + y0 * ystep;
+	int *dest = job->dest + y0 * c->metric_w;
 
-	for (y = c->metric_h; y; y--) {
+	for (y = y0; y < y1; y++) {
 		for (x = 0; x < w; x += xstep) {
-			*dest++ = func(a + x, b + x, s);
+			*dest++ = job->func(a + x, b + x, s);
 		}
 		a += ystep; b += ystep;
 	}
 }
 
+static void compute_metrics(struct pullup_context *c, struct metric_jobs *j)
+{
+	j->c = c;
+	j->bands = mp_thread_pool_get_threads(c->pool);
+	mp_thread_pool_run(c->pool, compute_metric_band, j,
+	                   j->num_jobs * j->bands);
+}
+
 
 
 
@@ -432,9 +622,11 @@ void pullup_submit_field(struct pullup_context *c, struct pullup_buffer *b,
 	f->affinity = 0;
 	f->pts = pts;
 
-	compute_metric(c, f, parity, f->prev->prev, parity, c->diff, f->diffs);
-	compute_metric(c, parity?f->prev:f, 0, parity?f:f->prev, 1, c->comb, f->comb);
-	compute_metric(c, f, parity, f, -1, c->var, f->var);
+	struct metric_jobs jobs = {0};
+	setup_metric(c, &jobs, f, parity, f->prev->prev, parity, c->diff, f->diffs);
+	setup_metric(c, &jobs, parity?f->prev:f, 0, parity?f:f->prev, 1, c->comb, f->comb);
+	setup_metric(c, &jobs, f, parity, f, -1, c->var, f->var);
+	compute_metrics(c, &jobs);
 
 	/* Advance the circular list */
 	if (!c->first) c->first = c->head;
@@ -770,6 +962,9 @@ void pullup_init_context(struct pullup_context *c)
 
 	c->head = make_field_queue(c, 8);
 
+	if (c->threads != 1)
+		c->pool = mp_thread_pool_create(NULL, c->threads);
+
 	c->frame = calloc(1, sizeof (struct pullup_frame));
 	c->frame->ifields = calloc(3, sizeof (struct pullup_buffer *));
 
@@ -786,6 +981,22 @@ void pullup_init_context(struct pullup_context *c)
 			c->var = var_y_mmx;
 		}
 #endif
+#endif
+#if HAVE_X86_INTRINSICS
+		if (c->cpu & PULLUP_CPU_SSE2) {
+			c->diff = diff_y_sse2;
+			c->comb = licomb_y_sse2;
+			c->var = var_y_sse2;
+		}
+		if (c->cpu & PULLUP_CPU_AVX2) {
+			c->diff = diff_y_avx2;
+			c->comb = licomb_y_avx2;
+		}
+#endif
+#if HAVE_NEON_INTRINSICS
+		c->diff = diff_y_neon;
+		c->comb = licomb_y_neon;
+		c->var = var_y_neon;
 #endif
 		/* c->comb = qpcomb_y; */
 		break;
@@ -803,6 +1014,7 @@ void pullup_init_context(struct pullup_context *c)
 void pullup_free_context(struct pullup_context *c)
 {
 	struct pullup_field *f;
+	talloc_free(c->pool);
 	free(c->buffers);
 	f = c->head;
 	do {
@@ -23,6 +23,7 @@
 #define PULLUP_CPU_MMX2 2
 #define PULLUP_CPU_SSE 16
 #define PULLUP_CPU_SSE2 32
+#define PULLUP_CPU_AVX2 64
 
 #define PULLUP_FMT_Y 1
 #define PULLUP_FMT_YUY2 2
@@ -71,6 +72,7 @@ struct pullup_context
 	int metric_plane;
 	int strict_breaks;
 	int strict_pairs;
+	int threads; /* for metrics; 0 = one per CPU */
 	/* Internal data */
 	struct pullup_field *first, *last, *head;
 	struct pullup_buffer *buffers;
@@ -80,6 +82,7 @@ struct pullup_context
 	int (*var)(unsigned char *, unsigned char *, int);
 	int metric_w, metric_h, metric_len, metric_offset;
 	struct pullup_frame *frame;
+	struct mp_thread_pool *pool;
 };
 
 
@@ -32,6 +32,7 @@
 #include "options/m_config.h"
 
 #include "options/options.h"
+#include "osdep/timer.h"
 
 #include "video/img_format.h"
 #include "video/mp_image.h"
@@ -52,6 +53,7 @@ extern const vf_info_t vf_info_mirror;
 extern const vf_info_t vf_info_noise;
 extern const vf_info_t vf_info_eq;
 extern const vf_info_t vf_info_gradfun;
+extern const vf_info_t vf_info_interpolate;
 extern const vf_info_t vf_info_unsharp;
 extern const vf_info_t vf_info_swapuv;
 extern const vf_info_t vf_info_hqdn3d;
@@ -93,6 +95,7 @@ static const vf_info_t *const filter_list[] = {
     &vf_info_noise,
     &vf_info_eq,
     &vf_info_gradfun,
+    &vf_info_interpolate,
     &vf_info_unsharp,
     &vf_info_swapuv,
     &vf_info_hqdn3d,
@@ -324,14 +327,21 @@ static int vf_do_filter(struct vf_instance *vf, struct mp_image *img)
     assert(vf->fmt_in.imgfmt);
     vf_fix_img_params(img, &vf->fmt_in);
 
+    int64_t start = mp_time_us();
+    vf->stats_frames += 1;
+    vf->stats_pixels += (int64_t)img->w * img->h;
+
+    int r = 0;
     if (vf->filter_ext) {
-        return vf->filter_ext(vf, img);
+        r = vf->filter_ext(vf, img);
     } else {
         if (vf->filter)
             img = vf->filter(vf, img);
         vf_add_output_frame(vf, img);
-        return 0;
     }
+
+    vf->stats_time += (mp_time_us() - start) / 1e6;
+    return r;
 }
 
 // Input a frame into the filter chain. Ownership of img is transferred.
@@ -691,3 +701,28 @@ double vf_softpulldown_adjust_pts(struct vf_detc_pts_buf *p, double pts,
                                        2.0 / last_frame_duration,
                                        1.0 / last_frame_duration);
 }
+
+void vf_fps_init_pts_buf(struct vf_fps_pts_buf *p, double fps)
+{
+    p->fps = fps;
+    vf_fps_reset_pts(p, MP_NOPTS_VALUE);
+}
+
+void vf_fps_reset_pts(struct vf_fps_pts_buf *p, double pts)
+{
+    p->base = pts;
+    p->frame = 0;
+}
+
+double vf_fps_next_pts(struct vf_fps_pts_buf *p, double end_pts)
+{
+    if (p->base == MP_NOPTS_VALUE || end_pts == MP_NOPTS_VALUE)
+        return MP_NOPTS_VALUE;
+    // Computed from the frame index, so that rounding errors don't add up.
+    double pts = p->base + p->frame / p->fps;
+    // A frame at end_pts (within rounding errors) belongs to the next interval.
+    if (pts >= end_pts - 1e-6)
+        return MP_NOPTS_VALUE;
+    p->frame++;
+    return pts;
+}
@@ -89,6 +89,11 @@ typedef struct vf_instance {
     // Caches valid output formats.
     uint8_t last_outfmts[IMGFMT_END - IMGFMT_START];
 
+    // Statistics for --benchmark: time spent in filter()/filter_ext() (in
+    // seconds), and the number of frames and pixels passed to it.
+    double stats_time;
+    int64_t stats_frames, stats_pixels;
+
     struct vf_instance *next;
 } vf_instance_t;
 
@@ -171,4 +176,22 @@ double vf_softpulldown_adjust_pts(struct vf_detc_pts_buf *p, double pts,
                                   bool reset_pattern, bool skip_frame,
                                   int last_frame_duration);
 
+// Output clock for filters that produce frames at a fixed rate, independent
+// of the input frame rate.
+struct vf_fps_pts_buf {
+    double fps;
+    double base;        // pts of output frame 0, or MP_NOPTS_VALUE if stopped
+    int64_t frame;      // index of the next output frame
+};
+void vf_fps_init_pts_buf(struct vf_fps_pts_buf *p, double fps);
+/* Restart the clock, so that the next output frame has the given pts.
+ * MP_NOPTS_VALUE stops the clock until the next reset.
+ */
+void vf_fps_reset_pts(struct vf_fps_pts_buf *p, double pts);
+/* Return the pts of the next output frame and advance the clock if that frame
+ * is before end_pts. Otherwise (or if the clock is stopped), return
+ * MP_NOPTS_VALUE.
+ */
+double vf_fps_next_pts(struct vf_fps_pts_buf *p, double end_pts);
+
 #endif /* MPLAYER_VF_H */
@@ -35,6 +35,13 @@
 
 #include "video/memcpy_pic.h"
 
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+#if HAVE_NEON_INTRINSICS
+#include <arm_neon.h>
+#endif
+
 const vf_info_t vf_info_divtc;
 
 struct vf_priv_s
@@ -97,12 +104,62 @@ static int diff_MMX(unsigned char *old, unsigned char *new, int os, int ns)
    }
 #endif
 
+#if HAVE_X86_INTRINSICS
+#define LOAD_2ROWS(p, s) _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(p)), \
+                                            _mm_loadl_epi64((const __m128i *)((p)+(s))))
+
+__attribute__((target("sse2")))
+static int diff_SSE2(unsigned char *old, unsigned char *new, int os, int ns)
+   {
+   __m128i d=_mm_setzero_si128();
+   int y;
+
+   for(y=0; y<8; y+=2, old+=2*os, new+=2*ns)
+      d=_mm_add_epi64(d, _mm_sad_epu8(LOAD_2ROWS(old, os), LOAD_2ROWS(new, ns)));
+
+   return _mm_cvtsi128_si32(d)+_mm_cvtsi128_si32(_mm_srli_si128(d, 8));
+   }
+
+#define LOAD_4ROWS(p, s) _mm256_inserti128_si256(_mm256_castsi128_si256( \
+                             LOAD_2ROWS(p, s)), LOAD_2ROWS((p)+2*(s), s), 1)
+
+__attribute__((target("avx2")))
+static int diff_AVX2(unsigned char *old, unsigned char *new, int os, int ns)
+   {
+   __m256i d=_mm256_add_epi64(
+      _mm256_sad_epu8(LOAD_4ROWS(old, os), LOAD_4ROWS(new, ns)),
+      _mm256_sad_epu8(LOAD_4ROWS(old+4*os, os), LOAD_4ROWS(new+4*ns, ns)));
+   __m128i r=_mm_add_epi64(_mm256_castsi256_si128(d),
+                           _mm256_extracti128_si256(d, 1));
+
+   return _mm_cvtsi128_si32(r)+_mm_cvtsi128_si32(_mm_srli_si128(r, 8));
+   }
+
+#undef LOAD_2ROWS
+#undef LOAD_4ROWS
+#endif
+
+#if HAVE_NEON_INTRINSICS
+static int diff_NEON(unsigned char *old, unsigned char *new, int os, int ns)
+   {
+   uint16x8_t d=vabdl_u8(vld1_u8(old), vld1_u8(new));
+   uint64x2_t s;
+   int y;
+
+   for(y=1; y<8; y++)
+      d=vabal_u8(d, vld1_u8(old+y*os), vld1_u8(new+y*ns));
+
+   s=vpaddlq_u32(vpaddlq_u16(d));
+   return vgetq_lane_u64(s, 0)+vgetq_lane_u64(s, 1);
+   }
+#endif
+
 static int diff_C(unsigned char *old, unsigned char *new, int os, int ns)
    {
    int x, y, d=0;
 
    for(y=8; y; y--, new+=ns, old+=os)
-      for(x=8; x; x--)
+      for(x=0; x<8; x++)
 	 d+=abs(new[x]-old[x]);
 
    return d;
@@ -647,6 +704,13 @@ static int vf_open(vf_instance_t *vf)
 #if HAVE_MMX && HAVE_EBX_AVAILABLE
    if(gCpuCaps.hasMMX) diff = diff_MMX;
 #endif
+#if HAVE_X86_INTRINSICS
+   if(gCpuCaps.hasSSE2) diff = diff_SSE2;
+   if(gCpuCaps.hasAVX2) diff = diff_AVX2;
+#endif
+#if HAVE_NEON_INTRINSICS
+   diff = diff_NEON;
+#endif
 
    vf_detc_init_pts_buf(&p->ptsbuf);
    return 1;
@@ -31,12 +31,12 @@
 
 #include "config.h"
 #include "common/msg.h"
-#include "common/cpudetect.h"
 #include "options/m_option.h"
 
 #include "video/img_format.h"
 #include "video/mp_image.h"
 #include "vf.h"
+#include "pixel_kernels.h"
 
 #define LUT16
 
@@ -48,6 +48,8 @@ typedef struct eq2_param_t {
 #endif
   int           lut_clean;
 
+  const struct mp_pixel_kernels *kernels;
+
   void (*adjust) (struct eq2_param_t *par, unsigned char *dst, unsigned char *src,
     unsigned w, unsigned h, unsigned dstride, unsigned sstride);
 
@@ -126,74 +128,21 @@ void create_lut (eq2_param_t *par)
   par->lut_clean = 1;
 }
 
-#if HAVE_MMX
 static
-void affine_1d_MMX (eq2_param_t *par, unsigned char *dst, unsigned char *src,
+void affine_1d (eq2_param_t *par, unsigned char *dst, unsigned char *src,
   unsigned w, unsigned h, unsigned dstride, unsigned sstride)
 {
-  unsigned i;
-  int      contrast, brightness;
-  unsigned dstep, sstep;
-  int      pel;
-  short    brvec[4];
-  short    contvec[4];
-  unsigned wcount = w >> 3;
-
-//  printf("\nmmx: src=%p dst=%p w=%d h=%d ds=%d ss=%d\n",src,dst,w,h,dstride,sstride);
+  int contrast, brightness;
 
   contrast = (int) (par->c * 256 * 16);
   brightness = ((int) (100.0 * par->b + 100.0) * 511) / 200 - 128 - contrast / 32;
 
-  brvec[0] = brvec[1] = brvec[2] = brvec[3] = brightness;
-  contvec[0] = contvec[1] = contvec[2] = contvec[3] = contrast;
-
-  sstep = sstride - w;
-  dstep = dstride - w;
-
   while (h-- > 0) {
-    __asm__ volatile (
-      "movq (%5), %%mm3 \n\t"
-      "movq (%6), %%mm4 \n\t"
-      "pxor %%mm0, %%mm0 \n\t"
-      "movl %4, %%eax\n\t"
-      ".align 4\n\t"
-      "1: \n\t"
-      "movq (%0), %%mm1 \n\t"
-      "movq (%0), %%mm2 \n\t"
-      "punpcklbw %%mm0, %%mm1 \n\t"
-      "punpckhbw %%mm0, %%mm2 \n\t"
-      "psllw $4, %%mm1 \n\t"
-      "psllw $4, %%mm2 \n\t"
-      "pmulhw %%mm4, %%mm1 \n\t"
-      "pmulhw %%mm4, %%mm2 \n\t"
-      "paddw %%mm3, %%mm1 \n\t"
-      "paddw %%mm3, %%mm2 \n\t"
-      "packuswb %%mm2, %%mm1 \n\t"
-      "add $8, %0 \n\t"
-      "movq %%mm1, (%1) \n\t"
-      "add $8, %1 \n\t"
-      "decl %%eax \n\t"
-      "jnz 1b \n\t"
-      : "=r" (src), "=r" (dst)
-      : "0" (src), "1" (dst), "g" (wcount), "r" (brvec), "r" (contvec)
-      : "%eax"
-    );
-
-    for (i = w & 7; i > 0; i--) {
-      pel = ((*src++ * contrast) >> 12) + brightness;
-      if (pel & 768) {
-        pel = (-pel) >> 31;
-      }
-      *dst++ = pel;
-    }
-
-    src += sstep;
-    dst += dstep;
+    par->kernels->affine (dst, src, w, contrast, brightness);
+    src += sstride;
+    dst += dstride;
   }
-
-  __asm__ volatile ( "emms \n\t" ::: "memory" );
 }
-#endif
 
 static
 void apply_lut (eq2_param_t *par, unsigned char *dst, unsigned char *src,
@@ -208,6 +157,16 @@ void apply_lut (eq2_param_t *par, unsigned char *dst, unsigned char *src,
   }
 
   lut = par->lut;
+
+  if (par->kernels->lut) {
+    for (j = 0; j < h; j++) {
+      par->kernels->lut (dst, src, w, lut);
+      src += sstride;
+      dst += dstride;
+    }
+    return;
+  }
+
 #ifdef LUT16
   lut16 = par->lut16;
   w2= (w>>3)<<2;
@@ -301,11 +260,9 @@ void check_values (eq2_param_t *par)
   if ((par->c == 1.0) && (par->b == 0.0) && (par->g == 1.0)) {
     par->adjust = NULL;
   }
-#if HAVE_MMX
-  else if (par->g == 1.0 && gCpuCaps.hasMMX) {
-    par->adjust = &affine_1d_MMX;
+  else if (par->g == 1.0 && par->kernels->simd) {
+    par->adjust = &affine_1d;
   }
-#endif
   else {
     par->adjust = &apply_lut;
   }
@@ -473,11 +430,15 @@ int vf_open(vf_instance_t *vf)
   eq2 = vf->priv;
   eq2->log = vf->log;
 
+  const struct mp_pixel_kernels *kernels = mp_get_pixel_kernels ();
+  MP_VERBOSE(vf, "Using %s kernels.\n", kernels->name);
+
   for (i = 0; i < 3; i++) {
     eq2->buf[i] = NULL;
     eq2->buf_w[i] = 0;
     eq2->buf_h[i] = 0;
 
+    eq2->param[i].kernels = kernels;
     eq2->param[i].adjust = NULL;
     eq2->param[i].c = 1.0;
     eq2->param[i].b = 0.0;
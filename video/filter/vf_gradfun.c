@@ -24,7 +24,11 @@
  * Foreach pixel, if it's within threshold of the blurred value, make it closer.
  * So now we have a smoothed and higher bitdepth version of all the shallow
  * gradients, while leaving detailed areas untouched.
- * Dither it back to 8bit.
+ * Dither it back to the input bitdepth.
+ *
+ * Formats with more than 8 bits per sample use the same algorithm, with the
+ * sample values scaled the same way (7 fractional bits), but with 32 bit
+ * intermediates. The threshold is relative to 8 bit sample values.
  */
 
 #include <stdio.h>
@@ -36,28 +40,45 @@
 #include <libavutil/common.h>
 
 #include "config.h"
+#include "talloc.h"
+#include "common/common.h"
 #include "common/cpudetect.h"
 #include "video/img_format.h"
 #include "video/mp_image.h"
 #include "vf.h"
 #include "video/memcpy_pic.h"
-#include "compat/x86_cpu.h"
+#include "misc/thread_pool.h"
 
 #include "options/m_option.h"
 
 #include "vf_lavfi.h"
 
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+
 struct vf_priv_s {
     float cfg_thresh;
     int cfg_radius;
     float cfg_size;
+    int cfg_threads;
     int thresh;
     int radius;
-    uint16_t *buf;
+    // One buffer of buf_size elements per slice. The elements are uint16_t
+    // for 8 bit formats, and uint32_t otherwise.
+    void *buf;
+    size_t buf_size;
+    int num_slices;
+    struct mp_thread_pool *pool;
     void (*filter_line)(uint8_t *dst, uint8_t *src, uint16_t *dc,
                         int width, int thresh, const uint16_t *dithers);
     void (*blur_line)(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
                       uint8_t *src, int sstride, int width);
+    void (*filter_line16)(uint16_t *dst, uint16_t *src, uint32_t *dc,
+                          int width, int thresh, const uint16_t *dithers,
+                          int depth);
+    void (*blur_line16)(uint32_t *dc, uint32_t *buf, uint32_t *buf1,
+                        uint16_t *src, int sstride, int width);
     struct vf_lw_opts *lw_opts;
 } const vf_priv_dflt = {
   .cfg_thresh = 1.5,
@@ -65,8 +86,6 @@ struct vf_priv_s {
   .cfg_size = -1,
 };
 
-static const uint16_t __attribute__((aligned(16))) pw_7f[8] = {127,127,127,127,127,127,127,127};
-static const uint16_t __attribute__((aligned(16))) pw_ff[8] = {255,255,255,255,255,255,255,255};
 static const uint16_t __attribute__((aligned(16))) dither[8][8] = {
     {  0, 96, 24,120,  6,102, 30,126 },
     { 64, 32, 88, 56, 70, 38, 94, 62 },
@@ -82,7 +101,7 @@ static void filter_line_c(uint8_t *dst, uint8_t *src, uint16_t *dc,
                           int width, int thresh, const uint16_t *dithers)
 {
     int x;
-    for (x=0; x<width; x++, dc+=x&1) {
+    for (x=0; x<width; dc+=x&1, x++) {
         int pix = src[x]<<7;
         int delta = dc[0] - pix;
         int m = abs(delta) * thresh >> 16;
@@ -105,187 +124,329 @@ static void blur_line_c(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
     }
 }
 
-#if HAVE_MMX2
-static void filter_line_mmx2(uint8_t *dst, uint8_t *src, uint16_t *dc,
-                             int width, int thresh, const uint16_t *dithers)
+static void filter_line16_c(uint16_t *dst, uint16_t *src, uint32_t *dc,
+                            int width, int thresh, const uint16_t *dithers,
+                            int depth)
 {
-    intptr_t x;
-    if (width&3) {
-        x = width&~3;
-        filter_line_c(dst+x, src+x, dc+x/2, width-x, thresh, dithers);
-        width = x;
+    int x;
+    int maxval = (1 << depth) - 1;
+    for (x=0; x<width; dc+=x&1, x++) {
+        int pix = src[x]<<7;
+        int delta = (int)dc[0] - pix;
+        int m = (unsigned)(abs(delta) >> (depth - 8)) * thresh >> 16;
+        m = FFMAX(0, 127-m);
+        pix += (int)((int64_t)(m*m) * delta >> 14) + dithers[x&7];
+        dst[x] = av_clip(pix>>7, 0, maxval);
     }
-    x = -width;
-    __asm__ volatile(
-        "movd          %4, %%mm5 \n"
-        "pxor       %%mm7, %%mm7 \n"
-        "pshufw $0, %%mm5, %%mm5 \n"
-        "movq          %6, %%mm6 \n"
-        "movq          %5, %%mm4 \n"
-        "1: \n"
-        "movd     (%2,%0), %%mm0 \n"
-        "movd     (%3,%0), %%mm1 \n"
-        "punpcklbw  %%mm7, %%mm0 \n"
-        "punpcklwd  %%mm1, %%mm1 \n"
-        "psllw         $7, %%mm0 \n"
-        "pxor       %%mm2, %%mm2 \n"
-        "psubw      %%mm0, %%mm1 \n" // delta = dc - pix
-        "psubw      %%mm1, %%mm2 \n"
-        "pmaxsw     %%mm1, %%mm2 \n"
-        "pmulhuw    %%mm5, %%mm2 \n" // m = abs(delta) * thresh >> 16
-        "psubw      %%mm6, %%mm2 \n"
-        "pminsw     %%mm7, %%mm2 \n" // m = -max(0, 127-m)
-        "pmullw     %%mm2, %%mm2 \n"
-        "paddw      %%mm4, %%mm0 \n" // pix += dither
-        "pmulhw     %%mm2, %%mm1 \n"
-        "psllw         $2, %%mm1 \n" // m = m*m*delta >> 14
-        "paddw      %%mm1, %%mm0 \n" // pix += m
-        "psraw         $7, %%mm0 \n"
-        "packuswb   %%mm0, %%mm0 \n"
-        "movd       %%mm0, (%1,%0) \n" // dst = clip(pix>>7)
-        "add           $4, %0 \n"
-        "jl 1b \n"
-        "emms \n"
-        :"+r"(x)
-        :"r"(dst+width), "r"(src+width), "r"(dc+width/2),
-         "rm"(thresh), "m"(*dithers), "m"(*pw_7f)
-        :"memory"
-    );
 }
-#endif
 
-#if HAVE_SSSE3
-static void filter_line_ssse3(uint8_t *dst, uint8_t *src, uint16_t *dc,
-                              int width, int thresh, const uint16_t *dithers)
+static void blur_line16_c(uint32_t *dc, uint32_t *buf, uint32_t *buf1,
+                          uint16_t *src, int sstride, int width)
+{
+    int x;
+    uint32_t v, old;
+    for (x=0; x<width; x++) {
+        v = buf1[x] + src[2*x] + src[2*x+1] + src[2*x+sstride] + src[2*x+1+sstride];
+        old = buf[x];
+        buf[x] = v;
+        dc[x] = v - old;
+    }
+}
+
+#if HAVE_X86_INTRINSICS
+
+// The SIMD versions are bit-exact with the C versions (TOOLS/simd_check
+// verifies this). dc has one value per 2 pixels. The C versions handle the
+// remaining pixels at the end of a line.
+
+__attribute__((target("sse2")))
+static void filter_line_sse2(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                             int width, int thresh, const uint16_t *dithers)
 {
-    intptr_t x;
-    if (width&7) {
-        // could be 10% faster if I somehow eliminated this
-        x = width&~7;
-        filter_line_c(dst+x, src+x, dc+x/2, width-x, thresh, dithers);
-        width = x;
+    __m128i zero = _mm_setzero_si128();
+    __m128i th = _mm_set1_epi16(thresh);
+    __m128i c127 = _mm_set1_epi16(127);
+    __m128i dith = _mm_loadu_si128((const __m128i *)dithers);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i pix = _mm_loadl_epi64((const __m128i *)(src + x));
+        pix = _mm_slli_epi16(_mm_unpacklo_epi8(pix, zero), 7);
+        __m128i d = _mm_loadl_epi64((const __m128i *)(dc + x / 2));
+        __m128i delta = _mm_sub_epi16(_mm_unpacklo_epi16(d, d), pix);
+        __m128i m = _mm_max_epi16(delta, _mm_sub_epi16(zero, delta));
+        m = _mm_mulhi_epu16(m, th);                         // abs(delta) * thresh >> 16
+        m = _mm_max_epi16(_mm_sub_epi16(c127, m), zero);    // max(0, 127-m)
+        m = _mm_mullo_epi16(m, m);
+        // m*m*delta >> 14: bits 14-29 of the 32 bit product
+        __m128i t = _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(m, delta), 2),
+                                 _mm_srli_epi16(_mm_mullo_epi16(m, delta), 14));
+        pix = _mm_add_epi16(pix, _mm_add_epi16(t, dith));
+        pix = _mm_srai_epi16(pix, 7);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(pix, pix));
     }
-    x = -width;
-    __asm__ volatile(
-        "movd           %4, %%xmm5 \n"
-        "pxor       %%xmm7, %%xmm7 \n"
-        "pshuflw $0,%%xmm5, %%xmm5 \n"
-        "movdqa         %6, %%xmm6 \n"
-        "punpcklqdq %%xmm5, %%xmm5 \n"
-        "movdqa         %5, %%xmm4 \n"
-        "1: \n"
-        "movq      (%2,%0), %%xmm0 \n"
-        "movq      (%3,%0), %%xmm1 \n"
-        "punpcklbw  %%xmm7, %%xmm0 \n"
-        "punpcklwd  %%xmm1, %%xmm1 \n"
-        "psllw          $7, %%xmm0 \n"
-        "psubw      %%xmm0, %%xmm1 \n" // delta = dc - pix
-        "pabsw      %%xmm1, %%xmm2 \n"
-        "pmulhuw    %%xmm5, %%xmm2 \n" // m = abs(delta) * thresh >> 16
-        "psubw      %%xmm6, %%xmm2 \n"
-        "pminsw     %%xmm7, %%xmm2 \n" // m = -max(0, 127-m)
-        "pmullw     %%xmm2, %%xmm2 \n"
-        "psllw          $1, %%xmm2 \n"
-        "paddw      %%xmm4, %%xmm0 \n" // pix += dither
-        "pmulhrsw   %%xmm2, %%xmm1 \n" // m = m*m*delta >> 14
-        "paddw      %%xmm1, %%xmm0 \n" // pix += m
-        "psraw          $7, %%xmm0 \n"
-        "packuswb   %%xmm0, %%xmm0 \n"
-        "movq       %%xmm0, (%1,%0) \n" // dst = clip(pix>>7)
-        "add            $8, %0 \n"
-        "jl 1b \n"
-        :"+&r"(x)
-        :"r"(dst+width), "r"(src+width), "r"(dc+width/2),
-         "rm"(thresh), "m"(*dithers), "m"(*pw_7f)
-        :"memory"
-    );
+    filter_line_c(dst + x, src + x, dc + x / 2, width - x, thresh, dithers);
 }
-#endif // HAVE_SSSE3
-
-#if HAVE_SSE2 && HAVE_6REGS
-#define BLURV(load)\
-    intptr_t x = -2*width;\
-    __asm__ volatile(\
-        "movdqa %6, %%xmm7 \n"\
-        "1: \n"\
-        load"   (%4,%0), %%xmm0 \n"\
-        load"   (%5,%0), %%xmm1 \n"\
-        "movdqa  %%xmm0, %%xmm2 \n"\
-        "movdqa  %%xmm1, %%xmm3 \n"\
-        "psrlw       $8, %%xmm0 \n"\
-        "psrlw       $8, %%xmm1 \n"\
-        "pand    %%xmm7, %%xmm2 \n"\
-        "pand    %%xmm7, %%xmm3 \n"\
-        "paddw   %%xmm1, %%xmm0 \n"\
-        "paddw   %%xmm3, %%xmm2 \n"\
-        "paddw   %%xmm2, %%xmm0 \n"\
-        "paddw  (%2,%0), %%xmm0 \n"\
-        "movdqa (%1,%0), %%xmm1 \n"\
-        "movdqa  %%xmm0, (%1,%0) \n"\
-        "psubw   %%xmm1, %%xmm0 \n"\
-        "movdqa  %%xmm0, (%3,%0) \n"\
-        "add        $16, %0 \n"\
-        "jl 1b \n"\
-        :"+&r"(x)\
-        :"r"(buf+width),\
-         "r"(buf1+width),\
-         "r"(dc+width),\
-         "r"(src+width*2),\
-         "r"(src+width*2+sstride),\
-         "m"(*pw_ff)\
-        :"memory"\
-    );
 
+__attribute__((target("sse2")))
 static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
                            uint8_t *src, int sstride, int width)
 {
-    if (((intptr_t)src|sstride)&15) {
-        BLURV("movdqu");
-    } else {
-        BLURV("movdqa");
+    __m128i ff = _mm_set1_epi16(0xFF);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 2 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 2 * x + sstride));
+        a = _mm_add_epi16(_mm_and_si128(a, ff), _mm_srli_epi16(a, 8));
+        b = _mm_add_epi16(_mm_and_si128(b, ff), _mm_srli_epi16(b, 8));
+        __m128i v = _mm_add_epi16(_mm_add_epi16(a, b),
+                                  _mm_loadu_si128((const __m128i *)(buf1 + x)));
+        __m128i old = _mm_loadu_si128((const __m128i *)(buf + x));
+        _mm_storeu_si128((__m128i *)(buf + x), v);
+        _mm_storeu_si128((__m128i *)(dc + x), _mm_sub_epi16(v, old));
     }
+    blur_line_c(dc + x, buf + x, buf1 + x, src + 2 * x, sstride, width - x);
 }
-#endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+__attribute__((target("sse2")))
+static void blur_line16_sse2(uint32_t *dc, uint32_t *buf, uint32_t *buf1,
+                             uint16_t *src, int sstride, int width)
 {
-    int bstride = ((width+15)&~15)/2;
-    int y;
-    uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
-    int thresh = ctx->thresh;
-
-    memset(dc, 0, (bstride+16)*sizeof(*buf));
-    for (y=0; y<r; y++)
-        ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
-    for (;;) {
-        if (y < height-r) {
-            int mod = ((y+r)/2)%r;
-            uint16_t *buf0 = buf+mod*bstride;
-            uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
-            int x, v;
-            ctx->blur_line(dc, buf0, buf1, src+(y+r)*sstride, sstride, width/2);
-            for (x=v=0; x<r; x++)
-                v += dc[x];
-            for (; x<width/2; x++) {
-                v += dc[x] - dc[x-r];
-                dc[x-r] = v * dc_factor >> 16;
-            }
-            for (; x<(width+r+1)/2; x++)
-                dc[x-r] = v * dc_factor >> 16;
-            for (x=-r/2; x<0; x++)
-                dc[x] = dc[0];
-        }
-        if (y == r) {
-            for (y=0; y<r; y++)
-                ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        }
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
+    __m128i ffff = _mm_set1_epi32(0xFFFF);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 2 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 2 * x + sstride));
+        a = _mm_add_epi32(_mm_and_si128(a, ffff), _mm_srli_epi32(a, 16));
+        b = _mm_add_epi32(_mm_and_si128(b, ffff), _mm_srli_epi32(b, 16));
+        __m128i v = _mm_add_epi32(_mm_add_epi32(a, b),
+                                  _mm_loadu_si128((const __m128i *)(buf1 + x)));
+        __m128i old = _mm_loadu_si128((const __m128i *)(buf + x));
+        _mm_storeu_si128((__m128i *)(buf + x), v);
+        _mm_storeu_si128((__m128i *)(dc + x), _mm_sub_epi32(v, old));
+    }
+    blur_line16_c(dc + x, buf + x, buf1 + x, src + 2 * x, sstride, width - x);
+}
+
+// For the _mm256_zeroupper() calls, see the AVX2 note in pixel_kernels.c.
+__attribute__((target("avx2")))
+static void filter_line_avx2(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                             int width, int thresh, const uint16_t *dithers)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i th = _mm256_set1_epi16(thresh);
+    __m256i c127 = _mm256_set1_epi16(127);
+    __m256i dith = _mm256_broadcastsi128_si256(
+                        _mm_loadu_si128((const __m128i *)dithers));
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i pix = _mm256_cvtepu8_epi16(
+                        _mm_loadu_si128((const __m128i *)(src + x)));
+        pix = _mm256_slli_epi16(pix, 7);
+        __m256i d = _mm256_cvtepu16_epi32(
+                        _mm_loadu_si128((const __m128i *)(dc + x / 2)));
+        d = _mm256_or_si256(d, _mm256_slli_epi32(d, 16));
+        __m256i delta = _mm256_sub_epi16(d, pix);
+        __m256i m = _mm256_mulhi_epu16(_mm256_abs_epi16(delta), th);
+        m = _mm256_max_epi16(_mm256_sub_epi16(c127, m), zero);
+        m = _mm256_mullo_epi16(m, m);
+        __m256i t = _mm256_or_si256(
+                        _mm256_slli_epi16(_mm256_mulhi_epi16(m, delta), 2),
+                        _mm256_srli_epi16(_mm256_mullo_epi16(m, delta), 14));
+        pix = _mm256_add_epi16(pix, _mm256_add_epi16(t, dith));
+        pix = _mm256_srai_epi16(pix, 7);
+        _mm_storeu_si128((__m128i *)(dst + x),
+                         _mm_packus_epi16(_mm256_castsi256_si128(pix),
+                                          _mm256_extracti128_si256(pix, 1)));
+    }
+    _mm256_zeroupper();
+    filter_line_sse2(dst + x, src + x, dc + x / 2, width - x, thresh, dithers);
+}
+
+__attribute__((target("avx2")))
+static void blur_line_avx2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
+                           uint8_t *src, int sstride, int width)
+{
+    __m256i ff = _mm256_set1_epi16(0xFF);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + 2 * x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 2 * x + sstride));
+        a = _mm256_add_epi16(_mm256_and_si256(a, ff), _mm256_srli_epi16(a, 8));
+        b = _mm256_add_epi16(_mm256_and_si256(b, ff), _mm256_srli_epi16(b, 8));
+        __m256i v = _mm256_add_epi16(_mm256_add_epi16(a, b),
+                        _mm256_loadu_si256((const __m256i *)(buf1 + x)));
+        __m256i old = _mm256_loadu_si256((const __m256i *)(buf + x));
+        _mm256_storeu_si256((__m256i *)(buf + x), v);
+        _mm256_storeu_si256((__m256i *)(dc + x), _mm256_sub_epi16(v, old));
+    }
+    _mm256_zeroupper();
+    blur_line_sse2(dc + x, buf + x, buf1 + x, src + 2 * x, sstride, width - x);
+}
+
+__attribute__((target("avx2")))
+static void filter_line16_avx2(uint16_t *dst, uint16_t *src, uint32_t *dc,
+                               int width, int thresh, const uint16_t *dithers,
+                               int depth)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i th = _mm256_set1_epi32(thresh);
+    __m256i c127 = _mm256_set1_epi32(127);
+    __m256i low14 = _mm256_set1_epi32((1 << 14) - 1);
+    __m256i maxval = _mm256_set1_epi32((1 << depth) - 1);
+    __m256i dup = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    __m128i shift = _mm_cvtsi32_si128(depth - 8);
+    __m256i dith = _mm256_cvtepu16_epi32(
+                        _mm_loadu_si128((const __m128i *)dithers));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i pix = _mm256_cvtepu16_epi32(
+                        _mm_loadu_si128((const __m128i *)(src + x)));
+        pix = _mm256_slli_epi32(pix, 7);
+        __m256i d = _mm256_castsi128_si256(
+                        _mm_loadu_si128((const __m128i *)(dc + x / 2)));
+        __m256i delta = _mm256_sub_epi32(_mm256_permutevar8x32_epi32(d, dup),
+                                         pix);
+        __m256i m = _mm256_srl_epi32(_mm256_abs_epi32(delta), shift);
+        m = _mm256_srli_epi32(_mm256_mullo_epi32(m, th), 16);
+        m = _mm256_max_epi32(_mm256_sub_epi32(c127, m), zero);
+        m = _mm256_mullo_epi32(m, m);
+        // m*m*delta >> 14 needs more than 32 bits; split delta at bit 14
+        __m256i t = _mm256_mullo_epi32(_mm256_srai_epi32(delta, 14), m);
+        t = _mm256_add_epi32(t, _mm256_srli_epi32(
+                _mm256_mullo_epi32(_mm256_and_si256(delta, low14), m), 14));
+        pix = _mm256_add_epi32(pix, _mm256_add_epi32(t, dith));
+        pix = _mm256_srai_epi32(pix, 7);
+        pix = _mm256_min_epi32(_mm256_max_epi32(pix, zero), maxval);
+        _mm_storeu_si128((__m128i *)(dst + x),
+                         _mm_packus_epi32(_mm256_castsi256_si128(pix),
+                                          _mm256_extracti128_si256(pix, 1)));
+    }
+    _mm256_zeroupper();
+    filter_line16_c(dst + x, src + x, dc + x / 2, width - x, thresh, dithers,
+                    depth);
+}
+
+__attribute__((target("avx2")))
+static void blur_line16_avx2(uint32_t *dc, uint32_t *buf, uint32_t *buf1,
+                             uint16_t *src, int sstride, int width)
+{
+    __m256i ffff = _mm256_set1_epi32(0xFFFF);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + 2 * x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 2 * x + sstride));
+        a = _mm256_add_epi32(_mm256_and_si256(a, ffff), _mm256_srli_epi32(a, 16));
+        b = _mm256_add_epi32(_mm256_and_si256(b, ffff), _mm256_srli_epi32(b, 16));
+        __m256i v = _mm256_add_epi32(_mm256_add_epi32(a, b),
+                        _mm256_loadu_si256((const __m256i *)(buf1 + x)));
+        __m256i old = _mm256_loadu_si256((const __m256i *)(buf + x));
+        _mm256_storeu_si256((__m256i *)(buf + x), v);
+        _mm256_storeu_si256((__m256i *)(dc + x), _mm256_sub_epi32(v, old));
+    }
+    _mm256_zeroupper();
+    blur_line16_sse2(dc + x, buf + x, buf1 + x, src + 2 * x, sstride, width - x);
+}
+
+#endif /* HAVE_X86_INTRINSICS */
+
+/* Filter the rows [y0, y1) of a plane. The rows are split into slices, which
+ * can run in parallel, each with its own buffer (sbuf). Each slice except the
+ * first starts at an even row y0 with r <= y0 < height - r - 1, and recomputes
+ * the vertical running sums it needs from the r block rows before it, so the
+ * result doesn't depend on the number of slices.
+ *
+ * sbuf layout: dc (with 16 elements of padding on both sides), a row of
+ * zeros, and r rows of vertical running sums.
+ */
+#define FILTER_SLICE(NAME, pixel, acc, mul, BLUR_LINE, FILTER_LINE, ...)      \
+static void NAME(struct vf_priv_s *ctx, acc *sbuf, pixel *dst, pixel *src,   \
+                 int width, int height, int dstride, int sstride, int r,     \
+                 int y0, int y1, int depth)                                  \
+{                                                                            \
+    int bstride = ((width+15)&~15)/2;                                        \
+    mul dc_factor = (1<<21)/(r*r);                                           \
+    acc *dc = sbuf+16;                                                       \
+    acc *zero = dc+bstride+16;                                               \
+    acc *buf = zero+bstride;                                                 \
+    int thresh = ctx->thresh;                                                \
+    int y = y0 ? y0 : r;                                                     \
+    int j0 = (y+r)/2 - r;                                                    \
+    int j;                                                                   \
+                                                                             \
+    memset(sbuf, 0, (2*bstride+32)*sizeof(*sbuf));                           \
+    for (j=j0; j<j0+r; j++) {                                                \
+        acc *buf1 = j == j0 ? zero : buf+((j-1)%r)*bstride;                  \
+        ctx->BLUR_LINE(dc, buf+(j%r)*bstride, buf1, src+2*j*sstride,         \
+                       sstride, width/2);                                    \
+    }                                                                        \
+    for (;;) {                                                               \
+        if (y+r+1 < height) {                                                \
+            int mod = ((y+r)/2)%r;                                           \
+            acc *buf0 = buf+mod*bstride;                                     \
+            acc *buf1 = buf+(mod?mod-1:r-1)*bstride;                         \
+            int x, v;                                                        \
+            ctx->BLUR_LINE(dc, buf0, buf1, src+(y+r)*sstride, sstride,       \
+                           width/2);                                         \
+            for (x=v=0; x<r; x++)                                            \
+                v += dc[x];                                                  \
+            for (; x<width/2; x++) {                                         \
+                v += dc[x] - dc[x-r];                                        \
+                dc[x-r] = v * dc_factor >> 16;                               \
+            }                                                                \
+            for (; x<(width+r+1)/2; x++)                                     \
+                dc[x-r] = v * dc_factor >> 16;                               \
+            for (x=-r/2; x<0; x++)                                           \
+                dc[x] = dc[0];                                               \
+        }                                                                    \
+        if (y == r && !y0) {                                                 \
+            for (y=0; y<r; y++)                                              \
+                ctx->FILTER_LINE(dst+y*dstride, src+y*sstride, dc-r/2,       \
+                                 width, thresh, dither[y&7] __VA_ARGS__);    \
+        }                                                                    \
+        ctx->FILTER_LINE(dst+y*dstride, src+y*sstride, dc-r/2, width,        \
+                         thresh, dither[y&7] __VA_ARGS__);                   \
+        if (++y >= y1) break;                                                \
+        ctx->FILTER_LINE(dst+y*dstride, src+y*sstride, dc-r/2, width,        \
+                         thresh, dither[y&7] __VA_ARGS__);                   \
+        if (++y >= y1) break;                                                \
+    }                                                                        \
+}
+
+FILTER_SLICE(filter_slice, uint8_t, uint16_t, uint32_t,
+             blur_line, filter_line)
+FILTER_SLICE(filter_slice16, uint16_t, uint32_t, uint64_t,
+             blur_line16, filter_line16, , depth)
+
+struct plane_job {
+    struct vf_priv_s *ctx;
+    struct mp_image *dst, *src;
+    int plane, w, h, r, depth;
+    int num_slices;
+};
+
+static void filter_slice_job(void *ptr, int n)
+{
+    struct plane_job *job = ptr;
+    struct vf_priv_s *ctx = job->ctx;
+    int r = job->r, h = job->h, p = job->plane;
+    // Slice boundaries are even rows in [r, h - r).
+    int rows = (h - 2*r) / 2;
+    int y0 = n ? r + 2*(n*rows/job->num_slices) : 0;
+    int y1 = n+1 < job->num_slices
+             ? r + 2*((n+1)*rows/job->num_slices) : h;
+    int depth = job->depth;
+
+    if (depth == 8) {
+        uint16_t *sbuf = (uint16_t *)ctx->buf + n * ctx->buf_size;
+        filter_slice(ctx, sbuf, job->dst->planes[p], job->src->planes[p],
+                     job->w, h, job->dst->stride[p], job->src->stride[p], r,
+                     y0, y1, depth);
+    } else {
+        uint32_t *sbuf = (uint32_t *)ctx->buf + n * ctx->buf_size;
+        filter_slice16(ctx, sbuf, (uint16_t *)job->dst->planes[p],
+                       (uint16_t *)job->src->planes[p], job->w, h,
+                       job->dst->stride[p] / 2, job->src->stride[p] / 2, r,
+                       y0, y1, depth);
     }
 }
 
@@ -297,6 +458,7 @@ static struct mp_image *filter(struct vf_instance *vf, struct mp_image *mpi)
         mp_image_copy_attributes(dmpi, mpi);
     }
 
+    int depth = mpi->fmt.plane_bits;
     for (int p=0; p < mpi->num_planes; p++) {
         int w = mpi->w;
         int h = mpi->h;
@@ -307,12 +469,18 @@ static struct mp_image *filter(struct vf_instance *vf, struct mp_image *mpi)
             r = ((r>>mpi->chroma_x_shift) + (r>>mpi->chroma_y_shift)) / 2;
             r = av_clip((r+1)&~1,4,32);
         }
-        if (FFMIN(w,h) > 2*r)
-            filter_plane(vf->priv, dmpi->planes[p], mpi->planes[p], w, h,
-                                   dmpi->stride[p], mpi->stride[p], r);
-        else if (dmpi->planes[p] != mpi->planes[p])
-            memcpy_pic(dmpi->planes[p], mpi->planes[p], w, h,
+        if (FFMIN(w,h) > 2*r) {
+            struct plane_job job = {
+                .ctx = vf->priv, .dst = dmpi, .src = mpi,
+                .plane = p, .w = w, .h = h, .r = r, .depth = depth,
+                .num_slices = MPMAX(1, MPMIN(vf->priv->num_slices, (h-2*r)/2)),
+            };
+            mp_thread_pool_run(vf->priv->pool, filter_slice_job, &job,
+                               job.num_slices);
+        } else if (dmpi->planes[p] != mpi->planes[p]) {
+            memcpy_pic(dmpi->planes[p], mpi->planes[p], w * ((depth+7)/8), h,
                        dmpi->stride[p], mpi->stride[p]);
+        }
     }
 
     if (dmpi != mpi)
@@ -322,31 +490,28 @@ static struct mp_image *filter(struct vf_instance *vf, struct mp_image *mpi)
 
 static int query_format(struct vf_instance *vf, unsigned int fmt)
 {
-    switch (fmt){
-    case IMGFMT_Y8:
-    case IMGFMT_444P:
-    case IMGFMT_422P:
-    case IMGFMT_440P:
-    case IMGFMT_420P:
-    case IMGFMT_411P:
-    case IMGFMT_410P:
-        return vf_next_query_format(vf,fmt);
-    }
-    return 0;
+    struct mp_imgfmt_desc desc = mp_imgfmt_get_desc(fmt);
+    if (!(desc.flags & MP_IMGFLAG_YUV_P) || !(desc.flags & MP_IMGFLAG_NE) ||
+        (desc.flags & MP_IMGFLAG_ALPHA) || desc.num_planes == 2)
+        return 0;
+    return vf_next_query_format(vf,fmt);
 }
 
 static int config(struct vf_instance *vf,
                   int width, int height, int d_width, int d_height,
                   unsigned int flags, unsigned int outfmt)
 {
-    free(vf->priv->buf);
+    av_free(vf->priv->buf);
     vf->priv->radius = vf->priv->cfg_radius;
     if (vf->priv->cfg_size > -1) {
         vf->priv->radius = (vf->priv->cfg_size / 100.0f)
                            * sqrtf(width * width + height * height);
     }
     vf->priv->radius = av_clip((vf->priv->radius+1)&~1, 4, 32);
-    vf->priv->buf = av_mallocz((((width+15)&~15)*(vf->priv->radius+1)/2+32)*sizeof(uint16_t));
+    // See FILTER_SLICE() for the layout; chroma planes need less.
+    vf->priv->buf_size = ((width+15)&~15)/2*(vf->priv->radius+2)+32;
+    vf->priv->buf = av_mallocz(vf->priv->buf_size * vf->priv->num_slices *
+                               sizeof(uint32_t));
     return vf_next_config(vf,width,height,d_width,d_height,flags,outfmt);
 }
 
@@ -354,6 +519,7 @@ static void uninit(struct vf_instance *vf)
 {
     if (!vf->priv) return;
     av_free(vf->priv->buf);
+    talloc_free(vf->priv->pool);
 }
 
 static void lavfi_recreate(struct vf_instance *vf)
@@ -398,18 +564,24 @@ static int vf_open(vf_instance_t *vf)
 
     vf->priv->blur_line = blur_line_c;
     vf->priv->filter_line = filter_line_c;
-#if HAVE_SSE2 && HAVE_6REGS
-    if (gCpuCaps.hasSSE2)
+    vf->priv->blur_line16 = blur_line16_c;
+    vf->priv->filter_line16 = filter_line16_c;
+#if HAVE_X86_INTRINSICS
+    if (gCpuCaps.hasSSE2) {
         vf->priv->blur_line = blur_line_sse2;
+        vf->priv->filter_line = filter_line_sse2;
+        vf->priv->blur_line16 = blur_line16_sse2;
+    }
+    if (gCpuCaps.hasAVX2) {
+        vf->priv->blur_line = blur_line_avx2;
+        vf->priv->filter_line = filter_line_avx2;
+        vf->priv->blur_line16 = blur_line16_avx2;
+        vf->priv->filter_line16 = filter_line16_avx2;
+    }
 #endif
-#if HAVE_MMX2
-    if (gCpuCaps.hasMMX2)
-        vf->priv->filter_line = filter_line_mmx2;
-#endif
-#if HAVE_SSSE3
-    if (gCpuCaps.hasSSSE3)
-        vf->priv->filter_line = filter_line_ssse3;
-#endif
+
+    vf->priv->pool = mp_thread_pool_create(NULL, vf->priv->cfg_threads);
+    vf->priv->num_slices = mp_thread_pool_get_threads(vf->priv->pool);
 
     return 1;
 }
@@ -419,6 +591,7 @@ static const m_option_t vf_opts_fields[] = {
     OPT_FLOATRANGE("strength", cfg_thresh, 0, 0.51, 255),
     OPT_INTRANGE("radius", cfg_radius, 0, 4, 32),
     OPT_FLOATRANGE("size", cfg_size, 0, 0.1, 5.0),
+    OPT_INTRANGE("threads", cfg_threads, 0, 0, 64),
     OPT_SUBSTRUCT("", lw_opts, vf_lw_conf, 0),
     {0}
 };
@@ -0,0 +1,445 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Frame rate conversion without GPU.
+ *
+ * Output frames are generated on a fixed clock. An output frame at time t
+ * between the input frames A and B is the weighted average of A and B, with
+ * the weight of B being (t - A.pts) / (B.pts - A.pts).
+ *
+ * In mci mode (motion compensated interpolation), each block of B gets an
+ * integer pel motion vector v pointing into A, found by a predictive search
+ * on the luma plane (zero, left neighbour, same block of the previous frame
+ * pair, a coarse grid, then small diamond refinement). The output block at
+ * position p then blends A at p + t*v with B at p - (1-t)*v. Blocks without
+ * a good match fall back to plain blending, and frame pairs with a scene
+ * change to the nearest input frame.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "talloc.h"
+#include "common/common.h"
+#include "common/msg.h"
+#include "options/m_option.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+#include "misc/thread_pool.h"
+#include "vf.h"
+#include "pixel_kernels.h"
+
+enum {
+    MODE_BLEND,
+    MODE_MCI,
+};
+
+// Frames further apart than this (in seconds) are not interpolated.
+#define MAX_FRAME_GAP 1.0
+
+// Blocks with a higher mean absolute difference per pixel at the best motion
+// vector are blended without motion compensation.
+#define BAD_BLOCK_SAD 24
+
+struct mv {
+    int16_t x, y;
+    bool bad;
+};
+
+struct vf_priv_s {
+    double fps;
+    int mode;
+    int block;
+    int search;
+    float scene;
+    int threads;
+
+    const struct mp_pixel_kernels *k;
+    struct mp_thread_pool *pool;
+    int num_slices;
+    struct vf_fps_pts_buf clock;
+
+    struct mp_image *prev;      // frame A (the last input frame)
+    bool prev_shown;            // an output frame was A, or derived from it
+
+    // Block motion field from B to A, and the one of the previous frame pair
+    // (used as temporal predictor).
+    int mb_w, mb_h;
+    struct mv *mv, *mv_prev;
+    bool have_mv_prev;
+    uint64_t *slice_sad;        // per slice sum of the block SADs
+};
+
+struct job {
+    struct vf_priv_s *p;
+    struct mp_image *dst, *a, *b;
+    int weight;
+    int num_slices;
+};
+
+// Slice n covers the block rows [*by0, *by1).
+static void slice_range(struct job *job, int n, int *by0, int *by1)
+{
+    int mb_h = job->p->mb_h;
+    *by0 = n * mb_h / job->num_slices;
+    *by1 = (n + 1) * mb_h / job->num_slices;
+}
+
+// Round n / d to the nearest integer (halfway cases away from zero).
+static int rdiv(int n, int d)
+{
+    return n >= 0 ? (n + d / 2) / d : -((-n + d / 2) / d);
+}
+
+struct search {
+    const struct mp_pixel_kernels *k;
+    const uint8_t *a, *b;       // a: plane of A, b: block in B
+    int a_stride, b_stride;
+    int x, y, w, h;             // block position and size
+    int pw, ph;                 // plane size
+    int range;
+    struct mv best;
+    unsigned int best_cost, best_sad;
+};
+
+// Evaluate the motion vector (vx, vy), and make it the best one if it is.
+static bool try_mv(struct search *s, int vx, int vy)
+{
+    if (abs(vx) > s->range || abs(vy) > s->range ||
+        s->x + vx < 0 || s->x + vx + s->w > s->pw ||
+        s->y + vy < 0 || s->y + vy + s->h > s->ph)
+        return false;
+    unsigned int sad = s->k->sad(s->a + (s->y + vy) * s->a_stride + s->x + vx,
+                                 s->a_stride, s->b, s->b_stride, s->w, s->h);
+    // Prefer short vectors, which are more likely the true motion.
+    unsigned int cost = sad + ((abs(vx) + abs(vy)) * s->w * s->h >> 5);
+    if (cost >= s->best_cost)
+        return false;
+    s->best = (struct mv){vx, vy};
+    s->best_cost = cost;
+    s->best_sad = sad;
+    return true;
+}
+
+static void estimate_slice(void *ptr, int n)
+{
+    struct job *job = ptr;
+    struct vf_priv_s *p = job->p;
+    struct mp_image *a = job->a, *b = job->b;
+    int bs = p->block;
+    uint64_t sum = 0;
+
+    int by0, by1;
+    slice_range(job, n, &by0, &by1);
+    for (int by = by0; by < by1; by++) {
+        for (int bx = 0; bx < p->mb_w; bx++) {
+            int i = by * p->mb_w + bx;
+            struct search s = {
+                .k = p->k,
+                .a = a->planes[0], .a_stride = a->stride[0],
+                .b = b->planes[0] + by * bs * b->stride[0] + bx * bs,
+                .b_stride = b->stride[0],
+                .x = bx * bs, .y = by * bs,
+                .w = MPMIN(bs, a->w - bx * bs), .h = MPMIN(bs, a->h - by * bs),
+                .pw = a->w, .ph = a->h,
+                .range = p->search,
+                .best_cost = UINT_MAX,
+            };
+            try_mv(&s, 0, 0);
+            if (p->mode == MODE_MCI) {
+                // Only predictors which don't depend on the slicing, so that
+                // the result is the same with any number of threads.
+                if (bx > 0)
+                    try_mv(&s, p->mv[i - 1].x, p->mv[i - 1].y);
+                if (p->have_mv_prev)
+                    try_mv(&s, p->mv_prev[i].x, p->mv_prev[i].y);
+                int step = MPMAX(2, s.range / 2);
+                for (int vy = -s.range; vy <= s.range; vy += step) {
+                    for (int vx = -s.range; vx <= s.range; vx += step)
+                        try_mv(&s, vx, vy);
+                }
+                for (int iter = 0; iter < 2 * s.range; iter++) {
+                    struct mv c = s.best;
+                    bool moved = try_mv(&s, c.x - 1, c.y);
+                    moved |= try_mv(&s, c.x + 1, c.y);
+                    moved |= try_mv(&s, c.x, c.y - 1);
+                    moved |= try_mv(&s, c.x, c.y + 1);
+                    if (!moved)
+                        break;
+                }
+                s.best.bad = s.best_sad > BAD_BLOCK_SAD * s.w * s.h;
+                p->mv[i] = s.best;
+            }
+            sum += s.best_sad;
+        }
+    }
+    p->slice_sad[n] = sum;
+}
+
+// Return the mean absolute difference per luma pixel between the frames
+// (after motion compensation in mci mode).
+static double estimate_motion(struct vf_priv_s *p, struct mp_image *a,
+                              struct mp_image *b)
+{
+    MPSWAP(struct mv *, p->mv, p->mv_prev);
+    struct job job = {
+        .p = p, .a = a, .b = b,
+        .num_slices = MPMIN(p->num_slices, p->mb_h),
+    };
+    mp_thread_pool_run(p->pool, estimate_slice, &job, job.num_slices);
+    p->have_mv_prev = p->mode == MODE_MCI;
+
+    uint64_t sum = 0;
+    for (int n = 0; n < job.num_slices; n++)
+        sum += p->slice_sad[n];
+    return sum / (double)(a->w * a->h);
+}
+
+static void render_slice(void *ptr, int n)
+{
+    struct job *job = ptr;
+    struct vf_priv_s *p = job->p;
+    struct mp_image *dst = job->dst, *a = job->a, *b = job->b;
+    const struct mp_pixel_kernels *k = p->k;
+    int weight = job->weight;
+
+    int by0, by1;
+    slice_range(job, n, &by0, &by1);
+    for (int plane = 0; plane < dst->num_planes; plane++) {
+        int xs = plane ? dst->chroma_x_shift : 0;
+        int ys = plane ? dst->chroma_y_shift : 0;
+        int pw = dst->plane_w[plane], ph = dst->plane_h[plane];
+        int bw = p->block >> xs, bh = p->block >> ys;
+        uint8_t *d = dst->planes[plane];
+        const uint8_t *sa = a->planes[plane], *sb = b->planes[plane];
+        int ds = dst->stride[plane], as = a->stride[plane], bs = b->stride[plane];
+
+        if (p->mode == MODE_BLEND) {
+            int y1 = by1 == p->mb_h ? ph : by1 * bh;
+            for (int y = by0 * bh; y < y1; y++)
+                k->blend(d + y * ds, sa + y * as, sb + y * bs, pw, weight);
+            continue;
+        }
+
+        for (int by = by0; by < by1; by++) {
+            int y = by * bh;
+            int h = by + 1 == p->mb_h ? ph - y : bh;
+            for (int bx = 0; bx < p->mb_w; bx++) {
+                int x = bx * bw;
+                int w = bx + 1 == p->mb_w ? pw - x : bw;
+                struct mv v = p->mv[by * p->mb_w + bx];
+                if (v.bad)
+                    v = (struct mv){0};
+                // Offsets into A and B; their difference is v in this plane.
+                int dax = rdiv(v.x * weight, 256 << xs);
+                int day = rdiv(v.y * weight, 256 << ys);
+                int dbx = dax - rdiv(v.x, 1 << xs);
+                int dby = day - rdiv(v.y, 1 << ys);
+                int ax = MPCLAMP(x + dax, 0, pw - w);
+                int ay = MPCLAMP(y + day, 0, ph - h);
+                int bxx = MPCLAMP(x + dbx, 0, pw - w);
+                int byy = MPCLAMP(y + dby, 0, ph - h);
+                // If only one of the source blocks is (partially) outside of
+                // the frame, use the other one alone.
+                bool a_out = ax != x + dax || ay != y + day;
+                bool b_out = bxx != x + dbx || byy != y + dby;
+                int wb = weight;
+                if (a_out != b_out)
+                    wb = a_out ? 256 : 0;
+                for (int r = 0; r < h; r++) {
+                    k->blend(d + (y + r) * ds + x,
+                             sa + (ay + r) * as + ax,
+                             sb + (byy + r) * bs + bxx, w, wb);
+                }
+            }
+        }
+    }
+}
+
+static struct mp_image *render(struct vf_instance *vf, struct mp_image *a,
+                               struct mp_image *b, int weight)
+{
+    struct vf_priv_s *p = vf->priv;
+    struct mp_image *dst = vf_alloc_out_image(vf);
+    mp_image_copy_attributes(dst, a);
+    struct job job = {
+        .p = p, .dst = dst, .a = a, .b = b, .weight = weight,
+        .num_slices = MPMIN(p->num_slices, p->mb_h),
+    };
+    mp_thread_pool_run(p->pool, render_slice, &job, job.num_slices);
+    return dst;
+}
+
+static void reset(struct vf_instance *vf)
+{
+    struct vf_priv_s *p = vf->priv;
+    talloc_free(p->prev);
+    p->prev = NULL;
+    p->prev_shown = false;
+    p->have_mv_prev = false;
+    vf_fps_reset_pts(&p->clock, MP_NOPTS_VALUE);
+}
+
+static int filter_ext(struct vf_instance *vf, struct mp_image *mpi)
+{
+    struct vf_priv_s *p = vf->priv;
+    struct mp_image *a = p->prev;
+    bool a_shown = p->prev_shown;
+
+    // Output frames are generated only once the next frame is known, so the
+    // filter delays by one frame.
+    p->prev = mpi;
+    p->prev_shown = false;
+    if (!a) {
+        vf_fps_reset_pts(&p->clock, mpi->pts);
+        return 0;
+    }
+
+    double delta = mpi->pts - a->pts;
+    if (mpi->pts == MP_NOPTS_VALUE || a->pts == MP_NOPTS_VALUE ||
+        !(delta > 0) || delta > MAX_FRAME_GAP)
+    {
+        // Discontinuity: pass A through, and restart the clock at B.
+        if (!a_shown) {
+            vf_add_output_frame(vf, a);
+        } else {
+            talloc_free(a);
+        }
+        vf_fps_reset_pts(&p->clock, mpi->pts);
+        p->have_mv_prev = false;
+        return 0;
+    }
+
+    bool scene_change = false;
+    if (p->mode == MODE_MCI || p->scene > 0) {
+        double diff = estimate_motion(p, a, mpi);
+        scene_change = p->scene > 0 && diff > p->scene;
+        if (scene_change)
+            MP_DBG(vf, "scene change at %f (diff %f)\n", mpi->pts, diff);
+    }
+
+    double pts;
+    while ((pts = vf_fps_next_pts(&p->clock, mpi->pts)) != MP_NOPTS_VALUE) {
+        int weight = MPCLAMP(lrint((pts - a->pts) / delta * 256), 0, 256);
+        if (scene_change)
+            weight = weight < 128 ? 0 : 256;
+        struct mp_image *out;
+        if (weight == 0) {
+            out = mp_image_new_ref(a);
+        } else if (weight == 256) {
+            out = mp_image_new_ref(mpi);
+            p->prev_shown = true;
+        } else {
+            out = render(vf, a, mpi, weight);
+        }
+        out->pts = pts;
+        vf_add_output_frame(vf, out);
+    }
+
+    talloc_free(a);
+    return 0;
+}
+
+static int query_format(struct vf_instance *vf, unsigned int fmt)
+{
+    struct mp_imgfmt_desc desc = mp_imgfmt_get_desc(fmt);
+    if (!(desc.flags & MP_IMGFLAG_YUV_P) || (desc.flags & MP_IMGFLAG_ALPHA) ||
+        desc.plane_bits != 8 || desc.num_planes == 2)
+        return 0;
+    return vf_next_query_format(vf, fmt);
+}
+
+static int config(struct vf_instance *vf,
+                  int width, int height, int d_width, int d_height,
+                  unsigned int flags, unsigned int outfmt)
+{
+    struct vf_priv_s *p = vf->priv;
+    reset(vf);
+    p->mb_w = (width + p->block - 1) / p->block;
+    p->mb_h = (height + p->block - 1) / p->block;
+    talloc_free(p->mv);
+    talloc_free(p->mv_prev);
+    p->mv = talloc_zero_array(vf, struct mv, p->mb_w * p->mb_h);
+    p->mv_prev = talloc_zero_array(vf, struct mv, p->mb_w * p->mb_h);
+    return vf_next_config(vf, width, height, d_width, d_height, flags, outfmt);
+}
+
+static int control(struct vf_instance *vf, int request, void *data)
+{
+    switch (request) {
+    case VFCTRL_SEEK_RESET:
+        reset(vf);
+        return CONTROL_OK;
+    }
+    return CONTROL_UNKNOWN;
+}
+
+static void uninit(struct vf_instance *vf)
+{
+    reset(vf);
+    talloc_free(vf->priv->pool);
+}
+
+static int vf_open(vf_instance_t *vf)
+{
+    struct vf_priv_s *p = vf->priv;
+
+    vf->filter_ext = filter_ext;
+    vf->query_format = query_format;
+    vf->config = config;
+    vf->control = control;
+    vf->uninit = uninit;
+
+    p->k = mp_get_pixel_kernels();
+    p->pool = mp_thread_pool_create(NULL, p->threads);
+    p->num_slices = mp_thread_pool_get_threads(p->pool);
+    p->slice_sad = talloc_zero_array(vf, uint64_t, p->num_slices);
+    vf_fps_init_pts_buf(&p->clock, p->fps);
+
+    MP_VERBOSE(vf, "using %s kernels, %d threads\n", p->k->name,
+               p->num_slices);
+    return 1;
+}
+
+#define OPT_BASE_STRUCT struct vf_priv_s
+const vf_info_t vf_info_interpolate = {
+    .description = "frame rate conversion by blending or motion compensation",
+    .name = "interpolate",
+    .open = vf_open,
+    .priv_size = sizeof(struct vf_priv_s),
+    .priv_defaults = &(const struct vf_priv_s){
+        .fps = 60,
+        .mode = MODE_BLEND,
+        .block = 16,
+        .search = 8,
+        .scene = 20,
+    },
+    .options = (const struct m_option[]){
+        OPT_DOUBLE("fps", fps, CONF_RANGE, .min = 1, .max = 1000),
+        OPT_CHOICE("mode", mode, 0,
+                   ({"blend", MODE_BLEND},
+                    {"mci", MODE_MCI})),
+        OPT_CHOICE("block", block, 0, ({"8", 8}, {"16", 16}, {"32", 32})),
+        OPT_INTRANGE("search", search, 0, 1, 64),
+        OPT_FLOATRANGE("scene", scene, 0, 0, 255),
+        OPT_INTRANGE("threads", threads, 0, 0, 64),
+        {0}
+    },
+};
@@ -76,6 +76,11 @@ struct vf_priv_s {
     AVRational timebase_out;
     AVRational par_in;
 
+    // Identifies the configuration the current graph was created with
+    char *graph_id;
+    // Number of frames sent to the current graph
+    int64_t frames_in;
+
     // for the lw wrapper
     void *old_priv;
     void (*lw_recreate_cb)(struct vf_instance *vf);
@@ -95,6 +100,9 @@ static void destroy_graph(struct vf_instance *vf)
     struct vf_priv_s *p = vf->priv;
     avfilter_graph_free(&p->graph);
     p->in = p->out = NULL;
+    talloc_free(p->graph_id);
+    p->graph_id = NULL;
+    p->frames_in = 0;
 }
 
 static AVRational par_from_sar_dar(int width, int height,
@@ -131,9 +139,35 @@ static bool recreate_graph(struct vf_instance *vf, int width, int height,
 
     if (bstr0(p->cfg_graph).len == 0) {
         MP_FATAL(vf, "lavfi: no filter graph set\n");
+        talloc_free(tmp);
         return false;
     }
 
+    // Build list of acceptable output pixel formats. libavfilter will insert
+    // conversion filters if needed.
+    char *fmtstr = talloc_strdup(tmp, "");
+    for (int n = IMGFMT_START; n < IMGFMT_END; n++) {
+        if (vf_next_query_format(vf, n)) {
+            const char *name = av_get_pix_fmt_name(imgfmt2pixfmt(n));
+            if (name) {
+                const char *s = fmtstr[0] ? FMTSEP : "";
+                fmtstr = talloc_asprintf_append_buffer(fmtstr, "%s%s", s, name);
+            }
+        }
+    }
+
+    // Keep the existing graph (and the frames buffered in it) if nothing the
+    // graph depends on has changed.
+    char *id = talloc_asprintf(tmp, "%dx%d:%dx%d:%u:%"PRId64":%s:%s:%s",
+                               width, height, d_width, d_height, fmt,
+                               p->cfg_sws_flags, fmtstr, p->cfg_graph,
+                               p->cfg_avopts ? p->cfg_avopts : "");
+    if (p->graph && p->graph_id && strcmp(p->graph_id, id) == 0) {
+        MP_VERBOSE(vf, "lavfi: reusing graph\n");
+        talloc_free(tmp);
+        return true;
+    }
+
     destroy_graph(vf);
     MP_VERBOSE(vf, "lavfi: create graph: '%s'\n", p->cfg_graph);
 
@@ -152,19 +186,6 @@ static bool recreate_graph(struct vf_instance *vf, int width, int height,
     if (!outputs || !inputs)
         goto error;
 
-    // Build list of acceptable output pixel formats. libavfilter will insert
-    // conversion filters if needed.
-    char *fmtstr = talloc_strdup(tmp, "");
-    for (int n = IMGFMT_START; n < IMGFMT_END; n++) {
-        if (vf_next_query_format(vf, n)) {
-            const char *name = av_get_pix_fmt_name(imgfmt2pixfmt(n));
-            if (name) {
-                const char *s = fmtstr[0] ? FMTSEP : "";
-                fmtstr = talloc_asprintf_append_buffer(fmtstr, "%s%s", s, name);
-            }
-        }
-    }
-
     char *sws_flags = talloc_asprintf(tmp, "flags=%"PRId64, p->cfg_sws_flags);
     graph->scale_sws_opts = av_strdup(sws_flags);
 
@@ -206,6 +227,7 @@ static bool recreate_graph(struct vf_instance *vf, int width, int height,
     p->in = in;
     p->out = out;
     p->graph = graph;
+    p->graph_id = talloc_steal(vf, id);
 
     assert(out->nb_inputs == 1);
     assert(in->nb_outputs == 1);
@@ -266,13 +288,13 @@ static AVFrame *mp_to_av(struct vf_instance *vf, struct mp_image *img)
     return frame;
 }
 
+// The returned image references av_frame's data; av_frame is not free'd.
 static struct mp_image *av_to_mp(struct vf_instance *vf, AVFrame *av_frame)
 {
     struct vf_priv_s *p = vf->priv;
     struct mp_image *img = mp_image_from_av_frame(av_frame);
     img->pts = av_frame->pts == AV_NOPTS_VALUE ?
                MP_NOPTS_VALUE : av_frame->pts * av_q2d(p->timebase_out);
-    av_frame_free(&av_frame);
     return img;
 }
 
@@ -283,22 +305,23 @@ static int filter_ext(struct vf_instance *vf, struct mp_image *mpi)
     if (!p->graph)
         return -1;
 
+    // Both directions only pass references; the image data is never copied.
     AVFrame *frame = mp_to_av(vf, mpi);
     if (av_buffersrc_add_frame(p->in, frame) < 0) {
         av_frame_free(&frame);
         return -1;
     }
-    av_frame_free(&frame);
+    p->frames_in++;
 
     for (;;) {
-        frame = av_frame_alloc();
+        av_frame_unref(frame);
         if (av_buffersink_get_frame(p->out, frame) < 0) {
             // Not an error situation - no more output buffers in queue.
-            av_frame_free(&frame);
             break;
         }
         vf_add_output_frame(vf, av_to_mp(vf, frame));
     }
+    av_frame_free(&frame);
 
     return 0;
 }
@@ -307,8 +330,12 @@ static void reset(vf_instance_t *vf)
 {
     struct vf_priv_s *p = vf->priv;
     struct mp_image_params *f = &vf->fmt_in;
-    if (p->graph && f->imgfmt)
+    // There's no way to flush a graph, so it has to be recreated if it could
+    // contain buffered frames.
+    if (p->graph && p->frames_in && f->imgfmt) {
+        destroy_graph(vf);
         recreate_graph(vf, f->w, f->h, f->d_w, f->d_h, f->imgfmt);
+    }
 }
 
 static int control(vf_instance_t *vf, int request, void *data)
@@ -26,7 +26,6 @@
 
 #include "config.h"
 #include "common/msg.h"
-#include "common/cpudetect.h"
 #include "options/m_option.h"
 
 #include "video/img_format.h"
@@ -36,6 +35,7 @@
 #include "libavutil/mem.h"
 
 #include "vf_lavfi.h"
+#include "pixel_kernels.h"
 
 #define MAX_NOISE 4096
 #define MAX_SHIFT 1024
@@ -43,12 +43,6 @@
 
 //===========================================================================//
 
-static inline void lineNoise_C(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift);
-static inline void lineNoiseAvg_C(uint8_t *dst, uint8_t *src, int len, int8_t **shift);
-
-static void (*lineNoise)(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift)= lineNoise_C;
-static void (*lineNoiseAvg)(uint8_t *dst, uint8_t *src, int len, int8_t **shift)= lineNoiseAvg_C;
-
 typedef struct FilterParam{
 	int strength;
 	int uniform;
@@ -70,6 +64,7 @@ struct vf_priv_s {
         int temporal;
         int uniform;
         int hq;
+        const struct mp_pixel_kernels *kernels;
         struct vf_lw_opts *lw_opts;
 };
 
@@ -151,138 +146,7 @@ static int8_t *initNoise(FilterParam *fp){
 
 /***************************************************************************/
 
-#if HAVE_MMX
-static inline void lineNoise_MMX(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift){
-	x86_reg mmx_len= len&(~7);
-	noise+=shift;
-
-	__asm__ volatile(
-		"mov %3, %%"REG_a"		\n\t"
-		"pcmpeqb %%mm7, %%mm7		\n\t"
-		"psllw $15, %%mm7		\n\t"
-		"packsswb %%mm7, %%mm7		\n\t"
-		".align 4                       \n\t"
-		"1:				\n\t"
-		"movq (%0, %%"REG_a"), %%mm0	\n\t"
-		"movq (%1, %%"REG_a"), %%mm1	\n\t"
-		"pxor %%mm7, %%mm0		\n\t"
-		"paddsb %%mm1, %%mm0		\n\t"
-		"pxor %%mm7, %%mm0		\n\t"
-		"movq %%mm0, (%2, %%"REG_a")	\n\t"
-		"add $8, %%"REG_a"		\n\t"
-		" js 1b				\n\t"
-		:: "r" (src+mmx_len), "r" (noise+mmx_len), "r" (dst+mmx_len), "g" (-mmx_len)
-		: "%"REG_a
-	);
-	if(mmx_len!=len)
-		lineNoise_C(dst+mmx_len, src+mmx_len, noise+mmx_len, len-mmx_len, 0);
-}
-#endif
-
-//duplicate of previous except movntq
-#if HAVE_MMX2
-static inline void lineNoise_MMX2(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift){
-	x86_reg mmx_len= len&(~7);
-	noise+=shift;
-
-	__asm__ volatile(
-		"mov %3, %%"REG_a"		\n\t"
-		"pcmpeqb %%mm7, %%mm7		\n\t"
-		"psllw $15, %%mm7		\n\t"
-		"packsswb %%mm7, %%mm7		\n\t"
-		".align 4                       \n\t"
-		"1:				\n\t"
-		"movq (%0, %%"REG_a"), %%mm0	\n\t"
-		"movq (%1, %%"REG_a"), %%mm1	\n\t"
-		"pxor %%mm7, %%mm0		\n\t"
-		"paddsb %%mm1, %%mm0		\n\t"
-		"pxor %%mm7, %%mm0		\n\t"
-		"movntq %%mm0, (%2, %%"REG_a")	\n\t"
-		"add $8, %%"REG_a"		\n\t"
-		" js 1b				\n\t"
-		:: "r" (src+mmx_len), "r" (noise+mmx_len), "r" (dst+mmx_len), "g" (-mmx_len)
-		: "%"REG_a
-	);
-	if(mmx_len!=len)
-		lineNoise_C(dst+mmx_len, src+mmx_len, noise+mmx_len, len-mmx_len, 0);
-}
-#endif
-
-static inline void lineNoise_C(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift){
-	int i;
-	noise+= shift;
-	for(i=0; i<len; i++)
-	{
-		int v= src[i]+ noise[i];
-		if(v>255) 	dst[i]=255; //FIXME optimize
-		else if(v<0) 	dst[i]=0;
-		else		dst[i]=v;
-	}
-}
-
-/***************************************************************************/
-
-#if HAVE_MMX
-static inline void lineNoiseAvg_MMX(uint8_t *dst, uint8_t *src, int len, int8_t **shift){
-	x86_reg mmx_len= len&(~7);
-	uint8_t *src_mmx_len = src+mmx_len;
-
-	__asm__ volatile(
-		"push %%"REG_BP"		\n\t"
-		"mov %0, %%"REG_BP"		\n\t"
-		"mov %5, %%"REG_a"		\n\t"
-		".align 4                       \n\t"
-		"1:				\n\t"
-		"movq (%1, %%"REG_a"), %%mm1	\n\t"
-		"movq (%%"REG_BP", %%"REG_a"), %%mm0	\n\t"
-		"paddb (%2, %%"REG_a"), %%mm1	\n\t"
-		"paddb (%3, %%"REG_a"), %%mm1	\n\t"
-		"movq %%mm0, %%mm2		\n\t"
-		"movq %%mm1, %%mm3		\n\t"
-		"punpcklbw %%mm0, %%mm0		\n\t"
-		"punpckhbw %%mm2, %%mm2		\n\t"
-		"punpcklbw %%mm1, %%mm1		\n\t"
-		"punpckhbw %%mm3, %%mm3		\n\t"
-		"pmulhw %%mm0, %%mm1		\n\t"
-		"pmulhw %%mm2, %%mm3		\n\t"
-		"paddw %%mm1, %%mm1		\n\t"
-		"paddw %%mm3, %%mm3		\n\t"
-		"paddw %%mm0, %%mm1		\n\t"
-		"paddw %%mm2, %%mm3		\n\t"
-		"psrlw $8, %%mm1		\n\t"
-		"psrlw $8, %%mm3		\n\t"
-                "packuswb %%mm3, %%mm1		\n\t"
-		"movq %%mm1, (%4, %%"REG_a")	\n\t"
-		"add $8, %%"REG_a"		\n\t"
-		" js 1b				\n\t"
-		"pop %%"REG_BP"			\n\t"
-		:: "g" (src_mmx_len), "r" (shift[0]+mmx_len),
-		   "r" (shift[1]+mmx_len), "r" (shift[2]+mmx_len),
-                   "r" (dst+mmx_len), "g" (-mmx_len)
-		: "%"REG_a
-	);
-
-	if(mmx_len!=len){
-		int8_t *shift2[3]={shift[0]+mmx_len, shift[1]+mmx_len, shift[2]+mmx_len};
-		lineNoiseAvg_C(dst+mmx_len, src+mmx_len, len-mmx_len, shift2);
-	}
-}
-#endif
-
-static inline void lineNoiseAvg_C(uint8_t *dst, uint8_t *src, int len, int8_t **shift){
-	int i;
-        int8_t *src2= (int8_t*)src;
-
-	for(i=0; i<len; i++)
-	{
-	    const int n= shift[0][i] + shift[1][i] + shift[2][i];
-	    dst[i]= src2[i]+((n*src2[i])>>7);
-	}
-}
-
-/***************************************************************************/
-
-static void donoise(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp){
+static void donoise(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp, const struct mp_pixel_kernels *k){
 	int8_t *noise= fp->noise;
 	int y;
 	int shift=0;
@@ -311,10 +175,10 @@ static void donoise(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, in
 
 		if(fp->quality==0) shift&= ~7;
 		if (fp->averaged) {
-		    lineNoiseAvg(dst, src, width, fp->prev_shift[y]);
+		    k->add_noise_avg(dst, src, fp->prev_shift[y], width);
 		    fp->prev_shift[y][fp->shiftptr] = noise + shift;
 		} else {
-		    lineNoise(dst, src, noise, width, shift);
+		    k->add_noise(dst, src, noise + shift, width);
 		}
 		dst+= dstStride;
 		src+= srcStride;
@@ -331,16 +195,10 @@ static struct mp_image *filter(struct vf_instance *vf, struct mp_image *mpi)
             mp_image_copy_attributes(dmpi, mpi);
         }
 
-	donoise(dmpi->planes[0], mpi->planes[0], dmpi->stride[0], mpi->stride[0], mpi->w, mpi->h, &vf->priv->lumaParam);
-	donoise(dmpi->planes[1], mpi->planes[1], dmpi->stride[1], mpi->stride[1], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
-	donoise(dmpi->planes[2], mpi->planes[2], dmpi->stride[2], mpi->stride[2], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
-
-#if HAVE_MMX
-	if(gCpuCaps.hasMMX) __asm__ volatile ("emms\n\t");
-#endif
-#if HAVE_MMX2
-	if(gCpuCaps.hasMMX2) __asm__ volatile ("sfence\n\t");
-#endif
+	const struct mp_pixel_kernels *k = vf->priv->kernels;
+	donoise(dmpi->planes[0], mpi->planes[0], dmpi->stride[0], mpi->stride[0], mpi->w, mpi->h, &vf->priv->lumaParam, k);
+	donoise(dmpi->planes[1], mpi->planes[1], dmpi->stride[1], mpi->stride[1], mpi->w/2, mpi->h/2, &vf->priv->chromaParam, k);
+	donoise(dmpi->planes[2], mpi->planes[2], dmpi->stride[2], mpi->stride[2], mpi->w/2, mpi->h/2, &vf->priv->chromaParam, k);
 
         if (dmpi != mpi)
             talloc_free(mpi);
@@ -396,16 +254,8 @@ static int vf_open(vf_instance_t *vf){
     parse(&vf->priv->lumaParam, vf->priv);
     parse(&vf->priv->chromaParam, vf->priv);
 
-#if HAVE_MMX
-    if(gCpuCaps.hasMMX){
-        lineNoise= lineNoise_MMX;
-        lineNoiseAvg= lineNoiseAvg_MMX;
-    }
-#endif
-#if HAVE_MMX2
-    if(gCpuCaps.hasMMX2) lineNoise= lineNoise_MMX2;
-//    if(gCpuCaps.hasMMX) lineNoiseAvg= lineNoiseAvg_MMX2;
-#endif
+    p->kernels = mp_get_pixel_kernels();
+    MP_VERBOSE(vf, "Using %s kernels.\n", p->kernels->name);
 
     return 1;
 }
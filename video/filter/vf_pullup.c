@@ -45,6 +45,7 @@ struct vf_priv_s {
 	double lastpts;
         int junk_left, junk_right, junk_top, junk_bottom;
         int strict_breaks, metric_plane;
+        int threads;
         struct vf_lw_opts *lw_opts;
 };
 
@@ -64,6 +65,7 @@ static void reset(struct vf_instance *vf)
     c->junk_bottom = vf->priv->junk_bottom;
     c->strict_breaks = vf->priv->strict_breaks;
     c->metric_plane = vf->priv->metric_plane;
+    c->threads = vf->priv->threads;
 }
 
 static void init_pullup(struct vf_instance *vf, mp_image_t *mpi)
@@ -89,6 +91,7 @@ static void init_pullup(struct vf_instance *vf, mp_image_t *mpi)
 	if (gCpuCaps.hasMMX2) c->cpu |= PULLUP_CPU_MMX2;
 	if (gCpuCaps.hasSSE) c->cpu |= PULLUP_CPU_SSE;
 	if (gCpuCaps.hasSSE2) c->cpu |= PULLUP_CPU_SSE2;
+	if (gCpuCaps.hasAVX2) c->cpu |= PULLUP_CPU_AVX2;
 
 	pullup_init_context(c);
 
@@ -311,6 +314,7 @@ const vf_info_t vf_info_pullup = {
         OPT_INT("jb", junk_bottom, 0),
         OPT_INT("sb", strict_breaks, 0),
         OPT_CHOICE("mp", metric_plane, 0, ({"y", 0}, {"u", 1}, {"v", 2})),
+        OPT_INTRANGE("threads", threads, 0, 0, 64),
         OPT_SUBSTRUCT("", lw_opts, vf_lw_conf, 0),
         {0}
     },
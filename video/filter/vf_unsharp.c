@@ -26,7 +26,6 @@
 
 #include "config.h"
 #include "common/msg.h"
-#include "common/cpudetect.h"
 #include "options/m_option.h"
 
 #include "video/img_format.h"
@@ -36,6 +35,7 @@
 #include "libavutil/common.h"
 
 #include "vf_lavfi.h"
+#include "pixel_kernels.h"
 
 //===========================================================================//
 
@@ -46,11 +46,13 @@ typedef struct FilterParam {
     int msizeX, msizeY;
     double amount;
     uint32_t *SC[MAX_MATRIX_SIZE-1];
+    uint32_t *row;
 } FilterParam;
 
 struct vf_priv_s {
     FilterParam lumaParam;
     FilterParam chromaParam;
+    const struct mp_pixel_kernels *kernels;
     struct vf_lw_opts *lw_opts;
 };
 
@@ -67,19 +69,24 @@ Originally published Boston, Nov 98
 
 */
 
-static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp ) {
+/* The filter is separable, and the additions are done modulo 2^32 in any
+ * case, so instead of running the state machine per pixel, each row is
+ * filtered horizontally first (by repeated pair sums on a padded copy), and
+ * then fed into the vertical state machine, which runs on whole rows. The
+ * result is identical.
+ */
+
+static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp, const struct mp_pixel_kernels *k ) {
 
     uint32_t **SC = fp->SC;
-    uint32_t SR[MAX_MATRIX_SIZE-1], Tmp1, Tmp2;
+    uint32_t *row = fp->row;
     uint8_t* src2 = src; // avoid gcc warning
 
-    int32_t res;
     int x, y, z;
     int amount = fp->amount * 65536.0;
     int stepsX = fp->msizeX/2;
     int stepsY = fp->msizeY/2;
     int scalebits = (stepsX+stepsY)*2;
-    int32_t halfscale = 1 << ((stepsX+stepsY)*2-1);
 
     if( !fp->amount ) {
 	if( src == dst )
@@ -93,28 +100,23 @@ static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, i
     }
 
     for( y=0; y<2*stepsY; y++ )
-	memset( SC[y], 0, sizeof(SC[y][0]) * (width+2*stepsX) );
+	memset( SC[y], 0, sizeof(SC[y][0]) * width );
 
     for( y=-stepsY; y<height+stepsY; y++ ) {
 	if( y < height ) src2 = src;
-	memset( SR, 0, sizeof(SR[0]) * (2*stepsX-1) );
-	for( x=-stepsX; x<width+stepsX; x++ ) {
-	    Tmp1 = x<=0 ? src2[0] : x>=width ? src2[width-1] : src2[x];
-	    for( z=0; z<stepsX*2; z+=2 ) {
-		Tmp2 = SR[z+0] + Tmp1; SR[z+0] = Tmp1;
-		Tmp1 = SR[z+1] + Tmp2; SR[z+1] = Tmp2;
-	    }
-	    for( z=0; z<stepsY*2; z+=2 ) {
-		Tmp2 = SC[z+0][x+stepsX] + Tmp1; SC[z+0][x+stepsX] = Tmp1;
-		Tmp1 = SC[z+1][x+stepsX] + Tmp2; SC[z+1][x+stepsX] = Tmp2;
-	    }
-	    if( x>=stepsX && y>=stepsY ) {
-		uint8_t* srx = src - stepsY*srcStride + x - stepsX;
-		uint8_t* dsx = dst - stepsY*dstStride + x - stepsX;
-
-		res = (int32_t)*srx + ( ( ( (int32_t)*srx - (int32_t)((Tmp1+halfscale) >> scalebits) ) * amount ) >> 16 );
-		*dsx = res>255 ? 255 : res<0 ? 0 : (uint8_t)res;
-	    }
+	for( x=0; x<stepsX; x++ ) {
+	    row[x] = src2[0];
+	    row[width+stepsX+x] = src2[width-1];
+	}
+	for( x=0; x<width; x++ )
+	    row[stepsX+x] = src2[x];
+	for( z=0; z<2*stepsX; z++ )
+	    k->pair_sum( row, width+2*stepsX-1-z );
+	k->blur_v( row, SC, 2*stepsY, width );
+	if( y>=stepsY ) {
+	    uint8_t* srx = src - stepsY*srcStride;
+	    uint8_t* dsx = dst - stepsY*dstStride;
+	    k->sharpen( dsx, srx, row, width, amount, scalebits );
 	}
 	if( y >= 0 ) {
 	    dst += dstStride;
@@ -125,6 +127,8 @@ static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, i
 
 //===========================================================================//
 
+static void uninit( struct vf_instance *vf );
+
 static int config( struct vf_instance *vf,
 		   int width, int height, int d_width, int d_height,
 		   unsigned int flags, unsigned int outfmt ) {
@@ -134,19 +138,21 @@ static int config( struct vf_instance *vf,
 
     // allocate buffers
 
+    uninit( vf );
+
     fp = &vf->priv->lumaParam;
-    memset( fp->SC, 0, sizeof( fp->SC ) );
     stepsX = fp->msizeX/2;
     stepsY = fp->msizeY/2;
     for( z=0; z<2*stepsY; z++ )
-	fp->SC[z] = av_malloc(sizeof(*(fp->SC[z])) * (width+2*stepsX));
+	fp->SC[z] = av_malloc(sizeof(*(fp->SC[z])) * width);
+    fp->row = av_malloc(sizeof(*fp->row) * (width+2*stepsX));
 
     fp = &vf->priv->chromaParam;
-    memset( fp->SC, 0, sizeof( fp->SC ) );
     stepsX = fp->msizeX/2;
     stepsY = fp->msizeY/2;
     for( z=0; z<2*stepsY; z++ )
-	fp->SC[z] = av_malloc(sizeof(*(fp->SC[z])) * (width+2*stepsX));
+	fp->SC[z] = av_malloc(sizeof(*(fp->SC[z])) * width);
+    fp->row = av_malloc(sizeof(*fp->row) * (width+2*stepsX));
 
     return vf_next_config( vf, width, height, d_width, d_height, flags, outfmt );
 }
@@ -161,18 +167,10 @@ static struct mp_image *filter(struct vf_instance *vf, struct mp_image *mpi)
         mp_image_copy_attributes(dmpi, mpi);
     }
 
-    unsharp( dmpi->planes[0], mpi->planes[0], dmpi->stride[0], mpi->stride[0], mpi->w,   mpi->h,   &vf->priv->lumaParam );
-    unsharp( dmpi->planes[1], mpi->planes[1], dmpi->stride[1], mpi->stride[1], mpi->w/2, mpi->h/2, &vf->priv->chromaParam );
-    unsharp( dmpi->planes[2], mpi->planes[2], dmpi->stride[2], mpi->stride[2], mpi->w/2, mpi->h/2, &vf->priv->chromaParam );
-
-#if HAVE_MMX
-    if(gCpuCaps.hasMMX)
-	__asm__ volatile ("emms\n\t");
-#endif
-#if HAVE_MMX2
-    if(gCpuCaps.hasMMX2)
-	__asm__ volatile ("sfence\n\t");
-#endif
+    const struct mp_pixel_kernels *k = vf->priv->kernels;
+    unsharp( dmpi->planes[0], mpi->planes[0], dmpi->stride[0], mpi->stride[0], mpi->w,   mpi->h,   &vf->priv->lumaParam, k );
+    unsharp( dmpi->planes[1], mpi->planes[1], dmpi->stride[1], mpi->stride[1], mpi->w/2, mpi->h/2, &vf->priv->chromaParam, k );
+    unsharp( dmpi->planes[2], mpi->planes[2], dmpi->stride[2], mpi->stride[2], mpi->w/2, mpi->h/2, &vf->priv->chromaParam, k );
 
     if (dmpi != mpi)
         talloc_free(mpi);
@@ -190,11 +188,13 @@ static void uninit( struct vf_instance *vf ) {
 	av_free( fp->SC[z] );
 	fp->SC[z] = NULL;
     }
+    av_freep( &fp->row );
     fp = &vf->priv->chromaParam;
     for( z=0; z<sizeof(fp->SC)/sizeof(fp->SC[0]); z++ ) {
 	av_free( fp->SC[z] );
 	fp->SC[z] = NULL;
     }
+    av_freep( &fp->row );
 }
 
 //===========================================================================//
@@ -227,6 +227,9 @@ static int vf_open( vf_instance_t *vf) {
         return 1;
     }
 
+    p->kernels = mp_get_pixel_kernels();
+    MP_VERBOSE(vf, "Using %s kernels.\n", p->kernels->name);
+
     return 1;
 }
 
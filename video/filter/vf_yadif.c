@@ -33,8 +33,13 @@
 #include "video/mp_image.h"
 #include "vf.h"
 #include "video/memcpy_pic.h"
+#include "misc/thread_pool.h"
 #include "libavutil/common.h"
 
+#if HAVE_X86_INTRINSICS
+#include <immintrin.h>
+#endif
+
 #include "vf_lavfi.h"
 
 //===========================================================================//
@@ -50,6 +55,8 @@ struct vf_priv_s {
     int stride[3];
     uint8_t *ref[4][3];
     int do_deinterlace;
+    int threads;
+    struct mp_thread_pool *pool;
     // for when using the lavfi wrapper
     struct vf_lw_opts *lw_opts;
 };
@@ -299,6 +306,124 @@ static void filter_line_mmx2(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, u
 
 #endif /* HAVE_MMX */
 
+static void filter_line_c(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity);
+
+#if HAVE_X86_INTRINSICS
+
+/* The SSE2 and AVX2 versions share this body. It works on 16 bit lanes (STEP
+ * pixels at a time), and must produce exactly the same output as
+ * filter_line_c(), which also handles the pixels at the end of the line
+ * (TOOLS/simd_check verifies this).
+ * The nested CHECKs of the C version are turned into masks: the second check
+ * in each direction is only applied where the first one succeeded.
+ */
+#define ABSDIFF(a, b) V(max_epi16)(V(sub_epi16)(a, b), V(sub_epi16)(b, a))
+#define AVG(a, b) V(srli_epi16)(V(add_epi16)(a, b), 1)
+#define CHECK(j, mask_in, mask_out) {\
+        VEC s_ = V(add_epi16)(V(add_epi16)(\
+            ABSDIFF(LOAD(&cur[x-refs-1+j]), LOAD(&cur[x+refs-1-j])),\
+            ABSDIFF(LOAD(&cur[x-refs  +j]), LOAD(&cur[x+refs  -j]))),\
+            ABSDIFF(LOAD(&cur[x-refs+1+j]), LOAD(&cur[x+refs+1-j])));\
+        VEC m_ = BLEND(mask_in, V(cmpgt_epi16)(score, s_), zero);\
+        score = BLEND(m_, s_, score);\
+        pred = BLEND(m_, AVG(LOAD(&cur[x-refs+j]), LOAD(&cur[x+refs-j])), pred);\
+        mask_out = m_;\
+    }
+
+#define FILTER_LINE_SIMD \
+    uint8_t *prev2 = parity ? prev : cur;\
+    uint8_t *next2 = parity ? cur  : next;\
+    const VEC zero = SETZERO();\
+    const VEC one = V(set1_epi16)(1);\
+    const VEC all = V(cmpeq_epi16)(zero, zero);\
+    int x;\
+    for (x = 0; x + STEP <= w; x += STEP) {\
+        VEC c = LOAD(&cur[x-refs]);\
+        VEC e = LOAD(&cur[x+refs]);\
+        VEC p2 = LOAD(&prev2[x]);\
+        VEC n2 = LOAD(&next2[x]);\
+        VEC d = AVG(p2, n2);\
+        VEC t1 = V(srli_epi16)(V(add_epi16)(ABSDIFF(LOAD(&prev[x-refs]), c),\
+                                            ABSDIFF(LOAD(&prev[x+refs]), e)), 1);\
+        VEC t2 = V(srli_epi16)(V(add_epi16)(ABSDIFF(LOAD(&next[x-refs]), c),\
+                                            ABSDIFF(LOAD(&next[x+refs]), e)), 1);\
+        VEC diff = V(max_epi16)(V(srli_epi16)(ABSDIFF(p2, n2), 1),\
+                                V(max_epi16)(t1, t2));\
+        VEC pred = AVG(c, e);\
+        VEC score = V(sub_epi16)(V(add_epi16)(V(add_epi16)(\
+            ABSDIFF(LOAD(&cur[x-refs-1]), LOAD(&cur[x+refs-1])),\
+            ABSDIFF(c, e)),\
+            ABSDIFF(LOAD(&cur[x-refs+1]), LOAD(&cur[x+refs+1]))), one);\
+        VEC m;\
+        CHECK(-1, all, m)\
+        CHECK(-2, m, m)\
+        CHECK( 1, all, m)\
+        CHECK( 2, m, m)\
+        if (p->mode < 2) {\
+            VEC b = AVG(LOAD(&prev2[x-2*refs]), LOAD(&next2[x-2*refs]));\
+            VEC f = AVG(LOAD(&prev2[x+2*refs]), LOAD(&next2[x+2*refs]));\
+            VEC de = V(sub_epi16)(d, e), dc = V(sub_epi16)(d, c);\
+            VEC bc = V(sub_epi16)(b, c), fe = V(sub_epi16)(f, e);\
+            VEC max = V(max_epi16)(V(max_epi16)(de, dc), V(min_epi16)(bc, fe));\
+            VEC min = V(min_epi16)(V(min_epi16)(de, dc), V(max_epi16)(bc, fe));\
+            diff = V(max_epi16)(diff, V(max_epi16)(min, V(sub_epi16)(zero, max)));\
+        }\
+        pred = V(max_epi16)(pred, V(sub_epi16)(d, diff));\
+        pred = V(min_epi16)(pred, V(add_epi16)(d, diff));\
+        STORE(&dst[x], pred);\
+    }\
+    if (x < w)\
+        filter_line_c(p, dst + x, prev + x, cur + x, next + x, w - x, refs, parity);
+
+#define VEC __m128i
+#define SETZERO _mm_setzero_si128
+#define STEP 8
+#define V(name) _mm_##name
+#define LOAD(ptr) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(ptr)), zero)
+#define STORE(ptr, v) _mm_storel_epi64((__m128i *)(ptr), _mm_packus_epi16(v, v))
+#define BLEND(m, a, b) _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+
+__attribute__((target("sse2")))
+static void filter_line_sse2(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity){
+    FILTER_LINE_SIMD
+}
+
+#undef VEC
+#undef SETZERO
+#undef STEP
+#undef V
+#undef LOAD
+#undef STORE
+#undef BLEND
+
+#define VEC __m256i
+#define SETZERO _mm256_setzero_si256
+#define STEP 16
+#define V(name) _mm256_##name
+#define LOAD(ptr) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(ptr)))
+#define STORE(ptr, v) _mm_storeu_si128((__m128i *)(ptr), \
+    _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)))
+#define BLEND(m, a, b) _mm256_or_si256(_mm256_and_si256(m, a), _mm256_andnot_si256(m, b))
+
+__attribute__((target("avx2")))
+static void filter_line_avx2(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity){
+    FILTER_LINE_SIMD
+}
+
+#undef VEC
+#undef SETZERO
+#undef STEP
+#undef V
+#undef LOAD
+#undef STORE
+#undef BLEND
+#undef ABSDIFF
+#undef AVG
+#undef CHECK
+#undef FILTER_LINE_SIMD
+
+#endif /* HAVE_X86_INTRINSICS */
+
 static void filter_line_c(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity){
     int x;
     uint8_t *prev2= parity ? prev : cur ;
@@ -358,32 +483,60 @@ static void filter_line_c(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint
     }
 }
 
-static void filter(struct vf_priv_s *p, uint8_t *dst[3], int dst_stride[3], int width, int height, int parity, int tff){
-    int y, i;
+struct filter_args {
+    struct vf_priv_s *p;
+    uint8_t **dst;
+    int *dst_stride;
+    int width, height;
+    int parity, tff;
+    int bands;              // number of row bands per plane
+};
 
-    for(i=0; i<3; i++){
-        int is_chroma= !!i;
-        int w= width >>is_chroma;
-        int h= height>>is_chroma;
-        int refs= p->stride[i];
-
-        for(y=0; y<h; y++){
-            if((y ^ parity) & 1){
-                uint8_t *prev= &p->ref[0][i][y*refs];
-                uint8_t *cur = &p->ref[1][i][y*refs];
-                uint8_t *next= &p->ref[2][i][y*refs];
-                uint8_t *dst2= &dst[i][y*dst_stride[i]];
-                filter_line(p, dst2, prev, cur, next, w, refs, parity ^ tff);
-            }else{
-                memcpy(&dst[i][y*dst_stride[i]], &p->ref[1][i][y*refs], w);
-            }
+// Filter one band of rows of one plane. Bands are independent of each other,
+// so they can run in parallel.
+static void filter_band(void *ctx, int n){
+    struct filter_args *a = ctx;
+    struct vf_priv_s *p = a->p;
+    int i = n / a->bands;
+    int band = n % a->bands;
+    int is_chroma= !!i;
+    int w= a->width >>is_chroma;
+    int h= a->height>>is_chroma;
+    int refs= p->stride[i];
+    int y0= h *  band    / a->bands;
+    int y1= h * (band+1) / a->bands;
+    int y;
+
+    for(y=y0; y<y1; y++){
+        if((y ^ a->parity) & 1){
+            uint8_t *prev= &p->ref[0][i][y*refs];
+            uint8_t *cur = &p->ref[1][i][y*refs];
+            uint8_t *next= &p->ref[2][i][y*refs];
+            uint8_t *dst2= &a->dst[i][y*a->dst_stride[i]];
+            filter_line(p, dst2, prev, cur, next, w, refs, a->parity ^ a->tff);
+        }else{
+            memcpy(&a->dst[i][y*a->dst_stride[i]], &p->ref[1][i][y*refs], w);
         }
     }
 #if HAVE_MMX
-    if(gCpuCaps.hasMMX2) __asm__ volatile("emms \n\t" : : : "memory");
+    if(filter_line == filter_line_mmx2) __asm__ volatile("emms \n\t" : : : "memory");
 #endif
 }
 
+static void filter(struct vf_priv_s *p, uint8_t *dst[3], int dst_stride[3], int width, int height, int parity, int tff){
+    struct filter_args args = {
+        .p = p,
+        .dst = dst,
+        .dst_stride = dst_stride,
+        .width = width,
+        .height = height,
+        .parity = parity,
+        .tff = tff,
+        .bands = mp_thread_pool_get_threads(p->pool),
+    };
+    mp_thread_pool_run(p->pool, filter_band, &args, 3 * args.bands);
+}
+
 static int config(struct vf_instance *vf,
         int width, int height, int d_width, int d_height,
 	unsigned int flags, unsigned int outfmt){
@@ -474,6 +627,9 @@ static void uninit(struct vf_instance *vf){
     int i;
     if(!vf->priv) return;
 
+    talloc_free(vf->priv->pool);
+    vf->priv->pool = NULL;
+
     for(i=0; i<3*3; i++){
         uint8_t **p= &vf->priv->ref[i%3][i/3];
         if(*p) free(*p - 3*vf->priv->stride[i/3]);
@@ -516,6 +672,13 @@ static int vf_open(vf_instance_t *vf){
 #if HAVE_MMX
     if(gCpuCaps.hasMMX2) filter_line = filter_line_mmx2;
 #endif
+#if HAVE_X86_INTRINSICS
+    if(gCpuCaps.hasSSE2) filter_line = filter_line_sse2;
+    if(gCpuCaps.hasAVX2) filter_line = filter_line_avx2;
+#endif
+
+    if (p->threads != 1)
+        p->pool = mp_thread_pool_create(vf, p->threads);
 
     return 1;
 }
@@ -528,6 +691,7 @@ static const m_option_t vf_opts_fields[] = {
                 {"frame-nospatial", 2},
                 {"field-nospatial", 3})),
     OPT_FLAG("enabled", do_deinterlace, 0),
+    OPT_INTRANGE("threads", threads, 0, 0, 64),
     OPT_SUBSTRUCT("", lw_opts, vf_lw_conf, 0),
     {0}
 };
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <setjmp.h>
+#include <pthread.h>
 
 #include <libavcodec/avcodec.h>
 #include <libavutil/mem.h>
@@ -32,9 +33,12 @@
 #endif
 
 #include "osdep/io.h"
+#include "osdep/numcores.h"
 
 #include "image_writer.h"
 #include "talloc.h"
+#include "common/common.h"
+#include "common/msg.h"
 #include "video/img_format.h"
 #include "video/mp_image.h"
 #include "video/fmt-conversion.h"
@@ -117,6 +121,8 @@ static int write_lavc(struct image_writer_ctx *ctx, mp_image_t *image, FILE *fp)
         avctx->prediction_method = ctx->opts->png_filter;
     }
 
+    // Images can be written from several threads (image_writer_queue). This
+    // relies on the lock manager registered in init_libav().
     if (avcodec_open2(avctx, codec, NULL) < 0) {
      print_open_fail:
         MP_ERR(ctx, "Could not open libavcodec encoder for saving images\n");
@@ -314,6 +320,175 @@ int write_image(struct mp_image *image, const struct image_writer_opts *opts,
     return success;
 }
 
+#define MAX_WRITER_THREADS 16
+
+struct image_writer_job {
+    struct mp_image *image;
+    struct image_writer_opts opts;
+    char *filename;
+    bool started;
+};
+
+struct image_writer_queue {
+    struct mp_log *log;
+    pthread_t *threads;
+    int num_threads;
+    int max_queued;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;  // workers wait on this for new jobs
+    pthread_cond_t done;    // add() and flush() wait on this for finished jobs
+    // --- protected by lock
+    bool terminate;
+    struct image_writer_job **jobs; // queued and running jobs, in FIFO order
+    int num_jobs;
+    int errors;
+};
+
+static bool write_job(struct image_writer_queue *q, struct image_writer_job *job)
+{
+    return write_image(job->image, &job->opts, job->filename, q->log);
+}
+
+static void *writer_thread(void *p)
+{
+    struct image_writer_queue *q = p;
+
+    pthread_mutex_lock(&q->lock);
+    while (1) {
+        struct image_writer_job *job = NULL;
+        for (int n = 0; n < q->num_jobs; n++) {
+            if (!q->jobs[n]->started) {
+                job = q->jobs[n];
+                break;
+            }
+        }
+        if (!job) {
+            if (q->terminate)
+                break;
+            pthread_cond_wait(&q->wakeup, &q->lock);
+            continue;
+        }
+        job->started = true;
+        pthread_mutex_unlock(&q->lock);
+        bool ok = write_job(q, job);
+        pthread_mutex_lock(&q->lock);
+        if (!ok)
+            q->errors++;
+        for (int n = 0; n < q->num_jobs; n++) {
+            if (q->jobs[n] == job) {
+                MP_TARRAY_REMOVE_AT(q->jobs, q->num_jobs, n);
+                break;
+            }
+        }
+        talloc_free(job);
+        pthread_cond_broadcast(&q->done);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+static void destroy_queue(void *p)
+{
+    struct image_writer_queue *q = p;
+
+    image_writer_queue_flush(q);
+
+    pthread_mutex_lock(&q->lock);
+    q->terminate = true;
+    pthread_cond_broadcast(&q->wakeup);
+    pthread_mutex_unlock(&q->lock);
+
+    for (int n = 0; n < q->num_threads; n++)
+        pthread_join(q->threads[n], NULL);
+
+    pthread_cond_destroy(&q->wakeup);
+    pthread_cond_destroy(&q->done);
+    pthread_mutex_destroy(&q->lock);
+}
+
+struct image_writer_queue *image_writer_queue_create(void *ta_parent,
+                                                     struct mp_log *log,
+                                                     int threads,
+                                                     int max_queued)
+{
+    if (threads <= 0)
+        threads = default_thread_count();
+    threads = MPCLAMP(threads, 1, MAX_WRITER_THREADS);
+
+    struct image_writer_queue *q = talloc_zero(ta_parent,
+                                               struct image_writer_queue);
+    q->log = log;
+    q->max_queued = max_queued > 0 ? max_queued : 2 * threads;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wakeup, NULL);
+    pthread_cond_init(&q->done, NULL);
+    talloc_set_destructor(q, destroy_queue);
+
+    q->threads = talloc_array(q, pthread_t, threads);
+    for (int n = 0; n < threads; n++) {
+        if (pthread_create(&q->threads[n], NULL, writer_thread, q))
+            break; // run with fewer threads
+        q->num_threads++;
+    }
+    if (!q->num_threads)
+        mp_warn(log, "Could not create image writer threads.\n");
+    return q;
+}
+
+void image_writer_queue_add(struct image_writer_queue *q, struct mp_image *image,
+                            const struct image_writer_opts *opts,
+                            const char *filename)
+{
+    struct image_writer_job *job = talloc_zero(NULL, struct image_writer_job);
+    job->image = talloc_steal(job, mp_image_new_ref(image));
+    job->opts = opts ? *opts : image_writer_opts_defaults;
+    job->opts.format = talloc_strdup(job, job->opts.format);
+    job->filename = talloc_strdup(job, filename);
+
+    if (!q->num_threads) {
+        if (!write_job(q, job))
+            q->errors++;
+        talloc_free(job);
+        return;
+    }
+
+    pthread_mutex_lock(&q->lock);
+    while (q->num_jobs >= q->max_queued)
+        pthread_cond_wait(&q->done, &q->lock);
+    MP_TARRAY_APPEND(q, q->jobs, q->num_jobs, job);
+    pthread_cond_signal(&q->wakeup);
+    pthread_mutex_unlock(&q->lock);
+}
+
+bool image_writer_queue_has_file(struct image_writer_queue *q,
+                                 const char *filename)
+{
+    bool found = false;
+    pthread_mutex_lock(&q->lock);
+    for (int n = 0; n < q->num_jobs; n++)
+        found |= strcmp(q->jobs[n]->filename, filename) == 0;
+    pthread_mutex_unlock(&q->lock);
+    return found;
+}
+
+int image_writer_queue_get_errors(struct image_writer_queue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    int errors = q->errors;
+    q->errors = 0;
+    pthread_mutex_unlock(&q->lock);
+    return errors;
+}
+
+void image_writer_queue_flush(struct image_writer_queue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->num_jobs)
+        pthread_cond_wait(&q->done, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+}
+
 void dump_png(struct mp_image *image, const char *filename, struct mp_log *log)
 {
     struct image_writer_opts opts = image_writer_opts_defaults;
@@ -15,6 +15,8 @@
  * with mplayer.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdbool.h>
+
 struct mp_image;
 struct mp_log;
 
@@ -50,5 +52,35 @@ const char *image_writer_file_ext(const struct image_writer_opts *opts);
 int write_image(struct mp_image *image, const struct image_writer_opts *opts,
                 const char *filename, struct mp_log *log);
 
+// Writes images with write_image() on a set of worker threads.
+struct image_writer_queue;
+
+// threads: number of worker threads (<= 0 for the number of CPUs)
+// max_queued: maximum number of images queued or being written (<= 0 for
+//             twice the number of threads); if the queue is full,
+//             image_writer_queue_add() blocks until an image is done
+// Freeing the queue with talloc_free() waits until all images are written.
+struct image_writer_queue *image_writer_queue_create(void *ta_parent,
+                                                     struct mp_log *log,
+                                                     int threads,
+                                                     int max_queued);
+
+// Queue the image for writing. A new reference to the image is created, and
+// opts and filename are copied, so the caller can free them. Images are
+// written in parallel, so they can finish in a different order.
+void image_writer_queue_add(struct image_writer_queue *q, struct mp_image *image,
+                            const struct image_writer_opts *opts,
+                            const char *filename);
+
+// Whether an image with this filename is queued and not written yet.
+bool image_writer_queue_has_file(struct image_writer_queue *q,
+                                 const char *filename);
+
+// Return the number of images that failed to be written since the last call.
+int image_writer_queue_get_errors(struct image_writer_queue *q);
+
+// Wait until all queued images have been written.
+void image_writer_queue_flush(struct image_writer_queue *q);
+
 // Debugging helper.
 void dump_png(struct mp_image *image, const char *filename, struct mp_log *log);
@@ -635,6 +635,26 @@ static void free_img(void *opaque, uint8_t *data)
 //          other words, it's an optimization).
 struct AVFrame *mp_image_to_av_frame_and_unref(struct mp_image *img)
 {
+    if (img->refcount && img->refcount->free == frame_free) {
+        // img wraps an AVFrame (see mp_image_from_av_frame()), so reference
+        // its buffers directly. This way the AVFrame becomes writeable as soon
+        // as all other references are gone, and no wrappers are needed.
+        AVFrame *src = img->refcount->arg;
+        AVFrame *frame = av_frame_alloc();
+        if (!frame)
+            abort(); // OOM
+        mp_image_copy_fields_to_av_frame(frame, img);
+        for (int n = 0; n < AV_NUM_DATA_POINTERS; n++) {
+            if (src->buf[n]) {
+                frame->buf[n] = av_buffer_ref(src->buf[n]);
+                if (!frame->buf[n])
+                    abort(); // OOM
+            }
+        }
+        talloc_free(img);
+        return frame;
+    }
+
     struct mp_image *new_ref = mp_image_new_ref(img); // ensure it's refcounted
     talloc_free(img);
     AVFrame *frame = av_frame_alloc();
@@ -40,6 +40,7 @@
 #include "options/m_config.h"
 #include "common/msg.h"
 #include "common/global.h"
+#include "common/trace.h"
 #include "video/mp_image.h"
 #include "video/vfcap.h"
 #include "sub/osd.h"
@@ -190,12 +191,19 @@ int vo_control(struct vo *vo, uint32_t request, void *data)
     return vo->driver->control(vo, request, data);
 }
 
+static void draw_image(struct vo *vo, struct mp_image *mpi)
+{
+    struct mp_trace_start t = mp_trace_begin(vo->global->trace);
+    vo->driver->draw_image(vo, mpi);
+    mp_trace_end(vo->global->trace, MP_TRACE_VO_DRAW, t);
+}
+
 void vo_queue_image(struct vo *vo, struct mp_image *mpi)
 {
     if (!vo->config_ok)
         return;
     if (vo->driver->buffer_frames) {
-        vo->driver->draw_image(vo, mpi);
+        draw_image(vo, mpi);
         return;
     }
     vo->frame_loaded = true;
@@ -251,7 +259,7 @@ void vo_new_frame_imminent(struct vo *vo)
         assert(vo->frame_loaded);
         assert(vo->waiting_mpi);
         assert(vo->waiting_mpi->pts == vo->next_pts);
-        vo->driver->draw_image(vo, vo->waiting_mpi);
+        draw_image(vo, vo->waiting_mpi);
         mp_image_unrefp(&vo->waiting_mpi);
     }
 }
@@ -273,10 +281,12 @@ void vo_flip_page(struct vo *vo, int64_t pts_us, int duration)
     }
     vo->want_redraw = false;
     vo->redrawing = false;
+    struct mp_trace_start t = mp_trace_begin(vo->global->trace);
     if (vo->driver->flip_page_timed)
         vo->driver->flip_page_timed(vo, pts_us, duration);
     else
         vo->driver->flip_page(vo);
+    mp_trace_end(vo->global->trace, MP_TRACE_VO_FLIP, t);
     vo->hasframe = true;
 }
 
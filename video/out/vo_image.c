@@ -43,7 +43,9 @@
 struct priv {
     struct image_writer_opts *opts;
     char *outdir;
+    int threads;
 
+    struct image_writer_queue *queue;
     struct mp_image *current;
     int frame;
 };
@@ -114,7 +116,7 @@ static void flip_page(struct vo *vo)
         filename = mp_path_join(t, bstr0(p->outdir), bstr0(filename));
 
     MP_INFO(vo, "Saving %s\n", filename);
-    write_image(p->current, p->opts, filename, vo->log);
+    image_writer_queue_add(p->queue, p->current, p->opts, filename);
 
     talloc_free(t);
     mp_image_unrefp(&p->current);
@@ -132,11 +134,16 @@ static void uninit(struct vo *vo)
     struct priv *p = vo->priv;
 
     mp_image_unrefp(&p->current);
+    talloc_free(p->queue);
 }
 
 static int preinit(struct vo *vo)
 {
+    struct priv *p = vo->priv;
     vo->untimed = true;
+    // Encoding the images is usually slower than decoding. The queue blocks
+    // flip_page() if the writers fall behind.
+    p->queue = image_writer_queue_create(NULL, vo->log, p->threads, 0);
     return 0;
 }
 
@@ -155,6 +162,7 @@ const struct vo_driver video_out_image =
     .options = (const struct m_option[]) {
         OPT_SUBSTRUCT("", opts, image_writer_conf, 0),
         OPT_STRING("outdir", outdir, 0),
+        OPT_INTRANGE("threads", threads, 0, 0, 16),
         {0},
     },
     .preinit = preinit,
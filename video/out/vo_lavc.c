@@ -57,8 +57,25 @@ struct priv {
     int worst_time_base_is_stream;
 
     struct mp_csp_details colorspace;
+
+    // Frames are encoded and written by encode_job() on this queue's thread.
+    // Only buffer, stream and have_first_packet are used there.
+    struct encode_lavc_queue *queue;
+};
+
+struct encode_job {
+    AVFrame *frame;             // NULL: drain the encoder
+    struct mp_image *image;     // owns the frame data
+    int64_t lastipts;           // used for packets without pts
 };
 
+static void free_job(void *p)
+{
+    struct encode_job *job = p;
+    avcodec_free_frame(&job->frame);
+    talloc_free(job->image);
+}
+
 static int preinit(struct vo *vo)
 {
     struct priv *vc;
@@ -84,11 +101,16 @@ static void uninit(struct vo *vo)
     if (vc->lastipts >= 0 && vc->stream)
         draw_image(vo, NULL);
 
+    encode_lavc_queue_destroy(vc->queue);
+    vc->queue = NULL;
+
     mp_image_unrefp(&vc->lastimg);
 
     vo->priv = NULL;
 }
 
+static void encode_job(void *priv, void *item);
+
 static int config(struct vo *vo, uint32_t width, uint32_t height,
                   uint32_t d_width, uint32_t d_height, uint32_t flags,
                   uint32_t format)
@@ -166,6 +188,8 @@ static int config(struct vo *vo, uint32_t width, uint32_t height,
 
     vc->buffer = talloc_size(vc, vc->buffer_size);
 
+    vc->queue = encode_lavc_queue_create(vo->encode_lavc_ctx, vo, encode_job, 4);
+
     mp_image_unrefp(&vc->lastimg);
 
     return 0;
@@ -192,7 +216,8 @@ static int query_format(struct vo *vo, uint32_t format)
             // we don't convert colorspaces here
 }
 
-static void write_packet(struct vo *vo, int size, AVPacket *packet)
+static void write_packet(struct vo *vo, int size, AVPacket *packet,
+                         int64_t lastipts)
 {
     struct priv *vc = vo->priv;
 
@@ -209,7 +234,7 @@ static void write_packet(struct vo *vo, int size, AVPacket *packet)
                                        vc->stream->time_base);
         } else {
             MP_VERBOSE(vo, "codec did not provide pts\n");
-            packet->pts = av_rescale_q(vc->lastipts, vc->worst_time_base,
+            packet->pts = av_rescale_q(lastipts, vc->worst_time_base,
                                        vc->stream->time_base);
         }
         if (packet->dts != AV_NOPTS_VALUE) {
@@ -272,12 +297,36 @@ static int encode_video(struct vo *vo, AVFrame *frame, AVPacket *packet)
     }
 }
 
+// Called on the queue thread.
+static void encode_job(void *priv, void *item)
+{
+    struct vo *vo = priv;
+    struct priv *vc = vo->priv;
+    struct encode_job *job = item;
+    int size;
+
+    do {
+        AVPacket packet;
+        av_init_packet(&packet);
+        packet.data = vc->buffer;
+        packet.size = vc->buffer_size;
+        size = encode_video(vo, job->frame, &packet);
+        write_packet(vo, size, &packet, job->lastipts);
+    } while (!job->frame && size > 0);
+}
+
+static struct encode_job *new_job(int64_t lastipts)
+{
+    struct encode_job *job = talloc_zero(NULL, struct encode_job);
+    talloc_set_destructor(job, free_job);
+    job->lastipts = lastipts;
+    return job;
+}
+
 static void draw_image(struct vo *vo, mp_image_t *mpi)
 {
     struct priv *vc = vo->priv;
     struct encode_lavc_context *ectx = vo->encode_lavc_ctx;
-    int size;
-    AVFrame *frame;
     AVCodecContext *avc;
     int64_t frameipts;
     double nextpts;
@@ -402,12 +451,9 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
     }
 
     if (vc->lastipts != MP_NOPTS_VALUE) {
-        frame = avcodec_alloc_frame();
-
         // we have a valid image in lastimg
         while (vc->lastipts < frameipts) {
             int64_t thisduration = vc->harddup ? 1 : (frameipts - vc->lastipts);
-            AVPacket packet;
 
             // we will ONLY encode this frame if it can be encoded at at least
             // vc->mindeltapts after the last encoded frame!
@@ -419,6 +465,10 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
                 skipframes = 0;
 
             if (thisduration > skipframes) {
+                struct encode_job *job = new_job(vc->lastipts);
+                job->image = mp_image_new_ref(vc->lastimg);
+                job->frame = avcodec_alloc_frame();
+                AVFrame *frame = job->frame;
                 avcodec_get_frame_defaults(frame);
 
                 // this is a nop, unless the worst time base is the STREAM time base
@@ -426,37 +476,25 @@ static void draw_image(struct vo *vo, mp_image_t *mpi)
                                           vc->worst_time_base, avc->time_base);
 
                 enum AVPictureType savetype = frame->pict_type;
-                mp_image_copy_fields_to_av_frame(frame, vc->lastimg);
+                mp_image_copy_fields_to_av_frame(frame, job->image);
                 frame->pict_type = savetype;
                     // keep this at avcodec_get_frame_defaults default
 
                 frame->quality = avc->global_quality;
 
-                av_init_packet(&packet);
-                packet.data = vc->buffer;
-                packet.size = vc->buffer_size;
-                size = encode_video(vo, frame, &packet);
-                write_packet(vo, size, &packet);
+                encode_lavc_queue_add(vc->queue, job);
                 ++vc->lastdisplaycount;
                 vc->lastencodedipts = vc->lastipts + skipframes;
             }
 
             vc->lastipts += thisduration;
         }
-
-        avcodec_free_frame(&frame);
     }
 
     if (!mpi) {
         // finish encoding
-        do {
-            AVPacket packet;
-            av_init_packet(&packet);
-            packet.data = vc->buffer;
-            packet.size = vc->buffer_size;
-            size = encode_video(vo, NULL, &packet);
-            write_packet(vo, size, &packet);
-        } while (size > 0);
+        encode_lavc_queue_add(vc->queue, new_job(vc->lastipts));
+        encode_lavc_queue_flush(vc->queue);
     } else {
         if (frameipts >= vc->lastframeipts) {
             if (vc->lastframeipts != MP_NOPTS_VALUE && vc->lastdisplaycount != 1)
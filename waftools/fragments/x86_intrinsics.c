@@ -0,0 +1,20 @@
+#include <immintrin.h>
+
+__attribute__((target("sse2")))
+static int test_sse2(const unsigned char *p)
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)p);
+    return _mm_movemask_epi8(_mm_max_epu8(a, a));
+}
+
+__attribute__((target("avx2")))
+static int test_avx2(const unsigned char *p)
+{
+    __m256i a = _mm256_loadu_si256((const __m256i *)p);
+    return _mm256_movemask_epi8(_mm256_max_epu8(a, a));
+}
+
+int main(void) {
+    unsigned char buf[32] = {0};
+    return test_sse2(buf) + test_avx2(buf);
+}
@@ -103,11 +103,12 @@ def build(ctx):
         ( "audio/filter/af_channels.c" ),
         ( "audio/filter/af_convert24.c" ),
         ( "audio/filter/af_convertsignendian.c" ),
+        ( "audio/filter/af_convolution.c" ),
         ( "audio/filter/af_delay.c" ),
         ( "audio/filter/af_drc.c" ),
         ( "audio/filter/af_dummy.c" ),
+        ( "audio/filter/af_ebur128.c" ),
         ( "audio/filter/af_equalizer.c" ),
-        ( "audio/filter/af_export.c",            "sys-mman-h" ),
         ( "audio/filter/af_extrastereo.c" ),
         ( "audio/filter/af_format.c" ),
         ( "audio/filter/af_hrtf.c" ),
@@ -122,7 +123,11 @@ def build(ctx):
         ( "audio/filter/af_sub.c" ),
         ( "audio/filter/af_surround.c" ),
         ( "audio/filter/af_sweep.c" ),
+        ( "audio/filter/af_tap.c",               "shm-open" ),
         ( "audio/filter/af_volume.c" ),
+        ( "audio/filter/biquad.c" ),
+        ( "audio/filter/chmix.c" ),
+        ( "audio/filter/fft_conv.c" ),
         ( "audio/filter/filter.c" ),
         ( "audio/filter/tools.c" ),
         ( "audio/filter/window.c" ),
@@ -161,6 +166,7 @@ def build(ctx):
         ( "common/msg.c" ),
         ( "common/playlist.c" ),
         ( "common/playlist_parser.c" ),
+        ( "common/trace.c" ),
         ( "common/version.c" ),
 
         ## Demuxers
@@ -183,12 +189,15 @@ def build(ctx):
         ( "input/cmd_parse.c" ),
         ( "input/event.c" ),
         ( "input/input.c" ),
+        ( "input/ipc.c",                         "posix-select" ),
         ( "input/keycodes.c" ),
         ( "input/joystick.c",                    "joystick" ),
         ( "input/lirc.c",                        "lirc" ),
 
         ## Misc
+        ( "misc/json.c" ),
         ( "misc/ring.c" ),
+        ( "misc/thread_pool.c" ),
         ( "misc/charset_conv.c" ),
 
         ## Options
@@ -202,9 +211,11 @@ def build(ctx):
 
         ## Player
         ( "player/audio.c" ),
+        ( "player/benchmark.c" ),
         ( "player/command.c" ),
         ( "player/configfiles.c" ),
         ( "player/dvdnav.c" ),
+        ( "player/encode_parallel.c",            "encoding" ),
         ( "player/loadfile.c" ),
         ( "player/main.c" ),
         ( "player/misc.c" ),
@@ -213,6 +224,7 @@ def build(ctx):
         ( "player/playloop.c" ),
         ( "player/screenshot.c" ),
         ( "player/sub.c" ),
+        ( "player/thumbnail.c" ),
         ( "player/timeline/tl_cue.c" ),
         ( "player/timeline/tl_mpv_edl.c" ),
         ( "player/timeline/tl_matroska.c" ),
@@ -291,6 +303,7 @@ def build(ctx):
         ( "video/decode/vda.c",                  "vda-hwaccel" ),
         ( "video/decode/vdpau.c",                "vdpau-hwaccel" ),
         ( "video/decode/vdpau_old.c",            "vdpau-decoder" ),
+        ( "video/filter/pixel_kernels.c" ),
         ( "video/filter/pullup.c" ),
         ( "video/filter/vf.c" ),
         ( "video/filter/vf_crop.c" ),
@@ -305,6 +318,7 @@ def build(ctx):
         ( "video/filter/vf_gradfun.c" ),
         ( "video/filter/vf_hqdn3d.c" ),
         ( "video/filter/vf_ilpack.c" ),
+        ( "video/filter/vf_interpolate.c" ),
         ( "video/filter/vf_lavfi.c",             "vf-lavfi"),
         ( "video/filter/vf_mirror.c" ),
         ( "video/filter/vf_noformat.c" ),